@@ -0,0 +1,12 @@
+// Shared by the vertex shaders reading VertexFormat's octahedral normals, included with #include "Common/octahedral.glsl".
+
+// Inverse of VertexEncoder::encodeOctahedral.
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
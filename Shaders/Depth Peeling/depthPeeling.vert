@@ -5,6 +5,7 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
+layout(location = 3) in vec2 octahedralNormal; // compact vertex format, normal then reads as zero
 
 uniform mat4 MVP;
 uniform vec3 diffuseColor;
@@ -14,13 +15,20 @@ out vec3 normalFrag;
 noperspective out vec4 projectedPosition;
 
 
+#include "Common/octahedral.glsl"
+
+vec3 vertexNormal()
+{
+    return dot(normal, normal) > 0.0 ? normal : decodeOctahedral(octahedralNormal);
+}
+
 void main()
 {
     gl_Position = MVP * vec4(position, 1);
     
     projectedPosition = gl_Position;
     diffuseColorFrag = diffuseColor;
-    normalFrag = normal;
+    normalFrag = vertexNormal();
 }
 
 
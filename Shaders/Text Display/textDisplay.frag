@@ -12,9 +12,10 @@ out vec4 color;
 
 void main()
 {
-    vec2 t = textCoords.xy;
-
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, textCoords.xy).r);
-    color = textColor * sampled;
+    //the atlas holds signed distances, 0.5 on the outline; the edge is smoothed over one screen pixel at any scale
+    float distance = texture(text, textCoords.xy).r;
+    float edge = max(fwidth(distance), 0.0001);
+    float coverage = smoothstep(0.5 - edge, 0.5 + edge, distance);
+    color = vec4(textColor.rgb, textColor.a * coverage);
 
 }
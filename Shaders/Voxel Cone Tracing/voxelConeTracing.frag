@@ -5,6 +5,7 @@
 #version 410 core
 
 #define NUM_SAMPLING_RAYS 5
+#define MAX_CONE_STEPS 5
 #define NUM_MIP_MAPS 7
 #define MAX_LIGHTS 1
 
@@ -49,6 +50,11 @@ uniform float   voxelDimensionsInWorldSpace;
 uniform float   coneVariances[NUM_MIP_MAPS];
 uniform uint   numberOfLods;
 
+// Cones and steps traced, fewer under load, indirectScale makes up for the light of the skipped ones.
+uniform uint    numberOfCones;
+uniform uint    coneSteps;
+uniform float   indirectScale;
+
 uniform Material material;
 
 
@@ -59,7 +65,7 @@ float oneOverNumLODs = 1.0f/numberOfLods;
 float distanceBetweenLods = distanceLimit / numberOfLods;
 vec4  albedoLODColors[NUM_MIP_MAPS];
 vec4  normalLODColors[NUM_MIP_MAPS];
-float rayWeight = 1.0f/float(NUM_SAMPLING_RAYS);
+float rayWeight = 1.0f/float(min(numberOfCones, uint(NUM_SAMPLING_RAYS)));
 
 
 in vec3 worldPosition;
@@ -256,7 +262,7 @@ vec4 voxelConeTracing( mat3 rotation,vec3 incomingNormal )
     float step = distanceLimit / 6.0f;
     float ambientStep = distanceLimit /10.0f;
     
-    for(uint i = 0; i < NUM_SAMPLING_RAYS; ++i)
+    for(uint i = 0; i < min(numberOfCones, uint(NUM_SAMPLING_RAYS)); ++i)
     {
         vec3 direction = rotation * samplingRays[i];
         //typically you would want to normalize because rotating a normal does not guarantee that it remains
@@ -271,7 +277,7 @@ vec4 voxelConeTracing( mat3 rotation,vec3 incomingNormal )
         float k = 1.0f;
         int l = 0;
         float m = voxelDimensionsInWorldSpace + voxelDimensionsInWorldSpace * .5f;
-        while(l < 5)
+        while(l < min(int(coneSteps), MAX_CONE_STEPS))
         {
             vec3 worldPos = m * direction + worldPosition;
             ambientOcclusion(direction, m, ambientStep, worldPos, sampleColor);
@@ -286,7 +292,7 @@ vec4 voxelConeTracing( mat3 rotation,vec3 incomingNormal )
 
         }
 
-        ambient.xyz += sampleColor.xyz;
+        ambient.xyz += sampleColor.xyz * indirectScale;
         ambient.a += sampleColor.a * rayWeight;
     }
     
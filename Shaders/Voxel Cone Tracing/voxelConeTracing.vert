@@ -6,8 +6,10 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
+layout(location = 3) in vec2 octahedralNormal; // compact vertex format, normal then reads as zero
 
 uniform mat4 M;
+uniform mat4 N; // inverse transpose of M, from the scene graph
 uniform mat4 V;
 uniform mat4 P;
 
@@ -16,9 +18,16 @@ uniform mat4 P;
 out vec3 worldPosition;
 out vec3 normalFrag;
 
+#include "Common/octahedral.glsl"
+
+vec3 vertexNormal()
+{
+    return dot(normal, normal) > 0.0 ? normal : decodeOctahedral(octahedralNormal);
+}
+
 void main(){
     worldPosition = (  M * vec4(position, 1)).xyz;
     
-    normalFrag = normalize(mat3(transpose(inverse(M))) * normal);
+    normalFrag = normalize(mat3(N) * vertexNormal());
     gl_Position = P * V * M * vec4(position, 1);
 }
@@ -4,6 +4,7 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
+layout(location = 3) in vec2 octahedralNormal; // compact vertex format, normal then reads as zero
 
 uniform mat4 M;
 uniform mat4 V;
@@ -12,8 +13,15 @@ uniform mat4 P;
 out vec3 worldPositionFrag;
 out vec3 normalFrag;
 
+#include "Common/octahedral.glsl"
+
+vec3 vertexNormal()
+{
+    return dot(normal, normal) > 0.0 ? normal : decodeOctahedral(octahedralNormal);
+}
+
 void main(){
 	worldPositionFrag = vec3(M * vec4(position, 1));
-	normalFrag = normalize(mat3(transpose(inverse(M))) * normal);
+	normalFrag = normalize(mat3(transpose(inverse(M))) * vertexNormal());
 	gl_Position = P * V * vec4(worldPositionFrag, 1);
 }
@@ -3,6 +3,7 @@
 // Standard library.
 #include <iostream>
 #include <iomanip>
+#include <cstring>
 #include <time.h>
 
 // External.
@@ -11,10 +12,18 @@
 // Internal.
 #include "Scene/Scene.h"
 #include "Scene/ScenePack.h"
+#include "Scene/SceneGraph.h"
 #include "Graphic/Graphics.h"
+#include "Graphic/GpuProfiler.h"
 #include "Graphic/Material/MaterialStore.h"
+#include "Graphic/Camera/Controllers/InputReplay.h"
 #include "Time/FrameRate.h"
+#include "Time/FrameStats.h"
 #include "Shape/TextQuad.h"
+#include "Utility/AssetLoader.h"
+#include "Utility/JobSystem.h"
+#include "Utility/AllocationTracker.h"
+#include "Utility/CpuProfiler.h"
 
 #define __LOG_INTERVAL 1 /* How often we should log frame rate info to the console. = 0 means don't log. */
 #if __LOG_INTERVAL > 0
@@ -30,6 +39,10 @@ Application & Application::getInstance() {
 }
 
 void Application::init() {
+	//the startup and the first frame are traced, see CpuProfiler
+	CpuProfiler::getInstance().setThreadName("Main");
+	CpuProfiler::getInstance().captureFrames(1, "startup-trace.json");
+	PROFILE_SCOPE("Application::init");
 	std::cout << "Initialization started." << std::endl;
 
 	// -------------------------------------
@@ -145,10 +158,15 @@ void Application::init() {
 void Application::run()
 {
 	std::cout << "Application is now running.\n" << std::endl;
-	std::cout << " :: Use R to switch between rendering modes.\n";
+	std::cout << " :: Use R to switch between rendering modes.\n";
+    std::cout << " :: Use G to export the GPU time of the render passes.\n";
+    std::cout << " :: Use C to trace the CPU work of the next frames.\n";
+    std::cout << " :: Use F5 to start and stop recording the camera, F6 to play the recording and F7 to fly through the scene.\n";
+    std::cout << " :: Use Q to switch lowering the quality to hold the GPU frame time on and off.\n";
 	// std::cout << " :: Use T to switch between interaction modes." << std::endl;
 
 	double smoothedDeltaTimeAccumulator = 0;
+	double lastFrameTime = glfwGetTime();
 #if __LOG_INTERVAL > 0
 	double updateCost = 0;
 	double renderCost = 0;
@@ -156,7 +174,13 @@ void Application::run()
 	double timestampLog = 0;
 #endif
 
-    std::string frameRate = "";
+	//the render thread draws frame N while this thread simulates frame N + 1, see RenderThread
+	renderThread.setRenderFunction([this](RenderThread::Frame& frame) { renderFrame(frame); });
+	if (RENDER_ON_SEPARATE_THREAD)
+	{
+		renderThread.start(currentWindow);
+	}
+
 	// Start the update loop.
 	while (!glfwWindowShouldClose(currentWindow) && !exitQueued)
 	{
@@ -164,12 +188,24 @@ void Application::run()
 		// Update input and timers.
 		// --------------------------------------------------
 		UpdateGlobalInputParameters();
+		JobSystem::getInstance().beginFrame();
+        RenderThread::Frame& frame = renderThread.beginFrame();
 
 		// Update time vals.
 		double currentTime = glfwGetTime();
-		FrameRate::deltaTime = currentTime - FrameRate::time;
-		FrameRate::time = currentTime;
-		FrameRate::framesPerSecond = 1.0 / (FrameRate::deltaTime + 0.0000001);
+		double wallDeltaTime = currentTime - lastFrameTime;
+		lastFrameTime = currentTime;
+		InputReplay& replay = InputReplay::getInstance();
+		if (replay.isDeterministic()) {
+			// Every frame advances the same time, the scene animates as it did while recording.
+			FrameRate::deltaTime = replay.getTimestep();
+			FrameRate::time = replay.getFrame() * replay.getTimestep();
+		}
+		else {
+			FrameRate::deltaTime = wallDeltaTime;
+			FrameRate::time = currentTime;
+		}
+		FrameRate::framesPerSecond = 1.0 / (wallDeltaTime + 0.0000001);
 
 		// --------------------------------------------------
 		// Update world.
@@ -179,7 +215,17 @@ void Application::run()
 			timestampCost = glfwGetTime();
 		}
 #endif
-		if (!paused) scene->update();
+		{
+			PROFILE_SCOPE("Application::run update");
+			double updateStart = glfwGetTime();
+			if (!paused) scene->update();
+			SceneGraph::getInstance().update(); // world and normal matrices of the transforms changed this frame
+			if (!paused && replay.endFrame()) {
+				std::cout << "Replay finished after " << replay.getFrame() << " frames." << std::endl;
+				FrameStats::getInstance().print(std::cout);
+			}
+			FrameStats::getInstance().recordPass("CPU update", (glfwGetTime() - updateStart) * 1000.0);
+		}
 #if __LOG_INTERVAL > 0 
 		{
 			updateCost += glfwGetTime() - timestampCost;
@@ -196,20 +242,79 @@ void Application::run()
 #endif
 		int viewportWidth, viewportHeight;
 		glfwGetWindowSize(currentWindow, &viewportWidth, &viewportHeight);
-		if (!paused) {
-			graphics.render(*scene, viewportWidth, viewportHeight, currentRenderingMode);
-
-		}
+        
+        //the render thread only sees this copy, the scene is free to change while it draws
+        {
+            PROFILE_SCOPE("Application::run snapshot");
+            frame.snapshot.capture(*scene);
+        }
+        frame.renderingMode = currentRenderingMode;
+        frame.viewportWidth = viewportWidth;
+        frame.viewportHeight = viewportHeight;
+        frame.paused = paused;
+        
+        char buf[RenderThread::OverlayLine::MAX_LENGTH];
+        float f = floorf(FrameRate::framesPerSecond * 100.0f)/100.0f;
+        glm::vec2 pos(50.0f, 50.0f);
+        
+        //heap allocations of every thread during the last frame, 0 once the frame's storage is warm
+        AllocationTracker::Counts allocations = AllocationTracker::getInstance().getLastFrame();
+        if(AllocationTracker::isTracking())
+            std::snprintf(buf, sizeof(buf), "Frame Rate: %.2f, %llu heap allocations (%llu bytes) last frame", f,
+                         static_cast<unsigned long long>(allocations.allocations), static_cast<unsigned long long>(allocations.bytes));
+        else
+            std::snprintf(buf, sizeof(buf), "Frame Rate: %.2f", f);
+        frame.addOverlayLine(buf, pos);
+        
+        const JobSystem::Stats& jobs = JobSystem::getInstance().getStats();
+        if(jobs.threads.size() > 1)
+        {
+            std::snprintf(buf, sizeof(buf), "Jobs: %zu on %zu threads, workers %.0f%% busy, %zu stolen", jobs.jobs(), jobs.threads.size(),
+                         jobs.workerUtilization() * 100.0, jobs.steals());
+            frame.addOverlayLine(buf, pos + glm::vec2(0.0f, 90.0f));
+        }
+        
+        size_t pendingLoads = AssetLoader::getInstance().pendingLoads();
+        if(pendingLoads != 0)
+        {
+            std::snprintf(buf, sizeof(buf), "Loading %zu model%s...", pendingLoads, pendingLoads == 1 ? "" : "s");
+            frame.addOverlayLine(buf, pos + glm::vec2(0.0f, 60.0f));
+        }
+        
+        //latency and throughput differ once simulation and rendering overlap, a frame is presented up to two frames after its input
+        RenderThread::Stats presents = renderThread.getStats();
+        if(presents.framesPerSecond > 0.0)
+        {
+            std::snprintf(buf, sizeof(buf), "Latency: %.1f ms, %.1f frames/s presented (render %.1f ms, waiting %.1f ms)", presents.latencySeconds * 1000.0,
+                         presents.framesPerSecond, presents.renderSeconds * 1000.0, presents.waitSeconds * 1000.0);
+            frame.addOverlayLine(buf, pos + glm::vec2(0.0f, 120.0f));
+        }
+        
+        //the spread of the latest frames, an average hides the spikes of e.g. revoxelization
+        FrameStats::Summary frameTimes = FrameStats::getInstance().getRecentFrames();
+        if(frameTimes.count != 0)
+        {
+            std::snprintf(buf, sizeof(buf), "Frame time: p50 %.1f, p95 %.1f, p99 %.1f, max %.1f ms, %zu of %zu over %.1f ms", frameTimes.p50, frameTimes.p95,
+                         frameTimes.p99, frameTimes.max, frameTimes.hitches, frameTimes.count, FrameStats::budgetMilliseconds);
+            frame.addOverlayLine(buf, pos + glm::vec2(0.0f, 150.0f));
+        }
+        
+        //models finished in the background are uploaded with the context, while this thread stays out of the scene
+        {
+            PROFILE_SCOPE("Application::run submit");
+            renderThread.submit([]() { AssetLoader::getInstance().update(); });
+        }
 
 
 		// --------------------------------------------------
-		// Swap buffers and update timers.
+		// Update timers.
 		// --------------------------------------------------
 #if __LOG_INTERVAL > 0
 		{
 			renderCost += glfwGetTime() - timestampCost;
 		}
 #endif
+		JobSystem::getInstance().endFrame(); // every job of the frame is done, its stats are ready
 
         
         // Update frame count.
@@ -221,31 +326,131 @@ void Application::run()
             FrameRate::smoothedDeltaTime = smoothedDeltaTimeAccumulator / FrameRate::smoothedDeltaTimeFrameCount;
             smoothedDeltaTimeAccumulator = 0;
         }
-        
-        glError();
-        
-        char buf[100];
-        float f = floorf(FrameRate::framesPerSecond * 100.0f)/100.0f;
-        static std::string frameRate;
-        
-        std::sprintf(buf, "Frame Rate: %.2f", f);
-        
-        frameRate = buf;
-        glm::vec2 pos(50.0f, 50.0f);
-        text->setScale(.5f);
-        text->print(frameRate, pos);
-        
-		// Swap front and back buffers.
-		if (!paused)
-            glfwSwapBuffers(currentWindow);
 
 		// Poll for and process events.
 		glfwPollEvents();
+		CpuProfiler::getInstance().frameEnded();
+		AllocationTracker::getInstance().frameEnded();
 	}
+
+    //the last frame is drawn and the context is back on this thread
+    renderThread.stop();
+    GpuProfiler::getInstance().clear();
+    FrameStats::getInstance().print(std::cout);
+
+	// Meshes only the store and the loader hold are freed while the context is still there.
+	AssetLoader::getInstance().clear();
+	AssetStore::getInstance().clear();
+
+    //the overlay lines and the atlas own GL objects, so they go before the context
+    overlayText.clear();
+    delete text;
+    text = nullptr;
 
 	glfwDestroyWindow(currentWindow);
 	glfwTerminate();
 	std::cout << "Application has now terminated." << std::endl;
+}
+
+void Application::renderFrame(RenderThread::Frame& frame)
+{
+    PROFILE_SCOPE("Application::renderFrame");
+    if (frame.paused)
+    {
+        lastPresentTime = 0.0; // the pause isn't a frame
+        return;
+    }
+    
+    double renderStart = glfwGetTime();
+    GpuProfiler& profiler = GpuProfiler::getInstance();
+    FrameStats& stats = FrameStats::getInstance();
+    profiler.beginFrame();
+    //on its own thread rendering is a frame loop of its own, its jobs neither hold up nor count in the simulation's frame
+    bool ownJobFrame = renderThread.isRunning();
+    if (ownJobFrame)
+        JobSystem::getInstance().beginFrame();
+    
+    graphics.quality = governor.getQuality();
+    graphics.render(frame.snapshot, frame.viewportWidth, frame.viewportHeight, frame.renderingMode);
+    glError();
+    
+    {
+        GpuProfiler::Scope profileText("Text overlay");
+        //every line keeps its geometry from the last frame, only the ones showing something new are laid out again
+        size_t lines = 0;
+        auto showLine = [this, &lines](const char* line, glm::vec2 position)
+        {
+            if (lines == overlayText.size())
+                overlayText.emplace_back();
+            overlayText[lines++].set(line, position, .5f);
+        };
+        for (RenderThread::OverlayLine& line : frame.overlay)
+            showLine(line.text, line.position);
+    
+        //the culling stats are written by the passes that just ran on this thread
+        const MeshletCuller::Stats& culling = graphics.getConeTracingCullingStats();
+        if(frame.renderingMode == Graphics::RenderingMode::VOXEL_CONE_TRACING && culling.meshlets != 0)
+        {
+            char buf[100];
+            std::snprintf(buf, sizeof(buf), "Meshlets: %zu / %zu (frustum %zu, backface %zu culled)", culling.visible(), culling.meshlets,
+                         culling.frustumCulled, culling.backfaceCulled);
+            showLine(buf, glm::vec2(50.0f, 80.0f));
+        }
+    
+        //GPU time of the passes read back a few frames ago, indented by nesting, and their p99 over the run
+        static std::vector<GpuProfiler::Pass> passes;
+        static std::vector<FrameStats::Summary> passStats;
+        unsigned long long gpuFrame = 0;
+        profiler.getPasses(passes, &gpuFrame);
+        if (gpuFrame != lastGpuFrame)
+        {
+            for (const GpuProfiler::Pass& pass : passes)
+            {
+                stats.recordPass(pass.name, pass.milliseconds);
+                //its levers only act on voxelization and cone tracing, the other modes would take it to the bottom for nothing
+                if (pass.depth == 0 && frame.renderingMode == Graphics::RenderingMode::VOXEL_CONE_TRACING)
+                    governor.recordFrame(pass.milliseconds);
+            }
+            lastGpuFrame = gpuFrame;
+        }
+        stats.getPasses(passStats);
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            char buf[100];
+            double p99 = 0.0;
+            for (const FrameStats::Summary& summary : passStats)
+            {
+                if (strcmp(summary.name, passes[i].name) == 0)
+                    p99 = summary.p99;
+            }
+            std::snprintf(buf, sizeof(buf), "GPU %s: %.2f ms (p99 %.2f)", passes[i].name, passes[i].averageMilliseconds, p99);
+            showLine(buf, glm::vec2(50.0f + 20.0f * passes[i].depth, 230.0f + 25.0f * i));
+        }
+        
+        const Graphics::Quality& quality = graphics.quality;
+        char buf[160];
+        if (governor.enabled)
+            std::snprintf(buf, sizeof(buf), "Quality: level %zu of %zu, render scale %.2f, %u cones of %u steps, voxelization every %u frames", governor.getLevel(),
+                         governor.getLevels() - 1, quality.renderScale, quality.cones, quality.coneSteps, quality.voxelizationInterval);
+        else
+            std::snprintf(buf, sizeof(buf), "Quality: full, Q lowers it to hold %.1f ms of GPU time", QualityGovernor::targetMilliseconds);
+        showLine(buf, glm::vec2(50.0f, 230.0f + 25.0f * passes.size()));
+        text->draw(overlayText.data(), lines);
+    }
+    
+    if (ownJobFrame)
+        JobSystem::getInstance().endFrame();
+    profiler.endFrame();
+    stats.recordPass("CPU render", (glfwGetTime() - renderStart) * 1000.0);
+    
+    // Swap front and back buffers.
+    glfwSwapBuffers(currentWindow);
+    
+    //present to present, what the screen shows, see FrameStats
+    double presentTime = glfwGetTime();
+    if (lastPresentTime > 0.0)
+        stats.recordFrame((presentTime - lastPresentTime) * 1000.0);
+    lastPresentTime = presentTime;
 }
 
 void Application::UpdateGlobalInputParameters() {
@@ -300,6 +505,7 @@ void Application::SetWindowMode(int quadWidth, int quadHeight, bool fullscreen =
 
 Application::~Application() {
 	delete scene;
+    overlayText.clear();
     delete text;
 }
 
@@ -354,6 +560,48 @@ void Application::GLFWKeyCallback(GLFWwindow * window, int key, int scanmode, in
 			glfwSetCursorPos(window, xwidth / 2, yheight / 2); // Reset mouse position for next update iteration.
 		}
 
+        // Trace the CPU work of the next frames.
+        if (key == GLFW_KEY_C) {
+            CpuProfiler::getInstance().captureFrames(5, "frame-trace.json");
+        }
+
+        // Export the GPU pass times of the last frames.
+        if (key == GLFW_KEY_G) {
+            bool written = GpuProfiler::getInstance().writeCsv("gpu-profile.csv");
+            written &= GpuProfiler::getInstance().writeJson("gpu-profile.json");
+            std::cout << (written ? "GPU profile written to gpu-profile.csv and gpu-profile.json." : "Failed writing the GPU profile.") << std::endl;
+        }
+
+        // Record the camera until pressed again.
+        InputReplay& replay = InputReplay::getInstance();
+        if (key == GLFW_KEY_F5) {
+            if (replay.getMode() == InputReplay::Mode::RECORDING) {
+                size_t frames = replay.getFrame();
+                bool written = replay.stopRecording(app.REPLAY_FILE);
+                std::cout << (written ? "Recorded " : "Failed writing ") << frames << " frames to " << app.REPLAY_FILE << "." << std::endl;
+            }
+            else if (!replay.isDeterministic()) {
+                replay.startRecording(*app.scene->renderingCamera);
+                std::cout << "Recording the camera, press F5 to stop." << std::endl;
+            }
+        }
+
+        // Play the recording or the scene's fly-through, the frame times of it are printed at the end.
+        if (key == GLFW_KEY_F6 || key == GLFW_KEY_F7) {
+            replay.stop();
+            bool started = key == GLFW_KEY_F6 ? replay.startPlayback(app.REPLAY_FILE) : replay.startFlyThrough(app.scene->getFlyThrough());
+            if (started)
+                FrameStats::getInstance().reset();
+            else
+                std::cout << (key == GLFW_KEY_F6 ? "Can't read " + std::string(app.REPLAY_FILE) + "." : std::string("The scene has no fly-through.")) << std::endl;
+        }
+
+        // Lower the quality under load or keep it full.
+        if (key == GLFW_KEY_Q) {
+            app.governor.enabled = !app.governor.enabled;
+            std::cout << "Quality governor " << (app.governor.enabled ? "on" : "off") << "." << std::endl;
+        }
+
 		// Pause / unpause.
 		if (key == GLFW_KEY_P) {
 			app.paused = !app.paused;
@@ -3,9 +3,11 @@
 #pragma once
 
 #include "Graphic/Graphics.h"
+#include "Graphic/QualityGovernor.h"
+#include "Graphic/RenderThread.h"
+#include "Shape/TextQuad.h"
 #include <string>
 
-class TextQuad;
 class Scene;
 class PointLight;
 class MeshRenderer;
@@ -24,6 +26,8 @@ public:
     const char * DEFAULT_TITLE = "Voxel Cone Tracing by Rafael Sabino";
     const unsigned int DEFAULT_FULLSCREEN = 0; // 0 is window, 1 is fullscreen, 2 is borderless fullscreen.
     const int DEFAULT_VSYNC = 1; // 0 is no vSync, can also use negative vSync (check GLFW docs).
+    const bool RENDER_ON_SEPARATE_THREAD = true; // false records the GL commands on the main thread after simulating, one frame at a time.
+    const char * REPLAY_FILE = "camera-recording.bin"; // written by F5, played by F6, see InputReplay
     
     int state = 0; // Used to simplify debugging. Sent to all shaders continuously.
     Graphics::RenderingMode currentRenderingMode = Graphics::RenderingMode::VOXEL_CONE_TRACING;
@@ -35,7 +39,7 @@ public:
     bool exitQueued = false;
     
     /// <summary> The currently opened window. </summary>
-    GLFWwindow * currentWindow;
+    GLFWwindow * currentWindow = nullptr;
     
     /// <summary> The scene to update and render. </summary>
     Scene * scene;
@@ -43,6 +47,12 @@ public:
     /// <summary> The graphical context that is used for rendering the current scene. </summary>
     Graphics graphics;
     
+    /// <summary> Owns the GL context while running and renders the snapshots of the scene. </summary>
+    RenderThread renderThread;
+    
+    /// <summary> Lowers Graphics::quality while the GPU is over its target, fed and read on the render thread. Q switches it. </summary>
+    QualityGovernor governor;
+    
     /// <summary> Returns the application instance (which is a singleton). </summary>
     static Application & getInstance();
     
@@ -83,9 +93,13 @@ private:
     // --- Other ---
     int previous_state_x, previous_state_z; // For testing.
     void UpdateGlobalInputParameters();
+    void renderFrame(RenderThread::Frame& frame); // on the render thread
+    double lastPresentTime = 0.0; // glfwGetTime of the last swap, 0 after a pause
+    unsigned long long lastGpuFrame = 0; // the GpuProfiler frame whose passes went to FrameStats
     bool initialized = false;
     Application(); // Make sure constructor is private to prevent instantiating outside of singleton pattern.
     static void OnWindowResize(GLFWwindow * window, int quadWidth, int quadHeight);
     
     TextQuad* text = nullptr;
+    std::vector<TextQuad::Line> overlayText; // by line of the overlay, grown to the most lines shown at once
 };
@@ -0,0 +1,44 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+
+namespace
+{
+    //uniform Catmull-Rom through p1 and p2, p0 and p3 shape the tangents
+    glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+    {
+        float t2 = t * t, t3 = t2 * t;
+        return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+}
+
+void CameraPath::evaluate(double seconds, glm::vec3& position, glm::vec3& forward) const
+{
+    if(keys.empty())
+        return;
+
+    glm::vec3 target;
+    if(keys.size() == 1 || seconds <= keys.front().seconds)
+    {
+        position = keys.front().position;
+        target = keys.front().target;
+    }
+    else if(seconds >= keys.back().seconds)
+    {
+        position = keys.back().position;
+        target = keys.back().target;
+    }
+    else
+    {
+        size_t next = std::upper_bound(keys.begin(), keys.end(), seconds, [](double value, const Key& key) { return value < key.seconds; }) - keys.begin();
+        size_t i1 = next - 1, i2 = next;
+        size_t i0 = i1 == 0 ? 0 : i1 - 1, i3 = std::min(i2 + 1, keys.size() - 1);
+        float t = static_cast<float>((seconds - keys[i1].seconds) / (keys[i2].seconds - keys[i1].seconds));
+        position = catmullRom(keys[i0].position, keys[i1].position, keys[i2].position, keys[i3].position, t);
+        target = catmullRom(keys[i0].target, keys[i1].target, keys[i2].target, keys[i3].target, t);
+    }
+
+    glm::vec3 direction = target - position;
+    if(glm::dot(direction, direction) > 1e-12f)
+        forward = glm::normalize(direction);
+}
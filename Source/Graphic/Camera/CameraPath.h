@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/// <summary>
+/// A camera flight through keys, positions and look at targets are interpolated with Catmull-Rom splines so the camera
+/// moves without jerks at the keys. Used for the fly-throughs of the scenes, see Scene::getFlyThrough.
+/// </summary>
+class CameraPath
+{
+public:
+    struct Key
+    {
+        double seconds;
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    /// <summary> By increasing time, the first at 0. </summary>
+    std::vector<Key> keys;
+
+    inline bool empty() const { return keys.empty(); }
+    inline double getDuration() const { return keys.empty() ? 0.0 : keys.back().seconds; }
+
+    /// <summary> Camera position and normalized direction at seconds, clamped to the path. </summary>
+    void evaluate(double seconds, glm::vec3& position, glm::vec3& forward) const;
+};
@@ -7,36 +7,75 @@
 //
 
 #include "Graphic/Camera/Controllers/FirstPersonController.h"
+#include "Graphic/Camera/Controllers/InputReplay.h"
 
 
 void FirstPersonController::update() {
     
-    auto & app = Application::getInstance();
+    InputReplay & replay = InputReplay::getInstance();
+    auto * camera = renderingCamera;
     
-    double xpos, ypos;
-    double xmid, ymid;
-    GLFWwindow * window = Application::getInstance().currentWindow;
-
-    glfwGetCursorPos(window, &xpos, &ypos);
+    // A recording, playback or fly-through started or ended, start over from the camera.
+    if (replay.getSession() != session) {
+        session = replay.getSession();
+        if (replay.getMode() == InputReplay::Mode::PLAYBACK)
+            replay.getStartCamera(camera->position, camera->forward);
+        firstUpdate = true;
+    }
     
-    if (firstUpdate) {
-        targetCamera->forward = renderingCamera->forward;
-        targetCamera->position = renderingCamera->position;
-        firstUpdate = false;
-
+    if (replay.getMode() == InputReplay::Mode::FLY_THROUGH) {
+        replay.getFlyThroughCamera(camera->position, camera->forward);
+        camera->updateViewMatrix();
+        return;
+    }
+    
+    // ----------
+    // Input.
+    // ----------
+    InputReplay::Input input;
+    if (replay.getMode() == InputReplay::Mode::PLAYBACK) {
+        if (!replay.getInput(input)) return;
+    }
+    else {
+        GLFWwindow * window = Application::getInstance().currentWindow;
+        if (window == nullptr) return; // headless, nothing to read input from
+        
+        double xpos, ypos;
+        glfwGetCursorPos(window, &xpos, &ypos);
+        if (firstUpdate) {
+            mouseXStart = xpos;
+            mouseYStart = ypos;
+        }
+        input.cursorX = static_cast<float>(mouseXStart - xpos);
+        input.cursorY = static_cast<float>(mouseYStart - ypos);
+        
+        // Reset mouse position for next update iteration.
+        //glfwSetCursorPos(window, xwidth / 2, yheight / 2);
         mouseXStart = xpos;
         mouseYStart = ypos;
+        
+        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+            input.keys |= InputReplay::FORWARD;
+        if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+            input.keys |= InputReplay::BACKWARD;
+        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+            input.keys |= InputReplay::RIGHT;
+        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+            input.keys |= InputReplay::LEFT;
+    }
+    
+    if (firstUpdate) {
+        targetCamera->forward = camera->forward;
+        targetCamera->position = camera->position;
+        firstUpdate = false;
     }
     
     // ----------
     // Rotation.
     // ----------
-
-    float xDelta = mouseXStart - xpos;
-    float yDelta = mouseYStart - ypos;
     
-    float xRot = static_cast<float>(CAMERA_ROTATION_SPEED * xDelta);
-    float yRot = static_cast<float>(CAMERA_ROTATION_SPEED * yDelta);
+    float xRot = static_cast<float>(CAMERA_ROTATION_SPEED * input.cursorX);
+    float yRot = static_cast<float>(CAMERA_ROTATION_SPEED * input.cursorY);
     
     // X rotation.
 
@@ -53,24 +92,23 @@ void FirstPersonController::update() {
     // Position.
     // ----------
     // Move forward.
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.keys & InputReplay::FORWARD) {
         targetCamera->position += targetCamera->front() * (float)FrameRate::deltaTime * CAMERA_SPEED;
     }
     // Move backward.
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.keys & InputReplay::BACKWARD) {
         targetCamera->position -= targetCamera->front() * (float)FrameRate::deltaTime * CAMERA_SPEED;
     }
     // Strafe right.
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.keys & InputReplay::RIGHT) {
         targetCamera->position += targetCamera->right() * (float)FrameRate::deltaTime * CAMERA_SPEED;
     }
     // Strafe left.
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.keys & InputReplay::LEFT) {
         targetCamera->position -= targetCamera->right() * (float)FrameRate::deltaTime * CAMERA_SPEED;
     }
     
     // Interpolate between target and current camera.
-    auto * camera = renderingCamera;
     float rotationInterpolation= glm::clamp(FrameRate::deltaTime * CAMERA_ROTATION_INTERPOLATION_SPEED, 0.0, 1.0);
     float positionInterpolation = glm::clamp(FrameRate::deltaTime * CAMERA_POSITION_INTERPOLATION_SPEED, 0.0, 1.0);
     
@@ -78,11 +116,8 @@ void FirstPersonController::update() {
     camera->forward = mix(camera->forward, targetCamera->front(), rotationInterpolation);
     camera->position = mix(camera->position, targetCamera->position, positionInterpolation);
     
-    // Reset mouse position for next update iteration.
-    //glfwSetCursorPos(window, xwidth / 2, yheight / 2);
-    mouseXStart = xpos;
-    mouseYStart = ypos;
-    
     // Update view (camera) matrix.
     camera->updateViewMatrix();
+    
+    replay.recordFrame(input, camera->position, camera->forward);
 }
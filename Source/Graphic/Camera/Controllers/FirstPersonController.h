@@ -31,6 +31,7 @@ public:
     void update();
 private:
 	bool firstUpdate = true;
+	unsigned int session = 0; // InputReplay::getSession() at the last update
     
     const float CAMERA_SPEED = 1.4f;
     const float CAMERA_ROTATION_SPEED = 0.003f;
@@ -0,0 +1,201 @@
+#include "InputReplay.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Graphic/Camera/Camera.h"
+
+double InputReplay::fixedTimestep = 1.0 / 60.0;
+
+static const char FILE_MAGIC[4] = { 'V', 'C', 'T', 'I' };
+static const uint32_t FILE_VERSION = 1;
+static const size_t HEADER_BYTES = 4 + 4 + 8 + 4 + 12 + 12;
+static const size_t FRAME_BYTES = 4 + 4 + 1 + 12 + 12;
+
+//cameras further apart than this, in world units, mean the playback doesn't follow the recording anymore
+static const float DIVERGENCE = 1e-3f;
+
+InputReplay& InputReplay::getInstance()
+{
+    static InputReplay replay;
+    return replay;
+}
+
+void InputReplay::start(Mode newMode)
+{
+    mode = newMode;
+    frame = 0;
+    diverged = false;
+    ++session;
+}
+
+void InputReplay::startRecording(const Camera& camera)
+{
+    frames.clear();
+    startPosition = camera.position;
+    startForward = camera.forward;
+    timestep = fixedTimestep;
+    start(Mode::RECORDING);
+}
+
+bool InputReplay::stopRecording(const std::string& path)
+{
+    if(mode != Mode::RECORDING)
+        return false;
+
+    bool written = writeFile(path);
+    stop();
+    return written;
+}
+
+bool InputReplay::startPlayback(const std::string& path)
+{
+    if(!readFile(path) || frames.empty())
+    {
+        stop();
+        return false;
+    }
+    start(Mode::PLAYBACK);
+    return true;
+}
+
+bool InputReplay::startFlyThrough(const CameraPath& path)
+{
+    if(path.empty())
+        return false;
+
+    flyThrough = path;
+    timestep = fixedTimestep;
+    start(Mode::FLY_THROUGH);
+    return true;
+}
+
+void InputReplay::stop()
+{
+    if(mode == Mode::LIVE)
+        return;
+
+    mode = Mode::LIVE;
+    frames.clear();
+    ++session;
+}
+
+size_t InputReplay::getLength() const
+{
+    if(mode == Mode::PLAYBACK)
+        return frames.size();
+    if(mode == Mode::FLY_THROUGH)
+        return static_cast<size_t>(flyThrough.getDuration() / timestep) + 1;
+    return 0;
+}
+
+void InputReplay::getStartCamera(glm::vec3& position, glm::vec3& forward) const
+{
+    position = startPosition;
+    forward = startForward;
+}
+
+bool InputReplay::getInput(Input& input) const
+{
+    if(mode != Mode::PLAYBACK || frame >= frames.size())
+        return false;
+
+    input = frames[frame].input;
+    return true;
+}
+
+void InputReplay::getFlyThroughCamera(glm::vec3& position, glm::vec3& forward) const
+{
+    flyThrough.evaluate(frame * timestep, position, forward);
+}
+
+void InputReplay::recordFrame(const Input& input, const glm::vec3& position, const glm::vec3& forward)
+{
+    if(mode == Mode::RECORDING)
+    {
+        frames.push_back({ input, position, forward });
+    }
+    else if(mode == Mode::PLAYBACK && frame < frames.size() && !diverged)
+    {
+        const Frame& recorded = frames[frame];
+        if(glm::distance(recorded.position, position) > DIVERGENCE || glm::distance(recorded.forward, forward) > DIVERGENCE)
+        {
+            std::cout << "Playback differs from the recording from frame " << frame << " on." << std::endl;
+            diverged = true;
+        }
+    }
+}
+
+bool InputReplay::endFrame()
+{
+    if(mode == Mode::LIVE)
+        return false;
+
+    ++frame;
+    bool ended = (mode == Mode::PLAYBACK && frame >= frames.size()) ||
+                 (mode == Mode::FLY_THROUGH && frame * timestep > flyThrough.getDuration());
+    if(ended)
+        stop();
+    return ended;
+}
+
+//magic, version, timestep, frame count, start position and forward, then per frame cursor x and y, keys, position and forward
+bool InputReplay::writeFile(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    auto write = [&](const void* data, size_t size) { file.write(static_cast<const char*>(data), size); };
+    uint32_t count = static_cast<uint32_t>(frames.size());
+    write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    write(&FILE_VERSION, sizeof(FILE_VERSION));
+    write(&timestep, sizeof(timestep));
+    write(&count, sizeof(count));
+    write(&startPosition[0], sizeof(float) * 3);
+    write(&startForward[0], sizeof(float) * 3);
+    for(const Frame& recorded : frames)
+    {
+        write(&recorded.input.cursorX, sizeof(float));
+        write(&recorded.input.cursorY, sizeof(float));
+        write(&recorded.input.keys, sizeof(uint8_t));
+        write(&recorded.position[0], sizeof(float) * 3);
+        write(&recorded.forward[0], sizeof(float) * 3);
+    }
+    return static_cast<bool>(file);
+}
+
+bool InputReplay::readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+        return false;
+    size_t bytes = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    auto read = [&](void* data, size_t size) { return static_cast<bool>(file.read(static_cast<char*>(data), size)); };
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    double seconds = 0.0;
+    if(!read(magic, sizeof(magic)) || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 || !read(&version, sizeof(version)) ||
+       version != FILE_VERSION || !read(&seconds, sizeof(seconds)) || !(seconds > 0.0) || !read(&count, sizeof(count)) ||
+       !read(&startPosition[0], sizeof(float) * 3) || !read(&startForward[0], sizeof(float) * 3))
+        return false;
+    if(bytes < HEADER_BYTES + size_t(count) * FRAME_BYTES)
+        return false;
+
+    frames.resize(count);
+    for(Frame& recorded : frames)
+    {
+        if(!read(&recorded.input.cursorX, sizeof(float)) || !read(&recorded.input.cursorY, sizeof(float)) ||
+           !read(&recorded.input.keys, sizeof(uint8_t)) || !read(&recorded.position[0], sizeof(float) * 3) ||
+           !read(&recorded.forward[0], sizeof(float) * 3))
+        {
+            frames.clear();
+            return false;
+        }
+    }
+    timestep = seconds;
+    return true;
+}
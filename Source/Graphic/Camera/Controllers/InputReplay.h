@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Graphic/Camera/CameraPath.h"
+
+class Camera;
+
+/// <summary>
+/// Records what FirstPersonController reads each frame and the camera it makes of it, and plays it back, so runs of
+/// the same recording see the same views. Recording, playback and fly-throughs advance the simulation by a fixed
+/// timestep per frame instead of the wall clock, and FrameRate::time starts at 0 with them.
+/// A recording is a 44 byte header and 33 bytes per frame, see writeFile.
+/// </summary>
+class InputReplay
+{
+public:
+    enum class Mode { LIVE, RECORDING, PLAYBACK, FLY_THROUGH };
+
+    enum Keys : uint8_t { FORWARD = 1, BACKWARD = 2, RIGHT = 4, LEFT = 8 };
+
+    struct Input
+    {
+        float cursorX = 0.0f, cursorY = 0.0f; // cursor movement since the last frame, pixels
+        uint8_t keys = 0; // Keys held
+    };
+
+    static InputReplay& getInstance();
+
+    /// <summary> Seconds a frame advances the simulation while recording and flying through. </summary>
+    static double fixedTimestep;
+
+    inline Mode getMode() const { return mode; }
+
+    /// <summary> Seconds per frame while not live, a playback uses the timestep it was recorded with. </summary>
+    inline double getTimestep() const { return timestep; }
+    inline bool isDeterministic() const { return mode != Mode::LIVE; }
+
+    /// <summary> Frames since the recording, playback or fly-through started. </summary>
+    inline size_t getFrame() const { return frame; }
+
+    /// <summary> Frames the playback or fly-through lasts, 0 while live or recording. </summary>
+    size_t getLength() const;
+
+    /// <summary> Changes whenever a mode starts or ends, the controller starts over from the camera then. </summary>
+    inline unsigned int getSession() const { return session; }
+
+    /// <summary> Records from camera on, until stopRecording. </summary>
+    void startRecording(const Camera& camera);
+
+    /// <summary> Writes the frames recorded so far to path and goes back to live input. False if path can't be written. </summary>
+    bool stopRecording(const std::string& path);
+
+    /// <summary> Plays the recording at path from its first frame. False if it can't be read. </summary>
+    bool startPlayback(const std::string& path);
+
+    /// <summary> Moves the camera along path, false for an empty path. </summary>
+    bool startFlyThrough(const CameraPath& path);
+
+    /// <summary> Back to live input, a recording in progress is dropped. </summary>
+    void stop();
+
+    /// <summary> Camera at the start of the playback. </summary>
+    void getStartCamera(glm::vec3& position, glm::vec3& forward) const;
+
+    /// <summary> The recorded input of the current frame while playing back. </summary>
+    bool getInput(Input& input) const;
+
+    /// <summary> The camera of the current frame while flying through. </summary>
+    void getFlyThroughCamera(glm::vec3& position, glm::vec3& forward) const;
+
+    /// <summary>
+    /// Called by the controller with the input it used and the camera it made of it. Recording keeps them, playback
+    /// compares the camera to the recording and reports the first frame it differs, e.g. after the controller changed.
+    /// </summary>
+    void recordFrame(const Input& input, const glm::vec3& position, const glm::vec3& forward);
+
+    /// <summary> Advances to the next frame after the scene updated. True on the frame a playback or fly-through ended. </summary>
+    bool endFrame();
+
+private:
+    struct Frame
+    {
+        Input input;
+        glm::vec3 position;
+        glm::vec3 forward;
+    };
+
+    InputReplay() {}
+    InputReplay(const InputReplay&) = delete;
+    InputReplay& operator=(const InputReplay&) = delete;
+
+    void start(Mode newMode);
+    bool writeFile(const std::string& path) const;
+    bool readFile(const std::string& path);
+
+    Mode mode = Mode::LIVE;
+    size_t frame = 0;
+    unsigned int session = 0;
+    bool diverged = false;
+
+    glm::vec3 startPosition, startForward;
+    double timestep = fixedTimestep;
+    std::vector<Frame> frames;
+    CameraPath flyThrough;
+};
@@ -98,6 +98,11 @@ protected:
     
 };
 
+int FBO::getFrameBufferID()
+{
+    return frameBuffer;
+}
+
 const Texture::Dimensions& FBO::getDimensions()
 {
     return dimensions;
@@ -0,0 +1,271 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+size_t GpuProfiler::historyFrames = 600;
+
+static const size_t NOT_RECORDED = size_t(-1);
+
+//passes every history slot has room for from the start, a frame with more grows its slot once
+static const size_t RESERVED_PASSES = 32;
+
+GpuProfiler::Scope::Scope(const char* name)
+{
+    index = GpuProfiler::getInstance().begin(name);
+}
+
+GpuProfiler::Scope::~Scope()
+{
+    GpuProfiler::getInstance().end(index);
+}
+
+GpuProfiler& GpuProfiler::getInstance()
+{
+    static GpuProfiler profiler;
+    return profiler;
+}
+
+void GpuProfiler::beginFrame()
+{
+    current = (current + 1) % FRAMES_IN_FLIGHT;
+    Frame& frame = frames[current];
+    if(frame.recorded)
+        resolve(frame);
+
+    frame.used = 0;
+    frame.recorded = false;
+    frame.number = frameNumber++;
+    depth = 0;
+    recording = enabled;
+    if(recording)
+        begin("Frame");
+}
+
+void GpuProfiler::endFrame()
+{
+    if(!recording)
+        return;
+
+    end(0);
+    recording = false;
+    frames[current].recorded = true;
+}
+
+size_t GpuProfiler::begin(const char* name)
+{
+    if(!recording)
+        return NOT_RECORDED;
+
+    Frame& frame = frames[current];
+    if(frame.used == frame.queries.size())
+    {
+        Query query;
+        GLuint ids[2];
+        glGenQueries(2, ids);
+        query.begin = ids[0];
+        query.end = ids[1];
+        frame.queries.push_back(query);
+    }
+
+    Query& query = frame.queries[frame.used];
+    query.name = name;
+    query.depth = depth++;
+    glQueryCounter(query.begin, GL_TIMESTAMP);
+    return frame.used++;
+}
+
+void GpuProfiler::end(size_t index)
+{
+    if(!recording || index == NOT_RECORDED)
+        return;
+
+    glQueryCounter(frames[current].queries[index].end, GL_TIMESTAMP);
+    --depth;
+}
+
+void GpuProfiler::resolve(Frame& frame)
+{
+    //the frame's first query ends last, once it is available all are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!available)
+    {
+        ++droppedFrames;
+        return;
+    }
+
+    previousPasses.swap(passes);
+    passes.clear();
+    passesFrame = frame.number;
+    for(size_t i = 0; i < frame.used; ++i)
+    {
+        const Query& query = frame.queries[i];
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+        double milliseconds = double(end - begin) / 1000000.0;
+
+        //a pass run several times in the frame, e.g. once per voxelization axis, counts once
+        //by its text, the same literal in two translation units can have two addresses
+        Pass* pass = nullptr;
+        for(Pass& existing : passes)
+        {
+            if(existing.depth == query.depth && strcmp(existing.name, query.name) == 0)
+                pass = &existing;
+        }
+        if(pass == nullptr)
+        {
+            passes.emplace_back();
+            pass = &passes.back();
+            pass->name = query.name;
+            pass->depth = query.depth;
+        }
+        pass->milliseconds += milliseconds;
+    }
+
+    for(Pass& pass : passes)
+    {
+        pass.averageMilliseconds = pass.milliseconds;
+        for(const Pass& old : previousPasses)
+        {
+            if(old.depth == pass.depth && strcmp(old.name, pass.name) == 0)
+                pass.averageMilliseconds = old.averageMilliseconds * 0.9 + pass.milliseconds * 0.1;
+        }
+    }
+
+    fitHistory();
+    if(history.empty())
+        return;
+    FrameTimes& slot = history[historyNext];
+    slot.number = frame.number;
+    slot.passes.assign(passes.begin(), passes.end());
+    historyNext = (historyNext + 1) % history.size();
+    historyCount = std::min(historyCount + 1, history.size());
+}
+
+void GpuProfiler::fitHistory()
+{
+    if(history.size() == historyFrames)
+        return;
+
+    //the newest frames move to the front of the new ring, the slots after them get their storage now
+    std::vector<FrameTimes> resized(historyFrames);
+    size_t kept = std::min(historyCount, historyFrames);
+    for(size_t i = 0; i < kept; ++i)
+        resized[i] = std::move(history[(historyNext + history.size() - kept + i) % history.size()]);
+    for(size_t i = kept; i < resized.size(); ++i)
+        resized[i].passes.reserve(std::max(RESERVED_PASSES, passes.size()));
+    history.swap(resized);
+    historyNext = history.empty() ? 0 : kept % history.size();
+    historyCount = kept;
+}
+
+const GpuProfiler::FrameTimes& GpuProfiler::historyFrame(size_t index) const
+{
+    return history[(historyNext + history.size() - historyCount + index) % history.size()];
+}
+
+void GpuProfiler::getPasses(std::vector<Pass>& passes, unsigned long long* frameNumber)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(frameNumber)
+        *frameNumber = passesFrame;
+    passes.assign(this->passes.begin(), this->passes.end());
+}
+
+std::vector<GpuProfiler::FrameTimes> GpuProfiler::getHistory()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<FrameTimes> frames;
+    frames.reserve(historyCount);
+    for(size_t i = 0; i < historyCount; ++i)
+        frames.push_back(historyFrame(i));
+    return frames;
+}
+
+void GpuProfiler::finish()
+{
+    glFinish();
+
+    //oldest first, the ring continues after the current frame
+    for(unsigned int i = 1; i <= FRAMES_IN_FLIGHT; ++i)
+    {
+        Frame& frame = frames[(current + i) % FRAMES_IN_FLIGHT];
+        if(!frame.recorded)
+            continue;
+        resolve(frame);
+        frame.recorded = false;
+    }
+
+    //e.g. after a benchmark's warmup changed historyFrames, the frames measured next don't allocate it
+    std::lock_guard<std::mutex> lock(mutex);
+    fitHistory();
+}
+
+size_t GpuProfiler::getDroppedFrames()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return droppedFrames;
+}
+
+bool GpuProfiler::writeCsv(const std::string& path)
+{
+    std::ofstream file(path);
+    if(!file)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "frame,pass,depth,milliseconds\n";
+    for(size_t i = 0; i < historyCount; ++i)
+    {
+        const FrameTimes& frame = historyFrame(i);
+        for(const Pass& pass : frame.passes)
+            file << frame.number << ',' << pass.name << ',' << pass.depth << ',' << pass.milliseconds << '\n';
+    }
+    return bool(file);
+}
+
+bool GpuProfiler::writeJson(const std::string& path)
+{
+    std::ofstream file(path);
+    if(!file)
+        return false;
+
+    //pass names are literals in the code, nothing in them needs escaping
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "{\n  \"droppedFrames\": " << droppedFrames << ",\n  \"frames\": [";
+    for(size_t i = 0; i < historyCount; ++i)
+    {
+        const FrameTimes& frame = historyFrame(i);
+        file << (i == 0 ? "\n" : ",\n") << "    { \"frame\": " << frame.number << ", \"passes\": [";
+        for(size_t j = 0; j < frame.passes.size(); ++j)
+        {
+            const Pass& pass = frame.passes[j];
+            file << (j == 0 ? "" : ", ") << "{ \"name\": \"" << pass.name << "\", \"depth\": " << pass.depth
+                 << ", \"milliseconds\": " << pass.milliseconds << " }";
+        }
+        file << "] }";
+    }
+    file << "\n  ]\n}\n";
+    return bool(file);
+}
+
+void GpuProfiler::clear()
+{
+    for(Frame& frame : frames)
+    {
+        for(Query& query : frame.queries)
+        {
+            GLuint ids[2] = { query.begin, query.end };
+            glDeleteQueries(2, ids);
+        }
+        frame.queries.clear();
+        frame.used = 0;
+        frame.recorded = false;
+    }
+    recording = false;
+}
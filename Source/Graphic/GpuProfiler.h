@@ -0,0 +1,123 @@
+#pragma once
+
+#include "OpenGL_Includes.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// GPU time of the render passes, measured with GL_TIMESTAMP queries around each Scope. The queries of a frame are read
+/// FRAMES_IN_FLIGHT frames later, so reading never waits for the GPU, a frame whose queries still aren't done is dropped.
+/// Scopes nest, passes of the same name and depth within a frame are summed. Record on the thread owning the context,
+/// getPasses and the exports may be called from any thread.
+/// </summary>
+class GpuProfiler
+{
+public:
+    /// <summary> Measures the GPU commands recorded between its construction and destruction. name must outlive the profiler, e.g. a literal. </summary>
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        size_t index;
+    };
+
+    struct Pass
+    {
+        const char* name = nullptr;
+        unsigned int depth = 0; // 0 is the whole frame
+        double milliseconds = 0.0;
+        double averageMilliseconds = 0.0; // exponential moving average over the frames
+    };
+
+    struct FrameTimes
+    {
+        unsigned long long number = 0; // counted by beginFrame from 0
+        std::vector<Pass> passes;
+    };
+
+    static GpuProfiler& getInstance();
+
+    static const unsigned int FRAMES_IN_FLIGHT = 4;
+
+    /// <summary> Frames kept for writeCsv and writeJson. Their storage is sized at the next frame read back or finish, not while recording. </summary>
+    static size_t historyFrames;
+
+    /// <summary> Scopes measure nothing while false. </summary>
+    bool enabled = true;
+
+    /// <summary> Starts the frame's queries after reading those of the frame recorded FRAMES_IN_FLIGHT frames ago. </summary>
+    void beginFrame();
+    void endFrame();
+
+    /// <summary>
+    /// Copies the passes of the latest frame read back into passes, in the order they began, reusing its storage.
+    /// frameNumber, if given, receives the frame's number.
+    /// </summary>
+    void getPasses(std::vector<Pass>& passes, unsigned long long* frameNumber = nullptr);
+
+    /// <summary> The kept frames, see historyFrames. </summary>
+    std::vector<FrameTimes> getHistory();
+
+    /// <summary> Waits for the GPU and reads every recorded frame, e.g. at the end of a benchmark. Stalls, not for use in a frame. </summary>
+    void finish();
+
+    /// <summary> Frames dropped because their queries weren't done when read. </summary>
+    size_t getDroppedFrames();
+
+    /// <summary> Writes the kept frames, one row or object per pass. False if path can't be written. </summary>
+    bool writeCsv(const std::string& path);
+    bool writeJson(const std::string& path);
+
+    /// <summary> Deletes the queries, needs the context. </summary>
+    void clear();
+
+private:
+    struct Query
+    {
+        const char* name = nullptr;
+        unsigned int depth = 0;
+        GLuint begin = 0;
+        GLuint end = 0;
+    };
+
+    struct Frame
+    {
+        std::vector<Query> queries; // the first used ones belong to the frame, the others wait for reuse
+        size_t used = 0;
+        unsigned long long number = 0;
+        bool recorded = false;
+    };
+
+    GpuProfiler() {}
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    size_t begin(const char* name);
+    void end(size_t index);
+    void resolve(Frame& frame);
+    void fitHistory();
+    const FrameTimes& historyFrame(size_t index) const; // 0 is the oldest kept
+
+    Frame frames[FRAMES_IN_FLIGHT];
+    unsigned int current = 0;
+    unsigned int depth = 0;
+    bool recording = false;
+    unsigned long long frameNumber = 0;
+
+    //read back results, shared with the threads reading them
+    std::mutex mutex;
+    std::vector<Pass> passes;
+    std::vector<Pass> previousPasses; // the frame before, for the averages, swapped with passes so neither allocates
+    unsigned long long passesFrame = 0;
+    std::vector<FrameTimes> history; // historyFrames slots used as a ring, each keeps its passes' storage
+    size_t historyNext = 0; // slot of the next frame
+    size_t historyCount = 0;
+    size_t droppedFrames = 0;
+};
@@ -29,6 +29,9 @@
 #include "Graphic/FBO/FBO_3D.h"
 #include "Texture3D.h"
 
+const unsigned int Graphics::Quality::MAX_CONES;
+const unsigned int Graphics::Quality::MAX_CONE_STEPS;
+
 // ----------------------
 // Rendering pipeline.
 // ----------------------
@@ -50,34 +53,48 @@ void Graphics::init(unsigned int viewportWidth, unsigned int viewportHeight)
                                               voxViewProj);
 }
 
-void Graphics::render(Scene & renderingScene, unsigned int viewportWidth, unsigned int viewportHeight, RenderingMode renderingMode)
+void Graphics::render(const SceneSnapshot & snapshot, unsigned int viewportWidth, unsigned int viewportHeight, RenderingMode renderingMode)
 {
-    voxelizeRenderTarget->Render(renderingScene);
+    voxelizeRenderTarget->voxelizationInterval = std::max(quality.voxelizationInterval, 1u);
+    voxConeTracingRT->renderScale = quality.renderScale;
+    voxConeTracingRT->cones = std::min(std::max(quality.cones, 1u), Quality::MAX_CONES);
+    voxConeTracingRT->coneSteps = std::min(std::max(quality.coneSteps, 1u), Quality::MAX_CONE_STEPS);
+    voxelizeRenderTarget->Render(snapshot);
 
     switch (renderingMode) {
     case RenderingMode::VOXELIZATION_VISUALIZATION:
-        voxVisualizationRT->Render(renderingScene);
+        voxVisualizationRT->Render(snapshot);
         break;
     case RenderingMode::VOXEL_CONE_TRACING:
-        voxConeTracingRT->Render(renderingScene);
+        voxConeTracingRT->Render(snapshot);
         break;
     case RenderingMode::ORTHOGRAPHIC_DEPTH_BUFFER_LAYER_0:
-        voxelizeRenderTarget->presentOrthographicDepth(renderingScene, 0);
+        voxelizeRenderTarget->presentOrthographicDepth(snapshot, 0);
         break;
     case RenderingMode::ORTHOGRAPHIC_DEPTH_BUFFER_LAYER_1:
-        voxelizeRenderTarget->presentOrthographicDepth(renderingScene, 1);
+        voxelizeRenderTarget->presentOrthographicDepth(snapshot, 1);
         break;
     case RenderingMode::ORTHOGRAPHIC_DEPTH_BUFFER_LAYER_2:
-        voxelizeRenderTarget->presentOrthographicDepth(renderingScene, 2);
+        voxelizeRenderTarget->presentOrthographicDepth(snapshot, 2);
         break;
     case RenderingMode::ORTHOGRAPHIC_DEPTH_BUFFER_LAYER_3:
-        voxelizeRenderTarget->presentOrthographicDepth(renderingScene, 3);
+        voxelizeRenderTarget->presentOrthographicDepth(snapshot, 3);
         break;
     }
     
 }
 
 
+const MeshletCuller::Stats& Graphics::getConeTracingCullingStats() const
+{
+    return voxConeTracingRT->cullingStats;
+}
+
+const MeshletCuller::Stats& Graphics::getVoxelizationCullingStats() const
+{
+    return voxelizeRenderTarget->cullingStats;
+}
+
 Graphics::~Graphics()
 {
 	delete cubeShape;
@@ -7,6 +7,7 @@
 
 
 #include "Scene/Scene.h"
+#include "Scene/SceneSnapshot.h"
 #include "Graphic/Camera/OrthographicCamera.h"
 #include "Shape/Mesh.h"
 
@@ -42,11 +43,27 @@ public:
 	/// <summary> Initializes rendering. </summary>
 	virtual void init(unsigned int viewportWidth, unsigned int viewportHeight); // Called pre-render once per run.
 
-	/// <sumamry> Renders a scene using a given rendering mode. </summary>
+	/// <sumamry> Renders a snapshot of a scene using a given rendering mode, see SceneSnapshot::capture. </summary>
 	virtual void render(
-		Scene & renderingScene, unsigned int viewportWidth,
+		const SceneSnapshot & snapshot, unsigned int viewportWidth,
 		unsigned int viewportHeight, RenderingMode renderingMode = RenderingMode::VOXEL_CONE_TRACING
 	);
+
+	/// <summary> What render trades for GPU time, full quality by default, see QualityGovernor. </summary>
+	struct Quality {
+		static const unsigned int MAX_CONES = 5; // NUM_SAMPLING_RAYS in voxelConeTracing.frag
+		static const unsigned int MAX_CONE_STEPS = 5; // MAX_CONE_STEPS in voxelConeTracing.frag
+
+		float renderScale = 1.0f; // of the viewport the cone tracing pass draws at, then stretched over it
+		unsigned int cones = MAX_CONES; // indirect light cones traced per pixel
+		unsigned int coneSteps = MAX_CONE_STEPS; // voxel samples along each cone
+		unsigned int voxelizationInterval = 1; // frames at least between two voxelizations of a changing scene
+	};
+	Quality quality;
+
+	/// <summary> Meshlet culling of the last cone tracing pass and of the last voxelization. </summary>
+	const MeshletCuller::Stats& getConeTracingCullingStats() const;
+	const MeshletCuller::Stats& getVoxelizationCullingStats() const;
     
 	~Graphics();
 private:
@@ -9,6 +9,7 @@
 
 
 #include "Shader.h"
+#include "Utility/CpuProfiler.h"
 
 
 const char * const Material::Commands::PROJECTION_MATRIX_NAME = "P";
@@ -16,6 +17,7 @@ const char * const Material::Commands::VIEW_MATRIX_NAME = "V";
 const char * const Material::Commands::CAMERA_POSITION_NAME = "cameraPosition";
 const char * const Material::Commands::NUMBER_OF_LIGHTS_NAME = "numberOfLights";
 const char * const Material::Commands::MODEL_MATRIX_NAME = "M";
+const char * const Material::Commands::NORMAL_MATRIX_NAME = "N";
 const char * const Material::Commands::SCREEN_SIZE_NAME = "screenSize";
 const char * const Material::Commands::APP_STATE_NAME = "state";
 
@@ -44,6 +46,7 @@ void Material::AssembleProgram(
                               const ShaderSharedPtr& tessControlShader
                             )
 {
+    PROFILE_SCOPE("Material::AssembleProgram");
     assert(vertexShader != nullptr);
     assert(fragmentShader != nullptr);
     
@@ -263,9 +266,13 @@ int Material::Commands::SetParameterSampler3D(const GLchar* parameterName, Textu
 
 int Material::Commands::SetPointLight(const GLchar *parameterName, const PointLight &light)
 {
-    int location = glGetUniformLocation(material->program, ("pointLights[" + std::to_string(light.index) + "].position").c_str());
+    //formatted on the stack, building the names as strings allocated for every light of every draw
+    char name[64];
+    snprintf(name, sizeof(name), "pointLights[%u].position", light.index);
+    int location = glGetUniformLocation(material->program, name);
     glUniform3fv(location, 1, glm::value_ptr(light.position));
-    location = location != -1 ?  glGetUniformLocation(material->program, ("pointLights[" + std::to_string(light.index) + "].color").c_str()) : location;
+    snprintf(name, sizeof(name), "pointLights[%u].color", light.index);
+    location = location != -1 ?  glGetUniformLocation(material->program, name) : location;
     glUniform3fv(location, 1, glm::value_ptr(light.color));
     return location;
 }
@@ -323,11 +330,12 @@ int Material::Commands::SetMatrix(const GLchar* parameterName, const glm::mat4&
 
 void Material::Commands::uploadParameters(ShaderParameter::ShaderParamsGroup &group)
 {
+    PROFILE_SCOPE("Material::Commands::uploadParameters");
     textureUnits = 0;
-    for (std::pair<const GLchar* , ShaderParameter > pair : group)
+    for (auto& pair : group)
     {
         const GLchar* name = pair.first;
-        ShaderParameter setting = pair.second;
+        ShaderParameter& setting = pair.second;
         glError();
         setValue(setting, name);
         glError();
@@ -59,6 +59,7 @@ public:
         static const char * const CAMERA_POSITION_NAME;
         static const char * const NUMBER_OF_LIGHTS_NAME ;
         static const char * const MODEL_MATRIX_NAME ;
+        static const char * const NORMAL_MATRIX_NAME;
         static const char * const SCREEN_SIZE_NAME;
         static const char * const APP_STATE_NAME ;
         
@@ -11,6 +11,7 @@
 #include "Graphic/Material/Voxelization/VoxelizationConeTracingMaterial.h"
 #include "Graphic/Material/Voxelization/VoxelizationMaterial.h"
 #include "Graphic/Material/Voxelization/VoxelVisualizationMaterial.h"
+#include "Utility/CpuProfiler.h"
 
 
 static std::unordered_map<const GLchar*,  ShaderSharedPtr> shaderDatabase;
@@ -18,6 +19,7 @@ static std::unordered_map<const GLchar*,  MaterialSharedPtr > materialDatabase;
 
 MaterialStore::MaterialStore()
 {
+    PROFILE_SCOPE("MaterialStore::MaterialStore");
     ShaderSharedPtr voxelizationVert = AddShader("Voxelization/voxelization.vert", Shader::ShaderType::VERTEX);
     ShaderSharedPtr voxelVisualizationVert = AddShader("Voxelization/Visualization/voxel_visualization.vert", Shader::ShaderType::VERTEX);
     ShaderSharedPtr wordPositionVert = AddShader("Positions/world_position.vert", Shader::ShaderType::VERTEX);
@@ -5,11 +5,39 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include "Utility/CpuProfiler.h"
 
 
 const std::string Shader::shaderResourcePath =  "/Shaders/";
 
+//a line #include "file" is replaced by the file, relative to the shader folder, so the shaders share functions GLSL can't import
+bool Shader::appendSource(const std::string& sourcePath, std::string& source, int depth)
+{
+    static const std::string INCLUDE = "#include \"";
+    static const int MAX_INCLUDE_DEPTH = 8;
+    
+    std::ifstream fileStream(sourcePath, std::ios::in);
+    if (!fileStream.is_open())
+        return false;
+    
+    std::string line;
+    while (std::getline(fileStream, line)) {
+        size_t quoteEnd = line.find('"', INCLUDE.size());
+        if (line.compare(0, INCLUDE.size(), INCLUDE) == 0 && quoteEnd != std::string::npos) {
+            std::string includePath = Resource::resourceRoot + Shader::shaderResourcePath + line.substr(INCLUDE.size(), quoteEnd - INCLUDE.size());
+            if (depth >= MAX_INCLUDE_DEPTH || !appendSource(includePath, source, depth + 1)) {
+                std::cerr << "Couldn't include '" << includePath << "' in shader '" << sourcePath << "'." << std::endl;
+                return false;
+            }
+            continue;
+        }
+        source.append(line + "\n");
+    }
+    return true;
+}
+
 unsigned int Shader::compile() {
+	PROFILE_SCOPE("Shader::compile");
 	// Create and compile shader.
     
 	shaderID = glCreateShader(static_cast<int>(shaderType));
@@ -45,21 +73,13 @@ Shader::Shader(const char* _path, ShaderType _type) :  shaderType(_type) {
     // Load the shader instantly.
     path = Resource::resourceRoot + Shader::shaderResourcePath + _path;
     
-	std::ifstream fileStream(path, std::ios::in);
-	if (!fileStream.is_open()) {
-		std::cerr << "Couldn't load shader '" + std::string(path) + "'." << std::endl;
-		fileStream.close();
-        assert(false);
-		return;
-	}
-	std::string line = "";
-	rawShader = "";
-	while (!fileStream.eof()) {
-		std::getline(fileStream, line);
-		rawShader.append(line + "\n");
-	}
-	fileStream.close();
-    
+	rawShader = "";
+	if (!appendSource(path, rawShader)) {
+		std::cerr << "Couldn't load shader '" + std::string(path) + "'." << std::endl;
+		assert(false);
+		return;
+	}
+    
     compile();
 }
 
@@ -43,7 +43,10 @@ protected:
     int shaderID;
 
 private:
-	std::string rawShader;
+	std::string rawShader;
+    
+    // Appends the file at sourcePath to source with its #include "file" lines expanded. False if a file can't be read.
+    static bool appendSource(const std::string& sourcePath, std::string& source, int depth = 0);
 
 };
 
@@ -14,7 +14,7 @@
 #include "glm/glm.hpp"
 #include "Utility/Logger.h"
 
-constexpr unsigned int VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS = 64u;
+unsigned int VoxelizationMaterial::voxelTextureDimensions = 64u;
 
 VoxelizationMaterial::VoxelizationMaterial(const GLchar* _name, const ShaderSharedPtr vertexShader,
                                            const ShaderSharedPtr fragmentShader, const ShaderSharedPtr geometryShader):
@@ -26,10 +26,10 @@ void VoxelizationMaterial::uploadGPUVoxParams(Transform& worldTransform, Scene&
                                             VoxProperties& voxProperties, OrthographicCamera& orthoCamera)
 {
     
-    assert((VOXEL_TEXTURE_DIMENSIONS & (VOXEL_TEXTURE_DIMENSIONS - 1))  % 2 == 0
+    assert((voxelTextureDimensions & (voxelTextureDimensions - 1))  % 2 == 0
            && "voxel textures must be a power of 2");
     
-    settings["cubeDimensions"] = VOXEL_TEXTURE_DIMENSIONS;
+    settings["cubeDimensions"] = voxelTextureDimensions;
     
     std::vector<PointLight> &lights = scene.pointLights;
     assert(lights.size() == 1 && "only one light supported at the moment");
@@ -106,7 +106,7 @@ private:
     
 public:
     static const std::vector<float> initTextureBuffer;
-    static const unsigned int VOXEL_TEXTURE_DIMENSIONS; //must be a power of two
+    static unsigned int voxelTextureDimensions; //must be a power of two up to 64 (NUM_MIP_MAPS in voxelConeTracing.frag), read when Graphics::init creates the voxel textures
     
 };
 
@@ -0,0 +1,191 @@
+#include "OffscreenContext.h"
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "OpenGL_Includes.h"
+#include "Graphic/FBO/FBO_2D.h"
+
+#if __APPLE__
+#include <OpenGL/OpenGL.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+bool OffscreenContext::create(unsigned int width, unsigned int height, bool software)
+{
+    destroy();
+    error.clear();
+    if(!createPlatformContext(software))
+        return false;
+    created = true;
+
+#ifndef __APPLE__
+    glewExperimental = GL_TRUE;
+    if(glewInit() != GLEW_OK)
+    {
+        error = "GLEW failed to initialize, it needs to be built for EGL (GLEW_EGL)";
+        destroy();
+        return false;
+    }
+    glGetError(); // glewInit leaves GL_INVALID_ENUM behind on core profiles
+#endif
+
+    //the default framebuffer of a window, here a texture with a depth buffer
+    Texture::Dimensions dimensions;
+    dimensions.width = width;
+    dimensions.height = height;
+    Texture::Properties properties;
+    properties.minFilter = GL_NEAREST;
+    properties.magFilter = GL_NEAREST;
+    FBO_2D::getDefault() = std::make_shared<FBO_2D>(dimensions, properties);
+    FBO_2D::getDefault()->addDepthTarget();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+std::string OffscreenContext::getRenderer() const
+{
+    const GLubyte* renderer = created ? glGetString(GL_RENDERER) : nullptr;
+    return renderer ? std::string(reinterpret_cast<const char*>(renderer)) : std::string();
+}
+
+void OffscreenContext::destroy()
+{
+    if(!created)
+        return;
+
+    FBO_2D::getDefault() = nullptr;
+    destroyPlatformContext();
+    created = false;
+}
+
+#if __APPLE__
+
+bool OffscreenContext::createPlatformContext(bool software)
+{
+    //the same version and profile Application asks GLFW for on macOS
+    std::vector<CGLPixelFormatAttribute> attributes =
+    {
+        kCGLPFAOpenGLProfile, (CGLPixelFormatAttribute)kCGLOGLPVersion_GL4_Core,
+        kCGLPFAColorSize, (CGLPixelFormatAttribute)24,
+        kCGLPFAAlphaSize, (CGLPixelFormatAttribute)8,
+        kCGLPFADepthSize, (CGLPixelFormatAttribute)24
+    };
+    if(software)
+    {
+        attributes.push_back(kCGLPFARendererID);
+        attributes.push_back((CGLPixelFormatAttribute)kCGLRendererGenericFloatID);
+    }
+    else
+    {
+        attributes.push_back(kCGLPFAAccelerated);
+    }
+    attributes.push_back((CGLPixelFormatAttribute)0);
+
+    CGLPixelFormatObj pixelFormat = nullptr;
+    GLint formats = 0;
+    if(CGLChoosePixelFormat(attributes.data(), &pixelFormat, &formats) != kCGLNoError || pixelFormat == nullptr)
+    {
+        error = "no OpenGL 4.1 core pixel format";
+        return false;
+    }
+
+    CGLContextObj cglContext = nullptr;
+    CGLError result = CGLCreateContext(pixelFormat, nullptr, &cglContext);
+    CGLReleasePixelFormat(pixelFormat);
+    if(result == kCGLNoError)
+        result = CGLSetCurrentContext(cglContext);
+    if(result != kCGLNoError)
+    {
+        error = CGLErrorString(result);
+        if(cglContext)
+            CGLReleaseContext(cglContext);
+        return false;
+    }
+
+    context = cglContext;
+    return true;
+}
+
+void OffscreenContext::destroyPlatformContext()
+{
+    CGLSetCurrentContext(nullptr);
+    CGLReleaseContext(static_cast<CGLContextObj>(context));
+    context = nullptr;
+}
+
+#else
+
+bool OffscreenContext::createPlatformContext(bool software)
+{
+    //Mesa reads it when the display is initialized
+    if(software)
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+
+    EGLDisplay eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major = 0, minor = 0;
+    if(eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        error = "no EGL display";
+        return false;
+    }
+    display = eglDisplay;
+
+    const EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configs = 0;
+    if(!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configs) || configs == 0 || !eglBindAPI(EGL_OPENGL_API))
+    {
+        error = "no EGL config for desktop OpenGL";
+        destroyPlatformContext();
+        return false;
+    }
+
+    //the passes draw into FBO_2D::getDefault(), the pbuffer only has to exist
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    surface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttributes);
+
+    //the same version and profile Application asks GLFW for
+    const EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if(surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, surface, surface, context))
+    {
+        error = "no OpenGL 4.5 context";
+        destroyPlatformContext();
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::destroyPlatformContext()
+{
+    if(display == nullptr)
+        return;
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    if(surface != EGL_NO_SURFACE)
+        eglDestroySurface(display, surface);
+    eglTerminate(display);
+    context = surface = display = nullptr;
+}
+
+#endif
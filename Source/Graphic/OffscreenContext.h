@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+/// <summary>
+/// GL context without a window, for tools rendering headless. CGL on macOS, where software picks Apple's software
+/// renderer, and an EGL pbuffer elsewhere, where software asks Mesa for llvmpipe so it runs without a GPU.
+/// create() also replaces FBO_2D::getDefault() with a framebuffer of the given size, the passes draw into it as they
+/// would into a window.
+/// </summary>
+class OffscreenContext
+{
+public:
+    /// <summary> Creates the context and makes it current on the calling thread. False with getError() set if it failed. </summary>
+    bool create(unsigned int width, unsigned int height, bool software);
+
+    /// <summary> Releases the framebuffer and the context. </summary>
+    void destroy();
+
+    inline const std::string& getError() const { return error; }
+
+    /// <summary> GL_RENDERER of the context, to tell hardware and software runs apart. </summary>
+    std::string getRenderer() const;
+
+    ~OffscreenContext() { destroy(); }
+
+private:
+    bool createPlatformContext(bool software);
+    void destroyPlatformContext();
+
+    std::string error;
+    bool created = false;
+
+    //platform handles, CGLContextObj on macOS, EGLDisplay, EGLSurface and EGLContext elsewhere
+    void* context = nullptr;
+    void* display = nullptr;
+    void* surface = nullptr;
+};
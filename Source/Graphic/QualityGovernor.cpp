@@ -0,0 +1,139 @@
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Graphic/GpuProfiler.h"
+
+double QualityGovernor::targetMilliseconds = 14.0;
+double QualityGovernor::downgradeAbove = 1.0;
+double QualityGovernor::upgradeBelow = 0.75;
+
+//an upgrade that didn't hold doubles the calm windows the next one needs, up to this many
+static const size_t MAX_CALM_WINDOWS = 16;
+
+QualityGovernor::QualityGovernor()
+{
+    buildLadder(Bounds());
+}
+
+QualityGovernor::QualityGovernor(const Bounds& bounds)
+{
+    buildLadder(bounds);
+}
+
+void QualityGovernor::buildLadder(const Bounds& bounds)
+{
+    float minRenderScale = std::min(std::max(bounds.minRenderScale, 0.1f), 1.0f);
+    float renderScaleStep = std::max(bounds.renderScaleStep, 0.01f);
+    unsigned int minCones = std::min(std::max(bounds.minCones, 1u), Graphics::Quality::MAX_CONES);
+    unsigned int minConeSteps = std::min(std::max(bounds.minConeSteps, 1u), Graphics::Quality::MAX_CONE_STEPS);
+    unsigned int maxVoxelizationInterval = std::max(bounds.maxVoxelizationInterval, 1u);
+
+    //each round lowers every lever that can still go down once, the render scale twice as it's the one that scales best
+    Graphics::Quality quality;
+    ladder.assign(1, quality);
+    for(bool stepped = true; stepped; )
+    {
+        stepped = false;
+        for(int lever = 0; lever < 5; ++lever)
+        {
+            Graphics::Quality next = quality;
+            if(lever == 0 && next.voxelizationInterval * 2 <= maxVoxelizationInterval)
+                next.voxelizationInterval *= 2;
+            else if((lever == 1 || lever == 3) && next.renderScale > minRenderScale + 0.001f)
+                next.renderScale = std::max(minRenderScale, std::round((next.renderScale - renderScaleStep) * 1000.0f) / 1000.0f);
+            else if(lever == 2 && next.coneSteps > minConeSteps)
+                --next.coneSteps;
+            else if(lever == 4 && next.cones > minCones)
+                --next.cones;
+            else
+                continue;
+            quality = next;
+            ladder.push_back(quality);
+            stepped = true;
+        }
+    }
+}
+
+void QualityGovernor::recordFrame(double gpuMilliseconds)
+{
+    if(!enabled)
+    {
+        if(level != 0)
+            std::cout << "Quality governor: disabled, back to full quality." << std::endl;
+        reset();
+        return;
+    }
+
+    if(ignoredFrames > 0)
+    {
+        --ignoredFrames;
+        return;
+    }
+    window[windowFrames++] = gpuMilliseconds;
+    if(windowFrames < WINDOW_FRAMES)
+        return;
+    windowFrames = 0;
+
+    //the 90th percentile, a single hitch doesn't lower quality but a steady tenth of slow frames does
+    double sorted[WINDOW_FRAMES];
+    std::copy(window, window + WINDOW_FRAMES, sorted);
+    size_t index = static_cast<size_t>(std::ceil(0.9 * WINDOW_FRAMES)) - 1;
+    std::nth_element(sorted, sorted + index, sorted + WINDOW_FRAMES);
+    double percentile = sorted[index];
+
+    bool afterUpgrade = lastStepWasUp;
+    lastStepWasUp = false;
+    if(percentile > targetMilliseconds * downgradeAbove)
+    {
+        calmWindows = 0;
+        if(afterUpgrade)
+            calmWindowsNeeded = std::min(calmWindowsNeeded * 2, MAX_CALM_WINDOWS);
+        if(level + 1 < ladder.size())
+            step(level + 1, percentile);
+        return;
+    }
+
+    if(afterUpgrade)
+        calmWindowsNeeded = std::max<size_t>(calmWindowsNeeded / 2, 1);
+    if(percentile < targetMilliseconds * upgradeBelow && level > 0)
+    {
+        if(++calmWindows >= calmWindowsNeeded)
+        {
+            calmWindows = 0;
+            step(level - 1, percentile);
+            lastStepWasUp = true;
+        }
+    }
+    else
+        calmWindows = 0;
+}
+
+void QualityGovernor::step(size_t newLevel, double percentile)
+{
+    level = newLevel;
+    windowFrames = 0;
+    ignoredFrames = GpuProfiler::FRAMES_IN_FLIGHT + 2;
+
+    const Graphics::Quality& quality = ladder[level];
+    std::ostringstream message;
+    message << "Quality governor: GPU p90 " << std::fixed << std::setprecision(2) << percentile << " ms "
+              << (percentile > targetMilliseconds ? "over" : "under") << " the " << targetMilliseconds << " ms target, level "
+              << level << " of " << ladder.size() - 1 << ": render scale " << quality.renderScale << ", " << quality.cones
+              << " cones of " << quality.coneSteps << " steps, voxelization every " << quality.voxelizationInterval << " frames";
+    std::cout << message.str() << std::endl;
+}
+
+void QualityGovernor::reset()
+{
+    level = 0;
+    windowFrames = 0;
+    ignoredFrames = 0;
+    calmWindows = 0;
+    calmWindowsNeeded = 1;
+    lastStepWasUp = false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "Graphic/Graphics.h"
+
+/// <summary>
+/// Holds the GPU frame time near targetMilliseconds by stepping Graphics::Quality along a ladder, from full quality down
+/// to the bounds: each step doubles the voxelization interval, lowers the render scale or takes away a cone step or a cone.
+/// A step down needs a window of frames over the target, a step up a window well under it, so the band between the two
+/// keeps it from flipping back and forth. Stepping up into a level that right away proved too slow waits twice as many
+/// windows the next time. Every step is logged to std::cout.
+/// Fed and read on the thread rendering, enabled may be set from any thread.
+/// </summary>
+class QualityGovernor
+{
+public:
+    /// <summary> The lowest quality the governor goes to. </summary>
+    struct Bounds
+    {
+        float minRenderScale = 0.5f;
+        float renderScaleStep = 0.1f;
+        unsigned int minCones = 3;
+        unsigned int minConeSteps = 3;
+        unsigned int maxVoxelizationInterval = 4;
+    };
+
+    /// <summary> GPU time per frame to hold, below the 16.7 ms of 60 Hz so the CPU side and the swap fit too. </summary>
+    static double targetMilliseconds;
+
+    /// <summary> A window over targetMilliseconds times downgradeAbove steps down, one under it times upgradeBelow steps up. </summary>
+    static double downgradeAbove;
+    static double upgradeBelow;
+
+    /// <summary> Frames per decision, the 90th percentile of their GPU times is compared with the target. </summary>
+    static const size_t WINDOW_FRAMES = 30;
+
+    /// <summary> Steps quality while true, false goes back to full quality. </summary>
+    std::atomic<bool> enabled{true};
+
+    QualityGovernor();
+    explicit QualityGovernor(const Bounds& bounds);
+
+    /// <summary> GPU time of a whole frame, once per frame read back, see GpuProfiler::getPasses. </summary>
+    void recordFrame(double gpuMilliseconds);
+
+    /// <summary> The quality to render the next frame with. </summary>
+    inline const Graphics::Quality& getQuality() const { return enabled ? ladder[level] : ladder[0]; }
+
+    /// <summary> 0 is full quality, getLevels() - 1 the bounds. </summary>
+    inline size_t getLevel() const { return level; }
+    inline size_t getLevels() const { return ladder.size(); }
+
+    /// <summary> Back to full quality, forgetting the frames seen. </summary>
+    void reset();
+
+private:
+    void buildLadder(const Bounds& bounds);
+    void step(size_t newLevel, double percentile);
+
+    std::vector<Graphics::Quality> ladder;
+    size_t level = 0;
+
+    double window[WINDOW_FRAMES];
+    size_t windowFrames = 0;
+    size_t ignoredFrames = 0; // still drawn at the previous level, the GPU times arrive frames late
+
+    size_t calmWindows = 0; // windows in a row under the upgrade threshold
+    size_t calmWindowsNeeded = 1;
+    bool lastStepWasUp = false;
+};
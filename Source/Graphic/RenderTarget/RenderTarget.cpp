@@ -9,13 +9,14 @@
 #include "RenderTarget.h"
 #include "Mesh.h"
 #include "Shape.h"
+#include <algorithm>
 
 
-void RenderTarget::setLightingParameters(ShaderParameter::ShaderParamsGroup& settings, std::vector<PointLight> &lights)
+void RenderTarget::setLightingParameters(ShaderParameter::ShaderParamsGroup& settings, const std::vector<PointLight> &lights)
 {
     unsigned int index = 0;
     unsigned int argumentIndex = 0;
-    for(PointLight &light : lights)
+    for(const PointLight &light : lights)
     {
         assert(index < MAX_ARGUMENTS);
         
@@ -33,3 +34,8 @@ void RenderTarget::setLightingParameters(ShaderParameter::ShaderParamsGroup& set
     settings[Material::Commands::NUMBER_OF_LIGHTS_NAME] = (int)lights.size();
     
 }
+
+float RenderTarget::maxScale(const glm::mat4& model)
+{
+    return std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+}
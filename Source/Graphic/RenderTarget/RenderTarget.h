@@ -9,7 +9,7 @@
 #pragma once
 
 #include "OpenGL_Includes.h"
-#include "Scene/Scene.h"
+#include "Scene/SceneSnapshot.h"
 #include "Graphic/Material/ShaderParameter.h"
 
 class FBO;
@@ -21,13 +21,16 @@ class RenderTarget {
 public:
     RenderTarget(){};
     
-    virtual void Render( Scene& renderScene ) = 0;
+    virtual void Render( const SceneSnapshot& snapshot ) = 0;
     
     virtual ~RenderTarget(){};
 
     
 protected:
-    void setLightingParameters(ShaderParameter::ShaderParamsGroup& settings, std::vector<PointLight> &lights);
+    void setLightingParameters(ShaderParameter::ShaderParamsGroup& settings, const std::vector<PointLight> &lights);
+    
+    // largest scale factor of a model matrix, to bring world space sizes into object space
+    static float maxScale(const glm::mat4& model);
 private:
     
     
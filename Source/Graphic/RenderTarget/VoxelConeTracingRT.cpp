@@ -15,7 +15,13 @@
 #include "Shape/Shape.h"
 #include "Graphic/FBO/FBO.h"
 #include "Graphic/FBO/FBO_2D.h"
+#include "Graphic/Graphics.h"
+#include "Utility/JobSystem.h"
+#include "Graphic/GpuProfiler.h"
+#include "Utility/CpuProfiler.h"
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
 
 
 VoxelConeTracingRT::VoxelConeTracingRT(Texture3D* _albedoVoxels, Texture3D* _normalVoxels, std::vector<std::shared_ptr<Texture3D>> &_albedoMipMaps,
@@ -61,9 +67,12 @@ normalMipMaps(_normalMipMaps)
 }
 
 
-void VoxelConeTracingRT::Render(Scene& scene)
+void VoxelConeTracingRT::Render(const SceneSnapshot& snapshot)
 {
-    FBO::Commands commands(FBO_2D::getDefault().get());
+    PROFILE_SCOPE("VoxelConeTracingRT::Render");
+    GpuProfiler::Scope profile("Cone tracing");
+    FBO_2D* target = renderScale < 1.0f ? getScaledTarget() : FBO_2D::getDefault().get();
+    FBO::Commands commands(target);
     
     commands.setClearColor();
     commands.clearRenderTarget();
@@ -74,34 +83,134 @@ void VoxelConeTracingRT::Render(Scene& scene)
     static ShaderParameter::ShaderParamsGroup params;
 
     params["voxViewProjection"] = voxViewProjection;
-    params["voxelDimensionsInWorldSpace"] = float(VoxelizeRT::VOXELS_WORLD_SCALE) / float(VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS);
+    params["voxelDimensionsInWorldSpace"] = float(VoxelizeRT::VOXELS_WORLD_SCALE) / float(VoxelizationMaterial::voxelTextureDimensions);
     
     Material::Commands matCommands(voxConeTracing.get());
     
-    setLightingParameters(params, scene.pointLights);
-    setCameraParameters(params, *scene.renderingCamera);
+    setLightingParameters(params, snapshot.pointLights);
+    setCameraParameters(params, snapshot.camera);
     //uploadRenderingSettings(params, voxConeTracing);
     setMipMapParameters(params);
     setSamplingRayParameters(params);
+    setConeCountParameters(params);
     
-    for(Shape* shape: scene.shapes)
+    float viewportHeight = float(target->getDimensions().height);
+    const Camera& camera = snapshot.camera;
+    glm::mat4 viewProjection = camera.getProjectionMatrix() * camera.viewMatrix;
+    cullingStats = MeshletCuller::Stats();
+    
+    //level selection and culling of every mesh run on the JobSystem, the draws are recorded here once all are done
+    size_t drawCount = 0;
+    shapeDraws.clear();
+    for(const SceneSnapshot::ShapeState& state: snapshot.shapes)
+    {
+        ShapeDraw shapeDraw;
+        shapeDraw.state = &state;
+        shapeDraw.view = MeshletCuller::makeView(viewProjection, state.model, camera.position, true);
+        shapeDraw.firstMesh = drawCount;
+        for(Mesh* mesh : state.shape->meshes)
+        {
+            if(meshDraws.size() == drawCount)
+                meshDraws.emplace_back();
+            meshDraws[drawCount].mesh = mesh;
+            meshDraws[drawCount].shapeDraw = shapeDraws.size();
+            ++drawCount;
+        }
+        shapeDraws.push_back(shapeDraw);
+    }
+    
+    JobSystem::getInstance().parallelFor(drawCount, 4, [&](size_t begin, size_t end)
     {
-        size_t numberOfProperties = shape->getMeshProperties().size();
-        glm::mat4 trans = shape->transform.getTransformMatrix();
+        for(size_t i = begin; i < end; ++i)
+        {
+            MeshDraw& draw = meshDraws[i];
+            const ShapeDraw& shapeDraw = shapeDraws[draw.shapeDraw];
+            unsigned int lod = selectLod(*draw.mesh, shapeDraw.state->model, camera, viewportHeight);
+            if(cullMeshlets && draw.mesh->enabled)
+            {
+                draw.mesh->cull(lod, shapeDraw.view, draw.drawList);
+            }
+            else
+            {
+                draw.drawList.lod = lod;
+                draw.drawList.whole = true;
+                draw.drawList.stats = MeshletCuller::Stats();
+            }
+        }
+    });
+    
+    for(const ShapeDraw& shapeDraw : shapeDraws)
+    {
+        const SceneSnapshot::ShapeState& state = *shapeDraw.state;
         
         Material::Commands commands(voxConeTracing.get());
-        params[Material::Commands::MODEL_MATRIX_NAME] = trans;
+        params[Material::Commands::MODEL_MATRIX_NAME] = state.model;
+        params[Material::Commands::NORMAL_MATRIX_NAME] = state.normal;
 
-        int i = 0;
-        for(Mesh* mesh : shape->meshes)
+        for(size_t i = 0; i < state.shape->meshes.size(); ++i)
         {
-            VoxProperties prop = i < shape->meshProperties.size()  ? shape->meshProperties[i] : shape->defaultVoxProperties;
+            MeshDraw& draw = meshDraws[shapeDraw.firstMesh + i];
+            const VoxProperties& prop = i < state.meshProperties.size()  ? state.meshProperties[i] : state.defaultVoxProperties;
             getVoxParameters(params, prop);
-            mesh->render(params, matCommands);
-            ++i;
+            draw.mesh->render(params, matCommands, draw.drawList);
+            if(draw.mesh->enabled)
+                cullingStats += draw.drawList.stats;
         }
     }
     commands.end();
+    
+    if(target != FBO_2D::getDefault().get())
+    {
+        //stretched over the viewport with bilinear filtering, what's drawn later, e.g. text, stays sharp
+        GpuProfiler::Scope upscale("Upscale");
+        const Texture::Dimensions& from = target->getDimensions();
+        const Texture::Dimensions& to = FBO_2D::getDefault()->getDimensions();
+        GLint previousFramebuffer = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target->getFrameBufferID());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO_2D::getDefault()->getFrameBufferID());
+        glBlitFramebuffer(0, 0, from.width, from.height, 0, 0, to.width, to.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+}
+
+FBO_2D* VoxelConeTracingRT::getScaledTarget()
+{
+    //the default framebuffer learns its size from the viewport the first time it's used
+    const Texture::Dimensions& viewport = FBO_2D::getDefault()->getDimensions();
+    if(viewport.width == 0 || viewport.height == 0)
+        return FBO_2D::getDefault().get();
+    
+    Texture::Dimensions dimensions;
+    dimensions.width = std::max(1u, static_cast<unsigned int>(viewport.width * renderScale + 0.5f));
+    dimensions.height = std::max(1u, static_cast<unsigned int>(viewport.height * renderScale + 0.5f));
+    if(scaledTarget == nullptr || scaledTarget->getDimensions().width != dimensions.width || scaledTarget->getDimensions().height != dimensions.height)
+    {
+        Texture::Properties properties;
+        properties.minFilter = GL_LINEAR;
+        properties.magFilter = GL_LINEAR;
+        scaledTarget = std::make_shared<FBO_2D>(dimensions, properties);
+        scaledTarget->addDepthTarget();
+    }
+    return scaledTarget.get();
+}
+
+unsigned int VoxelConeTracingRT::selectLod(Mesh& mesh, const glm::mat4& model, const Camera& camera, float viewportHeight)
+{
+    if(lodPixelError <= 0.0f || viewportHeight <= 0.0f)
+        return 0;
+    
+    //distance to the nearest point of the bounding sphere, inside it every level is too coarse
+    float scale = maxScale(model);
+    glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (mesh.getBoundsMin() + mesh.getBoundsMax()), 1.0f));
+    float radius = 0.5f * glm::length(mesh.getBoundsMax() - mesh.getBoundsMin()) * scale;
+    float distance = glm::length(center - camera.position) - radius;
+    if(distance <= 0.0f)
+        return 0;
+    
+    //world space height of a pixel at that distance, brought into object space
+    float pixelSize = 2.0f * distance / (camera.getProjectionMatrix()[1][1] * viewportHeight);
+    return mesh.lodForError(lodPixelError * pixelSize / scale);
 }
 
 void VoxelConeTracingRT::setupSamplingRays()
@@ -131,7 +240,23 @@ void VoxelConeTracingRT::setSamplingRayParameters(ShaderParameter::ShaderParamsG
     }
 }
 
-void VoxelConeTracingRT::getVoxParameters(ShaderParameter::ShaderParamsGroup &settings, VoxProperties &voxProperties)
+void VoxelConeTracingRT::setConeCountParameters(ShaderParameter::ShaderParamsGroup& params)
+{
+    //the shader adds up the light of every cone and step, the rest are scaled to make up for the skipped ones
+    static const float STEP_WEIGHT_GROWTH = 1.2f, STEP_WEIGHT_POWER = 1.8f; // k and pow(k, 1.8f) in voxelConeTracing.frag
+    float allSteps = 0.0f, usedSteps = 0.0f;
+    for(unsigned int i = 0; i < Graphics::Quality::MAX_CONE_STEPS; ++i)
+    {
+        float weight = std::pow(1.0f + STEP_WEIGHT_GROWTH * i, STEP_WEIGHT_POWER);
+        allSteps += weight;
+        usedSteps += i < coneSteps ? weight : 0.0f;
+    }
+    params["numberOfCones"] = cones;
+    params["coneSteps"] = coneSteps;
+    params["indirectScale"] = float(SAMPLING_RAYS) / float(cones) * allSteps / usedSteps;
+}
+
+void VoxelConeTracingRT::getVoxParameters(ShaderParameter::ShaderParamsGroup &settings, const VoxProperties &voxProperties)
 {
     settings["material.diffuseColor"] = voxProperties.diffuseColor;
     settings["material.specularColor"] = voxProperties.specularColor;
@@ -174,7 +299,7 @@ void VoxelConeTracingRT::setMipMapParameters(ShaderParameter::ShaderParamsGroup&
 }
 
 
-void VoxelConeTracingRT::setCameraParameters(ShaderParameter::ShaderParamsGroup& params, Camera &camera)
+void VoxelConeTracingRT::setCameraParameters(ShaderParameter::ShaderParamsGroup& params, const Camera &camera)
 {
     params[Material::Commands::VIEW_MATRIX_NAME] = camera.viewMatrix;
     params[Material::Commands::PROJECTION_MATRIX_NAME] = camera.getProjectionMatrix();
@@ -10,9 +10,13 @@
 
 #include "RenderTarget.h"
 #include "Graphic/Camera/Camera.h"
+#include "Shape/Mesh.h"
+#include "Shape/MeshletCuller.h"
 
 class VoxelizationConeTracingMaterial;
+class Shape;
 class Texture3D;
+class FBO_2D;
 
 
 class VoxelConeTracingRT : public RenderTarget
@@ -22,18 +26,37 @@ public:
     VoxelConeTracingRT(Texture3D* albedoVoxels, Texture3D* normalVoxels, std::vector<std::shared_ptr<Texture3D>> &_albedoMipMaps,
                        std::vector<std::shared_ptr<Texture3D>> &_normalMipMaps, glm::mat4& voxViewProjection);
     
-    void Render( Scene& scene) override;
+    void Render( const SceneSnapshot& snapshot) override;
     ~VoxelConeTracingRT() override;
     
+    // Largest error, in pixels, a mesh's level of detail may show on screen. 0 always draws full detail.
+    float lodPixelError = 1.0f;
+    
+    // Skip meshlets outside the camera frustum or facing away from it.
+    bool cullMeshlets = true;
+    
+    // Meshlets tested and culled by the last Render.
+    MeshletCuller::Stats cullingStats;
+    
+    // Fraction of the viewport the pass draws at before stretching its image over the viewport, see Graphics::Quality.
+    float renderScale = 1.0f;
+    
+    // Indirect light cones per pixel and voxel samples along each, up to Graphics::Quality::MAX_CONES and MAX_CONE_STEPS.
+    unsigned int cones = 5;
+    unsigned int coneSteps = 5;
+    
 private:
-    void getVoxParameters(ShaderParameter::ShaderParamsGroup &settings, VoxProperties &voxProperties);
+    void getVoxParameters(ShaderParameter::ShaderParamsGroup &settings, const VoxProperties &voxProperties);
     void setMipMapParameters(ShaderParameter::ShaderParamsGroup& settings);
-    void setCameraParameters(ShaderParameter::ShaderParamsGroup& params, Camera &camera);
+    void setCameraParameters(ShaderParameter::ShaderParamsGroup& params, const Camera &camera);
     void uploadRenderingSettings(ShaderParameter::ShaderParamsGroup& params, std::shared_ptr<VoxelizationConeTracingMaterial> &material );
     void setupSamplingRays();
     void setSamplingRayParameters(ShaderParameter::ShaderParamsGroup& params);
     void setConeApertureAndVariances(ShaderParameter::ShaderParamsGroup& params);
     void setSamplingWeights(ShaderParameter::ShaderParamsGroup& params);
+    void setConeCountParameters(ShaderParameter::ShaderParamsGroup& params);
+    FBO_2D* getScaledTarget();
+    unsigned int selectLod(Mesh& mesh, const glm::mat4& model, const Camera& camera, float viewportHeight);
 
 private:
     
@@ -56,4 +79,23 @@ private:
     char coneVariances[MAX_ARGUMENTS][MAX_ARGUMENTS];
     
     std::shared_ptr<VoxelizationConeTracingMaterial> voxConeTracing = nullptr;
+    
+    //what the pass draws into while renderScale is below 1, resized with the scale
+    std::shared_ptr<FBO_2D> scaledTarget;
+    
+    //what Render culled, kept between frames so the draw lists keep their storage
+    struct ShapeDraw
+    {
+        const SceneSnapshot::ShapeState* state = nullptr;
+        MeshletCuller::View view;
+        size_t firstMesh = 0; // in meshDraws
+    };
+    struct MeshDraw
+    {
+        Mesh* mesh = nullptr;
+        size_t shapeDraw = 0;
+        Mesh::DrawList drawList;
+    };
+    std::vector<ShapeDraw> shapeDraws;
+    std::vector<MeshDraw> meshDraws;
 };
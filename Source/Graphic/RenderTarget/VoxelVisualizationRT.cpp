@@ -15,6 +15,7 @@
 #include "Utility/ObjLoader.h"
 #include "Utility/Logger.h"
 #include "Graphic/FBO/FBO_2D.h"
+#include "Graphic/GpuProfiler.h"
 
 
 VoxelVisualizationRT::VoxelVisualizationRT(Texture3D* _voxelTexture)
@@ -24,22 +25,24 @@ VoxelVisualizationRT::VoxelVisualizationRT(Texture3D* _voxelTexture)
     
     //todo: ObjLoader should return a shared pointer
     cubeShape = ObjLoader::loadShapeFromObj("/Assets/Models/cube.obj");
+    cubeModel = cubeShape->transform.getTransformMatrix(); // Render runs on the render thread, away from the SceneGraph
 
 
 }
 
-void VoxelVisualizationRT::Render( Scene& scene )
+void VoxelVisualizationRT::Render( const SceneSnapshot& snapshot )
 {
+    GpuProfiler::Scope profile("Voxel visualization");
 
     static ShaderParameter::ShaderParamsGroup group;
     group["texture3D"] = voxelTexture;
-    group["camPosition"] = scene.renderingCamera->position;
+    group["camPosition"] = snapshot.camera.position;
     
-    glm::mat4 modelView = scene.renderingCamera->viewMatrix * cubeShape->transform.getTransformMatrix();
-    group["M"] = cubeShape->transform.getTransformMatrix();
-    group["stepSize"] = 1.0f/(float)VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS;
+    glm::mat4 modelView = snapshot.camera.viewMatrix * cubeModel;
+    group["M"] = cubeModel;
+    group["stepSize"] = 1.0f/(float)VoxelizationMaterial::voxelTextureDimensions;
     
-    glm::mat4 mvp = scene.renderingCamera->getProjectionMatrix() * modelView;
+    glm::mat4 mvp = snapshot.camera.getProjectionMatrix() * modelView;
 
     group["MVP"] = mvp;
     
@@ -52,7 +55,7 @@ void VoxelVisualizationRT::Render( Scene& scene )
 
     std::shared_ptr<Material> material =  std::static_pointer_cast<Material>(voxelVisualizationMaterial);
     Material::Commands materialCommands(voxelVisualizationMaterial.get());
-    cubeShape->render(scene, group, materialCommands);
+    cubeShape->render(snapshot, group, materialCommands);
     commands.enableDepthTest(true);
     commands.end();
 }
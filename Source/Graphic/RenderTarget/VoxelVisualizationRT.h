@@ -25,7 +25,7 @@ public:
     
     VoxelVisualizationRT(Texture3D* voxelTexture);
     
-    virtual void Render( Scene& scene ) override;
+    virtual void Render( const SceneSnapshot& snapshot ) override;
     
     void SetVoxelTexture(Texture3D* voxelTexture);
     
@@ -38,5 +38,6 @@ private:
     
     //TODO: make these pointers shared pointers
     Shape *cubeShape = nullptr;
+    glm::mat4 cubeModel;
     Texture3D* voxelTexture = nullptr;
 };
@@ -17,17 +17,21 @@
 #include "Utility/Logger.h"
 #include "Shape/Mesh.h"
 #include "Shape.h"
+#include "Utility/JobSystem.h"
+#include "Graphic/GpuProfiler.h"
+#include "Utility/CpuProfiler.h"
 #include <stdio.h>
+#include <cstring>
 
 
 const float VoxelizeRT::VOXELS_WORLD_SCALE = 3.5f;
 
 VoxelizeRT::VoxelizeRT( float worldSpaceWidth, float worldSpaceHeight, float worldSpaceDepth ):
 downSample("downsize.cl", "downsample",
-           glm::vec3(VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS, VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS, VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS), 3)
+           glm::vec3(VoxelizationMaterial::voxelTextureDimensions, VoxelizationMaterial::voxelTextureDimensions, VoxelizationMaterial::voxelTextureDimensions), 3)
 {
     Texture::Dimensions dimensions;
-    dimensions.width = dimensions.height = dimensions.depth = VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS;
+    dimensions.width = dimensions.height = dimensions.depth = VoxelizationMaterial::voxelTextureDimensions;
     
     //properties will initialize to default values automatically
     Texture::Properties properties;
@@ -60,7 +64,7 @@ downSample("downsize.cl", "downsample",
 
 void VoxelizeRT::initMipMaps(Texture::Properties &properties)
 {
-    unsigned int downDimensions = VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS;
+    unsigned int downDimensions = VoxelizationMaterial::voxelTextureDimensions;
     assert( downDimensions % 2 == 0);
     downDimensions = downDimensions >> 1;
     while(downDimensions)
@@ -112,8 +116,9 @@ void VoxelizeRT::initDepthPeelingBuffers(Texture::Dimensions& dimensions, Textur
     }
 }
 
-void VoxelizeRT::voxelize(Scene& renderScene)
+void VoxelizeRT::voxelize(const SceneSnapshot& snapshot)
 {
+    GpuProfiler::Scope profile("Voxel fill");
     FBO::Commands voxelCommands(voxelFBO.get());
     
     voxelCommands.colorMask( true );
@@ -127,7 +132,7 @@ void VoxelizeRT::voxelize(Scene& renderScene)
         Texture2D* normalTexture = static_cast<Texture2D*>(depthFBOs[i]->getRenderTexture(1));
         
         static ShaderParameter::ShaderParamsGroup settings;
-        setLightingParameters(settings, renderScene.pointLights);
+        setLightingParameters(settings, snapshot.pointLights);
 
         settings["depthTexture"] = depthTexture;
         settings["albedoTexture"] = albedoTexture;
@@ -138,7 +143,7 @@ void VoxelizeRT::voxelize(Scene& renderScene)
         toWorldSpace = glm::inverse(toWorldSpace);
         settings["zPlaneProjection"] = voxViewProjection;
         settings["toWorldSpace"] = toWorldSpace;
-        settings["cubeDimensions"] = VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS;
+        settings["cubeDimensions"] = VoxelizationMaterial::voxelTextureDimensions;
         
         Material::Commands commands(voxMaterial.get());
         commands.uploadParameters(settings);
@@ -151,8 +156,9 @@ void VoxelizeRT::voxelize(Scene& renderScene)
 
 }
 
-void VoxelizeRT::presentOrthographicDepth(Scene &scene,  int layer)
+void VoxelizeRT::presentOrthographicDepth(const SceneSnapshot &snapshot,  int layer)
 {
+    GpuProfiler::Scope profile("Depth layer");
     FBO::Commands fboCommands(FBO_2D::getDefault().get());
     
     fboCommands.setClearColor();
@@ -174,13 +180,58 @@ void VoxelizeRT::presentOrthographicDepth(Scene &scene,  int layer)
     fboCommands.end();
 }
 
-void VoxelizeRT::generateDepthPeelingMaps(Scene& renderScene)
+void VoxelizeRT::generateDepthPeelingMaps(const SceneSnapshot& snapshot)
 {    
     static ShaderParameter::ShaderParamsGroup params;
     
     glm::mat4 MVP = orthoCamera.getProjectionMatrix() * orthoCamera.viewMatrix;
     bool firstRender = true;
+    cullingStats = MeshletCuller::Stats();
     
+    //every layer draws the same meshlets, they are picked and culled once on the JobSystem before the first layer
+    size_t drawCount = 0;
+    shapeDraws.clear();
+    for(const SceneSnapshot::ShapeState& state: snapshot.shapes)
+    {
+        ShapeDraw shapeDraw;
+        shapeDraw.state = &state;
+        shapeDraw.view = MeshletCuller::makeView(MVP, state.model, orthoCamera.position, false);
+        shapeDraw.firstMesh = drawCount;
+        for(Mesh* mesh : state.shape->meshes)
+        {
+            if(meshDraws.size() == drawCount)
+                meshDraws.emplace_back();
+            meshDraws[drawCount].mesh = mesh;
+            meshDraws[drawCount].shapeDraw = shapeDraws.size();
+            ++drawCount;
+        }
+        shapeDraws.push_back(shapeDraw);
+    }
+    
+    JobSystem::getInstance().parallelFor(drawCount, 4, [&](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            MeshDraw& draw = meshDraws[i];
+            const ShapeDraw& shapeDraw = shapeDraws[draw.shapeDraw];
+            
+            //triangles much smaller than a voxel only cost time, the edge length of a voxel in object space picks the level of detail
+            float voxelSize = VOXELS_WORLD_SCALE / float(VoxelizationMaterial::voxelTextureDimensions) / maxScale(shapeDraw.state->model);
+            unsigned int lod = voxelizeLods ? draw.mesh->lodForEdgeLength(voxelSize) : 0;
+            if(cullMeshlets && draw.mesh->enabled)
+            {
+                draw.mesh->cull(lod, shapeDraw.view, draw.drawList);
+            }
+            else
+            {
+                draw.drawList.lod = lod;
+                draw.drawList.whole = true;
+                draw.drawList.stats = MeshletCuller::Stats();
+            }
+        }
+    });
+    
+    GpuProfiler::Scope profile("Depth peeling");
     Texture2D dummyTexture(true);
     Texture2D* texture = firstRender ? &dummyTexture : static_cast<Texture2D*>(depthFBOs[0]->getDepthTexture());
 
@@ -197,20 +248,22 @@ void VoxelizeRT::generateDepthPeelingMaps(Scene& renderScene)
         commands.backFaceCulling(false);
         commands.enableDepthTest(true);
         
-        for(Shape* shape: renderScene.shapes)
+        for(const ShapeDraw& shapeDraw : shapeDraws)
         {
-            params["MVP"] = MVP *shape->transform.getTransformMatrix();
-            size_t numberOfProperties = shape->getMeshProperties().size();
-
-            int i = 0;
-            for(Mesh* mesh : shape->meshes)
+            const SceneSnapshot::ShapeState& state = *shapeDraw.state;
+            params["MVP"] = MVP * state.model;
+            size_t numberOfProperties = state.meshProperties.size();
+            
+            for(size_t j = 0; j < state.shape->meshes.size(); ++j)
             {
+                MeshDraw& draw = meshDraws[shapeDraw.firstMesh + j];
                 glError();
-                params["diffuseColor"] = i < numberOfProperties ? shape->getMeshProperties()[i].diffuseColor : shape->defaultVoxProperties.diffuseColor;
+                params["diffuseColor"] = j < numberOfProperties ? state.meshProperties[j].diffuseColor : state.defaultVoxProperties.diffuseColor;
                 
-                mesh->render(params, depthPeelingCommands);
+                draw.mesh->render(params, depthPeelingCommands, draw.drawList);
+                if(draw.mesh->enabled)
+                    cullingStats += draw.drawList.stats;
                 glError();
-                ++i;
             }
         }
         commands.end();
@@ -220,18 +273,20 @@ void VoxelizeRT::generateDepthPeelingMaps(Scene& renderScene)
     }
 }
 
-void VoxelizeRT::fillUpVoxelTexture(Scene& renderScene)
+void VoxelizeRT::fillUpVoxelTexture(const SceneSnapshot& snapshot)
 {
-    generateDepthPeelingMaps(renderScene);
-    voxelize(renderScene);
+    generateDepthPeelingMaps(snapshot);
+    voxelize(snapshot);
 }
 
 void VoxelizeRT::generateMipMaps()
 {
+    //OpenCL runs the down sampling, the queries only see the GL side waiting for it
+    GpuProfiler::Scope profile("Mipmaps");
     Texture3D* currentAlbedoTexture = static_cast<Texture3D*>(voxelFBO->getRenderTexture(0));
     Texture3D* currentNormalTexture = static_cast<Texture3D*>(voxelFBO->getRenderTexture(1));
     
-    unsigned int dimensions = VoxelizationMaterial::VOXEL_TEXTURE_DIMENSIONS;
+    unsigned int dimensions = VoxelizationMaterial::voxelTextureDimensions;
     int i = 0;
     for( std::shared_ptr<Texture3D> albedoMipMap : albedoMipMaps)
     {
@@ -254,8 +309,94 @@ void VoxelizeRT::generateMipMaps()
     }
     
 }
-void VoxelizeRT::Render(Scene& renderScene)
+namespace
+{
+    //FNV-1a over the values, not the bytes, so padding never counts
+    inline void hashValue(uint64_t& hash, float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 0x100000001b3ull;
+    }
+
+    inline void hashValue(uint64_t& hash, const glm::vec3& value)
+    {
+        hashValue(hash, value.x);
+        hashValue(hash, value.y);
+        hashValue(hash, value.z);
+    }
+
+    void hashProperties(uint64_t& hash, const VoxProperties& properties)
+    {
+        hashValue(hash, properties.diffuseColor);
+        hashValue(hash, properties.specularColor);
+        hashValue(hash, properties.diffuseReflectivity);
+        hashValue(hash, properties.specularReflectivity);
+        hashValue(hash, properties.specularDiffusion);
+        hashValue(hash, properties.emissivity);
+        hashValue(hash, properties.transparency);
+        hashValue(hash, properties.refractiveIndex);
+    }
+}
+
+bool VoxelizeRT::sceneChanged(const SceneSnapshot& snapshot)
+{
+    bool changed = false;
+    
+    changed |= snapshot.graphVersion != voxelizedGraphVersion;
+    voxelizedGraphVersion = snapshot.graphVersion;
+    
+    //models finish loading in the background and meshes can be toggled
+    size_t meshes = 0;
+    for(const SceneSnapshot::ShapeState& state : snapshot.shapes)
+    {
+        for(Mesh* mesh : state.shape->meshes)
+            meshes += mesh->enabled ? 1 : 0;
+    }
+    changed |= meshes != voxelizedMeshes;
+    voxelizedMeshes = meshes;
+    
+    //the voxels hold the colors and reflectivity of the meshes, edited in the UI or by the scene
+    uint64_t propertiesHash = 0xcbf29ce484222325ull;
+    for(const SceneSnapshot::ShapeState& state : snapshot.shapes)
+    {
+        hashProperties(propertiesHash, state.defaultVoxProperties);
+        for(const VoxProperties& properties : state.meshProperties)
+            hashProperties(propertiesHash, properties);
+    }
+    changed |= propertiesHash != voxelizedPropertiesHash;
+    voxelizedPropertiesHash = propertiesHash;
+    
+    //the voxels are lit, position and color of every light per entry
+    size_t lightCount = snapshot.pointLights.size() * 2;
+    changed |= lightCount != voxelizedLights.size();
+    voxelizedLights.resize(lightCount);
+    for(size_t i = 0; i < snapshot.pointLights.size(); ++i)
+    {
+        const PointLight& light = snapshot.pointLights[i];
+        changed |= light.position != voxelizedLights[i * 2] || light.color != voxelizedLights[i * 2 + 1];
+        voxelizedLights[i * 2] = light.position;
+        voxelizedLights[i * 2 + 1] = light.color;
+    }
+    
+    return changed;
+}
+
+void VoxelizeRT::Render(const SceneSnapshot& snapshot)
 {
+    PROFILE_SCOPE("VoxelizeRT::Render");
+    //the voxels only depend on the scene's transforms, lights and loaded meshes, reuse them until one of those changes
+    if(sceneChanged(snapshot) && automaticallyVoxelize)
+        voxelizationQueued = true;
+    
+    //under load the voxels may lag a moving scene by a few frames, the change stays queued until the interval passed
+    if(rendersSinceVoxelization < voxelizationInterval)
+        ++rendersSinceVoxelization;
+    if(!voxelizationQueued || rendersSinceVoxelization < voxelizationInterval)
+        return;
+    voxelizationQueued = false;
+    rendersSinceVoxelization = 0;
+    GpuProfiler::Scope profile("Voxelize");
     
     //for opengl 4.2  (Macs support up to  4.1) this code isn't necessary because you have access to extensions that allow you to
     //to do this much easier in a shader, check out imageLoad/imageStore glsl functions.  Also, check out
@@ -270,7 +411,7 @@ void VoxelizeRT::Render(Scene& renderScene)
     orthoCamera.up = glm::vec3(-1.0f, 0.0f, 0.0f);
     orthoCamera.updateViewMatrix();
 
-    fillUpVoxelTexture(renderScene);
+    fillUpVoxelTexture(snapshot);
 
 
     //from z plane
@@ -279,7 +420,7 @@ void VoxelizeRT::Render(Scene& renderScene)
     orthoCamera.up = glm::vec3(0.0f, 1.0f, 0.0f);
     orthoCamera.updateViewMatrix();
 
-    fillUpVoxelTexture(renderScene);
+    fillUpVoxelTexture(snapshot);
 
     //from x plane
     orthoCamera.position = glm::vec3(1.5f, .0f, 0.f);
@@ -287,7 +428,7 @@ void VoxelizeRT::Render(Scene& renderScene)
     orthoCamera.up = glm::vec3(0.0f, 1.0f, 0.0f);
     orthoCamera.updateViewMatrix();
 
-    fillUpVoxelTexture(renderScene);
+    fillUpVoxelTexture(snapshot);
 
     generateMipMaps();
 
@@ -16,6 +16,8 @@
 #include "ScreenQuad.h"
 #include <array>
 #include "ComputeShader.h"
+#include "Shape/Mesh.h"
+#include "Shape/MeshletCuller.h"
 
 class OrthographicCamera;
 class Material;
@@ -23,14 +25,15 @@ class Points;
 class VoxelizationMaterial;
 class FBO_3D;
 class Texture3D;
+class Shape;
 
 class VoxelizeRT : public RenderTarget
 {
 public:
     VoxelizeRT(float worldSpaceWidth, float worldSpaceHeight, float worldSpaceDepth );
-    void presentOrthographicDepth( Scene& scene, int layer);
+    void presentOrthographicDepth( const SceneSnapshot& snapshot, int layer);
     
-    virtual void Render( Scene& scene ) override;
+    virtual void Render( const SceneSnapshot& snapshot ) override;
     virtual ~VoxelizeRT();
     
     inline std::shared_ptr<FBO_3D> getFBO(){ return voxelFBO;};
@@ -43,22 +46,38 @@ public:
     
     static const float VOXELS_WORLD_SCALE;
     
+    // Meshlets tested and culled by the last voxelization, over all depth peeling layers.
+    MeshletCuller::Stats cullingStats;
+    
+    // Render calls at least from one voxelization to the next, a scene changing every frame is voxelized every interval frames.
+    unsigned int voxelizationInterval = 1;
+    
+    
 private:
-    void fillUpVoxelTexture( Scene& renderScene);
-    void voxelize(Scene& renderScene);
-    void generateDepthPeelingMaps(Scene& renderScene);
+    void fillUpVoxelTexture( const SceneSnapshot& snapshot);
+    void voxelize(const SceneSnapshot& snapshot);
+    void generateDepthPeelingMaps(const SceneSnapshot& snapshot);
     void initDepthBuffer(int index, Texture::Dimensions &dimensions, Texture::Properties& properties);
     void generateMipMaps();
     void initMipMaps(Texture::Properties& properties);
     void initDepthPeelingBuffers(Texture::Dimensions& dimensions, Texture::Properties& properties);
+    // True if a transform, light, ready shape, enabled mesh or voxel property changed since the last call, and remembers the current state.
+    bool sceneChanged(const SceneSnapshot& snapshot);
     
 private:
     bool automaticallyRegenerateMipmap = true;
     bool regenerateMipmapQueued = true;
     bool automaticallyVoxelize = true;
+    bool voxelizeLods = true; // depth peel the level of detail whose triangles are about a voxel large
+    bool cullMeshlets = true; // skip meshlets outside the voxel volume, every face is needed so none are backface culled
     bool voxelizationQueued = true;
-    int voxelizationSparsity = 1; // Number of ticks between mipmap generation.
-    int ticksSinceLastVoxelization = voxelizationSparsity;
+    unsigned int rendersSinceVoxelization = 0; // counts up to voxelizationInterval
+    
+    //what the voxels were last built from
+    unsigned long long voxelizedGraphVersion = 0;
+    size_t voxelizedMeshes = 0;
+    std::vector<glm::vec3> voxelizedLights;
+    uint64_t voxelizedPropertiesHash = 0; // of the default and per mesh VoxProperties of every shape
     
     
     //state variables we will be modifying
@@ -85,4 +104,20 @@ private:
     std::vector< std::shared_ptr<Texture3D> > normalMipMaps;
     
     std::array<std::shared_ptr<FBO_2D>, 5> depthFBOs {nullptr, nullptr, nullptr, nullptr};
+    
+    //what the depth peeling layers draw, culled once per axis and kept between frames so the draw lists keep their storage
+    struct ShapeDraw
+    {
+        const SceneSnapshot::ShapeState* state = nullptr;
+        MeshletCuller::View view;
+        size_t firstMesh = 0; // in meshDraws
+    };
+    struct MeshDraw
+    {
+        Mesh* mesh = nullptr;
+        size_t shapeDraw = 0;
+        Mesh::DrawList drawList;
+    };
+    std::vector<ShapeDraw> shapeDraws;
+    std::vector<MeshDraw> meshDraws;
 };
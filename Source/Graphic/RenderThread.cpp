@@ -0,0 +1,145 @@
+#include "RenderThread.h"
+
+#include "OpenGL_Includes.h"
+#include "Utility/CpuProfiler.h"
+
+void RenderThread::start(GLFWwindow* _window)
+{
+    if(isRunning())
+        return;
+
+    window = _window;
+    stopping = false;
+    running = true;
+    glfwMakeContextCurrent(nullptr); // a context is current on one thread at a time
+    thread = std::thread(&RenderThread::work, this);
+}
+
+void RenderThread::stop()
+{
+    if(!isRunning())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+    running = false;
+    glfwMakeContextCurrent(window);
+}
+
+RenderThread::Frame& RenderThread::beginFrame()
+{
+    Frame& frame = frames[back];
+    frame.overlay.clear();
+    frame.simulationStart = std::chrono::steady_clock::now();
+    return frame;
+}
+
+void RenderThread::submit(std::function<void()> sync)
+{
+    auto waitStart = std::chrono::steady_clock::now();
+
+    if(!isRunning())
+    {
+        if(sync)
+            sync();
+        waitSum += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+        render(frames[back]);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return !frameQueued && !rendering; });
+
+    //the front frame was drawn, it becomes the one filled next
+    back ^= 1;
+    syncJob = std::move(sync);
+    frameQueued = true;
+    changed.notify_all();
+
+    //the main thread stays out of the scene and the GL resources until the sync job ran
+    changed.wait(lock, [this]() { return !frameQueued; });
+    waitSum += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+}
+
+RenderThread::Stats RenderThread::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void RenderThread::work()
+{
+    CpuProfiler::getInstance().setThreadName("Render");
+    glfwMakeContextCurrent(window);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        changed.wait(lock, [this]() { return frameQueued || stopping; });
+        if(!frameQueued)
+            break;
+
+        rendering = true;
+        std::function<void()> sync = std::move(syncJob);
+        syncJob = nullptr;
+        lock.unlock();
+        if(sync)
+            sync();
+
+        lock.lock();
+        frameQueued = false;
+        changed.notify_all();
+        Frame& frame = frames[back ^ 1];
+        lock.unlock();
+
+        render(frame);
+
+        lock.lock();
+        rendering = false;
+        changed.notify_all();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+void RenderThread::render(Frame& frame)
+{
+    auto renderStart = std::chrono::steady_clock::now();
+    if(renderFunction)
+        renderFunction(frame);
+    auto renderEnd = std::chrono::steady_clock::now();
+
+    //the stats are read by the main thread, without a render thread there is no one to race with
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if(isRunning())
+        lock.lock();
+
+    if(!frame.paused)
+    {
+        ++presentedFrames;
+        latencySum += std::chrono::duration<double>(renderEnd - frame.simulationStart).count();
+        renderSum += std::chrono::duration<double>(renderEnd - renderStart).count();
+    }
+
+    double elapsed = std::chrono::duration<double>(renderEnd - statsStart).count();
+    if(elapsed >= 1.0)
+    {
+        double frames = double(std::max<size_t>(presentedFrames, 1));
+        stats.framesPerSecond = double(presentedFrames) / elapsed;
+        stats.latencySeconds = latencySum / frames;
+        stats.renderSeconds = renderSum / frames;
+        stats.waitSeconds = waitSum / frames;
+        presentedFrames = 0;
+        latencySum = renderSum = waitSum = 0.0;
+        statsStart = renderEnd;
+    }
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Graphic/Graphics.h"
+#include "Scene/SceneSnapshot.h"
+
+struct GLFWwindow;
+
+/// <summary>
+/// Thread owning the GL context and submitting the draws of a frame while the main thread simulates the next one.
+/// Two frames are kept: the main thread fills the back one through beginFrame and hands it over with submit, the render
+/// thread draws the front one. The main thread is at most one frame ahead, submit waits until the last frame was drawn.
+/// Without start() every submit renders on the calling thread, for debugging or contexts that can't move.
+/// </summary>
+class RenderThread
+{
+public:
+    /// <summary> Text drawn over the frame, held in place so filling the overlay doesn't allocate. </summary>
+    struct OverlayLine
+    {
+        static const size_t MAX_LENGTH = 160;
+
+        char text[MAX_LENGTH];
+        glm::vec2 position;
+    };
+
+    /// <summary> Everything the render thread reads of a frame. Filled by the main thread, read only while it renders. </summary>
+    struct Frame
+    {
+        SceneSnapshot snapshot;
+        Graphics::RenderingMode renderingMode = Graphics::RenderingMode::VOXEL_CONE_TRACING;
+        unsigned int viewportWidth = 0;
+        unsigned int viewportHeight = 0;
+        bool paused = false; // nothing is drawn nor presented
+        std::vector<OverlayLine> overlay;
+        std::chrono::steady_clock::time_point simulationStart; // set by beginFrame
+
+        /// <summary> Adds a line of overlay text, cut at OverlayLine::MAX_LENGTH - 1 characters. </summary>
+        inline void addOverlayLine(const char* text, glm::vec2 position)
+        {
+            overlay.emplace_back();
+            OverlayLine& line = overlay.back();
+            std::snprintf(line.text, OverlayLine::MAX_LENGTH, "%s", text);
+            line.position = position;
+        }
+    };
+
+    /// <summary> Averages over the last second, latency runs from the start of a frame's simulation to its present. </summary>
+    struct Stats
+    {
+        double latencySeconds = 0.0;
+        double framesPerSecond = 0.0;
+        double renderSeconds = 0.0; // render thread busy per frame
+        double waitSeconds = 0.0; // main thread blocked in submit per frame
+    };
+
+    using RenderFunction = std::function<void(Frame& frame)>;
+
+    /// <summary> Called for every submitted frame with the context current, it presents the frame itself, e.g. with glfwSwapBuffers. </summary>
+    inline void setRenderFunction(RenderFunction render) { renderFunction = std::move(render); }
+
+    /// <summary> Releases window's context on the calling thread and makes it current on a new thread rendering the submitted frames. </summary>
+    void start(GLFWwindow* window);
+
+    /// <summary> Draws the submitted frame, then ends the thread and makes the context current on the calling thread again. </summary>
+    void stop();
+
+    inline bool isRunning() const { return running; }
+
+    /// <summary> The frame to fill for the next submit, its vectors keep their storage from two frames ago. </summary>
+    Frame& beginFrame();
+
+    /// <summary>
+    /// Hands the frame from beginFrame to the render thread once it drew the last one. sync runs on the render thread
+    /// before drawing while the caller still waits, it is the place for GL work the main thread needs, such as AssetLoader::update.
+    /// Without start() sync and the render function run inline.
+    /// </summary>
+    void submit(std::function<void()> sync = nullptr);
+
+    Stats getStats();
+
+    ~RenderThread();
+
+private:
+    void work();
+    void render(Frame& frame);
+
+    GLFWwindow* window = nullptr;
+    RenderFunction renderFunction;
+
+    Frame frames[2];
+    unsigned int back = 0;
+
+    std::thread thread;
+    bool running = false; // set before the thread starts and cleared after it ended, unlike thread it is safe to read from it
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool frameQueued = false; // submitted, the render thread hasn't taken it yet
+    bool rendering = false;
+    bool stopping = false;
+    std::function<void()> syncJob;
+
+    //accumulated until a second passed, then moved to stats
+    std::chrono::steady_clock::time_point statsStart = std::chrono::steady_clock::now();
+    size_t presentedFrames = 0;
+    double latencySum = 0.0;
+    double renderSum = 0.0;
+    double waitSum = 0.0;
+    Stats stats;
+};
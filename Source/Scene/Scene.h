@@ -6,6 +6,7 @@
 
 #include "../Graphic/Lighting/PointLight.h"
 #include "../Graphic/Camera/Camera.h"
+#include "../Graphic/Camera/CameraPath.h"
 
 
 class Mesh;
@@ -17,7 +18,7 @@ public:
 	/// <summary> The main camera used for rendering. </summary>
 	Camera * renderingCamera = nullptr;
 
-	std::vector<Mesh *> renderers;
+	std::vector<Mesh *> renderers; // meshes of the shapes, owned by their (shared) assets
 	std::vector<PointLight> pointLights;
 
 	/// <summary> Updates the scene. Is called pre-render. </summary>
@@ -26,6 +27,9 @@ public:
 	/// <summary> Initializes the scene. Is called after construction, but before update and render. </summary>
 	virtual void init(unsigned int viewportWidth, unsigned int viewportHeight) = 0;
 
+	/// <summary> A camera flight showing the scene, for repeatable benchmarks, see InputReplay::startFlyThrough. Empty if it has none. </summary>
+	virtual CameraPath getFlyThrough() const { return CameraPath(); }
+
 	/// <summary> Creates a new scene. Does not initialize it. </summary>
 	Scene() {}
     
@@ -0,0 +1,61 @@
+#include "Scene/SceneBvh.h"
+
+#include "Scene/SceneGraph.h"
+#include "Shape/Mesh.h"
+#include "Shape/Shape.h"
+
+void SceneBvh::build(const std::vector<Shape*>& shapes)
+{
+    sources.clear();
+    std::vector<Bvh::Geometry> geometry;
+    for(Shape* shape : shapes)
+    {
+        if(!shape->active || !shape->isReady())
+            continue;
+
+        const glm::mat4& transform = shape->transform.getTransformMatrix();
+        for(Mesh* mesh : shape->meshes)
+        {
+            const std::vector<glm::vec3>& positions = mesh->getCollisionPositions();
+            const std::vector<unsigned int>& indices = mesh->getCollisionIndices();
+            if(indices.empty())
+                continue;
+
+            Bvh::Geometry meshGeometry;
+            meshGeometry.positions = positions.data();
+            meshGeometry.vertexCount = positions.size();
+            meshGeometry.indices = indices.data();
+            meshGeometry.indexCount = indices.size();
+            meshGeometry.transform = transform;
+            geometry.push_back(meshGeometry);
+            sources.push_back({ shape, mesh });
+        }
+    }
+    bvh.build(geometry);
+    graphVersion = SceneGraph::getInstance().getVersion();
+}
+
+bool SceneBvh::update()
+{
+    //nothing moved if no world matrix changed since the transforms were last read
+    SceneGraph& graph = SceneGraph::getInstance();
+    graph.update();
+    if(graph.getVersion() == graphVersion)
+        return false;
+    graphVersion = graph.getVersion();
+
+    bool moved = false;
+    for(size_t i = 0; i < sources.size(); ++i)
+    {
+        const glm::mat4& transform = sources[i].shape->transform.getTransformMatrix();
+        if(transform != bvh.getGeometry()[i].transform)
+        {
+            bvh.setTransform(i, transform);
+            moved = true;
+        }
+    }
+
+    if(moved)
+        bvh.refit();
+    return moved;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "Utility/Bvh.h"
+
+class Mesh;
+class Shape;
+
+/// <summary>
+/// Bvh over the meshes of a scene's shapes in world space, refit as their transforms change. Shapes still loading
+/// have no meshes yet and meshes without collision geometry (see Mesh::keepCollisionGeometry) are left out, build
+/// again once they are ready.
+/// </summary>
+class SceneBvh
+{
+public:
+    void build(const std::vector<Shape*>& shapes);
+
+    /// <summary> Refits the tree if the transform of any shape changed since the last build or update. Returns true if it did. </summary>
+    bool update();
+
+    inline const Bvh& getBvh() const { return bvh; }
+
+    /// <summary> The shape and mesh a hit belongs to. </summary>
+    inline Shape* getShape(const Bvh::Hit& hit) const { return hit.valid() ? sources[hit.geometry].shape : nullptr; }
+    inline Mesh* getMesh(const Bvh::Hit& hit) const { return hit.valid() ? sources[hit.geometry].mesh : nullptr; }
+
+private:
+    struct Source
+    {
+        Shape* shape;
+        Mesh* mesh;
+    };
+
+    std::vector<Source> sources; // one per Bvh geometry
+    Bvh bvh;
+    unsigned long long graphVersion = 0; // SceneGraph version the transforms were last read at
+};
@@ -0,0 +1,409 @@
+#include "Scene/SceneGraph.h"
+
+#include "Utility/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SCENE_GRAPH_SSE2 1
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define SCENE_GRAPH_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    //four lanes, one node per lane when composing and inverting, one matrix column when multiplying
+#if SCENE_GRAPH_SSE2
+    struct Float4 { __m128 v; };
+    inline Float4 load4(const float* p) { return { _mm_loadu_ps(p) }; }
+    inline Float4 splat4(float f) { return { _mm_set1_ps(f) }; }
+    inline void store4(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+    inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+#elif SCENE_GRAPH_NEON
+    struct Float4 { float32x4_t v; };
+    inline Float4 load4(const float* p) { return { vld1q_f32(p) }; }
+    inline Float4 splat4(float f) { return { vdupq_n_f32(f) }; }
+    inline void store4(float* p, Float4 a) { vst1q_f32(p, a.v); }
+    inline Float4 operator+(Float4 a, Float4 b) { return { vaddq_f32(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) { return { vsubq_f32(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) { return { vmulq_f32(a.v, b.v) }; }
+#else
+    struct Float4 { float v[4]; };
+    inline Float4 load4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline Float4 splat4(float f) { return { { f, f, f, f } }; }
+    inline void store4(float* p, Float4 a) { for(int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline Float4 operator+(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    inline Float4 operator-(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    inline Float4 operator*(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+#endif
+
+    //result = a * b, column by column
+    inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+    {
+        Float4 a0 = load4(&a[0][0]), a1 = load4(&a[1][0]), a2 = load4(&a[2][0]), a3 = load4(&a[3][0]);
+        for(int i = 0; i < 4; ++i)
+        {
+            const glm::vec4& column = b[i];
+            store4(&result[i][0], a0 * splat4(column.x) + a1 * splat4(column.y) + a2 * splat4(column.z) + a3 * splat4(column.w));
+        }
+    }
+}
+
+const SceneGraph::NodeId SceneGraph::INVALID;
+size_t SceneGraph::parallelThreshold = 4096;
+
+SceneGraph& SceneGraph::getInstance()
+{
+    static SceneGraph graph;
+    return graph;
+}
+
+SceneGraph::NodeId SceneGraph::create(Transform* owner)
+{
+    NodeId node;
+    if(!freeNodes.empty())
+    {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else
+    {
+        node = NodeId(parents.size());
+        for(std::vector<float>* values : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ })
+            values->push_back(0.0f);
+        parents.push_back(INVALID);
+        owners.push_back(nullptr);
+        alive.push_back(0);
+        locals.push_back(glm::mat4(1.0f));
+        worlds.push_back(glm::mat4(1.0f));
+        normals.push_back(glm::mat4(1.0f));
+        orderIndex.push_back(0);
+        subtreeEnd.push_back(0);
+        isDirtyNode.push_back(0);
+    }
+
+    positionX[node] = positionY[node] = positionZ[node] = 0.0f;
+    rotationX[node] = rotationY[node] = rotationZ[node] = 0.0f;
+    scaleX[node] = scaleY[node] = scaleZ[node] = 1.0f;
+    parents[node] = INVALID;
+    owners[node] = owner;
+    alive[node] = 1;
+    locals[node] = worlds[node] = normals[node] = glm::mat4(1.0f);
+
+    orderInvalid = true;
+    markDirty(node);
+    return node;
+}
+
+void SceneGraph::destroy(NodeId node)
+{
+    if(node == INVALID || node >= alive.size() || !alive[node])
+        return;
+
+    for(NodeId child = 0; child < NodeId(parents.size()); ++child)
+    {
+        if(parents[child] == node && alive[child])
+        {
+            parents[child] = INVALID;
+            markDirty(child);
+        }
+    }
+
+    alive[node] = 0;
+    owners[node] = nullptr;
+    parents[node] = INVALID;
+    freeNodes.push_back(node);
+    orderInvalid = true;
+}
+
+void SceneGraph::setParent(NodeId node, NodeId parent)
+{
+    if(parents[node] == parent)
+        return;
+
+    //refuse to make a node its own ancestor
+    for(NodeId ancestor = parent; ancestor != INVALID; ancestor = parents[ancestor])
+    {
+        if(ancestor == node)
+            return;
+    }
+
+    parents[node] = parent;
+    orderInvalid = true;
+    markDirty(node);
+}
+
+void SceneGraph::setPosition(NodeId node, const glm::vec3& position)
+{
+    positionX[node] = position.x;
+    positionY[node] = position.y;
+    positionZ[node] = position.z;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(NodeId node, const glm::vec3& rotation)
+{
+    rotationX[node] = rotation.x;
+    rotationY[node] = rotation.y;
+    rotationZ[node] = rotation.z;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(NodeId node, const glm::vec3& scale)
+{
+    scaleX[node] = scale.x;
+    scaleY[node] = scale.y;
+    scaleZ[node] = scale.z;
+    markDirty(node);
+}
+
+void SceneGraph::markDirty(NodeId node)
+{
+    if(isDirtyNode[node])
+        return;
+    isDirtyNode[node] = 1;
+    dirty.push_back(node);
+}
+
+size_t SceneGraph::update()
+{
+    if(!isDirty())
+        return 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if(orderInvalid)
+        rebuildOrder();
+
+    //nodes destroyed after they were changed have nothing left to update
+    dirty.erase(std::remove_if(dirty.begin(), dirty.end(), [this](NodeId node)
+    {
+        if(alive[node])
+            return false;
+        isDirtyNode[node] = 0;
+        return true;
+    }), dirty.end());
+
+    changed.clear();
+    if(dirty.empty())
+        return 0;
+
+    //locals four at a time, a few thousand nodes per job on large graphs
+    JobSystem& jobs = JobSystem::getInstance();
+    size_t groups = (dirty.size() + 3) / 4;
+    jobs.parallelFor(groups, dirty.size() < parallelThreshold ? groups : parallelThreshold / 4, [this](size_t begin, size_t end)
+    {
+        updateLocals(begin * 4, std::min(end * 4, dirty.size()));
+    });
+
+    //a dirty node invalidates its subtree, one contiguous range of order in which every parent is ahead of its children
+    std::sort(dirty.begin(), dirty.end(), [this](NodeId a, NodeId b) { return orderIndex[a] < orderIndex[b]; });
+    subtrees.clear();
+    unsigned int covered = 0;
+    for(NodeId node : dirty)
+    {
+        isDirtyNode[node] = 0;
+        if(orderIndex[node] < covered)
+            continue;
+
+        subtrees.push_back(changed.size());
+        changed.insert(changed.end(), order.begin() + orderIndex[node], order.begin() + subtreeEnd[node]);
+        covered = subtreeEnd[node];
+    }
+    subtrees.push_back(changed.size());
+
+    //the subtrees don't overlap, each one is walked parents first by one job
+    size_t subtreeCount = subtrees.size() - 1;
+    jobs.parallelFor(subtreeCount, changed.size() < parallelThreshold ? subtreeCount : 1, [this](size_t begin, size_t end)
+    {
+        for(size_t i = subtrees[begin]; i < subtrees[end]; ++i)
+        {
+            NodeId current = changed[i];
+            NodeId parent = parents[current];
+            if(parent == INVALID)
+                worlds[current] = locals[current];
+            else
+                multiply(worlds[parent], locals[current], worlds[current]);
+        }
+    });
+
+    groups = (changed.size() + 3) / 4;
+    jobs.parallelFor(groups, changed.size() < parallelThreshold ? groups : parallelThreshold / 4, [this](size_t begin, size_t end)
+    {
+        updateNormals(begin * 4, std::min(end * 4, changed.size()));
+    });
+
+    stats.nodes = order.size();
+    stats.localUpdates = dirty.size();
+    stats.worldUpdates = changed.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    dirty.clear();
+    ++version;
+    return changed.size();
+}
+
+void SceneGraph::rebuildOrder()
+{
+    size_t count = parents.size();
+
+    //children of every node grouped by parent, counting sort
+    std::vector<unsigned int> firstChild(count + 1, 0);
+    for(NodeId node = 0; node < count; ++node)
+    {
+        if(alive[node] && parents[node] != INVALID)
+            ++firstChild[parents[node] + 1];
+    }
+    for(size_t i = 0; i < count; ++i)
+        firstChild[i + 1] += firstChild[i];
+    std::vector<NodeId> children(firstChild[count]);
+    std::vector<unsigned int> next(firstChild.begin(), firstChild.end() - 1);
+    for(NodeId node = 0; node < count; ++node)
+    {
+        if(alive[node] && parents[node] != INVALID)
+            children[next[parents[node]]++] = node;
+    }
+
+    order.clear();
+    std::vector<NodeId> stack;
+    for(NodeId root = 0; root < count; ++root)
+    {
+        if(!alive[root] || parents[root] != INVALID)
+            continue;
+
+        stack.push_back(root);
+        while(!stack.empty())
+        {
+            NodeId node = stack.back();
+            stack.pop_back();
+            orderIndex[node] = (unsigned int)order.size();
+            order.push_back(node);
+            for(unsigned int i = firstChild[node + 1]; i > firstChild[node]; --i)
+                stack.push_back(children[i - 1]);
+        }
+    }
+
+    for(NodeId node : order)
+        subtreeEnd[node] = orderIndex[node] + 1;
+    for(size_t i = order.size(); i-- > 0;)
+    {
+        NodeId parent = parents[order[i]];
+        if(parent != INVALID)
+            subtreeEnd[parent] = std::max(subtreeEnd[parent], subtreeEnd[order[i]]);
+    }
+
+    orderInvalid = false;
+}
+
+void SceneGraph::updateLocals(size_t begin, size_t end)
+{
+    //translate(position) * mat4_cast(quat(rotation)) * scale(scale), four nodes at a time
+    for(size_t first = begin; first < end; first += 4)
+    {
+        NodeId lanes[4];
+        float cx[4], cy[4], cz[4], sx[4], sy[4], sz[4], kx[4], ky[4], kz[4];
+        for(size_t lane = 0; lane < 4; ++lane)
+        {
+            NodeId node = lanes[lane] = dirty[std::min(first + lane, end - 1)];
+            cx[lane] = std::cos(rotationX[node] * 0.5f);
+            cy[lane] = std::cos(rotationY[node] * 0.5f);
+            cz[lane] = std::cos(rotationZ[node] * 0.5f);
+            sx[lane] = std::sin(rotationX[node] * 0.5f);
+            sy[lane] = std::sin(rotationY[node] * 0.5f);
+            sz[lane] = std::sin(rotationZ[node] * 0.5f);
+            kx[lane] = scaleX[node];
+            ky[lane] = scaleY[node];
+            kz[lane] = scaleZ[node];
+        }
+
+        //quaternion from euler angles, as glm::quat(vec3)
+        Float4 cosX = load4(cx), cosY = load4(cy), cosZ = load4(cz);
+        Float4 sinX = load4(sx), sinY = load4(sy), sinZ = load4(sz);
+        Float4 w = cosX * cosY * cosZ + sinX * sinY * sinZ;
+        Float4 x = sinX * cosY * cosZ - cosX * sinY * sinZ;
+        Float4 y = cosX * sinY * cosZ + sinX * cosY * sinZ;
+        Float4 z = cosX * cosY * sinZ - sinX * sinY * cosZ;
+
+        Float4 one = splat4(1.0f), two = splat4(2.0f);
+        Float4 xx = x * x, yy = y * y, zz = z * z;
+        Float4 xy = x * y, xz = x * z, yz = y * z;
+        Float4 wx = w * x, wy = w * y, wz = w * z;
+        Float4 scaleX4 = load4(kx), scaleY4 = load4(ky), scaleZ4 = load4(kz);
+
+        float m[9][4];
+        store4(m[0], (one - two * (yy + zz)) * scaleX4);
+        store4(m[1], two * (xy + wz) * scaleX4);
+        store4(m[2], two * (xz - wy) * scaleX4);
+        store4(m[3], two * (xy - wz) * scaleY4);
+        store4(m[4], (one - two * (xx + zz)) * scaleY4);
+        store4(m[5], two * (yz + wx) * scaleY4);
+        store4(m[6], two * (xz + wy) * scaleZ4);
+        store4(m[7], two * (yz - wx) * scaleZ4);
+        store4(m[8], (one - two * (xx + yy)) * scaleZ4);
+
+        size_t count = std::min<size_t>(4, end - first);
+        for(size_t lane = 0; lane < count; ++lane)
+        {
+            NodeId node = lanes[lane];
+            glm::mat4& local = locals[node];
+            local[0] = glm::vec4(m[0][lane], m[1][lane], m[2][lane], 0.0f);
+            local[1] = glm::vec4(m[3][lane], m[4][lane], m[5][lane], 0.0f);
+            local[2] = glm::vec4(m[6][lane], m[7][lane], m[8][lane], 0.0f);
+            local[3] = glm::vec4(positionX[node], positionY[node], positionZ[node], 1.0f);
+        }
+    }
+}
+
+void SceneGraph::updateNormals(size_t begin, size_t end)
+{
+    //the inverse of a 3x3 with columns a, b, c has the rows b x c, c x a, a x b over the determinant, so those are the columns of its transpose
+    for(size_t first = begin; first < end; first += 4)
+    {
+        float a[3][4], b[3][4], c[3][4];
+        for(size_t lane = 0; lane < 4; ++lane)
+        {
+            const glm::mat4& world = worlds[changed[std::min(first + lane, end - 1)]];
+            for(int row = 0; row < 3; ++row)
+            {
+                a[row][lane] = world[0][row];
+                b[row][lane] = world[1][row];
+                c[row][lane] = world[2][row];
+            }
+        }
+
+        Float4 ax = load4(a[0]), ay = load4(a[1]), az = load4(a[2]);
+        Float4 bx = load4(b[0]), by = load4(b[1]), bz = load4(b[2]);
+        Float4 cx = load4(c[0]), cy = load4(c[1]), cz = load4(c[2]);
+
+        Float4 r0x = by * cz - bz * cy, r0y = bz * cx - bx * cz, r0z = bx * cy - by * cx;
+        Float4 r1x = cy * az - cz * ay, r1y = cz * ax - cx * az, r1z = cx * ay - cy * ax;
+        Float4 r2x = ay * bz - az * by, r2y = az * bx - ax * bz, r2z = ax * by - ay * bx;
+
+        float determinant[4];
+        store4(determinant, ax * r0x + ay * r0y + az * r0z);
+        for(float& d : determinant)
+            d = std::abs(d) > 1e-20f ? 1.0f / d : 0.0f; //a degenerate scale leaves its normals at zero
+        Float4 inverse = load4(determinant);
+
+        float n[9][4];
+        store4(n[0], r0x * inverse); store4(n[1], r0y * inverse); store4(n[2], r0z * inverse);
+        store4(n[3], r1x * inverse); store4(n[4], r1y * inverse); store4(n[5], r1z * inverse);
+        store4(n[6], r2x * inverse); store4(n[7], r2y * inverse); store4(n[8], r2z * inverse);
+
+        size_t count = std::min<size_t>(4, end - first);
+        for(size_t lane = 0; lane < count; ++lane)
+        {
+            glm::mat4& normal = normals[changed[first + lane]];
+            normal[0] = glm::vec4(n[0][lane], n[1][lane], n[2][lane], 0.0f);
+            normal[1] = glm::vec4(n[3][lane], n[4][lane], n[5][lane], 0.0f);
+            normal[2] = glm::vec4(n[6][lane], n[7][lane], n[8][lane], 0.0f);
+            normal[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+}
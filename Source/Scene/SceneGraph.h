@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class Transform;
+
+/// <summary>
+/// Parent/child hierarchy of every Transform. Local position, rotation (euler angles) and scale are kept in structure
+/// of arrays, setting one marks its node dirty and update() recomputes, once per frame, the local matrices of the dirty
+/// nodes four at a time with SSE2 or NEON, then the world and normal matrices of the dirty subtrees only, on the JobSystem
+/// once enough nodes changed.
+/// Nodes are kept in depth first order, so every subtree is one contiguous range and parents come before their children.
+/// Only used from the thread owning the scene.
+/// </summary>
+class SceneGraph
+{
+public:
+    typedef unsigned int NodeId;
+    static const NodeId INVALID = 0xFFFFFFFFu;
+
+    struct Stats
+    {
+        size_t nodes = 0;
+        size_t localUpdates = 0; // dirty nodes whose local matrix was recomputed
+        size_t worldUpdates = 0; // nodes whose world matrix changed, dirty ones and their descendants
+        double seconds = 0.0;
+    };
+
+    static SceneGraph& getInstance();
+
+    NodeId create(Transform* owner);
+    /// <summary> Children of a destroyed node become roots, keeping their local values. </summary>
+    void destroy(NodeId node);
+
+    inline void setOwner(NodeId node, Transform* owner) { owners[node] = owner; }
+    inline Transform* getOwner(NodeId node) const { return node == INVALID ? nullptr : owners[node]; }
+
+    void setParent(NodeId node, NodeId parent);
+    inline NodeId getParent(NodeId node) const { return parents[node]; }
+
+    void setPosition(NodeId node, const glm::vec3& position);
+    void setRotation(NodeId node, const glm::vec3& rotation);
+    void setScale(NodeId node, const glm::vec3& scale);
+    inline glm::vec3 getPosition(NodeId node) const { return glm::vec3(positionX[node], positionY[node], positionZ[node]); }
+    inline glm::vec3 getRotation(NodeId node) const { return glm::vec3(rotationX[node], rotationY[node], rotationZ[node]); }
+    inline glm::vec3 getScale(NodeId node) const { return glm::vec3(scaleX[node], scaleY[node], scaleZ[node]); }
+
+    /// <summary> Brings the world and normal matrices of every changed node and its descendants up to date. Returns how many changed. </summary>
+    size_t update();
+
+    /// <summary> True while a change is waiting for update(). </summary>
+    inline bool isDirty() const { return !dirty.empty() || orderInvalid; }
+
+    /// <summary> Local to world matrix as of the last update(). </summary>
+    inline const glm::mat4& getWorldMatrix(NodeId node) const { return worlds[node]; }
+
+    /// <summary> Inverse transpose of the world matrix's upper 3x3 for normals, in a mat4 with an identity last row and column. </summary>
+    inline const glm::mat4& getNormalMatrix(NodeId node) const { return normals[node]; }
+
+    /// <summary> The change events of the last update() that changed anything: every node whose world matrix changed. </summary>
+    inline const std::vector<NodeId>& getChanged() const { return changed; }
+
+    /// <summary> Incremented by every update() that changed a world matrix, compare two versions to tell whether anything moved in between. </summary>
+    inline unsigned long long getVersion() const { return version; }
+
+    inline const Stats& getStats() const { return stats; }
+
+    /// <summary> Nodes to update before update() spreads the work over the JobSystem, smaller changes stay on the calling thread. </summary>
+    static size_t parallelThreshold;
+
+private:
+    SceneGraph() {}
+    SceneGraph(const SceneGraph&) = delete;
+    SceneGraph& operator=(const SceneGraph&) = delete;
+
+    void markDirty(NodeId node);
+    void rebuildOrder();
+    // Local matrices of dirty[begin, end) and normal matrices of changed[begin, end), begin a multiple of four.
+    void updateLocals(size_t begin, size_t end);
+    void updateNormals(size_t begin, size_t end);
+
+    //local values, structure of arrays indexed by NodeId
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ;
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    std::vector<NodeId> parents;
+    std::vector<Transform*> owners;
+    std::vector<unsigned char> alive;
+    std::vector<NodeId> freeNodes;
+
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat4> normals;
+
+    std::vector<NodeId> order; // alive nodes depth first, parents before their children
+    std::vector<unsigned int> orderIndex; // index of every node in order
+    std::vector<unsigned int> subtreeEnd; // one past the node's last descendant in order
+    bool orderInvalid = false;
+
+    std::vector<unsigned char> isDirtyNode;
+    std::vector<NodeId> dirty;
+    std::vector<NodeId> changed;
+    std::vector<size_t> subtrees; // where every dirty subtree starts in changed, then changed.size()
+    unsigned long long version = 0;
+    Stats stats;
+};
@@ -1,6 +1,25 @@
 #pragma once
 
+#include <string>
+
 #include "Scenes/CornellScene.h"
 #include "Scenes/DragonScene.h"
 #include "Scenes/MultipleObjectsScene.h"
 #include "Scenes/GlassScene.h"
+
+/// <summary> Names of the stock scenes for tools choosing one by name, see createStockScene. </summary>
+static const char* const STOCK_SCENES[] = { "glass", "cornell", "dragon", "multiple" };
+
+/// <summary> A new uninitialized stock scene by name, nullptr for unknown names. </summary>
+inline Scene* createStockScene(const std::string& name)
+{
+	if (name == "glass")
+		return new GlassScene();
+	if (name == "cornell")
+		return new CornellScene();
+	if (name == "dragon")
+		return new DragonScene();
+	if (name == "multiple")
+		return new MultipleObjectsScene();
+	return nullptr;
+}
@@ -0,0 +1,33 @@
+#include "Scene/SceneSnapshot.h"
+
+#include "Scene/Scene.h"
+#include "Scene/SceneGraph.h"
+#include "Shape/Shape.h"
+
+void SceneSnapshot::capture(Scene& scene)
+{
+    SceneGraph& graph = SceneGraph::getInstance();
+    graphVersion = graph.getVersion();
+
+    if(scene.renderingCamera)
+        static_cast<Camera&>(camera) = *scene.renderingCamera;
+    pointLights = scene.pointLights;
+
+    //the entries of the last capture are overwritten in place, their vectors keep their capacity, the ones past the ready shapes are dropped
+    size_t shapeCount = 0;
+    for(Shape* shape : scene.shapes)
+    {
+        if(!shape->isReady())
+            continue;
+
+        if(shapeCount == shapes.size())
+            shapes.emplace_back();
+        ShapeState& state = shapes[shapeCount++];
+        state.shape = shape;
+        state.model = graph.getWorldMatrix(shape->transform.getNode());
+        state.normal = graph.getNormalMatrix(shape->transform.getNode());
+        state.defaultVoxProperties = shape->defaultVoxProperties;
+        state.meshProperties.assign(shape->meshProperties.begin(), shape->meshProperties.end());
+    }
+    shapes.resize(shapeCount);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Graphic/Camera/PerspectiveCamera.h"
+#include "Graphic/Lighting/PointLight.h"
+#include "Graphic/Material/Voxelization/VoxelizationMaterial.h"
+
+class Scene;
+class Shape;
+
+/// <summary>
+/// Copy of everything a frame renders, taken from a Scene on the thread simulating it and read by the render passes
+/// without touching the Scene or the SceneGraph again: the camera, the lights and the transforms and properties of the
+/// shapes that are ready. Meshes are referenced, not copied, they only change while the render thread waits (see RenderThread).
+/// </summary>
+class SceneSnapshot
+{
+public:
+    struct ShapeState
+    {
+        Shape* shape = nullptr; // for its meshes only
+        glm::mat4 model;
+        glm::mat4 normal; // inverse transpose of model, see SceneGraph::getNormalMatrix
+        VoxProperties defaultVoxProperties;
+        std::vector<VoxProperties> meshProperties;
+    };
+
+    /// <summary> Overwrites the snapshot with scene as it is now, reusing the storage of the last capture. Call after SceneGraph::update. </summary>
+    void capture(Scene& scene);
+
+    /// <summary> A copy of the scene's rendering camera, only its Camera part. </summary>
+    PerspectiveCamera camera;
+    std::vector<PointLight> pointLights;
+    std::vector<ShapeState> shapes; // ready shapes in the scene's order
+
+    /// <summary> SceneGraph::getVersion() at capture, tells the passes whether anything moved since an older snapshot. </summary>
+    unsigned long long graphVersion = 0;
+};
@@ -11,6 +11,7 @@
 #include "Graphic/Lighting/PointLight.h"
 #include "Time/FrameRate.h"
 #include "Utility/ObjLoader.h"
+#include "Utility/AssetLoader.h"
 #include "Graphic/Material/ShaderParameter.h"
 #include "Shape/CornellBox.h"
 
@@ -27,17 +28,17 @@ void CornellScene::init(unsigned int viewportWidth, unsigned int viewportHeight)
 		renderers.push_back(((cornell->meshes[i])));
 	}
 
-    cornell->transform.position -= glm::vec3(0.00f, 0.0f, 0);
-    cornell->transform.scale = glm::vec3(0.995f);
-    cornell->transform.updateTransformMatrix();
+    cornell->transform.setPosition(glm::vec3(0.00f, 0.0f, 0));
+    cornell->transform.setScale(glm::vec3(0.995f));
 
 	// Light sphere.
-	lightSphere = ObjLoader::loadShapeFromObj("Assets\\Models\\sphere.obj");
+	lightSphere = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\sphere.obj", [this](Shape& shape) {
+		for (unsigned int i = 0; i < shape.meshes.size(); ++i) {
+			renderers.push_back((shape.meshes[i]));
+		}
+		lightSphereIndex = renderers.size() - 1;
+	});
 	shapes.push_back(lightSphere);
-	for (unsigned int i = 0; i < lightSphere->meshes.size(); ++i) {
-		renderers.push_back((lightSphere->meshes[i]));
-	}
-	lightSphereIndex = renderers.size() - 1;
 
 	renderers[5]->tweakable = true;
 
@@ -67,18 +68,29 @@ void CornellScene::update() {
 	glm::vec3 r = glm::vec3(sinf(float(FrameRate::time * 0.97)), sinf(float(FrameRate::time * 0.45)), sinf(float(FrameRate::time * 0.32)));
 
 	// Lighting.
-	lightSphere->transform.position = glm::vec3(0, 0.5, 0.1) + r * 0.1f;
-	lightSphere->transform.position.x *= 4.5f;
-	lightSphere->transform.position.z *= 4.5f;
-	lightSphere->transform.rotation = r;
-	lightSphere->transform.scale = glm::vec3(0.049f);
-	lightSphere->transform.updateTransformMatrix();
-
-	pointLights[0].position = lightSphere->transform.position;
+	glm::vec3 lightPosition = glm::vec3(0, 0.5, 0.1) + r * 0.1f;
+	lightPosition.x *= 4.5f;
+	lightPosition.z *= 4.5f;
+	lightSphere->transform.set(lightPosition, r, glm::vec3(0.049f));
+
+	pointLights[0].position = lightPosition;
     lightSphere->defaultVoxProperties.diffuseColor = pointLights[0].color;
 }
 
 CornellScene::~CornellScene() {
-	for (auto * r : renderers) delete r;
 	for (auto * s : shapes) delete s;
 }
+
+// Into the box past the flying ball, along the walls and back out.
+CameraPath CornellScene::getFlyThrough() const {
+	CameraPath path;
+	path.keys = {
+		{ 0.0, glm::vec3(0.0f, 0.0f, 1.8f), glm::vec3(0.0f, 0.0f, 0.0f) },
+		{ 3.0, glm::vec3(0.55f, 0.35f, 0.9f), glm::vec3(0.0f, 0.0f, -0.3f) },
+		{ 6.0, glm::vec3(0.6f, -0.45f, 0.2f), glm::vec3(-0.5f, 0.2f, -0.8f) },
+		{ 9.0, glm::vec3(-0.6f, 0.4f, 0.3f), glm::vec3(0.5f, -0.4f, -0.6f) },
+		{ 12.0, glm::vec3(-0.3f, 0.0f, 1.2f), glm::vec3(0.0f, 0.0f, 0.0f) },
+		{ 14.0, glm::vec3(0.0f, 0.0f, 1.8f), glm::vec3(0.0f, 0.0f, 0.0f) }
+	};
+	return path;
+}
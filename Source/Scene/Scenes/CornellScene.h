@@ -11,6 +11,7 @@ class CornellScene : public FirstPersonScene {
 public:
 	void update() override;
 	void init(unsigned int viewportWidth, unsigned int viewportHeight) override;
+	CameraPath getFlyThrough() const override;
 	~CornellScene();
 private:
 	std::vector<Shape*> shapes;
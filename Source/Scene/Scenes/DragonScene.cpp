@@ -8,6 +8,7 @@
 #include "Graphic/Camera/PerspectiveCamera.h"
 #include "Time/FrameRate.h"
 #include "Utility/ObjLoader.h"
+#include "Utility/AssetLoader.h"
 #include "Graphic/Material/ShaderParameter.h"
 #include "Shape/CornellBox.h"
 #include "Application.h"
@@ -21,27 +22,26 @@ void DragonScene::init(unsigned int viewportWidth, unsigned int viewportHeight)
 	shapes.push_back(cornell);
 	for (unsigned int i = 0; i < cornell->meshes.size(); ++i) renderers.push_back((cornell->meshes[i]));
 
-    cornell->transform.position -= glm::vec3(0.00f, 0.0f, 0);
-    cornell->transform.scale = glm::vec3(0.995f);
-    cornell->transform.updateTransformMatrix();
+    cornell->transform.setPosition(glm::vec3(0.00f, 0.0f, 0));
+    cornell->transform.setScale(glm::vec3(0.995f));
 
     renderers[5]->enabled = false; // Disable boxes.
 	renderers[6]->enabled = false; // Disable boxes.
 
 	// Dragon.
-	int dragonIndex = renderers.size();
-	Shape * dragon = ObjLoader::loadShapeFromObj("Assets\\Models\\dragon.obj");
+	Shape * dragon = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\dragon.obj", [this](Shape& shape) {
+		int dragonIndex = renderers.size();
+		for (unsigned int i = 0; i < shape.meshes.size(); ++i) {
+			renderers.push_back(((shape.meshes[i])));
+		}
+		auto * dragonRenderer = renderers[dragonIndex];
+		dragonRenderer->tweakable = true;
+		dragonRenderer->name = "Dragon";
+	});
 	shapes.push_back(dragon);
-	for (unsigned int i = 0; i < dragon->meshes.size(); ++i) {
-		renderers.push_back(((dragon->meshes[i])));
-	}
-	auto * dragonRenderer = renderers[dragonIndex];
-	dragon->transform.scale = glm::vec3(1.79f);
-	dragon->transform.rotation = glm::vec3(0, 2.0, 0);
-	dragon->transform.position = glm::vec3(-0.09f, -0.50f, 0.01f);
-	dragon->transform.updateTransformMatrix();
-	dragonRenderer->tweakable = true;
-	dragonRenderer->name = "Dragon";
+	dragon->transform.setScale(glm::vec3(1.79f));
+	dragon->transform.setRotation(glm::vec3(0, 2.0, 0));
+	dragon->transform.setPosition(glm::vec3(-0.09f, -0.50f, 0.01f));
 
     dragon->defaultVoxProperties = VoxProperties::White();
 
@@ -59,10 +59,11 @@ void DragonScene::init(unsigned int viewportWidth, unsigned int viewportHeight)
     dragon->defaultVoxProperties = voxProps;
 
 	// Light.
-	light = ObjLoader::loadShapeFromObj("Assets\\Models\\quad.obj");
+	light = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\quad.obj", [this](Shape& shape) {
+		renderers.push_back(shape.meshes[0]);
+		shape.meshes[0]->name = "Ceiling lamp";
+	});
 	shapes.push_back(light);
-
-	renderers.push_back(light->meshes[0]);
 
     light->defaultVoxProperties = VoxProperties::Emissive();
     light->defaultVoxProperties.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -71,16 +72,14 @@ void DragonScene::init(unsigned int viewportWidth, unsigned int viewportHeight)
     light->defaultVoxProperties.diffuseReflectivity = 1.0f;
     
 
-	light->transform.position = glm::vec3(0, 0.975, 0);
-	light->transform.rotation = glm::vec3(-3.1414 * 0.5, 3.1414 * 0.5, 0);
-	light->transform.scale = glm::vec3(0.14f, 0.34f, 1.0f);
-	light->transform.updateTransformMatrix();
-	light->meshes[0]->name = "Ceiling lamp";
+	light->transform.setPosition(glm::vec3(0, 0.975, 0));
+	light->transform.setRotation(glm::vec3(-3.1414 * 0.5, 3.1414 * 0.5, 0));
+	light->transform.setScale(glm::vec3(0.14f, 0.34f, 1.0f));
 
 	// Point light.
 	PointLight p;
 	p.color = glm::vec3(0.5);
-	p.position = light->transform.position - glm::vec3(0, 0.2, 0);
+	p.position = light->transform.getPosition() - glm::vec3(0, 0.2, 0);
 	pointLights.push_back(p);
 }
 
@@ -99,5 +98,18 @@ void DragonScene::update() {
 
 DragonScene::~DragonScene() {
 	for (auto * s : shapes) delete s;
-	for (auto * r : renderers) delete r;
+}
+
+// Around the dragon close to its specular scales, then up to the lamp and back.
+CameraPath DragonScene::getFlyThrough() const {
+	CameraPath path;
+	path.keys = {
+		{ 0.0, glm::vec3(0.0f, 0.0f, 1.8f), glm::vec3(-0.09f, -0.3f, 0.0f) },
+		{ 3.0, glm::vec3(0.6f, -0.2f, 0.8f), glm::vec3(-0.09f, -0.35f, 0.0f) },
+		{ 6.0, glm::vec3(0.5f, -0.4f, -0.3f), glm::vec3(-0.09f, -0.35f, 0.0f) },
+		{ 9.0, glm::vec3(-0.6f, -0.1f, 0.6f), glm::vec3(-0.09f, -0.4f, 0.0f) },
+		{ 12.0, glm::vec3(0.0f, 0.5f, 0.8f), glm::vec3(0.0f, 0.9f, 0.0f) },
+		{ 14.0, glm::vec3(0.0f, 0.0f, 1.8f), glm::vec3(-0.09f, -0.3f, 0.0f) }
+	};
+	return path;
 }
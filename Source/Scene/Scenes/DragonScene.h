@@ -12,6 +12,7 @@ class DragonScene : public FirstPersonScene {
 public:
 	void update() override;
 	void init(unsigned int viewportWidth, unsigned int viewportHeight) override;
+	CameraPath getFlyThrough() const override;
 	~DragonScene();
 private:
 	std::vector<Shape*> shapes;
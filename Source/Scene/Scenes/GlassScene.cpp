@@ -7,6 +7,7 @@
 #include "Graphic/Lighting/PointLight.h"
 #include "Time/FrameRate.h"
 #include "Utility/ObjLoader.h"
+#include "Utility/AssetLoader.h"
 #include "Graphic/Material/ShaderParameter.h"
 #include "Shape/CornellBox.h"
 
@@ -29,38 +30,40 @@ void GlassScene::init(unsigned int viewportWidth, unsigned int viewportHeight) {
 		renderers.push_back(((cornell->meshes[i])));
 	}
 
-    cornell->transform.position -= glm::vec3(0.00f, 0.0f, 0);
-    cornell->transform.scale = glm::vec3(0.995f);
-    cornell->transform.updateTransformMatrix();
+    cornell->transform.setPosition(glm::vec3(0.00f, 0.0f, 0));
+    cornell->transform.setScale(glm::vec3(0.995f));
 
 
 	// Light cube.
-	lightCube = ObjLoader::loadShapeFromObj("/Assets/Models/sphere.obj");
+	lightCube = AssetLoader::getInstance().loadShapeFromObj("/Assets/Models/sphere.obj", [this](Shape& shape) {
+		for (unsigned int i = 0; i < shape.meshes.size(); ++i) {
+			renderers.push_back(((shape.meshes[i])));
+		}
+		lightCubeIndex = renderers.size() - 1;
+		renderers[lightCubeIndex]->enabled = true;
+		renderers[lightCubeIndex]->name = "light cube";
+	});
 	shapes.push_back(lightCube);
-	for (unsigned int i = 0; i < lightCube->meshes.size(); ++i) {
-		renderers.push_back(((lightCube->meshes[i])));
-	}
-	lightCubeIndex = renderers.size() - 1;
-
+
     lightCube->defaultVoxProperties = VoxProperties::White();
-    // Buddha.
-    int buddhaIndex = renderers.size();
-    buddha = ObjLoader::loadShapeFromObj("/Assets/Models/dragon.obj");
-    shapes.push_back(buddha);
-    for (unsigned int i = 0; i < buddha->meshes.size(); ++i) {
-        renderers.push_back(((buddha->meshes[i])));
-    }
-    
-    buddhaRenderer = renderers[buddhaIndex];
-    buddha->transform.scale = glm::vec3(1.6f);
-    buddha->transform.rotation = glm::vec3(0, 2.4, 0);
-    buddha->transform.position = glm::vec3(0, -0.5, 0.05);
-    buddha->transform.updateTransformMatrix();
-    buddhaRenderer->tweakable = true;
-    buddhaRenderer->name = "Buddha";
-    buddhaRenderer->enabled = true;
-
-    buddha->defaultVoxProperties = VoxProperties::White();
+    // Buddha.
+    buddha = AssetLoader::getInstance().loadShapeFromObj("/Assets/Models/dragon.obj", [this](Shape& shape) {
+        int buddhaIndex = renderers.size();
+        for (unsigned int i = 0; i < shape.meshes.size(); ++i) {
+            renderers.push_back(((shape.meshes[i])));
+        }
+        buddhaRenderer = renderers[buddhaIndex];
+        buddhaRenderer->tweakable = true;
+        buddhaRenderer->name = "Buddha";
+        buddhaRenderer->enabled = true;
+    });
+    shapes.push_back(buddha);
+    
+    buddha->transform.setScale(glm::vec3(1.6f));
+    buddha->transform.setRotation(glm::vec3(0, 2.4, 0));
+    buddha->transform.setPosition(glm::vec3(0, -0.5, 0.05));
+
+    buddha->defaultVoxProperties = VoxProperties::White();
 
     
     buddha->defaultVoxProperties.specularColor = glm::vec3(0.99f, 0.62f, 0.43f);
@@ -76,12 +79,7 @@ void GlassScene::init(unsigned int viewportWidth, unsigned int viewportHeight) {
     lightCube->defaultVoxProperties.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
     lightCube->defaultVoxProperties.emissivity = 8.0f;
     lightCube->defaultVoxProperties.specularReflectivity = 0.0f;
-    lightCube->defaultVoxProperties.diffuseReflectivity = 0.0f;
-    
-    renderers[lightCubeIndex]->enabled = true;
-    
-
-    renderers[lightCubeIndex]->name = "light cube";
+    lightCube->defaultVoxProperties.diffuseReflectivity = 0.0f;
 
 	// An additional wall (behind the camera).
 	int backWallIndex = renderers.size();
@@ -97,19 +95,31 @@ void GlassScene::init(unsigned int viewportWidth, unsigned int viewportHeight) {
 void GlassScene::update() {
 	FirstPersonScene::update();
 
-    //buddha->transform.rotation.y = FrameRate::time;
-    //buddha->transform.updateTransformMatrix();
+    //buddha->transform.setRotation(glm::vec3(0, FrameRate::time, 0));
 
     glm::vec3 r = glm::vec3(sinf(float(FrameRate::time * 0.67)), sinf(float(FrameRate::time * 0.78)), cosf(float(FrameRate::time * 0.67))) * .6f;
 
-    pointLights[0].position = r; //renderers[lightCubeIndex]->transform.position;
-    lightCube->transform.position = r;
-    lightCube->transform.scale = glm::vec3(.03f);
-    lightCube->transform.updateTransformMatrix();
-    //lightCube->transform.position = r;
+    pointLights[0].position = r; //renderers[lightCubeIndex]->transform.getPosition();
+    lightCube->transform.setPosition(r);
+    lightCube->transform.setScale(glm::vec3(.03f));
+    //lightCube->transform.setPosition(r);
 }
 
 GlassScene::~GlassScene() {
 	for (auto * s : shapes)
         delete s;
 }
+
+// Around the refractive model, low enough to look through it at the walls.
+CameraPath GlassScene::getFlyThrough() const {
+	CameraPath path;
+	path.keys = {
+		{ 0.0, glm::vec3(0.0f, 0.0f, 1.5f), glm::vec3(0.0f, -0.2f, 0.0f) },
+		{ 3.0, glm::vec3(0.5f, 0.1f, 0.9f), glm::vec3(0.0f, -0.3f, 0.05f) },
+		{ 6.0, glm::vec3(0.65f, -0.25f, 0.3f), glm::vec3(0.0f, -0.35f, 0.05f) },
+		{ 9.0, glm::vec3(-0.6f, 0.3f, 0.6f), glm::vec3(0.0f, -0.35f, 0.05f) },
+		{ 12.0, glm::vec3(-0.2f, -0.3f, 1.0f), glm::vec3(0.2f, -0.4f, -0.5f) },
+		{ 14.0, glm::vec3(0.0f, 0.0f, 1.5f), glm::vec3(0.0f, -0.2f, 0.0f) }
+	};
+	return path;
+}
@@ -9,6 +9,7 @@
 #include "Graphic/Camera/PerspectiveCamera.h"
 #include "Time/FrameRate.h"
 #include "Utility/ObjLoader.h"
+#include "Utility/AssetLoader.h"
 #include "Graphic/Material/ShaderParameter.h"
 #include "Shape/CornellBox.h"
 #include "Application.h"
@@ -24,24 +25,25 @@ void MultipleObjectsScene::init(unsigned int viewportWidth, unsigned int viewpor
 	for (unsigned int i = 0; i < cornell->meshes.size(); ++i) {
 		renderers.push_back(cornell->meshes[i]);
 	}
-    cornell->transform.position -= glm::vec3(0.00f, 0.0f, 0);
-    cornell->transform.scale = glm::vec3(0.995f);
-    cornell->transform.updateTransformMatrix();
+    cornell->transform.setPosition(glm::vec3(0.00f, 0.0f, 0));
+    cornell->transform.setScale(glm::vec3(0.995f));
     cornell->defaultVoxProperties = VoxProperties::Red();
     
 	renderers[5]->enabled = false; // Disable boxes.
 	renderers[6]->enabled = false; // Disable boxes.
 
+	// Models load in the background, their meshes are only there once the shape is ready.
+	auto addRenderers = [this](Shape& shape) {
+		for (unsigned int i = 0; i < shape.meshes.size(); ++i) {
+			renderers.push_back((shape.meshes[i]));
+		}
+		if (!shape.meshes.empty()) shape.meshes[0]->tweakable = true;
+	};
+
 	// Susanne.
-	int objectIndex = renderers.size();
-	Shape * object = ObjLoader::loadShapeFromObj("Assets\\Models\\susanne.obj");
+	Shape * object = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\susanne.obj", addRenderers);
 	shapes.push_back(object);
-	for (unsigned int i = 0; i < object->meshes.size(); ++i) {
-		renderers.push_back((object->meshes[i]));
-	}
 
-	Mesh * objectRenderer = renderers[objectIndex];
-
     object->defaultVoxProperties = VoxProperties::White();
     
     object->defaultVoxProperties.specularColor = glm::vec3(0.2f, 0.8f, 1.0f);
@@ -52,24 +54,14 @@ void MultipleObjectsScene::init(unsigned int viewportWidth, unsigned int viewpor
     object->defaultVoxProperties.specularDiffusion = 3.2f;
     object->defaultVoxProperties.transparency = 1.0f;
     
-
-	objectRenderer->tweakable = true;
-    
-    object->transform.scale = glm::vec3(0.23f);
-    object->transform.rotation = glm::vec3(0.0f, 0.3f, 0.f);
-    object->transform.position = glm::vec3(0.07f, -0.49f, 0.36f);
-    object->transform.updateTransformMatrix();
+    object->transform.setScale(glm::vec3(0.23f));
+    object->transform.setRotation(glm::vec3(0.0f, 0.3f, 0.f));
+    object->transform.setPosition(glm::vec3(0.07f, -0.49f, 0.36f));
 
 	// Dragon.
-	objectIndex = renderers.size();
-	object = ObjLoader::loadShapeFromObj("Assets\\Models\\dragon.obj");
+	object = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\dragon.obj", addRenderers);
 	shapes.push_back(object);
-	for (unsigned int i = 0; i < object->meshes.size(); ++i) {
-		renderers.push_back((object->meshes[i]));
-	}
 
-	objectRenderer = renderers[objectIndex];
-
     object->defaultVoxProperties = VoxProperties::White();
     
     object->defaultVoxProperties.specularColor = glm::vec3(1.0f, 0.8f, 0.6f);
@@ -79,43 +71,32 @@ void MultipleObjectsScene::init(unsigned int viewportWidth, unsigned int viewpor
     object->defaultVoxProperties.diffuseReflectivity = 1.0f;
     object->defaultVoxProperties.specularDiffusion = 2.2f;
     
-    
-    objectRenderer->tweakable = true;
-	object->transform.scale = glm::vec3(1.3f);
-	object->transform.rotation = glm::vec3(0, 2.1, 0);
-	object->transform.position = glm::vec3(-0.28, -0.52, 0.00);
-	object->transform.updateTransformMatrix();
+	object->transform.setScale(glm::vec3(1.3f));
+	object->transform.setRotation(glm::vec3(0, 2.1, 0));
+	object->transform.setPosition(glm::vec3(-0.28, -0.52, 0.00));
 
 	// Bunny.
-	objectIndex = renderers.size();
-	object = ObjLoader::loadShapeFromObj("Assets\\Models\\bunny.obj");
+	object = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\bunny.obj", addRenderers);
 	shapes.push_back(object);
-	for (unsigned int i = 0; i < object->meshes.size(); ++i) {
-		renderers.push_back(((object->meshes[i])));
-	}
 
-	//objectRenderer = renderers[objectIndex];
-	
     object->defaultVoxProperties = VoxProperties::White();
     object->defaultVoxProperties.specularColor = glm::vec3(0.7f, 0.8f, 0.7f);
     object->defaultVoxProperties.diffuseColor = (object->defaultVoxProperties.specularColor);
     object->defaultVoxProperties.emissivity = 0.0f;
     object->defaultVoxProperties.specularReflectivity = 0.6f;
     object->defaultVoxProperties.diffuseReflectivity = 0.5f;
-    object->defaultVoxProperties.specularDiffusion = 9.4f;
+    object->defaultVoxProperties.specularDiffusion = 9.4f;
     
-	objectRenderer->tweakable = true;
-	object->transform.scale = glm::vec3(0.31f);
-	object->transform.rotation = glm::vec3(0, 0.4, 0);
-	object->transform.position = glm::vec3(0.44, -0.52, 0);
-	object->transform.updateTransformMatrix();
+	object->transform.setScale(glm::vec3(0.31f));
+	object->transform.setRotation(glm::vec3(0, 0.4, 0));
+	object->transform.setPosition(glm::vec3(0.44, -0.52, 0));
 
 	// Light.
-	int lightIndex = renderers.size();
-	Shape * light = ObjLoader::loadShapeFromObj("Assets\\Models\\quad.obj");
+	Shape * light = AssetLoader::getInstance().loadShapeFromObj("Assets\\Models\\quad.obj", [this](Shape& shape) {
+		Mesh * lamp =  ((shape.meshes[0]));
+		renderers.push_back(lamp);
+	});
 	shapes.push_back(light);
-	Mesh * lamp =  ((light->meshes[0]));
-	renderers.push_back(lamp);
 
     
     light->defaultVoxProperties = VoxProperties::Emissive();
@@ -126,21 +107,33 @@ void MultipleObjectsScene::init(unsigned int viewportWidth, unsigned int viewpor
     light->defaultVoxProperties.diffuseReflectivity = 0.0f;
 
 
-	light->transform.position = glm::vec3(0, 0.975, 0);
-	light->transform.rotation = glm::vec3(-3.1414 * 0.5, 3.1414 * 0.5, 0);
-	light->transform.scale = glm::vec3(0.14f, 0.34f, 1.0f);
-	light->transform.updateTransformMatrix();
+	light->transform.setPosition(glm::vec3(0, 0.975, 0));
+	light->transform.setRotation(glm::vec3(-3.1414 * 0.5, 3.1414 * 0.5, 0));
+	light->transform.setScale(glm::vec3(0.14f, 0.34f, 1.0f));
 
 	// Point light.
 	PointLight p;
 	p.color = glm::vec3(1.0f);
-	p.position = light->transform.position - glm::vec3(0, 0.38, 0);
+	p.position = light->transform.getPosition() - glm::vec3(0, 0.38, 0);
 	pointLights.push_back(p);
 }
 
 void MultipleObjectsScene::update() { FirstPersonScene::update(); }
 
 MultipleObjectsScene::~MultipleObjectsScene() {
-	for (auto * r : renderers) delete r;
 	for (auto * s : shapes) delete s;
 }
+
+// Along the row of objects on the floor, then a look up at the lamp from above them.
+CameraPath MultipleObjectsScene::getFlyThrough() const {
+	CameraPath path;
+	path.keys = {
+		{ 0.0, glm::vec3(0.0f, 0.0f, 1.8f), glm::vec3(0.0f, -0.3f, 0.0f) },
+		{ 3.0, glm::vec3(0.7f, -0.2f, 0.8f), glm::vec3(0.44f, -0.5f, 0.0f) },
+		{ 6.0, glm::vec3(0.1f, -0.25f, 0.85f), glm::vec3(0.07f, -0.49f, 0.36f) },
+		{ 9.0, glm::vec3(-0.65f, -0.2f, 0.7f), glm::vec3(-0.28f, -0.5f, 0.0f) },
+		{ 12.0, glm::vec3(0.0f, 0.2f, 0.6f), glm::vec3(0.0f, 0.95f, 0.0f) },
+		{ 14.0, glm::vec3(0.0f, 0.0f, 1.8f), glm::vec3(0.0f, -0.3f, 0.0f) }
+	};
+	return path;
+}
@@ -12,6 +12,7 @@ class MultipleObjectsScene : public FirstPersonScene {
 public:
 	void update() override;
 	void init(unsigned int viewportWidth, unsigned int viewportHeight) override;
+	CameraPath getFlyThrough() const override;
 	~MultipleObjectsScene();
 private:
 	std::vector<Shape*> shapes;
@@ -12,14 +12,9 @@
 
 
 CornellBox::CornellBox() :
-Shape()
+Shape(AssetStore::getInstance().loadMeshes("/Assets/Models/cornell.obj"))
 {
     
-    ObjLoader::RawObjData objData;
-    ObjLoader::loadRawObjData("/Assets/Models/cornell.obj", objData);
-    
-    loadMesh(objData.shapes);
-    
     meshProperties.push_back(VoxProperties::Green());
     meshProperties.push_back(VoxProperties::White()); //bottom
     meshProperties.push_back(VoxProperties::White());//top
@@ -2,12 +2,20 @@
 
 #include "OpenGL_Includes.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "glm/gtc/type_ptr.hpp"
 
 #include "Mesh.h"
 #include "Scene.h"
-#include "Graphic/Material/Voxelization/VoxelizationConeTracingMaterial.h"
+#include "Graphic/Material/Voxelization/VoxelizationConeTracingMaterial.h"
+#include "Utility/ObjParser.h"
+#include "Shape/VertexEncoder.h"
 
+bool Mesh::releaseCPUDataAfterUpload = true;
+bool Mesh::keepCollisionGeometry = false;
+VertexFormat Mesh::defaultVertexFormat = VertexFormat::Compact();
 
 Mesh::Mesh()
 :program(0)
@@ -15,48 +23,102 @@ Mesh::Mesh()
 }
 
 Mesh::Mesh(const tinyobj::shape_t& shape)
+:Mesh(ObjParser::toMeshData(shape))
+{
+}
+
+Mesh::Mesh(MeshData&& meshData)
 :program(0)
 {
-    indices.reserve(shape.mesh.indices.size());
-    
-    // Push back all indices.
-    for (const auto index : shape.mesh.indices) {
-        indices.push_back(index);
-    }
-    
-    vertexData.reserve(shape.mesh.positions.size());
+    vertexData = std::move(meshData.vertexData);
+    indices = std::move(meshData.indices);
+    lods = std::move(meshData.lods);
+    meshlets.assign(meshData.meshlets.data(), meshData.meshlets.size());
     
-    // Positions.
-    for (unsigned int i = 0, j = 0; i < shape.mesh.positions.size(); i += 3, ++j) {
-        if (j >= vertexData.size()) {
-            vertexData.push_back(VertexData());
+    if(!vertexData.empty())
+    {
+        boundsMin = boundsMax = vertexData.front().position;
+        for(const VertexData& vertex : vertexData)
+        {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
         }
-        vertexData[j].position.x = shape.mesh.positions[i + 0];
-        vertexData[j].position.y = shape.mesh.positions[i + 1];
-        vertexData[j].position.z = shape.mesh.positions[i + 2];
     }
     
-    // Normals.
-    for (unsigned int i = 0, j = 0; i < shape.mesh.normals.size(); i += 3, ++j) {
-        if (j >= vertexData.size()) {
-            vertexData.push_back(VertexData());
+    if(keepCollisionGeometry)
+    {
+        collisionPositions.reserve(vertexData.size());
+        for(const VertexData& vertex : vertexData)
+        {
+            collisionPositions.push_back(vertex.position);
         }
-        vertexData[j].normal.x = shape.mesh.normals[i + 0];
-        vertexData[j].normal.y = shape.mesh.normals[i + 1];
-        vertexData[j].normal.z = shape.mesh.normals[i + 2];
+        keepCollisionIndices(indices.data(), indices.size());
     }
     
-    // Texture coordinates.
-    for (unsigned int i = 0, j = 0; i < shape.mesh.texcoords.size(); i += 2, ++j) {
-        if (j >= vertexData.size()) {
-            vertexData.push_back(VertexData());
+    glError();
+    setupMeshRenderer();
+}
+
+Mesh::Mesh(const MeshCache::MeshView& cachedMesh)
+:program(0)
+{
+    // The cache is already in the GPU layout, upload straight from the mapped file.
+    vertexFormat = cachedMesh.format;
+    lods.assign(cachedMesh.lods, cachedMesh.lods + cachedMesh.lodCount);
+    meshlets.assign(cachedMesh.meshlets, cachedMesh.meshletCount);
+    boundsMin = cachedMesh.boundsMin;
+    boundsMax = cachedMesh.boundsMax;
+    
+    if(keepCollisionGeometry)
+    {
+        //decoded from the packed vertices, half positions lose nothing the GPU doesn't lose as well
+        collisionPositions.resize(cachedMesh.vertexCount);
+        unsigned int stride = cachedMesh.format.stride();
+        for(unsigned int i = 0; i < cachedMesh.vertexCount; ++i)
+        {
+            const unsigned char* vertex = cachedMesh.vertices + static_cast<size_t>(i) * stride;
+            if(cachedMesh.format.position == VertexFormat::Position::FLOAT32)
+            {
+                memcpy(&collisionPositions[i], vertex, sizeof(glm::vec3));
+            }
+            else
+            {
+                uint16_t half[3];
+                memcpy(half, vertex, sizeof(half));
+                collisionPositions[i] = glm::vec3(VertexEncoder::halfToFloat(half[0]), VertexEncoder::halfToFloat(half[1]), VertexEncoder::halfToFloat(half[2]));
+            }
         }
-        vertexData[j].texCoord.x = shape.mesh.texcoords[i + 0];
-        vertexData[j].texCoord.y = shape.mesh.texcoords[i + 1];
+        keepCollisionIndices(cachedMesh.indices, cachedMesh.indexCount);
     }
     
+    Mesh::Commands commands(this);
+    commands.uploadGPUVertexData(cachedMesh.vertices, cachedMesh.vertexCount, cachedMesh.format);
+    commands.uploadGPUIndexData(cachedMesh.indices, cachedMesh.indexCount);
     glError();
-    setupMeshRenderer();
+}
+
+Mesh::Mesh(unsigned int vertexBuffer, unsigned int indexBuffer, size_t indexCount, const VertexFormat& format,
+           const glm::vec3& _boundsMin, const glm::vec3& _boundsMax)
+:program(0)
+{
+    vertexFormat = format;
+    boundsMin = _boundsMin;
+    boundsMax = _boundsMax;
+    Mesh::Commands commands(this);
+    commands.adoptGPUBuffers(vertexBuffer, indexBuffer, indexCount, format);
+    glError();
+}
+
+void Mesh::keepCollisionIndices(const unsigned int* meshIndices, size_t count)
+{
+    //level 0 only, the coarser levels follow it in the same buffer
+    if(!lods.empty())
+    {
+        count = std::min<size_t>(count, lods[0].indexOffset + lods[0].indexCount);
+        meshIndices += lods[0].indexOffset;
+        count -= lods[0].indexOffset;
+    }
+    collisionIndices.assign(meshIndices, meshIndices + count);
 }
 
 void Mesh::setupMeshRenderer()
@@ -64,6 +126,11 @@ void Mesh::setupMeshRenderer()
     glError();
     Mesh::Commands commands(this);
     commands.uploadGPURenderingData();
+    
+    if(releaseCPUDataAfterUpload)
+    {
+        releaseCPUData();
+    }
 }
 
 void Mesh::render()
@@ -105,6 +172,106 @@ void Mesh::render(ShaderParameter::ShaderParamsGroup& group, Material::Commands&
     }
 }
 
+void Mesh::render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands, unsigned int lod)
+{
+    if(enabled)
+    {
+        commands.uploadParameters(group);
+        Mesh::Commands meshCommands(this);
+        meshCommands.render(lod);
+    }
+}
+
+void Mesh::render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands, unsigned int lod,
+                  const MeshletCuller::View& view, MeshletCuller::Stats* stats)
+{
+    if(enabled)
+    {
+        commands.uploadParameters(group);
+        Mesh::Commands meshCommands(this);
+        meshCommands.render(lod, view, stats);
+    }
+}
+
+void Mesh::render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands, const DrawList& drawList)
+{
+    if(enabled)
+    {
+        commands.uploadParameters(group);
+        Mesh::Commands meshCommands(this);
+        meshCommands.render(drawList);
+    }
+}
+
+void Mesh::cull(unsigned int lod, const MeshletCuller::View& view, DrawList& drawList) const
+{
+    drawList.lod = lod;
+    drawList.stats = MeshletCuller::Stats();
+    drawList.counts.clear();
+    drawList.offsets.clear();
+    
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = static_cast<unsigned int>(this->indexCount);
+    if(!lods.empty())
+    {
+        const MeshLod& level = lods[std::min<size_t>(lod, lods.size() - 1)];
+        indexOffset = level.indexOffset;
+        indexCount = level.indexCount;
+    }
+    
+    size_t first = 0, last = 0;
+    meshlets.find(indexOffset, indexCount, first, last);
+    drawList.whole = first == last;
+    if(drawList.whole)
+        return;
+    
+    //one scratch buffer per thread, culling runs on the workers
+    static thread_local std::vector<unsigned char> visible;
+    visible.resize(last - first);
+    MeshletCuller::cull(meshlets, first, last, view, visible.data(), &drawList.stats);
+    
+    //meshlets are consecutive in the index buffer, neighbouring visible ones become one range
+    unsigned int rangeEnd = 0;
+    for(size_t i = first; i < last; ++i)
+    {
+        if(!visible[i - first])
+            continue;
+        
+        unsigned int offset = meshlets.indexOffsets[i];
+        if(!drawList.counts.empty() && offset == rangeEnd)
+        {
+            drawList.counts.back() += static_cast<GLsizei>(meshlets.indexCounts[i]);
+        }
+        else
+        {
+            drawList.counts.push_back(static_cast<GLsizei>(meshlets.indexCounts[i]));
+            drawList.offsets.push_back((const GLvoid*)(offset * sizeof(unsigned int)));
+        }
+        rangeEnd = offset + meshlets.indexCounts[i];
+    }
+}
+
+unsigned int Mesh::lodForEdgeLength(float edgeLength) const
+{
+    unsigned int lod = 0;
+    //the error check keeps out levels that only reached their triangle count by distorting the surface
+    while(lod + 1 < lods.size() && lods[lod + 1].edgeLength <= edgeLength && lods[lod + 1].error <= edgeLength)
+    {
+        ++lod;
+    }
+    return lod;
+}
+
+unsigned int Mesh::lodForError(float maxError) const
+{
+    unsigned int lod = 0;
+    while(lod + 1 < lods.size() && lods[lod + 1].error < maxError)
+    {
+        ++lod;
+    }
+    return lod;
+}
+
 
 Mesh::~Mesh()
 {
@@ -115,16 +282,61 @@ Mesh::~Mesh()
 
 //////////////////////////////////////////Mesh::Commands
 Mesh::Commands::Commands(Mesh* _mesh):
-Primitive::Commands::Commands(_mesh)
+Primitive::Commands::Commands(_mesh),
+mesh(_mesh)
+{
+}
+
+void Mesh::Commands::uploadGPUVertexData(const VertexData* vertices, size_t count)
 {
+    std::vector<unsigned char> packed;
+    VertexEncoder::encode(vertices, count, mesh->vertexFormat, packed);
+    uploadGPUVertexData(packed.data(), count, mesh->vertexFormat);
 }
 
-void Mesh::Commands::uploadGPUVertexData()
+void Mesh::Commands::render()
 {
-    Primitive::Commands::uploadGPUVertexData();
-    glEnableVertexAttribArray(NORMALS_LOCATION);
-    static const int NUMBER_OF_ELEMENTS = 3;
-    glVertexAttribPointer(Mesh::Commands::NORMALS_LOCATION, NUMBER_OF_ELEMENTS, GL_FLOAT, GL_FALSE, sizeof(VertexData), (GLvoid*)offsetof(VertexData, normal));
+    render(0);
+}
+
+void Mesh::Commands::render(unsigned int lod)
+{
+    if(mesh->lods.empty())
+    {
+        Primitive::Commands::render();
+        return;
+    }
+    
+    const MeshLod& level = mesh->lods[std::min<size_t>(lod, mesh->lods.size() - 1)];
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT, (GLvoid*)(level.indexOffset * sizeof(unsigned int)));
+    glError();
+}
+
+void Mesh::Commands::render(unsigned int lod, const MeshletCuller::View& view, MeshletCuller::Stats* stats)
+{
+    //scratch space shared by all meshes, rendering happens on one thread
+    static DrawList drawList;
+    mesh->cull(lod, view, drawList);
+    if(stats)
+        *stats += drawList.stats;
+    render(drawList);
+}
+
+void Mesh::Commands::render(const DrawList& drawList)
+{
+    if(drawList.whole)
+    {
+        render(drawList.lod);
+        return;
+    }
+    
+    if(drawList.counts.empty())
+        return;
+    
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glMultiDrawElements(GL_TRIANGLES, drawList.counts.data(), GL_UNSIGNED_INT, drawList.offsets.data(), static_cast<GLsizei>(drawList.counts.size()));
+    glError();
 }
 
 Mesh::Commands::~Commands()
@@ -1,29 +1,85 @@
-#pragma once
+#pragma once
 
-#include "Primitive.h"
+#include "Primitive.h"
 #include "Utility/External/tiny_obj/tiny_obj_loader.h"
+#include "Utility/MeshCache.h"
+#include "Shape/MeshData.h"
+#include "Shape/MeshletCuller.h"
 #include "Shape/Transform.h"
 #include "Graphic/Material/Voxelization/VoxelizationConeTracingMaterial.h"
-
+
 class Mesh : protected Primitive
-{
+{
 public:
+    
+    // Ranges of the index buffer one level of detail leaves after culling, filled by Mesh::cull on any thread and drawn
+    // by Commands::render(drawList) on the one owning the GL context.
+    struct DrawList
+    {
+        unsigned int lod = 0;
+        bool whole = true; // the level has no meshlets and is drawn as is
+        std::vector<GLsizei> counts;
+        std::vector<const GLvoid*> offsets;
+        MeshletCuller::Stats stats;
+    };
 
     class Commands: public Primitive::Commands
     {
     public:
         explicit Commands(Mesh* mesh);
-        void uploadGPUVertexData() override;
+        using Primitive::Commands::uploadGPUVertexData;
+        void uploadGPUVertexData(const VertexData* vertices, size_t count) override;
+        
+        // Draws level of detail 0, render(lod) picks another one.
+        void render() override;
+        void render(unsigned int lod);
+        
+        // Draws the meshlets of the level that survive culling against view in one glMultiDrawElements,
+        // levels without meshlets are drawn whole.
+        void render(unsigned int lod, const MeshletCuller::View& view, MeshletCuller::Stats* stats = nullptr);
+        
+        // Draws the ranges mesh->cull left, in one glMultiDrawElements.
+        void render(const DrawList& drawList);
         
         ~Commands() override;
     private:
+        Mesh* mesh = nullptr;
     };
     
     void render(Scene& renderScene, Transform &transform);
     void render(Scene& scene, ShaderParameter::ShaderParamsGroup& group, Material::Commands* commands);
     virtual void render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands);
+    void render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands, unsigned int lod);
+    void render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands, unsigned int lod,
+                const MeshletCuller::View& view, MeshletCuller::Stats* stats = nullptr);
+    void render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands, const DrawList& drawList);
+    
+    // Culls the meshlets of level lod against view into drawList, touches no GL state so it can run on a JobSystem worker.
+    void cull(unsigned int lod, const MeshletCuller::View& view, DrawList& drawList) const;
+    
+    inline unsigned int getLodCount() const { return lods.empty() ? 1 : static_cast<unsigned int>(lods.size()); }
+    
+    // Coarsest level of detail whose average edge and error are no larger than edgeLength (object space), e.g. the size of a voxel.
+    unsigned int lodForEdgeLength(float edgeLength) const;
+    
+    // Coarsest level of detail that deviates less than maxError (object space) from the full mesh.
+    unsigned int lodForError(float maxError) const;
+    
+    inline const glm::vec3& getBoundsMin() const { return boundsMin; }
+    inline const glm::vec3& getBoundsMax() const { return boundsMax; }
+    
+    inline size_t getMeshletCount() const { return meshlets.size(); }
+    
+    // Object space positions and level 0 triangles for CPU queries (see SceneBvh), empty unless keepCollisionGeometry was set.
+    inline const std::vector<glm::vec3>& getCollisionPositions() const { return collisionPositions; }
+    inline const std::vector<unsigned int>& getCollisionIndices() const { return collisionIndices; }
     
     Mesh(const tinyobj::shape_t& shape);
+    Mesh(MeshData&& meshData);
+    Mesh(const MeshCache::MeshView& cachedMesh);
+    // Takes over GPU buffers filled elsewhere (see MeshStreamUploader), indexCount indices into vertices packed in format.
+    Mesh(unsigned int vertexBuffer, unsigned int indexBuffer, size_t indexCount, const VertexFormat& format,
+         const glm::vec3& boundsMin, const glm::vec3& boundsMax);
     Mesh();
     ~Mesh();
     
@@ -32,6 +88,18 @@ public:
     bool tweakable = false; // Automatically adds a window for this mesh renderer.
     std::string name = "Mesh renderer";
     
+    // Frees vertexData and indices once they are on the GPU. Turn off before loading meshes whose geometry is needed on the CPU.
+    static bool releaseCPUDataAfterUpload;
+    
+    // Keeps a copy of the positions and level 0 indices when the mesh is created, about 12 bytes per vertex and per triangle.
+    // Off by default, set it before loading the meshes of a scene a SceneBvh is built over.
+    // Streamed meshes never have one, their geometry only passes through on its way to the GPU.
+    static bool keepCollisionGeometry;
+    
+    // Layout vertices are packed into on upload. Compact by default: half positions and octahedral normals, 12 bytes per vertex.
+    static VertexFormat defaultVertexFormat;
+    VertexFormat vertexFormat = defaultVertexFormat;
+    
     // Used for (shared) rendering.  TODO: look into what he means by this
 	int program;
     
@@ -39,8 +107,17 @@ protected:
     void render();
     virtual void setupMeshRenderer();
     
+protected:
+    std::vector<MeshLod> lods; // ranges of the index buffer, empty if it only holds level 0
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    MeshletCuller::Clusters meshlets; // bounds of the meshlets of every level, kept on the CPU for culling
+    std::vector<glm::vec3> collisionPositions;
+    std::vector<unsigned int> collisionIndices;
+    
 private:
     Mesh(Mesh& mesh);
-private:
-	static unsigned int idCounter;
-};
+    void keepCollisionIndices(const unsigned int* indices, size_t count);
+private:
+	static unsigned int idCounter;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Shape/VertexData.h"
+
+/// <summary> One level of detail, a range of MeshData::indices drawn from the shared vertex buffer. </summary>
+struct MeshLod
+{
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    float error = 0.0f;         // object space distance the surface may deviate from level 0
+    float edgeLength = 0.0f;    // average object space edge length
+};
+
+/// <summary> A cluster of consecutive triangles of one level of detail with the bounds to cull it as a whole. </summary>
+struct Meshlet
+{
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    glm::vec3 center = glm::vec3(0.0f);     // bounding sphere
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f);   // normal cone: average direction the triangles face
+    float coneCutoff = 1.0f;                // sine of the cone's half angle, 1 if the cluster never faces away as a whole
+};
+
+/// <summary> Geometry of one mesh in the exact layout it is uploaded in. Loaders fill it and Mesh takes it over by moving. </summary>
+struct MeshData
+{
+    std::string name;
+    std::vector<VertexData> vertexData;
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods; // empty when indices holds only the full detail level
+    std::vector<Meshlet> meshlets; // sorted by indexOffset, levels too small to be worth culling have none
+};
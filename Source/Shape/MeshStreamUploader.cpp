@@ -0,0 +1,168 @@
+#include "Shape/MeshStreamUploader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Shape/Mesh.h"
+
+unsigned int MeshStreamUploader::ringSize = 3;
+size_t MeshStreamUploader::stagingSize = 4 * 1024 * 1024;
+
+MeshStreamUploader::MeshStreamUploader(const VertexFormat& _format):
+format(_format)
+{
+    //whole indices only, a chunk's indices may be split across staging buffers
+    stagingCapacity = std::max<size_t>(stagingSize, 1024) & ~static_cast<size_t>(sizeof(unsigned int) - 1);
+    ring.resize(std::max(1u, ringSize));
+    for(StagingBuffer& staging : ring)
+    {
+        glGenBuffers(1, &staging.buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+        glBufferData(GL_COPY_READ_BUFFER, stagingCapacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glError();
+}
+
+MeshStreamUploader::~MeshStreamUploader()
+{
+    for(StagingBuffer& staging : ring)
+    {
+        if(staging.fence != nullptr)
+            glDeleteSync(staging.fence);
+        glDeleteBuffers(1, &staging.buffer);
+    }
+    release(vertices);
+    release(indices);
+}
+
+size_t MeshStreamUploader::append(const ObjParser::Stream::Chunk& chunk)
+{
+    if(chunk.vertexCount == 0 || chunk.indices.empty())
+        return 0;
+
+    if(indices.size == 0)
+    {
+        boundsMin = chunk.boundsMin;
+        boundsMax = chunk.boundsMax;
+    }
+    else
+    {
+        boundsMin = glm::min(boundsMin, chunk.boundsMin);
+        boundsMax = glm::max(boundsMax, chunk.boundsMax);
+    }
+
+    unsigned int indexBase = static_cast<unsigned int>(vertices.size / format.stride());
+    size_t indexBytes = chunk.indices.size() * sizeof(unsigned int);
+    write(vertices, chunk.vertices.data(), chunk.vertices.size(), false, 0);
+    write(indices, reinterpret_cast<const unsigned char*>(chunk.indices.data()), indexBytes, true, indexBase);
+    return chunk.vertices.size() + indexBytes;
+}
+
+Mesh* MeshStreamUploader::finish()
+{
+    if(indices.size == 0)
+    {
+        release(vertices);
+        release(indices);
+        return nullptr;
+    }
+
+    //doubling leaves up to half of each buffer unused
+    if(vertices.capacity > vertices.size)
+        resize(vertices, vertices.size);
+    if(indices.capacity > indices.size)
+        resize(indices, indices.size);
+
+    Mesh* mesh = new Mesh(vertices.buffer, indices.buffer, indices.size / sizeof(unsigned int), format, boundsMin, boundsMax);
+    vertices = GrowingBuffer();
+    indices = GrowingBuffer();
+    return mesh;
+}
+
+void MeshStreamUploader::reserve(GrowingBuffer& destination, size_t bytes)
+{
+    if(destination.size + bytes > destination.capacity)
+        resize(destination, std::max(std::max(destination.capacity * 2, destination.size + bytes), stagingCapacity));
+}
+
+void MeshStreamUploader::resize(GrowingBuffer& buffer, size_t capacity)
+{
+    GLuint resized = 0;
+    glGenBuffers(1, &resized);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+    if(buffer.size != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, buffer.size);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    //deleting it right away is fine, GL keeps it until the copy is done
+    if(buffer.buffer != 0)
+        glDeleteBuffers(1, &buffer.buffer);
+    buffer.buffer = resized;
+    buffer.capacity = capacity;
+    glError();
+}
+
+void MeshStreamUploader::write(GrowingBuffer& destination, const unsigned char* data, size_t bytes, bool isIndices, unsigned int indexBase)
+{
+    reserve(destination, bytes);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination.buffer);
+
+    for(size_t written = 0; written < bytes;)
+    {
+        size_t count = std::min(stagingCapacity, bytes - written);
+        StagingBuffer& staging = ring[nextStaging];
+        nextStaging = (nextStaging + 1) % ring.size();
+
+        //only blocks when the CPU went around the ring faster than the GPU copies
+        if(staging.fence != nullptr)
+        {
+            GLenum result;
+            do
+            {
+                result = glClientWaitSync(staging.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            while(result == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(staging.fence);
+            staging.fence = nullptr;
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+        void* mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        assert(mapped != nullptr);
+        if(isIndices)
+        {
+            const unsigned int* source = reinterpret_cast<const unsigned int*>(data + written);
+            unsigned int* target = static_cast<unsigned int*>(mapped);
+            for(size_t i = 0; i < count / sizeof(unsigned int); ++i)
+                target[i] = source[i] + indexBase;
+        }
+        else
+        {
+            memcpy(mapped, data + written, count);
+        }
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, destination.size, count);
+        staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        destination.size += count;
+        written += count;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glError();
+}
+
+void MeshStreamUploader::release(GrowingBuffer& buffer)
+{
+    if(buffer.buffer != 0)
+        glDeleteBuffers(1, &buffer.buffer);
+    buffer = GrowingBuffer();
+}
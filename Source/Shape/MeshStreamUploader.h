@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "OpenGL_Includes.h"
+#include "Shape/VertexFormat.h"
+#include "Utility/ObjParser.h"
+
+class Mesh;
+
+// Uploads the chunks of an ObjParser::Stream into one vertex and one index buffer per mesh, both grown on the GPU as
+// chunks arrive. Data goes through a ring of staging buffers and glCopyBufferSubData, a staging buffer is written again
+// only after its fence signalled, so no more than ringSize * stagingSize bytes are waiting for the GPU.
+// Call everything on the thread owning the GL context.
+class MeshStreamUploader
+{
+public:
+    explicit MeshStreamUploader(const VertexFormat& format);
+    ~MeshStreamUploader();
+
+    // Appends chunk to the mesh being built and returns the bytes uploaded. Its indices are rebased on the way.
+    size_t append(const ObjParser::Stream::Chunk& chunk);
+
+    // Hands the buffers to a new Mesh and starts the next one. nullptr if nothing was appended since the last call.
+    Mesh* finish();
+
+    // Staging buffers in the ring and their size in bytes, read by the constructor.
+    static unsigned int ringSize;
+    static size_t stagingSize;
+
+private:
+    struct GrowingBuffer
+    {
+        GLuint buffer = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    struct StagingBuffer
+    {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    MeshStreamUploader(const MeshStreamUploader&) = delete;
+    MeshStreamUploader& operator=(const MeshStreamUploader&) = delete;
+
+    // Makes room for bytes more, doubling the buffer.
+    void reserve(GrowingBuffer& destination, size_t bytes);
+    // Moves the contents into a new buffer of capacity bytes, copying on the GPU.
+    void resize(GrowingBuffer& buffer, size_t capacity);
+    // Copies bytes into destination behind its contents, staging at most stagingSize bytes at a time. indexBase is added to
+    // every unsigned int when the data are indices.
+    void write(GrowingBuffer& destination, const unsigned char* data, size_t bytes, bool isIndices, unsigned int indexBase);
+    void release(GrowingBuffer& buffer);
+
+    VertexFormat format;
+    GrowingBuffer vertices;
+    GrowingBuffer indices;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    std::vector<StagingBuffer> ring;
+    size_t nextStaging = 0;
+    size_t stagingCapacity = 0;
+};
@@ -0,0 +1,237 @@
+#include "Shape/MeshletCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MESHLET_CULLER_SSE2 1
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MESHLET_CULLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    //bit per cluster of a group of four
+    struct Masks
+    {
+        int outside = 0;
+        int backface = 0;
+    };
+
+    inline void cullOne(const MeshletCuller::Clusters& clusters, size_t i, const MeshletCuller::View& view, bool& outside, bool& backface)
+    {
+        glm::vec3 center(clusters.centerX[i], clusters.centerY[i], clusters.centerZ[i]);
+        float radius = clusters.radius[i];
+
+        outside = false;
+        for(const glm::vec4& plane : view.planes)
+        {
+            outside |= glm::dot(glm::vec3(plane), center) + plane.w + radius < 0.0f;
+        }
+
+        //every face of the cluster points away if the direction to it lies inside the cone widened by 90 degrees
+        backface = false;
+        if(view.cullBackfaces && !outside)
+        {
+            glm::vec3 direction = center - view.cameraPosition;
+            glm::vec3 axis(clusters.axisX[i], clusters.axisY[i], clusters.axisZ[i]);
+            backface = glm::dot(direction, axis) >= clusters.cutoff[i] * glm::length(direction) + radius;
+        }
+    }
+
+#if MESHLET_CULLER_SSE2
+
+    inline Masks cullFour(const MeshletCuller::Clusters& clusters, size_t i, const MeshletCuller::View& view)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        __m128 centerX = _mm_loadu_ps(&clusters.centerX[i]);
+        __m128 centerY = _mm_loadu_ps(&clusters.centerY[i]);
+        __m128 centerZ = _mm_loadu_ps(&clusters.centerZ[i]);
+        __m128 radius = _mm_loadu_ps(&clusters.radius[i]);
+
+        __m128 outside = zero;
+        for(const glm::vec4& plane : view.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerY, _mm_set1_ps(plane.y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, _mm_set1_ps(plane.z)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        Masks masks;
+        masks.outside = _mm_movemask_ps(outside);
+        if(view.cullBackfaces && masks.outside != 0xf)
+        {
+            __m128 directionX = _mm_sub_ps(centerX, _mm_set1_ps(view.cameraPosition.x));
+            __m128 directionY = _mm_sub_ps(centerY, _mm_set1_ps(view.cameraPosition.y));
+            __m128 directionZ = _mm_sub_ps(centerZ, _mm_set1_ps(view.cameraPosition.z));
+            __m128 length = _mm_add_ps(_mm_mul_ps(directionX, directionX), _mm_mul_ps(directionY, directionY));
+            length = _mm_sqrt_ps(_mm_add_ps(length, _mm_mul_ps(directionZ, directionZ)));
+            __m128 dot = _mm_mul_ps(directionX, _mm_loadu_ps(&clusters.axisX[i]));
+            dot = _mm_add_ps(dot, _mm_mul_ps(directionY, _mm_loadu_ps(&clusters.axisY[i])));
+            dot = _mm_add_ps(dot, _mm_mul_ps(directionZ, _mm_loadu_ps(&clusters.axisZ[i])));
+            __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&clusters.cutoff[i]), length), radius);
+            masks.backface = _mm_movemask_ps(_mm_andnot_ps(outside, _mm_cmpge_ps(dot, limit)));
+        }
+        return masks;
+    }
+
+#elif MESHLET_CULLER_NEON
+
+    inline int movemask(uint32x4_t mask)
+    {
+        return int(vgetq_lane_u32(mask, 0) & 1) | int(vgetq_lane_u32(mask, 1) & 2) |
+               int(vgetq_lane_u32(mask, 2) & 4) | int(vgetq_lane_u32(mask, 3) & 8);
+    }
+
+    inline Masks cullFour(const MeshletCuller::Clusters& clusters, size_t i, const MeshletCuller::View& view)
+    {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        float32x4_t centerX = vld1q_f32(&clusters.centerX[i]);
+        float32x4_t centerY = vld1q_f32(&clusters.centerY[i]);
+        float32x4_t centerZ = vld1q_f32(&clusters.centerZ[i]);
+        float32x4_t radius = vld1q_f32(&clusters.radius[i]);
+
+        uint32x4_t outside = vdupq_n_u32(0);
+        for(const glm::vec4& plane : view.planes)
+        {
+            float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane.w), centerX, plane.x);
+            distance = vmlaq_n_f32(distance, centerY, plane.y);
+            distance = vmlaq_n_f32(distance, centerZ, plane.z);
+            outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(distance, radius), zero));
+        }
+
+        Masks masks;
+        masks.outside = movemask(outside);
+        if(view.cullBackfaces && masks.outside != 0xf)
+        {
+            float32x4_t directionX = vsubq_f32(centerX, vdupq_n_f32(view.cameraPosition.x));
+            float32x4_t directionY = vsubq_f32(centerY, vdupq_n_f32(view.cameraPosition.y));
+            float32x4_t directionZ = vsubq_f32(centerZ, vdupq_n_f32(view.cameraPosition.z));
+            float32x4_t length = vmulq_f32(directionX, directionX);
+            length = vmlaq_f32(length, directionY, directionY);
+            length = vsqrtq_f32(vmlaq_f32(length, directionZ, directionZ));
+            float32x4_t dot = vmulq_f32(directionX, vld1q_f32(&clusters.axisX[i]));
+            dot = vmlaq_f32(dot, directionY, vld1q_f32(&clusters.axisY[i]));
+            dot = vmlaq_f32(dot, directionZ, vld1q_f32(&clusters.axisZ[i]));
+            float32x4_t limit = vmlaq_f32(radius, vld1q_f32(&clusters.cutoff[i]), length);
+            masks.backface = movemask(vbicq_u32(vcgeq_f32(dot, limit), outside));
+        }
+        return masks;
+    }
+
+#endif
+}
+
+MeshletCuller::Stats& MeshletCuller::Stats::operator+=(const Stats& other)
+{
+    meshlets += other.meshlets;
+    frustumCulled += other.frustumCulled;
+    backfaceCulled += other.backfaceCulled;
+    triangles += other.triangles;
+    trianglesCulled += other.trianglesCulled;
+    return *this;
+}
+
+void MeshletCuller::Clusters::assign(const Meshlet* meshlets, size_t count)
+{
+    std::vector<float>* floats[] = { &centerX, &centerY, &centerZ, &radius, &axisX, &axisY, &axisZ, &cutoff };
+    for(std::vector<float>* values : floats)
+    {
+        values->resize(count);
+    }
+    indexOffsets.resize(count);
+    indexCounts.resize(count);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        const Meshlet& meshlet = meshlets[i];
+        indexOffsets[i] = meshlet.indexOffset;
+        indexCounts[i] = meshlet.indexCount;
+        centerX[i] = meshlet.center.x;
+        centerY[i] = meshlet.center.y;
+        centerZ[i] = meshlet.center.z;
+        radius[i] = meshlet.radius;
+        axisX[i] = meshlet.coneAxis.x;
+        axisY[i] = meshlet.coneAxis.y;
+        axisZ[i] = meshlet.coneAxis.z;
+        cutoff[i] = meshlet.coneCutoff;
+    }
+}
+
+void MeshletCuller::Clusters::find(unsigned int indexOffset, unsigned int indexCount, size_t& first, size_t& last) const
+{
+    first = std::lower_bound(indexOffsets.begin(), indexOffsets.end(), indexOffset) - indexOffsets.begin();
+    last = std::lower_bound(indexOffsets.begin() + first, indexOffsets.end(), indexOffset + indexCount) - indexOffsets.begin();
+}
+
+MeshletCuller::View MeshletCuller::makeView(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition, bool cullBackfaces)
+{
+    //Gribb and Hartmann: the planes of the clip volume are sums of the rows of the matrix
+    glm::mat4 matrix = viewProjection * model;
+    glm::vec4 rows[4];
+    for(int row = 0; row < 4; ++row)
+    {
+        rows[row] = glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+    }
+
+    View view;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        view.planes[2 * axis] = rows[3] + rows[axis];
+        view.planes[2 * axis + 1] = rows[3] - rows[axis];
+    }
+    for(glm::vec4& plane : view.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        plane = length > 0.0f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    view.cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    view.cullBackfaces = cullBackfaces;
+    return view;
+}
+
+void MeshletCuller::cull(const Clusters& clusters, size_t first, size_t last, const View& view, unsigned char* visible, Stats* stats)
+{
+    Stats counts;
+    size_t i = first;
+
+#if MESHLET_CULLER_SSE2 || MESHLET_CULLER_NEON
+    for(; i + 4 <= last; i += 4)
+    {
+        Masks masks = cullFour(clusters, i, view);
+        for(int lane = 0; lane < 4; ++lane)
+        {
+            bool outside = (masks.outside >> lane) & 1;
+            bool backface = (masks.backface >> lane) & 1;
+            visible[i + lane - first] = !(outside || backface);
+            counts.frustumCulled += outside;
+            counts.backfaceCulled += backface;
+            counts.trianglesCulled += (outside || backface) ? clusters.indexCounts[i + lane] / 3 : 0;
+        }
+    }
+#endif
+
+    for(; i < last; ++i)
+    {
+        bool outside, backface;
+        cullOne(clusters, i, view, outside, backface);
+        visible[i - first] = !(outside || backface);
+        counts.frustumCulled += outside;
+        counts.backfaceCulled += backface;
+        counts.trianglesCulled += (outside || backface) ? clusters.indexCounts[i] / 3 : 0;
+    }
+
+    if(stats != nullptr)
+    {
+        counts.meshlets = last - first;
+        for(size_t j = first; j < last; ++j)
+        {
+            counts.triangles += clusters.indexCounts[j] / 3;
+        }
+        *stats += counts;
+    }
+}
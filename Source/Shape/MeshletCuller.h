@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Shape/MeshData.h"
+
+/// <summary>
+/// CPU culling of meshlets against the view frustum and by their normal cones, four at a time with SSE2 or NEON.
+/// The tests run in the mesh's object space, only the planes and the camera are transformed, never the bounds.
+/// </summary>
+class MeshletCuller
+{
+public:
+    struct Stats
+    {
+        size_t meshlets = 0;
+        size_t frustumCulled = 0;
+        size_t backfaceCulled = 0;
+        size_t triangles = 0;
+        size_t trianglesCulled = 0;
+
+        inline size_t visible() const { return meshlets - frustumCulled - backfaceCulled; }
+
+        Stats& operator+=(const Stats& other);
+    };
+
+    /// <summary> Frustum planes (pointing inwards) and camera position in one mesh's object space. </summary>
+    struct View
+    {
+        glm::vec4 planes[6];
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        bool cullBackfaces = false;
+    };
+
+    /// <summary> The bounds of a mesh's meshlets as structure of arrays, in the order of Meshlet::indexOffset. </summary>
+    struct Clusters
+    {
+        std::vector<unsigned int> indexOffsets;
+        std::vector<unsigned int> indexCounts;
+        std::vector<float> centerX, centerY, centerZ, radius;
+        std::vector<float> axisX, axisY, axisZ, cutoff;
+
+        void assign(const Meshlet* meshlets, size_t count);
+        inline size_t size() const { return indexOffsets.size(); }
+        inline bool empty() const { return indexOffsets.empty(); }
+
+        /// <summary> The clusters [first, last) covering the index range of one level of detail, empty if it has none. </summary>
+        void find(unsigned int indexOffset, unsigned int indexCount, size_t& first, size_t& last) const;
+    };
+
+    /// <summary>
+    /// Brings the frustum of viewProjection and cameraPosition (world space) into the object space of model.
+    /// Backface culling tests the cones against the direction from cameraPosition, so it needs a perspective camera.
+    /// </summary>
+    static View makeView(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition, bool cullBackfaces);
+
+    /// <summary> Sets visible[i - first] to 1 for every cluster in [first, last) that may be visible and to 0 for the others. </summary>
+    static void cull(const Clusters& clusters, size_t first, size_t last, const View& view, unsigned char* visible, Stats* stats = nullptr);
+};
@@ -17,14 +17,19 @@ Primitive::Commands::Commands(Primitive* _primitive)
 }
 
 void Primitive::Commands::uploadGPUVertexData()
+{
+    uploadGPUVertexData(primitive->vertexData.data(), primitive->vertexData.size());
+}
+
+void Primitive::Commands::uploadGPUVertexData(const VertexData* vertices, size_t count)
 {
     
-    if(primitive->vertexData.size() != 0)
+    if(count != 0)
     {
         auto dataSize = sizeof(VertexData);
         static const int NUMBER_OF_ELEMENTS = 3;
         glBindBuffer(GL_ARRAY_BUFFER, primitive->vbo);
-        glBufferData(GL_ARRAY_BUFFER, primitive->vertexData.size() * dataSize, primitive->vertexData.data(),
+        glBufferData(GL_ARRAY_BUFFER, count * dataSize, vertices,
                      primitive->staticMesh ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
         glEnableVertexAttribArray(POSITION_LOCATION);
         glVertexAttribPointer(POSITION_LOCATION, NUMBER_OF_ELEMENTS, GL_FLOAT, GL_FALSE, dataSize, (GLvoid*)offsetof(VertexData, position));
@@ -35,13 +40,77 @@ void Primitive::Commands::uploadGPUVertexData()
 
 }
 
+void Primitive::Commands::uploadGPUVertexData(const void* vertices, size_t count, const VertexFormat& format)
+{
+    if(count != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, primitive->vbo);
+        glBufferData(GL_ARRAY_BUFFER, count * format.stride(), vertices,
+                     primitive->staticMesh ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+        setVertexAttributes(format);
+    }
+}
+
+void Primitive::Commands::adoptGPUBuffers(unsigned int vertexBuffer, unsigned int indexBuffer, size_t indexCount, const VertexFormat& format)
+{
+    //the vertex array stays, it is bound since the constructor
+    glDeleteBuffers(1, &primitive->vbo);
+    glDeleteBuffers(1, &primitive->ebo);
+    primitive->vbo = vertexBuffer;
+    primitive->ebo = indexBuffer;
+    
+    glBindBuffer(GL_ARRAY_BUFFER, primitive->vbo);
+    setVertexAttributes(format);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive->ebo);
+    primitive->indexCount = indexCount;
+}
+
+void Primitive::Commands::setVertexAttributes(const VertexFormat& format)
+{
+    const GLsizei stride = static_cast<GLsizei>(format.stride());
+    const bool halfPosition = format.position == VertexFormat::Position::HALF;
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glVertexAttribPointer(POSITION_LOCATION, 3, halfPosition ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (GLvoid*)(size_t)format.positionOffset());
+    
+    //only one of the two normal attributes is fed, the other one reads as zero
+    if(format.normal == VertexFormat::Normal::OCTAHEDRAL_16)
+    {
+        glDisableVertexAttribArray(NORMALS_LOCATION);
+        glEnableVertexAttribArray(OCTAHEDRAL_NORMALS_LOCATION);
+        glVertexAttribPointer(OCTAHEDRAL_NORMALS_LOCATION, 2, GL_SHORT, GL_TRUE, stride, (GLvoid*)(size_t)format.normalOffset());
+    }
+    else
+    {
+        glDisableVertexAttribArray(OCTAHEDRAL_NORMALS_LOCATION);
+        glEnableVertexAttribArray(NORMALS_LOCATION);
+        glVertexAttribPointer(NORMALS_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(size_t)format.normalOffset());
+    }
+    
+    if(format.texCoord == VertexFormat::TexCoord::NONE)
+    {
+        glDisableVertexAttribArray(TEXTURE_LOCATION);
+    }
+    else
+    {
+        const bool halfTexCoord = format.texCoord == VertexFormat::TexCoord::HALF;
+        glEnableVertexAttribArray(TEXTURE_LOCATION);
+        glVertexAttribPointer(TEXTURE_LOCATION, 2, halfTexCoord ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (GLvoid*)(size_t)format.texCoordOffset());
+    }
+}
+
 void Primitive::Commands::uploadGPUIndexData()
 {
-    if(primitive->indices.size() != 0)
+    uploadGPUIndexData(primitive->indices.data(), primitive->indices.size());
+}
+
+void Primitive::Commands::uploadGPUIndexData(const unsigned int* indices, size_t count)
+{
+    if(count != 0)
     {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive->ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, primitive->indices.size() * sizeof(unsigned int), primitive->indices.data(), primitive->staticMesh ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, primitive->staticMesh ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
     }
+    primitive->indexCount = count;
 
 }
 
@@ -55,7 +124,7 @@ void Primitive::Commands::uploadGPURenderingData()
 void Primitive::Commands::render()
 {
     assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-    glDrawElements(GL_TRIANGLES, primitive->indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(primitive->indexCount), GL_UNSIGNED_INT, 0);
     glError();
 }
 
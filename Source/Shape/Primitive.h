@@ -11,6 +11,7 @@
 #include "OpenGL_Includes.h"
 #include <vector>
 #include "VertexData.h"
+#include "VertexFormat.h"
 
 //Primitive family of classes holds data and makes use of the Primitive::Commands family of classes
 //to render it's data
@@ -33,26 +34,48 @@ public:
         static const int POSITION_LOCATION = 0;
         static const unsigned int NORMALS_LOCATION = 1;
         static const int TEXTURE_LOCATION = 2;
+        static const int OCTAHEDRAL_NORMALS_LOCATION = 3; // VertexFormat::Normal::OCTAHEDRAL_16, decoded in the vertex shader
         
         virtual void uploadGPUVertexData();
         virtual void uploadGPUIndexData();
         
+        //uploads from memory the primitive doesn't own, e.g. a memory mapped MeshCache
+        virtual void uploadGPUVertexData(const VertexData* vertices, size_t count);
+        virtual void uploadGPUIndexData(const unsigned int* indices, size_t count);
+        
+        //uploads vertices already packed into format, see VertexEncoder
+        void uploadGPUVertexData(const void* vertices, size_t count, const VertexFormat& format);
+        
+        //takes over buffers filled elsewhere, e.g. streamed in through staging buffers, in place of the primitive's own
+        void adoptGPUBuffers(unsigned int vertexBuffer, unsigned int indexBuffer, size_t indexCount, const VertexFormat& format);
+        
         virtual ~Commands();
         
     protected:
 
         virtual void initBuffers();
+        //points the vertex attributes at the bound GL_ARRAY_BUFFER
+        void setVertexAttributes(const VertexFormat& format);
     protected:
         Primitive* primitive = nullptr;
     };
     
     Primitive():vao(0), vbo(0), ebo(0){}
     
+protected:
+    // Drops the CPU copies of vertexData and indices, the GPU buffers and indexCount stay valid.
+    inline void releaseCPUData()
+    {
+        std::vector<VertexData>().swap(vertexData);
+        std::vector<unsigned int>().swap(indices);
+    }
+    
 protected:
     bool staticMesh = true;
     unsigned int vao;
     unsigned int vbo, ebo; // Vertex Buffer Object, Vertex Array Object, Element Buffer Object.
     std::vector<VertexData> vertexData;
     std::vector<unsigned int> indices;
+    size_t indexCount = 0; // number of indices in the element buffer
 
 };
@@ -9,6 +9,7 @@
 #include "Shape.h"
 #include "Mesh.h"
 #include "Graphic/Material/MaterialStore.h"
+#include "Utility/AssetLoader.h"
 
 Shape::Shape()
 {
@@ -19,17 +20,64 @@ Shape::Shape(std::vector<tinyobj::shape_t>& shapes)
     loadMesh(shapes);
 }
 
+Shape::Shape(const MeshCache& cache)
+{
+    loadMesh(cache);
+}
+
+Shape::Shape(std::vector<MeshData>&& meshData)
+{
+    loadMesh(std::move(meshData));
+}
+
+Shape::Shape(const MeshAssetSharedPtr& asset)
+{
+    setAsset(asset);
+}
+
 void Shape::loadMesh(std::vector<tinyobj::shape_t> &shapes)
 {
+    MeshAssetSharedPtr meshAsset = std::make_shared<MeshAsset>();
     for (const tinyobj::shape_t & shape : shapes)
     {
         Mesh* newMesh = new Mesh(shape);
         
-        meshes.push_back(newMesh);
+        meshAsset->meshes.push_back(newMesh);
+    }
+    meshAsset->ready = true;
+    setAsset(meshAsset);
+}
+
+void Shape::loadMesh(const MeshCache& cache)
+{
+    MeshAssetSharedPtr meshAsset = std::make_shared<MeshAsset>();
+    for (const MeshCache::MeshView& cachedMesh : cache.getMeshes())
+    {
+        meshAsset->meshes.push_back(new Mesh(cachedMesh));
     }
+    meshAsset->ready = true;
+    setAsset(meshAsset);
+}
+
+void Shape::loadMesh(std::vector<MeshData>&& meshData)
+{
+    MeshAssetSharedPtr meshAsset = std::make_shared<MeshAsset>();
+    for (MeshData& data : meshData)
+    {
+        meshAsset->meshes.push_back(new Mesh(std::move(data)));
+    }
+    meshData.clear();
+    meshAsset->ready = true;
+    setAsset(meshAsset);
+}
+
+void Shape::setAsset(const MeshAssetSharedPtr& _asset)
+{
+    asset = _asset;
+    meshes = asset ? asset->meshes : std::vector<Mesh*>();
 }
 
-void Shape::render(Scene& scene, ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands)
+void Shape::render(const SceneSnapshot& snapshot, ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands)
 {
     if(active)
     {
@@ -44,6 +92,8 @@ void Shape::render(Scene& scene, ShaderParameter::ShaderParamsGroup& group, Mate
 
 Shape::~Shape()
 {
-    for(Mesh* mesh: meshes)
-        delete mesh;
+    if(!ready)
+        AssetLoader::getInstance().cancel(this);
+    
+    //the meshes go with the last shape using the asset
 }
@@ -4,22 +4,25 @@
 
 #include "Transform.h"
 #include "Utility/External/tiny_obj/tiny_obj_loader.h"
+#include "Utility/MeshCache.h"
+#include "Utility/AssetStore.h"
+#include "Shape/MeshData.h"
 #include "Graphic/Material/Material.h"
 #include "Shape/Transform.h"
 #include "Graphic/Material/Voxelization/VoxelizationMaterial.h"
 #include "Graphic/Material/Voxelization/VoxelizationConeTracingMaterial.h"
 
-class Scene;
+class SceneSnapshot;
 class Material;
 class Mesh;
 
 class Shape
 {
 public:
-	std::vector<Mesh*> meshes;
+	std::vector<Mesh*> meshes; // the meshes of asset, shared with every shape using the same asset
     
 public:
-    void render(Scene& scene, ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands);
+    void render(const SceneSnapshot& snapshot, ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands);
     
     inline void diffuseColor(glm::vec3 _diffuseColor){ defaultVoxProperties.diffuseColor = _diffuseColor;}
     inline void specularColor(glm::vec3 _specularColor){ defaultVoxProperties.specularColor = _specularColor;}
@@ -31,12 +34,20 @@ public:
     inline void refractiveIndex(float _refractiveIndex ){ defaultVoxProperties.refractiveIndex = _refractiveIndex; }
     
     inline const std::vector<VoxProperties>& getMeshProperties( ) const { return meshProperties ;}
+    
+    inline const MeshAssetSharedPtr& getAsset() const { return asset; }
+    
+    // False while AssetLoader is still loading or uploading the meshes, render passes skip shapes that aren't ready.
+    inline bool isReady() const { return ready; }
     VoxelizationMaterial::VoxProperties defaultVoxProperties = VoxProperties::Default();;
     
     void setVoxProperites(VoxelizationMaterial::VoxProperties &voxProperties);
     
     Shape();
     Shape(std::vector<tinyobj::shape_t>& shapes);
+    Shape(const MeshCache& cache);
+    Shape(std::vector<MeshData>&& meshData);
+    explicit Shape(const MeshAssetSharedPtr& asset);
     virtual ~Shape();
     
 public:
@@ -46,8 +57,14 @@ public:
     
 protected:
     void loadMesh(std::vector<tinyobj::shape_t>& shapes );
+    void loadMesh(const MeshCache& cache);
+    void loadMesh(std::vector<MeshData>&& meshData);
+    void setAsset(const MeshAssetSharedPtr& asset);
     
 protected:
+    MeshAssetSharedPtr asset; // owns the meshes, a private one unless they came through AssetStore
+    bool ready = true;
+    friend class AssetLoader;
 
     
     
@@ -11,19 +11,30 @@
 #include "Material.h"
 #include "MaterialStore.h"
 #include "FBO_2D.h"
+#include "Graphic/Material/Resource.h"
+#include "Utility/FontAtlas.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+
+//vertices the GPU buffer starts with, a few overlay lines of 60 characters
+static const size_t INITIAL_VERTICES = 6 * 60 * 8;
 
 TextQuad::TextQuad(glm::vec2 & _dimensions):
 Mesh()
 {
     indices.reserve(6);
-    vertexData.reserve(6);
+    vertexData.reserve(INITIAL_VERTICES);
+    vertexCapacity = INITIAL_VERTICES;
     screenDimensions = _dimensions;
     scale = 1.0f;
     textDisplay = MaterialStore::GET_MAT<Material>("text-display");
     color = glm::vec4(1.0f);
     orthoProjection = glm::ortho(0.0f, screenDimensions.x, 0.0f, screenDimensions.y, -.1f, 3.0f);
-    loadTextures();
+    //without glyphs nothing is drawn, add, flush and draw do nothing
+    enabled = loadTextures();
     staticMesh = false;
     
     //this doesn't change
@@ -38,96 +49,85 @@ Mesh()
     
 }
 
-void TextQuad::loadTextures()
+bool TextQuad::loadTextures()
 {
-    int result = FT_Init_FreeType(&ft);
-    assert(result == 0 && "FreeType Library failed to initialize");
-    
-#ifdef __APPLE__
-    
-    // this font comes with MacOS X
-    result = FT_New_Face(ft, "/Library/Fonts/Devanagari Sangam MN.ttc", 0, &face);
-    
-#else
-    //other platforms not supported
-    #error "If you would like text to render on screen, you'll need to specify a .ttc file on your computer where the font comes from"
-
-#endif
-    
-    
-    assert(result == 0 && "FreeType font not found");
-    FT_Set_Pixel_Sizes(face, 0, 48);
+    //the atlas font-atlas-baker wrote, committed with the assets, the app doesn't bake fonts itself
+    FontAtlas font;
+    std::string atlasPath = Resource::resourceRoot + FontAtlas::DEFAULT_PATH;
+    if(!font.open(atlasPath))
+    {
+        std::cerr << "No font atlas at [" << atlasPath << "], the text overlay is off, bake one with font-atlas-baker" << std::endl;
+        return false;
+    }
     
-    for(GLubyte c = 0; c < 128; c++)
+    glm::vec2 atlasSize(font.getWidth(), font.getHeight());
+    float toReference = static_cast<float>(REFERENCE_PIXEL_SIZE) / std::max(font.getPixelSize(), 1u);
+    for(int c = 0; c < CHARACTERS; c++)
     {
-        unsigned int result = FT_Load_Char(face, c , FT_LOAD_RENDER);
-        assert(result == 0);
-        
-        Texture2D* texture = new Texture2D(true);
-        Texture2D::Commands textureCommands(texture);
-        textureCommands.unpackAlignment(1);
-        textureCommands.end();
-        
-        texture->SetWidth(face->glyph->bitmap.width);
-        texture->SetHeight(face->glyph->bitmap.rows);
-        texture->SetDataType(GL_UNSIGNED_BYTE);
-        texture->SetPixelFormat(GL_RED);
-        texture->SetMinFilter(GL_LINEAR);
-        texture->SetMagFilter(GL_LINEAR);
-        texture->SetBuffer(face->glyph->bitmap.buffer);
-        texture->SaveTextureState();
+        const FontAtlas::Glyph& glyph = font.getGlyph(c);
         Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            static_cast<unsigned int>(face->glyph->advance.x)
+            glm::vec2(glyph.x, glyph.y) / atlasSize,
+            glm::vec2(glyph.x + glyph.width, glyph.y + glyph.height) / atlasSize,
+            glm::vec2(glyph.width, glyph.height) * toReference,
+            glm::vec2(glyph.left, glyph.top) * toReference,
+            glyph.advance / 64.0f * toReference
         };
-        
-
-        characters.insert(std::pair<GLchar, Character>(c, character));
+        characters[c] = character;
     }
     
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+    atlas = new Texture2D(true);
+    Texture2D::Commands textureCommands(atlas);
+    textureCommands.unpackAlignment(1);
+    textureCommands.end();
     
+    //the atlas is only read, the texture takes it from the mapped file
+    atlas->SetWidth(font.getWidth());
+    atlas->SetHeight(font.getHeight());
+    atlas->SetDataType(GL_UNSIGNED_BYTE);
+    atlas->SetPixelFormat(GL_RED);
+    atlas->SetWrap(GL_CLAMP_TO_EDGE);
+    atlas->SetMinFilter(GL_LINEAR);
+    atlas->SetMagFilter(GL_LINEAR);
+    atlas->SetBuffer(const_cast<unsigned char*>(font.getPixels()));
+    atlas->SaveTextureState();
+    atlas->SetBuffer(nullptr);
+    return true;
 }
 
-void TextQuad::updateVertices( Character& ch, glm::vec2& position)
+void TextQuad::addVertices(const Character& ch, const glm::vec2& position, float scale, std::vector<VertexData>& vertices) const
 {
 
     float xpos = position.x + ch.Bearing.x * scale;
     float ypos = position.y - (ch.Size.y - ch.Bearing.y) * scale;//position.y + ch.Bearing.y * scale;
     
     VertexData data;
-    vertexData.clear();
-    indices.clear();
     
     float w = ch.Size.x * scale;
     float h = ch.Size.y * scale;
     
     data.position = glm::vec3(xpos, ypos + h, 0.0f);
-    data.texCoord = glm::vec2(0.0f, 0.0f);
-    vertexData.push_back(data);
+    data.texCoord = glm::vec2(ch.uvMin.x, ch.uvMin.y);
+    vertices.push_back(data);
     
     data.position = glm::vec3(xpos, ypos, 0.0f);
-    data.texCoord = glm::vec2(0.0f, 1.0f);
-    vertexData.push_back(data);
+    data.texCoord = glm::vec2(ch.uvMin.x, ch.uvMax.y);
+    vertices.push_back(data);
     
     data.position = glm::vec3(xpos + w, ypos, 0.0f);
-    data.texCoord = glm::vec2(1.0f, 1.0f);
-    vertexData.push_back(data);
+    data.texCoord = glm::vec2(ch.uvMax.x, ch.uvMax.y);
+    vertices.push_back(data);
     
     data.position = glm::vec3(xpos, ypos + h,0.0f);
-    data.texCoord = glm::vec2( 0.0f, 0.0f);
-    vertexData.push_back(data);
+    data.texCoord = glm::vec2(ch.uvMin.x, ch.uvMin.y);
+    vertices.push_back(data);
     
     data.position = glm::vec3(xpos + w, ypos,0.0f);
-    data.texCoord = glm::vec2( 1.0f, 1.0f);
-    vertexData.push_back(data);
+    data.texCoord = glm::vec2(ch.uvMax.x, ch.uvMax.y);
+    vertices.push_back(data);
 
     data.position = glm::vec3(xpos + w, ypos + h,0.0f);
-    data.texCoord = glm::vec2( 1.0f, 0.0f);
-    vertexData.push_back(data);
+    data.texCoord = glm::vec2(ch.uvMax.x, ch.uvMin.y);
+    vertices.push_back(data);
 }
 
 void TextQuad::setupMeshRenderer()
@@ -139,35 +139,94 @@ void TextQuad::setupMeshRenderer()
 
 void TextQuad::print(std::string& text, glm::vec2 position)
 {
+    print(text.c_str(), position);
+}
+
+void TextQuad::print(const char* text, glm::vec2 position)
+{
+    add(text, position);
+    flush();
+}
+
+void TextQuad::add(const char* text, glm::vec2 position)
+{
+    if(!enabled)
+        return;
+    layout(text, position, scale, vertexData);
+}
+
+void TextQuad::layout(const char* text, glm::vec2 position, float scale, std::vector<VertexData>& vertices) const
+{
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        //characters outside of ASCII have no glyph
+        unsigned char index = static_cast<unsigned char>(*c);
+        const Character& ch = characters[index < CHARACTERS ? index : '?'];
+        if(ch.Size.x != 0 && ch.Size.y != 0)
+            addVertices(ch, position, scale, vertices);
+        position.x += ch.Advance * scale;
+    }
+}
+
+void TextQuad::flush()
+{
+    if(vertexData.empty())
+        return;
+    
     FBO::Commands fboCommands(FBO_2D::getDefault().get());
     
     fboCommands.enableDepthTest(false);
     fboCommands.backFaceCulling(false);
     fboCommands.blendSrcAlphaOneMinusSrcAlpha();
     
-    Commands commands(this);
-    
     static ShaderParameter::ShaderParamsGroup group;
     Material::Commands matCommands(textDisplay.get());
     
     group["projection"] =orthoProjection;
+    group["text"] = atlas;
+    group["textColor"] = color;
     
     glError();
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    TextQuad::Commands txtCommands(this);
+    txtCommands.uploadGPUVertexSubData();
+    glError();
+    render(group, matCommands);
+    vertexData.clear();
+}
+
+void TextQuad::draw(Line* lines, size_t count)
+{
+    if(count == 0 || !enabled)
+        return;
+    
+    FBO::Commands fboCommands(FBO_2D::getDefault().get());
+    
+    fboCommands.enableDepthTest(false);
+    fboCommands.backFaceCulling(false);
+    fboCommands.blendSrcAlphaOneMinusSrcAlpha();
+    
+    static ShaderParameter::ShaderParamsGroup group;
+    Material::Commands matCommands(textDisplay.get());
+    
+    group["projection"] =orthoProjection;
+    group["text"] = atlas;
+    group["textColor"] = color;
+    matCommands.uploadParameters(group);
+    
+    TextQuad::Commands txtCommands(this);
+    for(size_t i = 0; i < count; ++i)
     {
-        Character& ch =characters[*c];
-        updateVertices(ch, position);
-
-        TextQuad::Commands txtCommands(this);
-        
-        txtCommands.uploadGPUVertexSubData();
-        glError();
-        group["text"] = ch.texture;
-        group["textColor"] = color;
-        render(group, matCommands);
-        position.x += (ch.Advance >> 6) * scale;
+        Line& line = lines[i];
+        if(line.changed)
+        {
+            lineVertices.clear();
+            layout(line.text, line.position, line.scale, lineVertices);
+            txtCommands.uploadLine(line, lineVertices);
+            line.changed = false;
+        }
+        txtCommands.renderLine(line);
     }
+    glError();
 }
 
 
@@ -200,7 +259,7 @@ void TextQuad::Commands::uploadGPUVertexData()
     static const int NUMBER_OF_ELEMENTS = 3;
     glBindBuffer(GL_ARRAY_BUFFER, textQuad->vbo);
     glError();
-    glBufferData(GL_ARRAY_BUFFER, 6 * dataSize, nullptr,
+    glBufferData(GL_ARRAY_BUFFER, textQuad->vertexCapacity * dataSize, nullptr,
                  textQuad->staticMesh ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
     glError();
     glEnableVertexAttribArray(POSITION_LOCATION);
@@ -216,24 +275,110 @@ void TextQuad::Commands::uploadGPUVertexSubData()
     glBindBuffer(GL_ARRAY_BUFFER, textQuad->vbo);
     glError();
     auto dataSize = sizeof(VertexData);
-    size_t s = textQuad->vertexData.size();
+    
+    //orphaned before every batch, the driver hands out fresh storage instead of waiting for the last draw from it
+    textQuad->vertexCapacity = std::max(textQuad->vertexCapacity, textQuad->vertexData.size());
+    glBufferData(GL_ARRAY_BUFFER, textQuad->vertexCapacity * dataSize, nullptr, GL_DYNAMIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER,0,textQuad->vertexData.size() * dataSize, textQuad->vertexData.data());
     glError();
 }
 
 void TextQuad::Commands::render()
 {
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(textQuad->vertexData.size()));
 }
 
-TextQuad::~TextQuad()
+void TextQuad::Commands::uploadLine(Line& line, const std::vector<VertexData>& vertices)
+{
+    auto dataSize = sizeof(VertexData);
+    if(line.vao == 0)
+    {
+        glGenVertexArrays(1, &line.vao);
+        glGenBuffers(1, &line.vbo);
+        glBindVertexArray(line.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, line.vbo);
+        static const int NUMBER_OF_ELEMENTS = 3;
+        glEnableVertexAttribArray(POSITION_LOCATION);
+        glVertexAttribPointer(POSITION_LOCATION, NUMBER_OF_ELEMENTS, GL_FLOAT, GL_FALSE, dataSize, (GLvoid*)offsetof(VertexData, position));
+        glEnableVertexAttribArray(TEXTURE_LOCATION);
+        static const int NUMBER_OF_TEXTURE_ELEMENTS = 2;
+        glVertexAttribPointer(TEXTURE_LOCATION, NUMBER_OF_TEXTURE_ELEMENTS, GL_FLOAT, GL_FALSE, dataSize, (GLvoid*)offsetof(VertexData, texCoord));
+    }
+    else
+        glBindBuffer(GL_ARRAY_BUFFER, line.vbo);
+    
+    //orphaned like the batch, a line changing every frame doesn't wait for the draw of the last one
+    line.vertexCapacity = std::max(line.vertexCapacity, vertices.size());
+    line.vertexCount = vertices.size();
+    glBufferData(GL_ARRAY_BUFFER, line.vertexCapacity * dataSize, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, line.vertexCount * dataSize, vertices.data());
+    glError();
+}
+
+void TextQuad::Commands::renderLine(const Line& line)
+{
+    if(line.vertexCount == 0)
+        return;
+    glBindVertexArray(line.vao);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(line.vertexCount));
+}
+
+void TextQuad::Commands::deleteLine(Line& line)
+{
+    if(line.vao == 0)
+        return;
+    glDeleteBuffers(1, &line.vbo);
+    glDeleteVertexArrays(1, &line.vao);
+    line.vao = line.vbo = 0;
+    line.vertexCount = line.vertexCapacity = 0;
+}
+
+///////LINE
+
+TextQuad::Line::Line(Line&& other)
 {
-    for( std::map<GLchar, Character>::iterator it = characters.begin();
-        it != characters.end(); ++it)
+    *this = std::move(other);
+}
+
+TextQuad::Line& TextQuad::Line::operator=(Line&& other)
+{
+    if(this != &other)
     {
-        Character& ch = it->second;
-        delete ch.texture;
+        TextQuad::Commands::deleteLine(*this);
+        memcpy(text, other.text, sizeof(text));
+        position = other.position;
+        scale = other.scale;
+        changed = other.changed;
+        vao = other.vao;
+        vbo = other.vbo;
+        vertexCount = other.vertexCount;
+        vertexCapacity = other.vertexCapacity;
+        other.vao = other.vbo = 0;
+        other.vertexCount = other.vertexCapacity = 0;
     }
+    return *this;
+}
+
+void TextQuad::Line::set(const char* _text, glm::vec2 _position, float _scale)
+{
+    //compared before copied, most lines show what they showed last frame
+    if(strncmp(text, _text, MAX_LENGTH - 1) == 0 && position == _position && scale == _scale && vao != 0)
+        return;
+    strncpy(text, _text, MAX_LENGTH - 1);
+    text[MAX_LENGTH - 1] = '\0';
+    position = _position;
+    scale = _scale;
+    changed = true;
+}
+
+TextQuad::Line::~Line()
+{
+    TextQuad::Commands::deleteLine(*this);
+}
+
+TextQuad::~TextQuad()
+{
+    delete atlas;
 }
 
 
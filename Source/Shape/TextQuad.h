@@ -8,14 +8,11 @@
 
 #pragma once
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 #include "Primitive.h"
 #include "Mesh.h"
 #include "glm.hpp"
 #include <string>
-#include <map>
+#include <vector>
 
 
 class Texture2D;
@@ -24,16 +21,53 @@ class TextQuad : private Mesh
 {
     
 private:
+    // Sizes in pixels at scale 1, the quad covers the glyph and the distance field around it.
     struct Character {
-        Texture2D* texture;    // ID handle of the glyph texture
-        glm::ivec2 Size;       // Size of glyph
-        glm::ivec2 Bearing;    // Offset from baseline to left/top of glyph
-        unsigned int     Advance;    // Offset to advance to next glyph
+        glm::vec2 uvMin;       // Top left of the glyph in the atlas
+        glm::vec2 uvMax;       // Bottom right of the glyph in the atlas
+        glm::vec2 Size;        // Size of glyph
+        glm::vec2 Bearing;     // Offset from baseline to left/top of glyph
+        float     Advance;     // Offset to advance to next glyph
     };
     
+    static const int CHARACTERS = 128;
+    
+    // Glyph height in pixels at scale 1, whatever size the atlas was baked at.
+    static const unsigned int REFERENCE_PIXEL_SIZE = 48;
+    
 public:
     TextQuad(glm::vec2& screenDimensions);
     
+    // A string kept laid out in a GPU buffer of its own, laid out and uploaded again only when its text, position or scale
+    // changes, so a line showing the same thing as the last frame costs one draw call and nothing else.
+    class Line
+    {
+    public:
+        static const size_t MAX_LENGTH = 160;
+        
+        Line() {}
+        Line(Line&& other);
+        Line& operator=(Line&& other);
+        ~Line();
+        
+        // Cheap when nothing differs from the last call, the next draw lays it out otherwise.
+        void set(const char* text, glm::vec2 position, float scale = 1.0f);
+        
+    private:
+        friend class TextQuad;
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+        
+        char text[MAX_LENGTH] = {};
+        glm::vec2 position = glm::vec2(0.0f);
+        float scale = 1.0f;
+        bool changed = false;
+        
+        GLuint vao = 0, vbo = 0;
+        size_t vertexCount = 0;
+        size_t vertexCapacity = 0; // vertices the buffer holds, it only grows
+    };
+    
     class Commands: public Primitive::Commands
     {
     public:
@@ -41,14 +75,29 @@ public:
         void uploadGPUVertexData() override;
         void render() override;
         void uploadGPUVertexSubData();
+        void uploadLine(Line& line, const std::vector<VertexData>& vertices);
+        void renderLine(const Line& line);
+        static void deleteLine(Line& line);
     private:
         TextQuad* textQuad = nullptr;
     };
 
+    // False when there is no font atlas, nothing is drawn then.
+    inline bool isEnabled() const { return enabled; }
     inline void setColor(glm::vec4& _color){ color = _color;}
     inline void setScale(float _scale ){ scale = _scale;}
     
+    // Draws text at once, with one draw call.
     void print(std::string& text, glm::vec2 position);
+    void print(const char* text, glm::vec2 position);
+    
+    // Lays out text with the current scale into the batch the next flush draws, so many lines cost one draw call.
+    void add(const char* text, glm::vec2 position);
+    // Draws every string added since the last flush in the current color.
+    void flush();
+    
+    // Draws lines in the current color, sharing the shader setup, only the ones that changed are laid out again.
+    void draw(Line* lines, size_t count);
     
     void render(ShaderParameter::ShaderParamsGroup& group, Material::Commands& commands) override;
     
@@ -57,8 +106,10 @@ public:
 private:
     
     void init();
-    void loadTextures();
-    void updateVertices(Character &character, glm::vec2 &position);
+    // False when there is no atlas, see font-atlas-baker.
+    bool loadTextures();
+    void layout(const char* text, glm::vec2 position, float scale, std::vector<VertexData>& vertices) const;
+    void addVertices(const Character &character, const glm::vec2 &position, float scale, std::vector<VertexData>& vertices) const;
     void setupMeshRenderer() override;
 
 private:
@@ -66,12 +117,13 @@ private:
     glm::vec4 color;
     glm::mat4 orthoProjection;
     
-    std::map<GLchar, Character> characters;
+    // All glyphs packed into one signed distance field texture, the quads of a batch sample it with a single bind.
+    Character characters[CHARACTERS];
+    Texture2D* atlas = nullptr;
     std::shared_ptr<Material> textDisplay;
+    size_t vertexCapacity = 0; // vertices the GPU buffer holds, it grows with the largest batch
+    std::vector<VertexData> lineVertices; // a changed line is laid out here before its upload
 
-    FT_Library ft;
-    FT_Face face;
-    
     float scale;
 };
 
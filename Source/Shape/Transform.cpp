@@ -3,32 +3,74 @@
 #include <ostream>
 
 Transform::Transform() {
-	updateTransformMatrix();
+	node = SceneGraph::getInstance().create(this);
 }
 
-void Transform::updateTransformMatrix() {
-	transform = glm::translate(position) * glm::mat4_cast(glm::quat(rotation)) * glm::scale(scale);
-	transformIsInvalid = false;
+Transform::Transform(const Transform & other) : Transform() {
+	*this = other;
+}
+
+Transform & Transform::operator=(const Transform & other) {
+	if (this != &other) {
+		set(other.getPosition(), other.getRotation(), other.getScale());
+		setParent(other.getParent());
+	}
+	return *this;
+}
+
+Transform::~Transform() {
+	SceneGraph::getInstance().destroy(node);
+}
+
+glm::vec3 Transform::getPosition() const { return SceneGraph::getInstance().getPosition(node); }
+glm::vec3 Transform::getRotation() const { return SceneGraph::getInstance().getRotation(node); }
+glm::vec3 Transform::getScale() const { return SceneGraph::getInstance().getScale(node); }
+void Transform::setPosition(const glm::vec3 & position) { SceneGraph::getInstance().setPosition(node, position); }
+void Transform::setRotation(const glm::vec3 & rotation) { SceneGraph::getInstance().setRotation(node, rotation); }
+void Transform::setScale(const glm::vec3 & scale) { SceneGraph::getInstance().setScale(node, scale); }
+
+void Transform::set(const glm::vec3 & position, const glm::vec3 & rotation, const glm::vec3 & scale) {
+	setPosition(position);
+	setRotation(rotation);
+	setScale(scale);
+}
+
+void Transform::setParent(Transform * parent) {
+	SceneGraph::getInstance().setParent(node, parent ? parent->node : SceneGraph::INVALID);
+}
+
+Transform * Transform::getParent() const {
+	SceneGraph & graph = SceneGraph::getInstance();
+	return graph.getOwner(graph.getParent(node));
 }
 
 const glm::mat4 & Transform::getTransformMatrix() {
-	if (transformIsInvalid) { updateTransformMatrix(); }
-	return transform;
+	SceneGraph & graph = SceneGraph::getInstance();
+	if (graph.isDirty()) { graph.update(); }
+	return graph.getWorldMatrix(node);
+}
+
+const glm::mat4 & Transform::getNormalMatrix() {
+	SceneGraph & graph = SceneGraph::getInstance();
+	if (graph.isDirty()) { graph.update(); }
+	return graph.getNormalMatrix(node);
 }
 
-glm::vec3 Transform::forward() { return glm::quat(rotation) * glm::vec3(0, 0, 1); }
-glm::vec3 Transform::up() { return glm::quat(rotation) * glm::vec3(0, 1, 0); }
-glm::vec3 Transform::right() { return glm::quat(rotation) * glm::vec3(-1, 0, 0); }
+glm::vec3 Transform::forward() { return glm::quat(getRotation()) * glm::vec3(0, 0, 1); }
+glm::vec3 Transform::up() { return glm::quat(getRotation()) * glm::vec3(0, 1, 0); }
+glm::vec3 Transform::right() { return glm::quat(getRotation()) * glm::vec3(-1, 0, 0); }
 
 std::ostream & operator<<(std::ostream & os, const Transform & t) {
+	glm::vec3 position = t.getPosition(), rotation = t.getRotation(), scale = t.getScale();
+	const glm::mat4 & transform = SceneGraph::getInstance().getWorldMatrix(t.node);
 	os << "- - - transform - - -" << std::endl;
-	os << "position: " << t.position.x << ", " << t.position.y << ", " << t.position.z << std::endl;
-	os << "rotation: " << t.rotation.x << ", " << t.rotation.y << ", " << t.rotation.z << std::endl;
-	os << "scale: " << t.scale.x << ", " << t.scale.y << ", " << t.scale.z << std::endl;
+	os << "position: " << position.x << ", " << position.y << ", " << position.z << std::endl;
+	os << "rotation: " << rotation.x << ", " << rotation.y << ", " << rotation.z << std::endl;
+	os << "scale: " << scale.x << ", " << scale.y << ", " << scale.z << std::endl;
 	os << "matrix: " << std::endl;
 	for (int i = 0; i < 4; i++) {
 		for (int j = 0; j < 4; j++) {
-			os << t.transform[i][j] << " ";
+			os << transform[i][j] << " ";
 		}
 		os << std::endl;
 	}
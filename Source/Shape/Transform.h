@@ -8,22 +8,39 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/quaternion.hpp"
 
-/// <summary> Represents a transform: rotation, position and scale. </summary>
+#include "Scene/SceneGraph.h"
+
+/// <summary>
+/// Represents a transform: rotation, position and scale relative to its parent. The values live in the SceneGraph,
+/// setting one only marks the node dirty, its matrices are recomputed with the rest of the graph by SceneGraph::update().
+/// </summary>
 class Transform {
 public:
-	glm::vec3 position = { 0,0,0 }, scale = { 1,1,1 }, rotation = { 0,0,0 };
-	Transform * parent = nullptr;
-
 	Transform();
+	/// <summary> Copies the local values and the parent into a new node. </summary>
+	Transform(const Transform & other);
+	Transform & operator=(const Transform & other);
+	~Transform();
+
+	glm::vec3 getPosition() const;
+	glm::vec3 getRotation() const;
+	glm::vec3 getScale() const;
+	void setPosition(const glm::vec3 & position);
+	void setRotation(const glm::vec3 & rotation);
+	void setScale(const glm::vec3 & scale);
+	void set(const glm::vec3 & position, const glm::vec3 & rotation, const glm::vec3 & scale);
+
+	/// <summary> Makes this transform relative to parent, nullptr for the world. A parent can't be one of its descendants. </summary>
+	void setParent(Transform * parent);
+	Transform * getParent() const;
+
+	/// <summary> Returns a reference to the local to world matrix, updating the scene graph first if anything changed since. </summary>
+	const glm::mat4 & getTransformMatrix();
 
-	/// <summary> Is true when the transform matrix is not correctly representing the position, scale and rotation vectors. </summary>
-	bool transformIsInvalid = false;
-
-	/// <summary> Recalculates the transform matrix according to the position, scale and rotation vectors. </summary>
-	void updateTransformMatrix();
+	/// <summary> Returns a reference to the inverse transpose of the transform matrix, for normals. </summary>
+	const glm::mat4 & getNormalMatrix();
 
-	/// <summary> Returns a reference to the transform matrix </summary>
-	const glm::mat4 & getTransformMatrix();
+	inline SceneGraph::NodeId getNode() const { return node; }
 
 	/// <summary> Output. </summary>
 	friend std::ostream & operator<<(std::ostream &, const Transform &);
@@ -33,5 +50,5 @@ public:
 	glm::vec3 up();
 	glm::vec3 right();
 private:
-	glm::mat4 transform;
+	SceneGraph::NodeId node;
 };
@@ -0,0 +1,398 @@
+#include "Shape/VertexEncoder.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define VERTEX_ENCODER_SSE2 1
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define VERTEX_ENCODER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    const float SNORM16_SCALE = 32767.0f;
+
+    inline uint32_t asUint(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float asFloat(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline int16_t toSnorm16(float value)
+    {
+        value = std::min(std::max(value, -1.0f), 1.0f);
+        return static_cast<int16_t>(std::lrint(value * SNORM16_SCALE));
+    }
+
+    //four vertices worth of encoded attributes
+    struct Block
+    {
+        uint16_t positions[4][4];
+        int16_t normals[4][2];
+        uint16_t texCoords[4][2];
+    };
+
+#if VERTEX_ENCODER_SSE2
+
+    //round to nearest even, handles denormals, overflow to infinity and NaN; the result is in the low 16 bits
+    //of each lane, sign extended so _mm_packs_epi32 keeps it intact
+    inline __m128i floatToHalf4(__m128 value)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128i infinity32 = _mm_set1_epi32(0x7f800000);
+        const __m128i overflow = _mm_set1_epi32((127 + 16) << 23);
+        const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+        const __m128i denormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i normalBias = _mm_set1_epi32(0xfff - (112 << 23));
+        const __m128i infinity16 = _mm_set1_epi32(0x7c00);
+        const __m128i nanBit = _mm_set1_epi32(0x200);
+
+        __m128 sign = _mm_and_ps(value, signMask);
+        __m128 absolute = _mm_xor_ps(value, sign);
+        __m128i bits = _mm_castps_si128(absolute);
+
+        __m128i isNan = _mm_cmpgt_epi32(bits, infinity32);
+        __m128i isRegular = _mm_cmpgt_epi32(overflow, bits);
+        __m128i isDenormal = _mm_cmpgt_epi32(minNormal, bits);
+        __m128i special = _mm_or_si128(_mm_and_si128(isNan, nanBit), infinity16);
+
+        __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(denormalMagic))), denormalMagic);
+
+        __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+        __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, normalBias), mantissaOdd), 13);
+
+        __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+        __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+        return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+    }
+
+    inline void positionsToHalf(const VertexData* v, Block& block)
+    {
+        //each load reads position and color.x, transposed into x, y, z rows
+        __m128 x = _mm_loadu_ps(&v[0].position.x);
+        __m128 y = _mm_loadu_ps(&v[1].position.x);
+        __m128 z = _mm_loadu_ps(&v[2].position.x);
+        __m128 w = _mm_loadu_ps(&v[3].position.x);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        __m128i xy = _mm_packs_epi32(floatToHalf4(x), floatToHalf4(y));
+        __m128i zw = _mm_packs_epi32(floatToHalf4(z), _mm_setzero_si128());
+        xy = _mm_unpacklo_epi16(xy, _mm_srli_si128(xy, 8));
+        zw = _mm_unpacklo_epi16(zw, _mm_srli_si128(zw, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(block.positions[0]), _mm_unpacklo_epi32(xy, zw));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(block.positions[2]), _mm_unpackhi_epi32(xy, zw));
+    }
+
+    inline void normalsToOctahedral(const VertexData* v, Block& block)
+    {
+        //each load reads normal and texCoord.x
+        __m128 x = _mm_loadu_ps(&v[0].normal.x);
+        __m128 y = _mm_loadu_ps(&v[1].normal.x);
+        __m128 z = _mm_loadu_ps(&v[2].normal.x);
+        __m128 w = _mm_loadu_ps(&v[3].normal.x);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z));
+        __m128 valid = _mm_cmpgt_ps(l1, _mm_setzero_ps());
+        __m128 px = _mm_and_ps(_mm_div_ps(x, l1), valid);
+        __m128 py = _mm_and_ps(_mm_div_ps(y, l1), valid);
+
+        //fold the lower hemisphere over the diagonals
+        __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, py)), _mm_or_ps(one, _mm_and_ps(px, signMask)));
+        __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, px)), _mm_or_ps(one, _mm_and_ps(py, signMask)));
+        __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+        px = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, px));
+        py = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, py));
+
+        const __m128 scale = _mm_set1_ps(SNORM16_SCALE);
+        px = _mm_mul_ps(_mm_min_ps(_mm_max_ps(px, _mm_sub_ps(_mm_setzero_ps(), one)), one), scale);
+        py = _mm_mul_ps(_mm_min_ps(_mm_max_ps(py, _mm_sub_ps(_mm_setzero_ps(), one)), one), scale);
+
+        __m128i xy = _mm_packs_epi32(_mm_cvtps_epi32(px), _mm_cvtps_epi32(py));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(block.normals[0]), _mm_unpacklo_epi16(xy, _mm_srli_si128(xy, 8)));
+    }
+
+    inline void texCoordsToHalf(const VertexData* v, Block& block)
+    {
+        //64 bit loads, texCoord is the last member so reading further could run past the array
+        __m128 t01 = _mm_castpd_ps(_mm_loadh_pd(_mm_load_sd(reinterpret_cast<const double*>(&v[0].texCoord.x)), reinterpret_cast<const double*>(&v[1].texCoord.x)));
+        __m128 t23 = _mm_castpd_ps(_mm_loadh_pd(_mm_load_sd(reinterpret_cast<const double*>(&v[2].texCoord.x)), reinterpret_cast<const double*>(&v[3].texCoord.x)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(block.texCoords[0]), _mm_packs_epi32(floatToHalf4(t01), floatToHalf4(t23)));
+    }
+
+#elif VERTEX_ENCODER_NEON
+
+    inline uint16x4_t floatToHalf4(float32x4_t value)
+    {
+        return vreinterpret_u16_f16(vcvt_f16_f32(value));
+    }
+
+    inline void positionsToHalf(const VertexData* v, Block& block)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            //reads position and color.x, the fourth half is padding
+            uint16x4_t half = floatToHalf4(vld1q_f32(&v[k].position.x));
+            vst1_u16(block.positions[k], vset_lane_u16(0, half, 3));
+        }
+    }
+
+    inline void normalsToOctahedral(const VertexData* v, Block& block)
+    {
+        const float xs[4] = { v[0].normal.x, v[1].normal.x, v[2].normal.x, v[3].normal.x };
+        const float ys[4] = { v[0].normal.y, v[1].normal.y, v[2].normal.y, v[3].normal.y };
+        const float zs[4] = { v[0].normal.z, v[1].normal.z, v[2].normal.z, v[3].normal.z };
+        float32x4_t x = vld1q_f32(xs);
+        float32x4_t y = vld1q_f32(ys);
+        float32x4_t z = vld1q_f32(zs);
+
+        const uint32x4_t signMask = vdupq_n_u32(0x80000000u);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+
+        float32x4_t l1 = vaddq_f32(vaddq_f32(vabsq_f32(x), vabsq_f32(y)), vabsq_f32(z));
+        uint32x4_t valid = vcgtq_f32(l1, zero);
+        float32x4_t px = vbslq_f32(valid, vdivq_f32(x, l1), zero);
+        float32x4_t py = vbslq_f32(valid, vdivq_f32(y, l1), zero);
+
+        float32x4_t foldedX = vmulq_f32(vsubq_f32(one, vabsq_f32(py)), vbslq_f32(signMask, px, one));
+        float32x4_t foldedY = vmulq_f32(vsubq_f32(one, vabsq_f32(px)), vbslq_f32(signMask, py, one));
+        uint32x4_t lower = vcltq_f32(z, zero);
+        px = vbslq_f32(lower, foldedX, px);
+        py = vbslq_f32(lower, foldedY, py);
+
+        const float32x4_t scale = vdupq_n_f32(SNORM16_SCALE);
+        px = vmulq_f32(vminq_f32(vmaxq_f32(px, vnegq_f32(one)), one), scale);
+        py = vmulq_f32(vminq_f32(vmaxq_f32(py, vnegq_f32(one)), one), scale);
+
+        int16x4x2_t xy = { { vqmovn_s32(vcvtnq_s32_f32(px)), vqmovn_s32(vcvtnq_s32_f32(py)) } };
+        vst2_s16(block.normals[0], xy);
+    }
+
+    inline void texCoordsToHalf(const VertexData* v, Block& block)
+    {
+        float32x4_t t01 = vcombine_f32(vld1_f32(&v[0].texCoord.x), vld1_f32(&v[1].texCoord.x));
+        float32x4_t t23 = vcombine_f32(vld1_f32(&v[2].texCoord.x), vld1_f32(&v[3].texCoord.x));
+        vst1_u16(block.texCoords[0], floatToHalf4(t01));
+        vst1_u16(block.texCoords[2], floatToHalf4(t23));
+    }
+
+#else
+
+    inline void positionsToHalf(const VertexData* v, Block& block)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            block.positions[k][0] = VertexEncoder::floatToHalf(v[k].position.x);
+            block.positions[k][1] = VertexEncoder::floatToHalf(v[k].position.y);
+            block.positions[k][2] = VertexEncoder::floatToHalf(v[k].position.z);
+            block.positions[k][3] = 0;
+        }
+    }
+
+    inline void normalsToOctahedral(const VertexData* v, Block& block)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            VertexEncoder::encodeOctahedral(v[k].normal, block.normals[k]);
+        }
+    }
+
+    inline void texCoordsToHalf(const VertexData* v, Block& block)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            block.texCoords[k][0] = VertexEncoder::floatToHalf(v[k].texCoord.x);
+            block.texCoords[k][1] = VertexEncoder::floatToHalf(v[k].texCoord.y);
+        }
+    }
+
+#endif
+}
+
+uint16_t VertexEncoder::floatToHalf(float value)
+{
+    uint32_t bits = asUint(value);
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t result;
+    if(bits >= (127u + 16u) << 23)
+    {
+        //overflow to infinity, NaN stays NaN
+        result = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    }
+    else if(bits < (127u - 14u) << 23)
+    {
+        //denormal, let the float adder do the rounding
+        const uint32_t denormalMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+        result = static_cast<uint16_t>(asUint(asFloat(bits) + asFloat(denormalMagic)) - denormalMagic);
+    }
+    else
+    {
+        uint32_t mantissaOdd = (bits >> 13) & 1u;
+        bits -= 112u << 23;
+        bits += 0xfffu + mantissaOdd;
+        result = static_cast<uint16_t>(bits >> 13);
+    }
+    return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+float VertexEncoder::halfToFloat(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+
+    if(exponent == 0)
+    {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return asFloat(asUint(magnitude) | sign);
+    }
+    if(exponent == 31)
+    {
+        return asFloat(sign | 0x7f800000u | (mantissa << 13));
+    }
+    return asFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+void VertexEncoder::encodeOctahedral(const glm::vec3& normal, int16_t encoded[2])
+{
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    float x = l1 > 0.0f ? normal.x / l1 : 0.0f;
+    float y = l1 > 0.0f ? normal.y / l1 : 0.0f;
+
+    if(normal.z < 0.0f)
+    {
+        float foldedX = (1.0f - std::fabs(y)) * std::copysign(1.0f, x);
+        float foldedY = (1.0f - std::fabs(x)) * std::copysign(1.0f, y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    encoded[0] = toSnorm16(x);
+    encoded[1] = toSnorm16(y);
+}
+
+glm::vec3 VertexEncoder::decodeOctahedral(const int16_t encoded[2])
+{
+    glm::vec3 normal(std::max(encoded[0] / SNORM16_SCALE, -1.0f), std::max(encoded[1] / SNORM16_SCALE, -1.0f), 0.0f);
+    normal.z = 1.0f - std::fabs(normal.x) - std::fabs(normal.y);
+    if(normal.z < 0.0f)
+    {
+        float x = (1.0f - std::fabs(normal.y)) * std::copysign(1.0f, normal.x);
+        float y = (1.0f - std::fabs(normal.x)) * std::copysign(1.0f, normal.y);
+        normal.x = x;
+        normal.y = y;
+    }
+    return glm::normalize(normal);
+}
+
+void VertexEncoder::encode(const VertexData* vertices, size_t count, const VertexFormat& format, std::vector<unsigned char>& output)
+{
+    output.resize(count * format.stride());
+    if(count != 0)
+    {
+        encode(vertices, count, format, output.data());
+    }
+}
+
+void VertexEncoder::encode(const VertexData* vertices, size_t count, const VertexFormat& format, unsigned char* output)
+{
+    const size_t stride = format.stride();
+    const size_t positionOffset = format.positionOffset();
+    const size_t normalOffset = format.normalOffset();
+    const size_t texCoordOffset = format.texCoordOffset();
+
+    const bool halfPositions = format.position == VertexFormat::Position::HALF;
+    const bool octahedralNormals = format.normal == VertexFormat::Normal::OCTAHEDRAL_16;
+    const bool halfTexCoords = format.texCoord == VertexFormat::TexCoord::HALF;
+    const bool floatTexCoords = format.texCoord == VertexFormat::TexCoord::FLOAT32;
+
+    Block block;
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const VertexData* v = vertices + i;
+        unsigned char* out = output + i * stride;
+
+        if(halfPositions)
+            positionsToHalf(v, block);
+        if(octahedralNormals)
+            normalsToOctahedral(v, block);
+        if(halfTexCoords)
+            texCoordsToHalf(v, block);
+
+        for(int k = 0; k < 4; ++k, out += stride)
+        {
+            if(halfPositions)
+                memcpy(out + positionOffset, block.positions[k], sizeof(block.positions[k]));
+            else
+                memcpy(out + positionOffset, &v[k].position.x, 3 * sizeof(float));
+
+            if(octahedralNormals)
+                memcpy(out + normalOffset, block.normals[k], sizeof(block.normals[k]));
+            else
+                memcpy(out + normalOffset, &v[k].normal.x, 3 * sizeof(float));
+
+            if(halfTexCoords)
+                memcpy(out + texCoordOffset, block.texCoords[k], sizeof(block.texCoords[k]));
+            else if(floatTexCoords)
+                memcpy(out + texCoordOffset, &v[k].texCoord.x, 2 * sizeof(float));
+        }
+    }
+
+    //remaining vertices one at a time
+    for(; i < count; ++i)
+    {
+        const VertexData& v = vertices[i];
+        unsigned char* out = output + i * stride;
+
+        if(halfPositions)
+        {
+            uint16_t position[4] = { floatToHalf(v.position.x), floatToHalf(v.position.y), floatToHalf(v.position.z), 0 };
+            memcpy(out + positionOffset, position, sizeof(position));
+        }
+        else
+        {
+            memcpy(out + positionOffset, &v.position.x, 3 * sizeof(float));
+        }
+
+        if(octahedralNormals)
+        {
+            int16_t normal[2];
+            encodeOctahedral(v.normal, normal);
+            memcpy(out + normalOffset, normal, sizeof(normal));
+        }
+        else
+        {
+            memcpy(out + normalOffset, &v.normal.x, 3 * sizeof(float));
+        }
+
+        if(halfTexCoords)
+        {
+            uint16_t texCoord[2] = { floatToHalf(v.texCoord.x), floatToHalf(v.texCoord.y) };
+            memcpy(out + texCoordOffset, texCoord, sizeof(texCoord));
+        }
+        else if(floatTexCoords)
+        {
+            memcpy(out + texCoordOffset, &v.texCoord.x, 2 * sizeof(float));
+        }
+    }
+}
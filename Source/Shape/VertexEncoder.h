@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Shape/VertexData.h"
+#include "Shape/VertexFormat.h"
+
+/// <summary>
+/// Packs VertexData into the interleaved layout described by a VertexFormat. Half floats and octahedral
+/// normals are computed four vertices at a time with SSE2 or NEON, with a scalar fallback elsewhere.
+/// </summary>
+class VertexEncoder
+{
+public:
+    /// <summary> Writes count vertices to output, which must hold count * format.stride() bytes. </summary>
+    static void encode(const VertexData* vertices, size_t count, const VertexFormat& format, unsigned char* output);
+    static void encode(const VertexData* vertices, size_t count, const VertexFormat& format, std::vector<unsigned char>& output);
+
+    static uint16_t floatToHalf(float value);
+    static float halfToFloat(uint16_t value);
+
+    /// <summary> Octahedral encoding of a (not necessarily normalized) direction into two snorm16 values, decoded by Shaders/Common/octahedral.glsl. </summary>
+    static void encodeOctahedral(const glm::vec3& normal, int16_t encoded[2]);
+    static glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+};
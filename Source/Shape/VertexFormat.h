@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// Describes how VertexData is packed into a vertex buffer. Attributes are stored interleaved in the
+/// order position, normal, texture coordinate; color is never uploaded.
+/// </summary>
+struct VertexFormat
+{
+    enum class Position : uint8_t
+    {
+        FLOAT32,    // 3 x 32 bit float
+        HALF        // 3 x 16 bit float, padded to 8 bytes
+    };
+
+    enum class Normal : uint8_t
+    {
+        FLOAT32,        // 3 x 32 bit float
+        OCTAHEDRAL_16   // 2 x 16 bit snorm, octahedral encoding
+    };
+
+    enum class TexCoord : uint8_t
+    {
+        NONE,
+        FLOAT32,    // 2 x 32 bit float
+        HALF        // 2 x 16 bit float
+    };
+
+    Position position = Position::FLOAT32;
+    Normal normal = Normal::FLOAT32;
+    TexCoord texCoord = TexCoord::FLOAT32;
+
+    /// <summary> 32 bit floats everywhere, 32 bytes per vertex. </summary>
+    static inline VertexFormat Full() { return VertexFormat(); }
+
+    /// <summary> Half positions, octahedral normals and no texture coordinates, 12 bytes per vertex. </summary>
+    static inline VertexFormat Compact()
+    {
+        VertexFormat format;
+        format.position = Position::HALF;
+        format.normal = Normal::OCTAHEDRAL_16;
+        format.texCoord = TexCoord::NONE;
+        return format;
+    }
+
+    inline unsigned int positionSize() const { return position == Position::FLOAT32 ? 12 : 8; }
+    inline unsigned int normalSize() const { return normal == Normal::FLOAT32 ? 12 : 4; }
+    inline unsigned int texCoordSize() const { return texCoord == TexCoord::NONE ? 0 : (texCoord == TexCoord::FLOAT32 ? 8 : 4); }
+
+    inline unsigned int positionOffset() const { return 0; }
+    inline unsigned int normalOffset() const { return positionSize(); }
+    inline unsigned int texCoordOffset() const { return positionSize() + normalSize(); }
+    inline unsigned int stride() const { return positionSize() + normalSize() + texCoordSize(); }
+
+    /// <summary> Compact identifier, e.g. to tag files holding vertices in this format. </summary>
+    inline uint32_t code() const
+    {
+        return static_cast<uint32_t>(position) | static_cast<uint32_t>(normal) << 8 | static_cast<uint32_t>(texCoord) << 16;
+    }
+
+    inline bool operator==(const VertexFormat& other) const { return code() == other.code(); }
+    inline bool operator!=(const VertexFormat& other) const { return code() != other.code(); }
+};
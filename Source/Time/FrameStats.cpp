@@ -0,0 +1,198 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+double FrameStats::budgetMilliseconds = 1000.0 / 60.0;
+
+static const uint64_t MAX_MICROSECONDS = (uint64_t(1) << 36) - 1;
+
+FrameStats& FrameStats::getInstance()
+{
+    static FrameStats stats;
+    return stats;
+}
+
+void FrameStats::recordFrame(double milliseconds)
+{
+    frames.record(milliseconds, milliseconds > budgetMilliseconds);
+
+    uint64_t index = recentWritten.fetch_add(1, std::memory_order_relaxed);
+    recent[index % RECENT_FRAMES].store(static_cast<float>(milliseconds), std::memory_order_relaxed);
+}
+
+void FrameStats::recordPass(const char* name, double milliseconds)
+{
+    //slots are claimed once and never given back, a name is found by pointer and its text
+    for(size_t i = 0; i < MAX_PASSES; ++i)
+    {
+        const char* slot = passNames[i].load(std::memory_order_acquire);
+        if(slot == nullptr)
+        {
+            if(passNames[i].compare_exchange_strong(slot, name, std::memory_order_acq_rel))
+                slot = name;
+        }
+        if(slot == name || strcmp(slot, name) == 0)
+        {
+            passes[i].record(milliseconds, false);
+            return;
+        }
+    }
+}
+
+FrameStats::Summary FrameStats::getFrames() const
+{
+    return frames.summarize();
+}
+
+FrameStats::Summary FrameStats::getRecentFrames() const
+{
+    //slots being written while copied hold either the old or the new frame, fine for a sliding window
+    float values[RECENT_FRAMES];
+    size_t count = static_cast<size_t>(std::min(recentWritten.load(std::memory_order_relaxed), static_cast<uint64_t>(RECENT_FRAMES)));
+    for(size_t i = 0; i < count; ++i)
+        values[i] = recent[i].load(std::memory_order_relaxed);
+
+    Summary summary;
+    summary.count = count;
+    if(count == 0)
+        return summary;
+
+    std::sort(values, values + count);
+    auto percentile = [&](double fraction) { return values[std::min(count - 1, static_cast<size_t>(std::ceil(fraction * count)) - 1)]; };
+    for(size_t i = 0; i < count; ++i)
+    {
+        summary.mean += values[i];
+        if(values[i] > budgetMilliseconds)
+            ++summary.hitches;
+    }
+    summary.mean /= count;
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = values[count - 1];
+    return summary;
+}
+
+void FrameStats::getPasses(std::vector<Summary>& summaries) const
+{
+    summaries.clear();
+    for(size_t i = 0; i < MAX_PASSES; ++i)
+    {
+        const char* name = passNames[i].load(std::memory_order_acquire);
+        if(name == nullptr)
+            break;
+        summaries.push_back(passes[i].summarize());
+        summaries.back().name = name;
+    }
+}
+
+void FrameStats::print(std::ostream& stream) const
+{
+    auto row = [&](const char* name, const Summary& summary)
+    {
+        stream << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+               << std::setw(9) << summary.count << std::setw(9) << summary.mean << std::setw(9) << summary.p50
+               << std::setw(9) << summary.p95 << std::setw(9) << summary.p99 << std::setw(9) << summary.max << std::endl;
+    };
+
+    Summary all = getFrames();
+    stream << "Frame times in ms, " << all.hitches << " of " << all.count << " frames over the budget of "
+           << std::fixed << std::setprecision(2) << budgetMilliseconds << " ms" << std::endl;
+    stream << std::left << std::setw(24) << "" << std::right << std::setw(9) << "count" << std::setw(9) << "mean"
+           << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9) << "max" << std::endl;
+    row("Present to present", all);
+    std::vector<Summary> summaries;
+    getPasses(summaries);
+    for(const Summary& pass : summaries)
+        row(pass.name, pass);
+}
+
+void FrameStats::reset()
+{
+    frames.reset();
+    for(Histogram& pass : passes)
+        pass.reset();
+    for(std::atomic<float>& value : recent)
+        value.store(0.0f, std::memory_order_relaxed);
+    recentWritten.store(0, std::memory_order_relaxed);
+}
+
+void FrameStats::Histogram::record(double milliseconds, bool hitch)
+{
+    uint64_t microseconds = std::min(static_cast<uint64_t>(std::max(0.0, milliseconds) * 1000.0 + 0.5), MAX_MICROSECONDS);
+    counts[bucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+    if(hitch)
+        hitches.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = maxMicroseconds.load(std::memory_order_relaxed);
+    while(microseconds > max && !maxMicroseconds.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+    {
+    }
+
+    //last, a reader seeing the count sees the bucket too
+    count.fetch_add(1, std::memory_order_release);
+}
+
+FrameStats::Summary FrameStats::Histogram::summarize() const
+{
+    Summary summary;
+    uint64_t total = count.load(std::memory_order_acquire);
+    summary.count = static_cast<size_t>(total);
+    if(total == 0)
+        return summary;
+
+    summary.hitches = static_cast<size_t>(hitches.load(std::memory_order_relaxed));
+    summary.mean = totalMicroseconds.load(std::memory_order_relaxed) / 1000.0 / total;
+    summary.max = maxMicroseconds.load(std::memory_order_relaxed) / 1000.0;
+
+    //the highest value of the bucket holding the percentile, never above the largest value recorded
+    double* targets[] = { &summary.p50, &summary.p95, &summary.p99 };
+    double fractions[] = { 0.50, 0.95, 0.99 };
+    size_t next = 0;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS && next < 3; ++i)
+    {
+        seen += counts[i].load(std::memory_order_relaxed);
+        while(next < 3 && seen >= static_cast<uint64_t>(std::ceil(fractions[next] * total)))
+            *targets[next++] = std::min(highestInBucket(i) / 1000.0, summary.max);
+    }
+    while(next < 3)
+        *targets[next++] = summary.max; // buckets reset while reading
+    return summary;
+}
+
+void FrameStats::Histogram::reset()
+{
+    for(std::atomic<uint32_t>& bucketCount : counts)
+        bucketCount.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    totalMicroseconds.store(0, std::memory_order_relaxed);
+    maxMicroseconds.store(0, std::memory_order_relaxed);
+    hitches.store(0, std::memory_order_relaxed);
+}
+
+size_t FrameStats::Histogram::bucket(uint64_t microseconds)
+{
+    if(microseconds < 64)
+        return static_cast<size_t>(microseconds);
+
+    unsigned int exponent = 6;
+    while((microseconds >> (exponent + 1)) != 0)
+        ++exponent;
+    uint64_t subBucket = microseconds >> (exponent - 5); // 32 to 63
+    return 64 + (exponent - 6) * 32 + static_cast<size_t>(subBucket - 32);
+}
+
+uint64_t FrameStats::Histogram::highestInBucket(size_t index)
+{
+    if(index < 64)
+        return index;
+
+    unsigned int exponent = static_cast<unsigned int>((index - 64) / 32 + 6);
+    uint64_t subBucket = (index - 64) % 32 + 32;
+    return ((subBucket + 1) << (exponent - 5)) - 1;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// Frame time statistics that show stutter averages hide. The whole run goes into log-linear histograms in the manner of
+/// HdrHistogram, its percentiles are within 3%, the latest frames into a ring for a sliding window. Frames over
+/// budgetMilliseconds are hitches. Passes, e.g. those GpuProfiler measures, get a histogram each.
+/// Recording is lock-free and doesn't allocate, any thread may record and read.
+/// </summary>
+class FrameStats
+{
+public:
+    struct Summary
+    {
+        const char* name = nullptr; // the pass, nullptr for frames
+        size_t count = 0;
+        size_t hitches = 0; // frames over budgetMilliseconds
+        double mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0; // milliseconds
+    };
+
+    static FrameStats& getInstance();
+
+    /// <summary> Frames taking longer are hitches, 60 Hz by default. </summary>
+    static double budgetMilliseconds;
+
+    static const size_t RECENT_FRAMES = 240;
+    static const size_t MAX_PASSES = 32;
+
+    void recordFrame(double milliseconds);
+
+    /// <summary> name must outlive the stats, e.g. a literal. Passes after the first MAX_PASSES names are dropped. </summary>
+    void recordPass(const char* name, double milliseconds);
+
+    /// <summary> Every frame since the start or reset. </summary>
+    Summary getFrames() const;
+
+    /// <summary> The latest RECENT_FRAMES frames, exact. </summary>
+    Summary getRecentFrames() const;
+
+    /// <summary> Fills summaries with one per pass name, in the order they were first recorded, reusing its storage. </summary>
+    void getPasses(std::vector<Summary>& summaries) const;
+
+    /// <summary> Writes the frame and pass summaries as a table. </summary>
+    void print(std::ostream& stream) const;
+
+    void reset();
+
+private:
+    //microseconds, below 64 exactly, then 32 buckets per power of two up to about 19 hours
+    class Histogram
+    {
+    public:
+        static const size_t BUCKETS = 1024;
+
+        void record(double milliseconds, bool hitch);
+        Summary summarize() const;
+        void reset();
+
+    private:
+        static size_t bucket(uint64_t microseconds);
+        static uint64_t highestInBucket(size_t index);
+
+        std::atomic<uint32_t> counts[BUCKETS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalMicroseconds{0};
+        std::atomic<uint64_t> maxMicroseconds{0};
+        std::atomic<uint64_t> hitches{0};
+    };
+
+    FrameStats() {}
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+
+    Histogram frames;
+    std::atomic<float> recent[RECENT_FRAMES] = {};
+    std::atomic<uint64_t> recentWritten{0};
+
+    std::atomic<const char*> passNames[MAX_PASSES] = {};
+    Histogram passes[MAX_PASSES];
+};
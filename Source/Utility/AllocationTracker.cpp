@@ -0,0 +1,127 @@
+#include "Utility/AllocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    //constant initialized, operator new may run before any constructor of the program
+    std::atomic<uint64_t> totalAllocations{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::atomic<uint64_t> totalFrees{ 0 };
+
+    thread_local uint64_t threadAllocations = 0;
+    thread_local uint64_t threadBytes = 0;
+    thread_local uint64_t threadFrees = 0;
+
+#if ALLOCATION_TRACKING
+    inline void counted(size_t size)
+    {
+        totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        totalBytes.fetch_add(size, std::memory_order_relaxed);
+        ++threadAllocations;
+        threadBytes += size;
+    }
+
+    inline void freed(void* pointer)
+    {
+        if(pointer == nullptr)
+            return;
+        totalFrees.fetch_add(1, std::memory_order_relaxed);
+        ++threadFrees;
+        std::free(pointer);
+    }
+
+    void* allocate(size_t size)
+    {
+        counted(size);
+        void* pointer = std::malloc(size == 0 ? 1 : size);
+        if(pointer == nullptr)
+            throw std::bad_alloc();
+        return pointer;
+    }
+#endif
+}
+
+AllocationTracker::Counts AllocationTracker::Counts::operator-(const Counts& other) const
+{
+    Counts difference;
+    difference.allocations = allocations - other.allocations;
+    difference.bytes = bytes - other.bytes;
+    difference.frees = frees - other.frees;
+    return difference;
+}
+
+AllocationTracker& AllocationTracker::getInstance()
+{
+    static AllocationTracker tracker;
+    return tracker;
+}
+
+bool AllocationTracker::isTracking()
+{
+    return ALLOCATION_TRACKING != 0;
+}
+
+AllocationTracker::Counts AllocationTracker::getTotal()
+{
+    Counts counts;
+    counts.allocations = totalAllocations.load(std::memory_order_relaxed);
+    counts.bytes = totalBytes.load(std::memory_order_relaxed);
+    counts.frees = totalFrees.load(std::memory_order_relaxed);
+    return counts;
+}
+
+AllocationTracker::Counts AllocationTracker::getThread()
+{
+    Counts counts;
+    counts.allocations = threadAllocations;
+    counts.bytes = threadBytes;
+    counts.frees = threadFrees;
+    return counts;
+}
+
+void AllocationTracker::frameEnded()
+{
+    Counts total = getTotal();
+    lastAllocations.store(total.allocations - frameStartAllocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    lastBytes.store(total.bytes - frameStartBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    lastFrees.store(total.frees - frameStartFrees.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    frameStartAllocations.store(total.allocations, std::memory_order_relaxed);
+    frameStartBytes.store(total.bytes, std::memory_order_relaxed);
+    frameStartFrees.store(total.frees, std::memory_order_relaxed);
+}
+
+AllocationTracker::Counts AllocationTracker::getLastFrame() const
+{
+    Counts counts;
+    counts.allocations = lastAllocations.load(std::memory_order_relaxed);
+    counts.bytes = lastBytes.load(std::memory_order_relaxed);
+    counts.frees = lastFrees.load(std::memory_order_relaxed);
+    return counts;
+}
+
+#if ALLOCATION_TRACKING
+//every replaceable form, one that isn't replaced would pair the library's allocation with this free or the other way round
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    counted(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    counted(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept { freed(pointer); }
+void operator delete[](void* pointer) noexcept { freed(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { freed(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { freed(pointer); }
+void operator delete(void* pointer, size_t) noexcept { freed(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { freed(pointer); }
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#define ALLOCATION_TRACKING 1 /* 0 leaves operator new and delete to the standard library, every count stays 0. */
+
+/// <summary>
+/// Counts the heap allocations made through operator new and delete, which it replaces for the whole program, so it
+/// finds the std::string, std::function and container growth of the frame loop. Counts are kept for all threads and
+/// for the calling thread, frameEnded closes a frame so the counts of the last one can be read while the next runs.
+/// A steady frame is meant to make none: storage of the frame is sized while warming up and reused from then on.
+/// </summary>
+class AllocationTracker
+{
+public:
+    struct Counts
+    {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0; // requested by the allocations
+        uint64_t frees = 0;
+
+        Counts operator-(const Counts& other) const;
+    };
+
+    static AllocationTracker& getInstance();
+
+    /// <summary> False when compiled with ALLOCATION_TRACKING 0. </summary>
+    static bool isTracking();
+
+    /// <summary> Since the program started, of every thread. </summary>
+    static Counts getTotal();
+
+    /// <summary> Since the calling thread started. </summary>
+    static Counts getThread();
+
+    /// <summary> Ends a frame, of every thread, at the same point of every frame, e.g. after the present. </summary>
+    void frameEnded();
+
+    /// <summary> Made between the last two frameEnded calls. </summary>
+    Counts getLastFrame() const;
+
+private:
+    AllocationTracker() {}
+    AllocationTracker(const AllocationTracker&) = delete;
+    AllocationTracker& operator=(const AllocationTracker&) = delete;
+
+    //the totals at the last frameEnded and the frame before it, written by the thread ending frames only
+    std::atomic<uint64_t> frameStartAllocations{ 0 }, frameStartBytes{ 0 }, frameStartFrees{ 0 };
+    std::atomic<uint64_t> lastAllocations{ 0 }, lastBytes{ 0 }, lastFrees{ 0 };
+};
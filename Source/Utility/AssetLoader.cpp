@@ -0,0 +1,224 @@
+#include "Utility/AssetLoader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <limits>
+
+#include "Shape/Shape.h"
+#include "Shape/Mesh.h"
+#include "Utility/JobSystem.h"
+
+size_t AssetLoader::uploadBudget = 16 * 1024 * 1024;
+unsigned int AssetLoader::threadCount = 0;
+unsigned int AssetLoader::queuedChunks = 4;
+
+AssetLoader& AssetLoader::getInstance()
+{
+    static AssetLoader loader;
+    return loader;
+}
+
+Shape* AssetLoader::loadShapeFromObj(const std::string& path, std::function<void(Shape&)> onReady)
+{
+    bool created = false;
+    MeshAssetSharedPtr asset = AssetStore::getInstance().acquire(path, created);
+
+    Shape* shape = new Shape();
+    shape->ready = false;
+    waiters.push_back(Waiter{ shape, asset, std::move(onReady) });
+
+    if(!created)
+        return shape;
+
+    std::shared_ptr<Load> load = std::make_shared<Load>();
+    load->asset = asset;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.push_back(load);
+        if(!pool)
+            pool.reset(new ThreadPool(threadCount));
+    }
+
+    //only the worker touches load->loaded until parsed is set
+    pool->enqueue([this, load]()
+    {
+        //the parallel parts of the load run on the JobSystem's workers, next to the frames and not as part of them
+        JobSystem::Background background;
+        bool loaded = ObjLoader::loadObj(load->asset->path, load->loaded);
+        if(load->loaded.stream)
+            streamChunks(*load);
+        size_t meshCount = load->loaded.meshCount();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            load->meshCount = meshCount;
+            load->failed = !loaded;
+            load->parsed = true;
+        }
+        loadProgressed.notify_all();
+    });
+
+    return shape;
+}
+
+void AssetLoader::streamChunks(Load& load)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        load.streamed = true;
+    }
+
+    ObjParser::Stream& stream = *load.loaded.stream;
+    ObjParser::Stream::Chunk chunk;
+    while(stream.next(chunk))
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunkTaken.wait(lock, [&]() { return load.chunks.size() < std::max(1u, queuedChunks) || load.abandoned; });
+        if(load.abandoned)
+            break;
+        load.chunks.push_back(std::move(chunk));
+        lock.unlock();
+        loadProgressed.notify_all();
+    }
+    stream.close();
+}
+
+void AssetLoader::update()
+{
+    upload(uploadBudget);
+}
+
+void AssetLoader::finish()
+{
+    //a streaming worker waits for its chunks to be uploaded, so this thread uploads while the loads run instead of waiting for the pool
+    while(true)
+    {
+        upload(std::numeric_limits<size_t>::max());
+        std::unique_lock<std::mutex> lock(mutex);
+        if(loads.empty())
+            break;
+        loadProgressed.wait(lock, [this]()
+        {
+            return std::any_of(loads.begin(), loads.end(), [](const std::shared_ptr<Load>& load) { return load->parsed || !load->chunks.empty(); });
+        });
+    }
+    //every load is uploaded, the workers are only returning from their tasks
+    if(pool)
+        pool->wait();
+}
+
+void AssetLoader::cancel(Shape* shape)
+{
+    auto cancelled = [shape](const Waiter& waiter) { return waiter.shape == shape; };
+    waiters.erase(std::remove_if(waiters.begin(), waiters.end(), cancelled), waiters.end());
+}
+
+void AssetLoader::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(std::shared_ptr<Load>& load : loads)
+            load->abandoned = true;
+    }
+    chunkTaken.notify_all();
+
+    //joins the running loads, the queued ones are dropped with the pool
+    pool.reset();
+    //their assets never become ready, the next load of the model starts over
+    for(std::shared_ptr<Load>& load : loads)
+        AssetStore::getInstance().evict(load->asset->path);
+    loads.clear();
+
+    for(Waiter& waiter : waiters)
+        waiter.shape->ready = true;
+    waiters.clear();
+}
+
+size_t AssetLoader::pendingLoads()
+{
+    return waiters.size();
+}
+
+void AssetLoader::upload(size_t budget)
+{
+    size_t uploaded = 0;
+    bool uploadedAny = false;
+    while(!uploadedAny || uploaded < budget)
+    {
+        //first load in queue order that is parsed or has streamed chunks waiting
+        std::shared_ptr<Load> load;
+        ObjParser::Stream::Chunk chunk;
+        bool hasChunk = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto next = std::find_if(loads.begin(), loads.end(), [](const std::shared_ptr<Load>& candidate) { return candidate->parsed || !candidate->chunks.empty(); });
+            if(next == loads.end())
+                break;
+            load = *next;
+            if(!load->chunks.empty())
+            {
+                chunk = std::move(load->chunks.front());
+                load->chunks.pop_front();
+                hasChunk = true;
+                chunkTaken.notify_all();
+            }
+        }
+
+        MeshAsset& asset = *load->asset;
+        if(hasChunk)
+        {
+            if(!load->uploader)
+                load->uploader.reset(new MeshStreamUploader(Mesh::defaultVertexFormat));
+            uploaded += load->uploader->append(chunk);
+            uploadedAny = true;
+            if(chunk.lastOfMesh)
+            {
+                if(Mesh* mesh = load->uploader->finish())
+                    asset.meshes.push_back(mesh);
+            }
+        }
+        else if(asset.meshes.size() < load->meshCount)
+        {
+            size_t bytes = 0;
+            asset.meshes.push_back(load->loaded.uploadMesh(asset.meshes.size(), &bytes));
+            uploaded += bytes;
+            uploadedAny = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(load->parsed && load->chunks.empty() && (load->streamed || asset.meshes.size() == load->meshCount))
+        {
+            loads.erase(std::find(loads.begin(), loads.end(), load));
+            load->uploader.reset();
+            if(load->failed)
+            {
+                //the waiting shapes stay empty, the next load of the model tries again
+                std::cerr << "Failed to load '" << asset.path << "', the shape stays empty." << std::endl;
+                AssetStore::getInstance().evict(asset.path);
+            }
+            asset.ready = true;
+        }
+    }
+
+    notifyWaiters();
+}
+
+void AssetLoader::notifyWaiters()
+{
+    //onReady may load more models and add waiters, so the ready ones are taken out first
+    std::vector<Waiter> ready;
+    auto firstReady = std::stable_partition(waiters.begin(), waiters.end(), [](const Waiter& waiter) { return !waiter.asset->isReady(); });
+    std::move(firstReady, waiters.end(), std::back_inserter(ready));
+    waiters.erase(firstReady, waiters.end());
+
+    for(Waiter& waiter : ready)
+    {
+        Shape& shape = *waiter.shape;
+        shape.setAsset(waiter.asset);
+        shape.ready = true;
+        if(waiter.onReady)
+            waiter.onReady(shape);
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Utility/AssetStore.h"
+#include "Utility/ObjLoader.h"
+#include "Utility/ThreadPool.h"
+#include "Shape/MeshStreamUploader.h"
+
+class Shape;
+
+/// <summary>
+/// Loads models in the background. Parsing, optimizing and caching run on a ThreadPool through ObjLoader::loadObj,
+/// the GPU uploads are done by update() on the main thread, a few meshes per frame within uploadBudget bytes.
+/// A Shape returned by loadShapeFromObj renders as soon as it is ready, scenes don't wait for their models.
+/// Models go through AssetStore, one that is resident or already loading is shared instead of loaded again.
+/// </summary>
+class AssetLoader
+{
+public:
+    static AssetLoader& getInstance();
+
+    /// <summary>
+    /// Returns an empty Shape that isn't ready yet, its transform and properties can be set right away.
+    /// onReady runs on the main thread once the last mesh is uploaded, it is the place for anything touching the meshes.
+    /// Resident models are ready on the next update without any loading or upload.
+    /// </summary>
+    Shape* loadShapeFromObj(const std::string& path, std::function<void(Shape&)> onReady = nullptr);
+
+    /// <summary> Uploads finished loads until uploadBudget bytes went to the GPU. Call once per frame on the thread owning the GL context. </summary>
+    void update();
+
+    /// <summary> Blocks until every queued load is parsed and uploaded, ignoring the budget. </summary>
+    void finish();
+
+    /// <summary> Forgets shape, called when a shape is deleted before it became ready. Its model still loads into AssetStore. </summary>
+    void cancel(Shape* shape);
+
+    /// <summary> Drops every load and stops the workers, shapes still waiting stay empty and their models are evicted from AssetStore. Call before the GL context goes away. </summary>
+    void clear();
+
+    /// <summary> Shapes waiting for their model. </summary>
+    size_t pendingLoads();
+
+    /// <summary> Bytes of vertex and index data uploaded per update. At least one mesh is uploaded per update. </summary>
+    static size_t uploadBudget;
+
+    /// <summary> Worker threads, 0 leaves one hardware thread to the main thread. Read when the first load starts. </summary>
+    static unsigned int threadCount;
+
+    /// <summary> Chunks a worker streaming a large model parses ahead of the upload, bounds the memory the stream holds. </summary>
+    static unsigned int queuedChunks;
+
+private:
+    struct Load
+    {
+        MeshAssetSharedPtr asset;
+        ObjLoader::LoadedObj loaded;
+        size_t meshCount = 0;
+        bool parsed = false;
+        bool failed = false; // ObjLoader::loadObj failed, set with parsed
+
+        // Streamed models, see ObjLoader::streamingThreshold. The worker queues chunks, update() uploads them.
+        std::deque<ObjParser::Stream::Chunk> chunks;
+        std::unique_ptr<MeshStreamUploader> uploader; // main thread only
+        bool streamed = false;
+        bool abandoned = false;
+    };
+
+    struct Waiter
+    {
+        Shape* shape;
+        MeshAssetSharedPtr asset;
+        std::function<void(Shape&)> onReady;
+    };
+
+    AssetLoader() {}
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Runs on the worker, waits whenever queuedChunks chunks are waiting for upload.
+    void streamChunks(Load& load);
+    void upload(size_t budget);
+    // Hands the assets that became ready to the shapes waiting for them.
+    void notifyWaiters();
+
+    std::mutex mutex;
+    std::condition_variable chunkTaken;
+    std::condition_variable loadProgressed; // a load was parsed or queued a chunk
+    std::deque<std::shared_ptr<Load>> loads; // in the order they were queued
+    std::vector<Waiter> waiters; // main thread only
+    std::unique_ptr<ThreadPool> pool;
+};
@@ -6,8 +6,20 @@
 //  Copyright © 2017 Rafael Sabino. All rights reserved.
 //
 
+#define __UTILITY_LOG_ASSET_STORE true
+
+#include <iostream>
+#if __UTILITY_LOG_ASSET_STORE
+#include <iomanip>
+#endif
+
 #include "Utility/AssetStore.h"
 
+#include <chrono>
+
+#include "Utility/AssetLoader.h"
+#include "Utility/ObjLoader.h"
+#include "Shape/Mesh.h"
 
 #if __APPLE__
 //TODO: there is already a Resource::resourceRoot with the same value
@@ -18,3 +30,134 @@ const std::string AssetStore::resourceRoot = "../Resources";
 const std::string AssetStore::resourceRoot = ".";
 
 #endif
+
+MeshAsset::~MeshAsset()
+{
+    for(Mesh* mesh : meshes)
+        delete mesh;
+}
+
+AssetStore& AssetStore::getInstance()
+{
+    static AssetStore store;
+    return store;
+}
+
+std::string AssetStore::canonicalPath(const std::string& path)
+{
+    //"Assets\\Models\\dragon.obj", "/Assets/Models/dragon.obj" and "/Assets/Models/../Models/dragon.obj" are one asset
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while(start <= path.size())
+    {
+        size_t end = path.find_first_of("/\\", start);
+        if(end == std::string::npos)
+            end = path.size();
+
+        std::string part = path.substr(start, end - start);
+        if(part == ".." && !parts.empty() && parts.back() != "..")
+            parts.pop_back();
+        else if(!part.empty() && part != ".")
+            parts.push_back(part);
+        start = end + 1;
+    }
+
+    std::string canonical;
+    for(const std::string& part : parts)
+        canonical += "/" + part;
+    return canonical;
+}
+
+MeshAssetSharedPtr AssetStore::loadMeshes(const std::string& path)
+{
+    bool created = false;
+    MeshAssetSharedPtr asset = acquire(path, created);
+    if(!created && !asset->ready)
+    {
+        AssetLoader::getInstance().finish();
+        //a load that failed or was dropped leaves nothing to reuse, it is loaded again below
+        if(!asset->ready)
+        {
+            evict(asset->path);
+            asset = acquire(path, created);
+        }
+    }
+    if(!created)
+    {
+#if __UTILITY_LOG_ASSET_STORE
+        std::cout << "Reusing resident '" << asset->path << "' (" << asset->meshes.size() << " meshes)." << std::endl;
+#endif
+        return asset;
+    }
+
+    ObjLoader::LoadedObj loaded;
+    if(!ObjLoader::loadObj(asset->path, loaded))
+    {
+        //not kept in the store, the next load of path tries again
+        std::cerr << "Failed to load '" << resourceRoot + asset->path << "', the shape stays empty." << std::endl;
+        evict(asset->path);
+        asset->path.clear();
+        asset->ready = true;
+        return asset;
+    }
+
+#if __UTILITY_LOG_ASSET_STORE
+    auto logTimestamp = std::chrono::steady_clock::now();
+#endif
+
+    if(loaded.stream)
+        ObjLoader::uploadStream(*loaded.stream, asset->meshes);
+    for(size_t i = 0; i < loaded.meshCount(); ++i)
+        asset->meshes.push_back(loaded.uploadMesh(i));
+    asset->ready = true;
+
+#if __UTILITY_LOG_ASSET_STORE
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - logTimestamp).count();
+    std::cout << std::setprecision(4) << " - Uploading '" << resourceRoot + asset->path << "' took " << seconds << " seconds." << std::endl;
+#endif
+    return asset;
+}
+
+MeshAssetSharedPtr AssetStore::find(const std::string& path) const
+{
+    auto found = assets.find(canonicalPath(path));
+    return found == assets.end() ? nullptr : found->second;
+}
+
+MeshAssetSharedPtr AssetStore::acquire(const std::string& path, bool& created)
+{
+    std::string key = canonicalPath(path);
+    MeshAssetSharedPtr& asset = assets[key];
+    created = !asset;
+    if(created)
+        asset = std::make_shared<MeshAsset>(key);
+    return asset;
+}
+
+size_t AssetStore::collect()
+{
+    size_t freed = 0;
+    for(auto it = assets.begin(); it != assets.end();)
+    {
+        if(it->second.use_count() == 1)
+        {
+            it = assets.erase(it);
+            ++freed;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return freed;
+}
+
+bool AssetStore::evict(const std::string& path)
+{
+    return assets.erase(canonicalPath(path)) > 0;
+}
+
+void AssetStore::clear()
+{
+    assets.clear();
+}
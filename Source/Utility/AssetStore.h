@@ -7,12 +7,85 @@
 //
 
 #pragma once
+
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+class Mesh;
+
+/// <summary>
+/// The uploaded meshes of one model, shared by every Shape that loads it. The meshes are freed with the last reference,
+/// per mesh settings such as enabled and name are shared as well.
+/// </summary>
+class MeshAsset
+{
+public:
+    std::string path; // canonical path, the key in AssetStore, empty for meshes that aren't cached
+    std::vector<Mesh*> meshes;
+
+    /// <summary> False while AssetLoader is still loading or uploading the meshes. </summary>
+    inline bool isReady() const { return ready; }
+
+    MeshAsset() {}
+    explicit MeshAsset(const std::string& _path) : path(_path) {}
+    ~MeshAsset();
+
+private:
+    MeshAsset(const MeshAsset&) = delete;
+    MeshAsset& operator=(const MeshAsset&) = delete;
+
+    bool ready = false;
+    friend class AssetStore;
+    friend class AssetLoader;
+    friend class Shape;
+};
+
+typedef std::shared_ptr<MeshAsset> MeshAssetSharedPtr;
+
+/// <summary>
+/// Cache of uploaded models keyed by canonical path, so a model used by several scenes or render targets is parsed
+/// and uploaded once. The store keeps a reference to every asset, collect() frees the ones no Shape uses anymore.
+/// Only used from the thread owning the GL context.
+/// </summary>
 class AssetStore {
-    
+public:
+    static AssetStore& getInstance();
+
+    /// <summary> Path relative to the resource root with '/' separators, a leading '/' and "." and ".." resolved. </summary>
+    static std::string canonicalPath(const std::string& path);
+
+    /// <summary> Returns the asset of path, loading and uploading it now unless it is resident. Waits for AssetLoader if it is loading it.
+    /// A model that fails to load comes back empty and isn't kept, so the next call tries again. </summary>
+    MeshAssetSharedPtr loadMeshes(const std::string& path);
+
+    /// <summary> Returns the asset of path, nullptr if it is neither resident nor loading. </summary>
+    MeshAssetSharedPtr find(const std::string& path) const;
+
+    /// <summary> Returns the asset of path, adding an empty one that isn't ready if there is none. created tells whether it needs to be loaded. </summary>
+    MeshAssetSharedPtr acquire(const std::string& path, bool& created);
+
+    /// <summary> Frees the assets only the store references and returns how many. Call after switching scenes, once the new one holds its assets. </summary>
+    size_t collect();
+
+    /// <summary> Forgets the asset of path so the next load parses it again, shapes holding it keep it. Returns whether there was one. </summary>
+    bool evict(const std::string& path);
+
+    /// <summary> Drops the references of the store, assets still used by shapes live until those are deleted. </summary>
+    void clear();
+
+    inline size_t residentAssets() const { return assets.size(); }
+
 protected:
     static const std::string resourceRoot;
-};
 
+    AssetStore() {}
 
+private:
+    AssetStore(const AssetStore&) = delete;
+    AssetStore& operator=(const AssetStore&) = delete;
 
+    std::unordered_map<std::string, MeshAssetSharedPtr> assets;
+};
@@ -0,0 +1,1008 @@
+#include "Utility/Bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Utility/JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BVH_SSE2 1
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BVH_NEON 1
+#include <arm_neon.h>
+#endif
+
+unsigned int Bvh::leafSize = 4;
+unsigned int Bvh::maxLeafSize = 16;
+unsigned int Bvh::threadCount = 0;
+
+namespace
+{
+    const unsigned int INVALID = Bvh::INVALID;
+    const int BIN_COUNT = 16;
+    const float TRAVERSAL_COST = 1.0f; // relative to one triangle test
+    //deeper binary nodes become leaves, which bounds the traversal stacks below
+    const unsigned int MAX_DEPTH = 64;
+    const unsigned int STACK_SIZE = 3 * MAX_DEPTH + 4;
+
+    // -------------------------------------
+    // Four floats at a time, the only SIMD the traversal needs.
+    // -------------------------------------
+
+#if BVH_SSE2
+    struct Float4 { __m128 v; };
+    inline Float4 load4(const float* p) { return { _mm_loadu_ps(p) }; }
+    inline Float4 splat4(float f) { return { _mm_set1_ps(f) }; }
+    inline void store4(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+    inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+    inline Float4 min4(Float4 a, Float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+    inline Float4 max4(Float4 a, Float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+    inline int lessEqual(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+#elif BVH_NEON
+    struct Float4 { float32x4_t v; };
+    inline Float4 load4(const float* p) { return { vld1q_f32(p) }; }
+    inline Float4 splat4(float f) { return { vdupq_n_f32(f) }; }
+    inline void store4(float* p, Float4 a) { vst1q_f32(p, a.v); }
+    inline Float4 operator+(Float4 a, Float4 b) { return { vaddq_f32(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) { return { vsubq_f32(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) { return { vmulq_f32(a.v, b.v) }; }
+    inline Float4 min4(Float4 a, Float4 b) { return { vminq_f32(a.v, b.v) }; }
+    inline Float4 max4(Float4 a, Float4 b) { return { vmaxq_f32(a.v, b.v) }; }
+    inline int lessEqual(Float4 a, Float4 b)
+    {
+        static const uint32_t bits[4] = { 1, 2, 4, 8 };
+        return static_cast<int>(vaddvq_u32(vandq_u32(vcleq_f32(a.v, b.v), vld1q_u32(bits))));
+    }
+#else
+    struct Float4 { float v[4]; };
+    inline Float4 load4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline Float4 splat4(float f) { return { { f, f, f, f } }; }
+    inline void store4(float* p, Float4 a) { for(int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline Float4 operator+(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    inline Float4 operator-(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    inline Float4 operator*(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    inline Float4 min4(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] = std::min(a.v[i], b.v[i]); return a; }
+    inline Float4 max4(Float4 a, Float4 b) { for(int i = 0; i < 4; ++i) a.v[i] = std::max(a.v[i], b.v[i]); return a; }
+    inline int lessEqual(Float4 a, Float4 b)
+    {
+        int mask = 0;
+        for(int i = 0; i < 4; ++i) mask |= (a.v[i] <= b.v[i] ? 1 : 0) << i;
+        return mask;
+    }
+#endif
+
+    inline int validChildren(const Bvh::Node& node)
+    {
+        return (node.children[0] != INVALID ? 1 : 0) | (node.children[1] != INVALID ? 2 : 0) |
+               (node.children[2] != INVALID ? 4 : 0) | (node.children[3] != INVALID ? 8 : 0);
+    }
+
+    // -------------------------------------
+    // Build
+    // -------------------------------------
+
+    struct Box
+    {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+        inline void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+        inline void grow(const Box& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+        inline float area() const
+        {
+            glm::vec3 size = max - min;
+            return size.x < 0.0f ? 0.0f : 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+    };
+
+    struct Reference
+    {
+        Box bounds;
+        glm::vec3 centroid;
+        unsigned int triangle;
+    };
+
+    //a Box grown four floats at a time from a Reference's vectors, the fourth lane reads the next member and is ignored
+    struct Box4
+    {
+        Float4 min = splat4(std::numeric_limits<float>::infinity());
+        Float4 max = splat4(-std::numeric_limits<float>::infinity());
+
+        inline void grow(const glm::vec3& point) { Float4 p = load4(&point.x); min = min4(min, p); max = max4(max, p); }
+        inline void grow(const Box& box) { min = min4(min, load4(&box.min.x)); max = max4(max, load4(&box.max.x)); }
+        inline void grow(const Box4& box) { min = min4(min, box.min); max = max4(max, box.max); }
+        inline Box box() const
+        {
+            float low[4], high[4];
+            store4(low, min);
+            store4(high, max);
+            Box box;
+            box.min = glm::vec3(low[0], low[1], low[2]);
+            box.max = glm::vec3(high[0], high[1], high[2]);
+            return box;
+        }
+        inline float area() const
+        {
+            float size[4];
+            store4(size, max - min);
+            return size[0] < 0.0f ? 0.0f : 2.0f * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+        }
+    };
+
+    struct BuildNode
+    {
+        Box bounds;
+        unsigned int left = INVALID;
+        unsigned int right = INVALID;
+        unsigned int first = 0;
+        unsigned int count = 0;
+        unsigned int job = INVALID; // subtree built separately, see Builder::jobs
+
+        inline bool isLeaf() const { return left == INVALID && job == INVALID; }
+    };
+
+    struct Job
+    {
+        unsigned int first;
+        unsigned int count;
+        unsigned int depth;
+    };
+
+    //binary binned SAH tree over references[first, first + count), partitioned in place so leaves are ranges of it
+    struct Builder
+    {
+        Reference* references = nullptr;
+        std::vector<BuildNode> nodes;
+        std::vector<Job>* jobs = nullptr; // ranges of at most jobSize are left to other builders when set
+        size_t jobSize = 0;
+
+        unsigned int build(unsigned int first, unsigned int count, unsigned int depth)
+        {
+            unsigned int index = static_cast<unsigned int>(nodes.size());
+            nodes.emplace_back();
+
+            Box4 boundsSum, centroidsSum;
+            for(unsigned int i = first; i < first + count; ++i)
+            {
+                const Reference& reference = references[i];
+                boundsSum.grow(reference.bounds);
+                centroidsSum.grow(reference.centroid);
+            }
+            Box bounds = boundsSum.box(), centroids = centroidsSum.box();
+            nodes[index].bounds = bounds;
+            nodes[index].first = first;
+            nodes[index].count = count;
+
+            if(jobs != nullptr && depth > 0 && count <= jobSize)
+            {
+                nodes[index].job = static_cast<unsigned int>(jobs->size());
+                jobs->push_back({ first, count, depth });
+                return index;
+            }
+
+            unsigned int middle = 0;
+            if(!split(first, count, depth, bounds, centroids, middle))
+                return index;
+
+            unsigned int left = build(first, middle - first, depth + 1);
+            unsigned int right = build(middle, first + count - middle, depth + 1);
+            nodes[index].left = left;
+            nodes[index].right = right;
+            return index;
+        }
+
+        //false if the range is better off as a leaf
+        bool split(unsigned int first, unsigned int count, unsigned int depth, const Box& bounds, const Box& centroids, unsigned int& middle)
+        {
+            if(count <= Bvh::leafSize || depth >= MAX_DEPTH)
+                return false;
+
+            struct Bin
+            {
+                Box4 bounds;
+                unsigned int count = 0;
+            };
+            Bin bins[3][BIN_COUNT];
+            glm::vec3 extent = centroids.max - centroids.min;
+            glm::vec3 scale;
+            for(int axis = 0; axis < 3; ++axis)
+                scale[axis] = extent[axis] > 0.0f ? BIN_COUNT * (1.0f - 1e-5f) / extent[axis] : 0.0f;
+
+            auto binOf = [&](const glm::vec3& centroid, int axis)
+            {
+                return std::min(BIN_COUNT - 1, static_cast<int>((centroid[axis] - centroids.min[axis]) * scale[axis]));
+            };
+
+            for(unsigned int i = first; i < first + count; ++i)
+            {
+                const Reference& reference = references[i];
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    Bin& bin = bins[axis][binOf(reference.centroid, axis)];
+                    bin.bounds.grow(reference.bounds);
+                    ++bin.count;
+                }
+            }
+
+            float bestCost = std::numeric_limits<float>::infinity();
+            int bestAxis = -1, bestBin = 0;
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                if(extent[axis] <= 0.0f)
+                    continue;
+
+                //right to left sums first, then sweep left to right
+                float rightArea[BIN_COUNT];
+                unsigned int rightCount[BIN_COUNT];
+                Box4 box;
+                unsigned int sum = 0;
+                for(int bin = BIN_COUNT - 1; bin > 0; --bin)
+                {
+                    box.grow(bins[axis][bin].bounds);
+                    sum += bins[axis][bin].count;
+                    rightArea[bin] = box.area();
+                    rightCount[bin] = sum;
+                }
+
+                box = Box4();
+                sum = 0;
+                for(int bin = 0; bin < BIN_COUNT - 1; ++bin)
+                {
+                    box.grow(bins[axis][bin].bounds);
+                    sum += bins[axis][bin].count;
+                    float cost = box.area() * sum + rightArea[bin + 1] * rightCount[bin + 1];
+                    if(sum > 0 && rightCount[bin + 1] > 0 && cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
+
+            if(bestAxis < 0)
+            {
+                //every centroid in one spot, only the leaf size limit forces a split
+                if(count <= Bvh::maxLeafSize)
+                    return false;
+                middle = first + count / 2;
+                return true;
+            }
+
+            float parentArea = bounds.area();
+            float splitCost = TRAVERSAL_COST + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+            if(splitCost >= float(count) && count <= Bvh::maxLeafSize)
+                return false;
+
+            Reference* split = std::partition(references + first, references + first + count, [&](const Reference& reference)
+            {
+                return binOf(reference.centroid, bestAxis) <= bestBin;
+            });
+            middle = static_cast<unsigned int>(split - references);
+            if(middle == first || middle == first + count)
+                middle = first + count / 2;
+            return true;
+        }
+    };
+
+    inline void transformTriangle(const Bvh::Geometry& geometry, size_t primitive, Bvh::Triangle& triangle)
+    {
+        const unsigned int* corners = geometry.indices + primitive * 3;
+        triangle.v0 = glm::vec3(geometry.transform * glm::vec4(geometry.positions[corners[0]], 1.0f));
+        triangle.v1 = glm::vec3(geometry.transform * glm::vec4(geometry.positions[corners[1]], 1.0f));
+        triangle.v2 = glm::vec3(geometry.transform * glm::vec4(geometry.positions[corners[2]], 1.0f));
+    }
+
+    void setChild(Bvh::Node& node, int slot, const Box& bounds, unsigned int child, unsigned int count)
+    {
+        node.minX[slot] = bounds.min.x;
+        node.minY[slot] = bounds.min.y;
+        node.minZ[slot] = bounds.min.z;
+        node.maxX[slot] = bounds.max.x;
+        node.maxY[slot] = bounds.max.y;
+        node.maxZ[slot] = bounds.max.z;
+        node.children[slot] = child;
+        node.counts[slot] = count;
+    }
+
+    Box childBounds(const Bvh::Node& node, int slot)
+    {
+        Box box;
+        box.min = glm::vec3(node.minX[slot], node.minY[slot], node.minZ[slot]);
+        box.max = glm::vec3(node.maxX[slot], node.maxY[slot], node.maxZ[slot]);
+        return box;
+    }
+
+    //turns the binary trees into 4-wide nodes by opening the largest inner child until there are four
+    struct Collapser
+    {
+        const std::vector<Builder>& trees; // trees[0] is the top, trees[job + 1] the subtree of job
+        std::vector<Bvh::Node>& nodes;
+        unsigned int depth = 0;
+
+        struct Ref
+        {
+            unsigned int tree;
+            unsigned int node;
+        };
+
+        inline const BuildNode& get(Ref& ref) const
+        {
+            //the top tree only has a placeholder where a subtree was built separately
+            while(trees[ref.tree].nodes[ref.node].job != INVALID)
+            {
+                ref.tree = trees[ref.tree].nodes[ref.node].job + 1;
+                ref.node = 0;
+            }
+            return trees[ref.tree].nodes[ref.node];
+        }
+
+        unsigned int collapse(Ref ref, unsigned int level)
+        {
+            depth = std::max(depth, level + 1);
+            const BuildNode& root = get(ref);
+
+            Ref slots[4];
+            int slotCount = 0;
+            if(root.isLeaf())
+            {
+                slots[slotCount++] = ref;
+            }
+            else
+            {
+                slots[slotCount++] = { ref.tree, root.left };
+                slots[slotCount++] = { ref.tree, root.right };
+                while(slotCount < 4)
+                {
+                    int largest = -1;
+                    float largestArea = -1.0f;
+                    for(int i = 0; i < slotCount; ++i)
+                    {
+                        const BuildNode& child = get(slots[i]);
+                        if(!child.isLeaf() && child.bounds.area() > largestArea)
+                        {
+                            largest = i;
+                            largestArea = child.bounds.area();
+                        }
+                    }
+                    if(largest < 0)
+                        break;
+
+                    const BuildNode& opened = get(slots[largest]);
+                    Ref tree = slots[largest];
+                    slots[largest] = { tree.tree, opened.left };
+                    slots[slotCount++] = { tree.tree, opened.right };
+                }
+            }
+
+            unsigned int index = static_cast<unsigned int>(nodes.size());
+            nodes.emplace_back();
+            for(int i = 0; i < 4; ++i)
+            {
+                setChild(nodes[index], i, Box(), INVALID, 0);
+            }
+
+            for(int i = 0; i < slotCount; ++i)
+            {
+                const BuildNode& child = get(slots[i]);
+                if(child.isLeaf())
+                {
+                    setChild(nodes[index], i, child.bounds, child.first, child.count);
+                }
+                else
+                {
+                    Box bounds = child.bounds;
+                    unsigned int childIndex = collapse(slots[i], level + 1);
+                    setChild(nodes[index], i, bounds, childIndex, 0);
+                }
+            }
+            return index;
+        }
+    };
+
+    // -------------------------------------
+    // Queries
+    // -------------------------------------
+
+    struct Ray
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        Float4 originX, originY, originZ;
+        Float4 inverseX, inverseY, inverseZ;
+
+        Ray(const glm::vec3& _origin, const glm::vec3& _direction)
+        :origin(_origin), direction(_direction)
+        {
+            //a tiny component instead of zero keeps inf * 0 out of the slab test
+            glm::vec3 inverse;
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                float d = direction[axis];
+                inverse[axis] = 1.0f / (std::fabs(d) > 1e-30f ? d : (d < 0.0f ? -1e-30f : 1e-30f));
+            }
+            originX = splat4(origin.x);
+            originY = splat4(origin.y);
+            originZ = splat4(origin.z);
+            inverseX = splat4(inverse.x);
+            inverseY = splat4(inverse.y);
+            inverseZ = splat4(inverse.z);
+        }
+    };
+
+    //slab test of the four children, returns a bit per child hit within maxDistance and where each is entered
+    inline int intersectChildren(const Bvh::Node& node, const Ray& ray, float maxDistance, float entry[4])
+    {
+        Float4 t0x = (load4(node.minX) - ray.originX) * ray.inverseX;
+        Float4 t1x = (load4(node.maxX) - ray.originX) * ray.inverseX;
+        Float4 t0y = (load4(node.minY) - ray.originY) * ray.inverseY;
+        Float4 t1y = (load4(node.maxY) - ray.originY) * ray.inverseY;
+        Float4 t0z = (load4(node.minZ) - ray.originZ) * ray.inverseZ;
+        Float4 t1z = (load4(node.maxZ) - ray.originZ) * ray.inverseZ;
+        Float4 enter = max4(max4(min4(t0x, t1x), min4(t0y, t1y)), max4(min4(t0z, t1z), splat4(0.0f)));
+        Float4 leave = min4(min4(max4(t0x, t1x), max4(t0y, t1y)), min4(max4(t0z, t1z), splat4(maxDistance)));
+        store4(entry, enter);
+        return lessEqual(enter, leave) & validChildren(node);
+    }
+
+    //Moller-Trumbore, both sides
+    inline bool intersectTriangle(const Bvh::Triangle& triangle, const Ray& ray, float maxDistance, float& distance, float& u, float& v)
+    {
+        glm::vec3 edge1 = triangle.v1 - triangle.v0;
+        glm::vec3 edge2 = triangle.v2 - triangle.v0;
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if(std::fabs(determinant) < 1e-12f)
+            return false;
+
+        float inverse = 1.0f / determinant;
+        glm::vec3 s = ray.origin - triangle.v0;
+        u = glm::dot(s, p) * inverse;
+        if(u < 0.0f || u > 1.0f)
+            return false;
+
+        glm::vec3 q = glm::cross(s, edge1);
+        v = glm::dot(ray.direction, q) * inverse;
+        if(v < 0.0f || u + v > 1.0f)
+            return false;
+
+        distance = glm::dot(edge2, q) * inverse;
+        return distance >= 0.0f && distance <= maxDistance;
+    }
+
+    inline int overlapChildren(const Bvh::Node& node, Float4 boxMinX, Float4 boxMinY, Float4 boxMinZ, Float4 boxMaxX, Float4 boxMaxY, Float4 boxMaxZ)
+    {
+        return lessEqual(load4(node.minX), boxMaxX) & lessEqual(load4(node.minY), boxMaxY) & lessEqual(load4(node.minZ), boxMaxZ) &
+               lessEqual(boxMinX, load4(node.maxX)) & lessEqual(boxMinY, load4(node.maxY)) & lessEqual(boxMinZ, load4(node.maxZ)) &
+               validChildren(node);
+    }
+
+    //separating axis test of Akenine-Moller: the box axes, the triangle's normal and the nine edge cross products
+    bool triangleOverlapsBox(const Bvh::Triangle& triangle, const glm::vec3& center, const glm::vec3& halfSize)
+    {
+        glm::vec3 v[3] = { triangle.v0 - center, triangle.v1 - center, triangle.v2 - center };
+        glm::vec3 edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+
+        for(int e = 0; e < 3; ++e)
+        {
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                //edge x unit axis
+                glm::vec3 unit(0.0f);
+                unit[axis] = 1.0f;
+                glm::vec3 direction = glm::cross(edges[e], unit);
+                float p0 = glm::dot(v[0], direction), p1 = glm::dot(v[1], direction), p2 = glm::dot(v[2], direction);
+                float radius = glm::dot(halfSize, glm::abs(direction));
+                if(std::min(p0, std::min(p1, p2)) > radius || std::max(p0, std::max(p1, p2)) < -radius)
+                    return false;
+            }
+        }
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            if(std::min(v[0][axis], std::min(v[1][axis], v[2][axis])) > halfSize[axis] ||
+               std::max(v[0][axis], std::max(v[1][axis], v[2][axis])) < -halfSize[axis])
+                return false;
+        }
+
+        glm::vec3 normal = glm::cross(edges[0], edges[1]);
+        float distance = glm::dot(normal, v[0]);
+        return std::fabs(distance) <= glm::dot(halfSize, glm::abs(normal));
+    }
+
+    //Ericson, Real-Time Collision Detection 5.1.5, with the barycentric weights of v1 and v2
+    glm::vec3 closestOnTriangle(const Bvh::Triangle& triangle, const glm::vec3& p, glm::vec2& barycentric)
+    {
+        const glm::vec3& a = triangle.v0;
+        const glm::vec3& b = triangle.v1;
+        const glm::vec3& c = triangle.v2;
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if(d1 <= 0.0f && d2 <= 0.0f)
+        {
+            barycentric = glm::vec2(0.0f, 0.0f);
+            return a;
+        }
+
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if(d3 >= 0.0f && d4 <= d3)
+        {
+            barycentric = glm::vec2(1.0f, 0.0f);
+            return b;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+        if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            float v = d1 / (d1 - d3);
+            barycentric = glm::vec2(v, 0.0f);
+            return a + v * ab;
+        }
+
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if(d6 >= 0.0f && d5 <= d6)
+        {
+            barycentric = glm::vec2(0.0f, 1.0f);
+            return c;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+        if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            float w = d2 / (d2 - d6);
+            barycentric = glm::vec2(0.0f, w);
+            return a + w * ac;
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if(va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        {
+            float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            barycentric = glm::vec2(1.0f - w, w);
+            return b + w * (c - b);
+        }
+
+        float denominator = 1.0f / (va + vb + vc);
+        float v = vb * denominator;
+        float w = vc * denominator;
+        barycentric = glm::vec2(v, w);
+        return a + ab * v + ac * w;
+    }
+
+    struct StackEntry
+    {
+        unsigned int child; // node index or first triangle
+        unsigned int count; // triangles, 0 for a node
+        float distance;     // where the ray enters its box, or the squared distance to it
+    };
+
+    //pushes the children in mask farthest first, so the nearest is visited next
+    inline void pushSorted(const Bvh::Node& node, int mask, const float distances[4], StackEntry* stack, unsigned int& size)
+    {
+        StackEntry entries[4];
+        int count = 0;
+        for(int i = 0; i < 4; ++i)
+        {
+            if(mask & (1 << i))
+            {
+                StackEntry entry = { node.children[i], node.counts[i], distances[i] };
+                int j = count++;
+                for(; j > 0 && entries[j - 1].distance < entry.distance; --j)
+                    entries[j] = entries[j - 1];
+                entries[j] = entry;
+            }
+        }
+        for(int i = 0; i < count; ++i)
+            stack[size++] = entries[i];
+    }
+}
+
+void Bvh::clear()
+{
+    geometry.clear();
+    moved.clear();
+    triangles.clear();
+    nodes.clear();
+    boundsMin = boundsMax = glm::vec3(0.0f);
+    stats = Stats();
+}
+
+void Bvh::build(const std::vector<Geometry>& _geometry)
+{
+    auto start = std::chrono::steady_clock::now();
+    clear();
+    geometry = _geometry;
+    moved.assign(geometry.size(), 0);
+
+    std::vector<size_t> firstTriangle(geometry.size() + 1, 0);
+    for(size_t i = 0; i < geometry.size(); ++i)
+    {
+        firstTriangle[i + 1] = firstTriangle[i] + geometry[i].indexCount / 3;
+    }
+    size_t triangleCount = firstTriangle.back();
+    if(triangleCount == 0)
+        return;
+
+    //world space triangles in input order with their bounds
+    std::vector<Triangle> source(triangleCount);
+    std::vector<Reference> references(triangleCount);
+    JobSystem::getInstance().parallelFor(triangleCount, 1 << 14, [&](size_t begin, size_t end)
+    {
+        size_t g = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), begin) - firstTriangle.begin() - 1;
+        for(size_t i = begin; i < end; ++i)
+        {
+            while(i >= firstTriangle[g + 1])
+                ++g;
+
+            Triangle& triangle = source[i];
+            transformTriangle(geometry[g], i - firstTriangle[g], triangle);
+            triangle.geometry = static_cast<unsigned int>(g);
+            triangle.primitive = static_cast<unsigned int>(i - firstTriangle[g]);
+
+            Reference& reference = references[i];
+            reference.bounds = Box();
+            reference.bounds.grow(triangle.v0);
+            reference.bounds.grow(triangle.v1);
+            reference.bounds.grow(triangle.v2);
+            reference.centroid = (reference.bounds.min + reference.bounds.max) * 0.5f;
+            reference.triangle = static_cast<unsigned int>(i);
+        }
+    });
+
+    //the top levels on this thread, down to ranges small enough to spread the rest over the workers
+    JobSystem& jobSystem = JobSystem::getInstance();
+    unsigned int threads = threadCount != 0 ? threadCount : jobSystem.size();
+    std::vector<Job> jobs;
+    std::vector<Builder> trees(1);
+    trees[0].references = references.data();
+    if(threads > 1)
+    {
+        trees[0].jobs = &jobs;
+        trees[0].jobSize = std::max<size_t>(1024, triangleCount / (threads * 8));
+    }
+    trees[0].build(0, static_cast<unsigned int>(triangleCount), 0);
+
+    trees.resize(jobs.size() + 1);
+    std::vector<size_t> jobOrder(jobs.size());
+    for(size_t i = 0; i < jobOrder.size(); ++i)
+    {
+        jobOrder[i] = i;
+    }
+    std::sort(jobOrder.begin(), jobOrder.end(), [&jobs](size_t a, size_t b) { return jobs[a].count > jobs[b].count; });
+
+    //a JobSystem job per subtree, queued largest first: the workers steal the oldest, so the big ones start first
+    JobSystem::Counter subtreesBuilt;
+    for(size_t index : jobOrder)
+    {
+        jobSystem.run([&jobs, &trees, &references, index]()
+        {
+            const Job& job = jobs[index];
+            Builder& tree = trees[index + 1];
+            tree.references = references.data();
+            tree.nodes.reserve(job.count / Bvh::leafSize * 2);
+            tree.build(job.first, job.count, job.depth);
+        }, &subtreesBuilt);
+    }
+    jobSystem.wait(subtreesBuilt);
+
+    Collapser collapser = { trees, nodes };
+    nodes.reserve(triangleCount / 4);
+    collapser.collapse({ 0, 0 }, 0);
+    nodes.shrink_to_fit();
+
+    triangles.resize(triangleCount);
+    JobSystem::getInstance().parallelFor(triangleCount, 1 << 16, [&](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            triangles[i] = source[references[i].triangle];
+        }
+    });
+    updateBounds();
+
+    stats.triangles = triangleCount;
+    stats.nodes = nodes.size();
+    stats.depth = collapser.depth;
+    stats.sahCost = sahCost();
+    for(const Node& node : nodes)
+    {
+        for(int i = 0; i < 4; ++i)
+        {
+            stats.leaves += node.isLeaf(i) ? 1 : 0;
+        }
+    }
+    stats.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+float Bvh::sahCost() const
+{
+    if(nodes.empty())
+        return 0.0f;
+
+    //every node is entered with the probability of its box being hit, relative to the root's
+    float rootArea = std::max(Box{ boundsMin, boundsMax }.area(), 1e-30f);
+    float cost = TRAVERSAL_COST;
+    for(const Node& node : nodes)
+    {
+        for(int i = 0; i < 4; ++i)
+        {
+            if(node.isEmpty(i))
+                continue;
+            float probability = childBounds(node, i).area() / rootArea;
+            cost += probability * (node.isLeaf(i) ? float(node.counts[i]) : TRAVERSAL_COST);
+        }
+    }
+    return cost;
+}
+
+void Bvh::setTransform(size_t index, const glm::mat4& transform)
+{
+    if(geometry[index].transform != transform)
+    {
+        geometry[index].transform = transform;
+        moved[index] = 1;
+    }
+}
+
+void Bvh::refit()
+{
+    if(std::find(moved.begin(), moved.end(), 1) == moved.end())
+        return;
+
+    JobSystem::getInstance().parallelFor(triangles.size(), 1 << 15, [this](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            Triangle& triangle = triangles[i];
+            if(moved[triangle.geometry])
+                transformTriangle(geometry[triangle.geometry], triangle.primitive, triangle);
+        }
+    });
+
+    //children come after their parents, so walking backwards sees every child refit before its parent
+    for(size_t n = nodes.size(); n-- > 0;)
+    {
+        Node& node = nodes[n];
+        for(int i = 0; i < 4; ++i)
+        {
+            if(node.isEmpty(i))
+                continue;
+
+            Box bounds;
+            if(node.isLeaf(i))
+            {
+                for(unsigned int t = node.children[i]; t < node.children[i] + node.counts[i]; ++t)
+                {
+                    bounds.grow(triangles[t].v0);
+                    bounds.grow(triangles[t].v1);
+                    bounds.grow(triangles[t].v2);
+                }
+            }
+            else
+            {
+                const Node& child = nodes[node.children[i]];
+                for(int j = 0; j < 4; ++j)
+                {
+                    if(!child.isEmpty(j))
+                        bounds.grow(childBounds(child, j));
+                }
+            }
+            setChild(node, i, bounds, node.children[i], node.counts[i]);
+        }
+    }
+
+    std::fill(moved.begin(), moved.end(), 0);
+    updateBounds();
+}
+
+void Bvh::updateBounds()
+{
+    Box bounds;
+    if(!nodes.empty())
+    {
+        for(int i = 0; i < 4; ++i)
+        {
+            if(!nodes[0].isEmpty(i))
+                bounds.grow(childBounds(nodes[0], i));
+        }
+    }
+    boundsMin = nodes.empty() ? glm::vec3(0.0f) : bounds.min;
+    boundsMax = nodes.empty() ? glm::vec3(0.0f) : bounds.max;
+}
+
+bool Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, Hit& hit, float maxDistance) const
+{
+    if(nodes.empty())
+        return false;
+
+    Ray ray(origin, direction);
+    float closest = maxDistance;
+    unsigned int closestTriangle = INVALID;
+    glm::vec2 closestBarycentric(0.0f);
+
+    StackEntry stack[STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = { 0, 0, 0.0f };
+    float entry[4];
+    while(size > 0)
+    {
+        const StackEntry current = stack[--size];
+        if(current.distance > closest)
+            continue;
+
+        if(current.count != 0)
+        {
+            for(unsigned int t = current.child; t < current.child + current.count; ++t)
+            {
+                float distance, u, v;
+                if(intersectTriangle(triangles[t], ray, closest, distance, u, v))
+                {
+                    closest = distance;
+                    closestTriangle = t;
+                    closestBarycentric = glm::vec2(u, v);
+                }
+            }
+            continue;
+        }
+
+        const Node& node = nodes[current.child];
+        int mask = intersectChildren(node, ray, closest, entry);
+        pushSorted(node, mask, entry, stack, size);
+    }
+
+    if(closestTriangle == INVALID)
+        return false;
+
+    hit.distance = closest;
+    hit.point = origin + direction * closest;
+    hit.barycentric = closestBarycentric;
+    hit.triangle = closestTriangle;
+    hit.geometry = triangles[closestTriangle].geometry;
+    hit.primitive = triangles[closestTriangle].primitive;
+    return true;
+}
+
+bool Bvh::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+    if(nodes.empty())
+        return false;
+
+    Ray ray(origin, direction);
+    unsigned int stack[STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = 0;
+    float entry[4];
+    while(size > 0)
+    {
+        const Node& node = nodes[stack[--size]];
+        int mask = intersectChildren(node, ray, maxDistance, entry);
+        for(int i = 0; i < 4; ++i)
+        {
+            if(!(mask & (1 << i)))
+                continue;
+
+            if(!node.isLeaf(i))
+            {
+                stack[size++] = node.children[i];
+                continue;
+            }
+
+            for(unsigned int t = node.children[i]; t < node.children[i] + node.counts[i]; ++t)
+            {
+                float distance, u, v;
+                if(intersectTriangle(triangles[t], ray, maxDistance, distance, u, v))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t Bvh::overlapBox(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<unsigned int>& result) const
+{
+    if(nodes.empty())
+        return 0;
+
+    size_t before = result.size();
+    glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    glm::vec3 halfSize = (boxMax - boxMin) * 0.5f;
+    Float4 minX = splat4(boxMin.x), minY = splat4(boxMin.y), minZ = splat4(boxMin.z);
+    Float4 maxX = splat4(boxMax.x), maxY = splat4(boxMax.y), maxZ = splat4(boxMax.z);
+
+    unsigned int stack[STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = 0;
+    while(size > 0)
+    {
+        const Node& node = nodes[stack[--size]];
+        int mask = overlapChildren(node, minX, minY, minZ, maxX, maxY, maxZ);
+        for(int i = 0; i < 4; ++i)
+        {
+            if(!(mask & (1 << i)))
+                continue;
+
+            if(!node.isLeaf(i))
+            {
+                stack[size++] = node.children[i];
+                continue;
+            }
+
+            for(unsigned int t = node.children[i]; t < node.children[i] + node.counts[i]; ++t)
+            {
+                if(triangleOverlapsBox(triangles[t], center, halfSize))
+                    result.push_back(t);
+            }
+        }
+    }
+    return result.size() - before;
+}
+
+bool Bvh::closestPoint(const glm::vec3& point, Hit& hit, float maxDistance) const
+{
+    if(nodes.empty())
+        return false;
+
+    Float4 x = splat4(point.x), y = splat4(point.y), z = splat4(point.z);
+    Float4 zero = splat4(0.0f);
+    float closest = maxDistance < std::numeric_limits<float>::infinity() ? maxDistance * maxDistance : maxDistance;
+    unsigned int closestTriangle = INVALID;
+    glm::vec3 closestPoint(0.0f);
+    glm::vec2 closestBarycentric(0.0f);
+
+    StackEntry stack[STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = { 0, 0, 0.0f };
+    float distances[4];
+    while(size > 0)
+    {
+        const StackEntry current = stack[--size];
+        if(current.distance > closest)
+            continue;
+
+        if(current.count != 0)
+        {
+            for(unsigned int t = current.child; t < current.child + current.count; ++t)
+            {
+                glm::vec2 barycentric;
+                glm::vec3 candidate = closestOnTriangle(triangles[t], point, barycentric);
+                glm::vec3 offset = candidate - point;
+                float distance = glm::dot(offset, offset);
+                if(distance <= closest)
+                {
+                    closest = distance;
+                    closestTriangle = t;
+                    closestPoint = candidate;
+                    closestBarycentric = barycentric;
+                }
+            }
+            continue;
+        }
+
+        //squared distance from the point to each child box, 0 inside
+        const Node& node = nodes[current.child];
+        Float4 dx = max4(max4(load4(node.minX) - x, x - load4(node.maxX)), zero);
+        Float4 dy = max4(max4(load4(node.minY) - y, y - load4(node.maxY)), zero);
+        Float4 dz = max4(max4(load4(node.minZ) - z, z - load4(node.maxZ)), zero);
+        Float4 squared = dx * dx + dy * dy + dz * dz;
+        store4(distances, squared);
+        int mask = lessEqual(squared, splat4(closest)) & validChildren(node);
+        pushSorted(node, mask, distances, stack, size);
+    }
+
+    if(closestTriangle == INVALID)
+        return false;
+
+    hit.distance = std::sqrt(closest);
+    hit.point = closestPoint;
+    hit.barycentric = closestBarycentric;
+    hit.triangle = closestTriangle;
+    hit.geometry = triangles[closestTriangle].geometry;
+    hit.primitive = triangles[closestTriangle].primitive;
+    return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/// <summary>
+/// Bounding volume hierarchy over world space triangles for ray, box overlap and closest point queries on the CPU,
+/// e.g. picking, CPU voxelization or offline baking. Built top down with binned SAH, the subtrees in parallel, then
+/// collapsed into 4-wide nodes whose boxes are tested four at a time with SSE or NEON (scalar elsewhere).
+/// Triangles are copied in, so the tree only needs the source geometry again to refit after a transform changed.
+/// </summary>
+class Bvh
+{
+public:
+    static const unsigned int INVALID = 0xFFFFFFFFu;
+
+    /// <summary> Object space triangles and their transform. The arrays must outlive the tree if it is refit. </summary>
+    struct Geometry
+    {
+        const glm::vec3* positions = nullptr;
+        size_t vertexCount = 0;
+        const unsigned int* indices = nullptr; // three per triangle
+        size_t indexCount = 0;
+        glm::mat4 transform = glm::mat4(1.0f);
+    };
+
+    struct Triangle
+    {
+        glm::vec3 v0, v1, v2; // world space
+        unsigned int geometry;
+        unsigned int primitive; // triangle index within its geometry
+    };
+
+    /// <summary> 4 child boxes stored as structure of arrays. A child is a node, a leaf of counts[i] triangles or empty. </summary>
+    struct Node
+    {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        unsigned int children[4]; // node index, first triangle of a leaf or INVALID
+        unsigned int counts[4];   // triangles in a leaf, 0 for nodes
+
+        inline bool isLeaf(int i) const { return counts[i] != 0; }
+        inline bool isEmpty(int i) const { return children[i] == INVALID; }
+    };
+
+    struct Hit
+    {
+        float distance = std::numeric_limits<float>::infinity(); // along the ray or from the query point
+        glm::vec3 point = glm::vec3(0.0f);
+        glm::vec2 barycentric = glm::vec2(0.0f); // weights of the triangle's v1 and v2 at point
+        unsigned int triangle = INVALID; // index into getTriangles()
+        unsigned int geometry = INVALID;
+        unsigned int primitive = INVALID;
+
+        inline bool valid() const { return triangle != INVALID; }
+    };
+
+    struct Stats
+    {
+        size_t triangles = 0;
+        size_t nodes = 0;
+        size_t leaves = 0;
+        unsigned int depth = 0;
+        float sahCost = 0.0f; // expected cost of a random ray, in triangle tests
+        double buildSeconds = 0.0;
+    };
+
+    /// <summary> Replaces the tree with one over every triangle of geometry. </summary>
+    void build(const std::vector<Geometry>& geometry);
+    void clear();
+
+    /// <summary> Moves a geometry's triangles to transform, call refit() once every moved geometry is set. </summary>
+    void setTransform(size_t geometry, const glm::mat4& transform);
+
+    /// <summary>
+    /// Recomputes the moved triangles and every box bottom up, keeping the tree's topology. Much faster than build
+    /// but the tree gets worse the more the geometry moved relative to each other, rebuild after large changes.
+    /// </summary>
+    void refit();
+
+    /// <summary> Closest triangle hit by the ray within maxDistance, both sides of triangles count. direction needn't be normalized, distances are then in its units. </summary>
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, Hit& hit, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /// <summary> True if anything lies on the ray within maxDistance, stops at the first hit. </summary>
+    bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /// <summary> Appends the triangles intersecting the box (exact test, not only their bounds). Returns the number appended. </summary>
+    size_t overlapBox(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<unsigned int>& triangles) const;
+
+    /// <summary> Closest point on any triangle no farther than maxDistance from point. </summary>
+    bool closestPoint(const glm::vec3& point, Hit& hit, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /// <summary> Expected cost of a random ray through the tree in triangle tests, stats.sahCost after the build. </summary>
+    float sahCost() const;
+
+    inline const std::vector<Triangle>& getTriangles() const { return triangles; }
+    inline const std::vector<Node>& getNodes() const { return nodes; }
+    inline const std::vector<Geometry>& getGeometry() const { return geometry; }
+    inline const Stats& getStats() const { return stats; }
+    inline bool empty() const { return triangles.empty(); }
+    inline const glm::vec3& getBoundsMin() const { return boundsMin; }
+    inline const glm::vec3& getBoundsMax() const { return boundsMax; }
+
+    /// <summary> Triangles per leaf the build aims for and the most it allows. </summary>
+    static unsigned int leafSize;
+    static unsigned int maxLeafSize;
+
+    /// <summary> Threads the subtrees of a build are sized for, built as JobSystem jobs, 0 means one per thread of the JobSystem. </summary>
+    static unsigned int threadCount;
+
+private:
+    void updateBounds();
+
+    std::vector<Geometry> geometry;
+    std::vector<unsigned char> moved; // per geometry, set by setTransform until the next refit
+    std::vector<Triangle> triangles;  // in leaf order
+    std::vector<Node> nodes;          // parents before their children, nodes[0] is the root
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    Stats stats;
+};
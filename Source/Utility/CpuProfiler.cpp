@@ -0,0 +1,184 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+size_t CpuProfiler::bufferEvents = size_t(1) << 16;
+
+CpuProfiler::Scope::Scope(const char* _name) : name(_name)
+{
+    CpuProfiler& profiler = CpuProfiler::getInstance();
+    start = profiler.isCapturing() ? profiler.now() : -1;
+}
+
+CpuProfiler::Scope::~Scope()
+{
+    if(start < 0)
+        return;
+
+    CpuProfiler& profiler = CpuProfiler::getInstance();
+    profiler.record(name, start, profiler.now());
+}
+
+CpuProfiler& CpuProfiler::getInstance()
+{
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+long long CpuProfiler::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+CpuProfiler::ThreadBuffer& CpuProfiler::threadBuffer()
+{
+    //the buffers live as long as the profiler, so the trace keeps the events of threads that already ended
+    thread_local ThreadBuffer* buffer = nullptr;
+    if(buffer == nullptr)
+    {
+        std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+        created->events.resize(std::max<size_t>(bufferEvents, 1));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        created->id = unsigned(buffers.size());
+        created->captureStart = 0;
+        buffer = created.get();
+        buffers.push_back(std::move(created));
+    }
+    return *buffer;
+}
+
+void CpuProfiler::record(const char* name, long long start, long long end)
+{
+    //a scope begun during the capture may end after it; writing is raised before capturing is checked, and endCapture drops
+    //capturing before waiting for writing, so either this sees the capture stopped or endCapture waits for the event
+    ThreadBuffer& buffer = threadBuffer();
+    buffer.writing.store(true);
+    if(capturing.load())
+    {
+        size_t index = buffer.written.load(std::memory_order_relaxed);
+        buffer.events[index % buffer.events.size()] = { name, start, end };
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+    buffer.writing.store(false, std::memory_order_release);
+}
+
+size_t CpuProfiler::captureBegin(const ThreadBuffer& buffer, size_t end)
+{
+    //a buffer outgrown by the capture only has its latest events
+    size_t oldest = end > buffer.events.size() ? end - buffer.events.size() : 0;
+    return std::max(buffer.captureStart, oldest);
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.name = name;
+}
+
+void CpuProfiler::beginCapture()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(capturing.load(std::memory_order_relaxed))
+        return;
+
+    for(std::unique_ptr<ThreadBuffer>& buffer : buffers)
+        buffer->captureStart = buffer->written.load(std::memory_order_acquire);
+    //orders the reads of the last endCapture before the writes of this capture
+    capturing.store(true);
+}
+
+bool CpuProfiler::endCapture(const std::string& path, std::vector<ScopeTotal>* totals)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!capturing.load(std::memory_order_relaxed))
+        return false;
+    capturing.store(false);
+    framesToCapture = 0;
+
+    //no thread writes into its buffer from here on, until the next beginCapture which waits for the lock
+    for(std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        while(buffer->writing.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    if(totals)
+    {
+        totals->clear();
+        for(std::unique_ptr<ThreadBuffer>& buffer : buffers)
+        {
+            size_t end = buffer->written.load(std::memory_order_acquire);
+            for(size_t i = captureBegin(*buffer, end); i < end; ++i)
+            {
+                const Event& event = buffer->events[i % buffer->events.size()];
+                auto total = std::find_if(totals->begin(), totals->end(), [&event](const ScopeTotal& t) { return strcmp(t.name, event.name) == 0; });
+                if(total == totals->end())
+                {
+                    totals->emplace_back();
+                    total = totals->end() - 1;
+                    total->name = event.name;
+                }
+                ++total->calls;
+                total->milliseconds += double(event.end - event.start) / 1000000.0;
+            }
+        }
+    }
+
+    if(path.empty())
+        return true;
+    std::ofstream file(path);
+    if(!file)
+        return false;
+
+    //complete events ("X") with microsecond times, names are literals in the code and need no escaping
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for(std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        if(buffer->name)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                 << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            first = false;
+        }
+
+        size_t end = buffer->written.load(std::memory_order_acquire);
+        for(size_t i = captureBegin(*buffer, end); i < end; ++i)
+        {
+            const Event& event = buffer->events[i % buffer->events.size()];
+            file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                 << ",\"ts\":" << double(event.start) / 1000.0 << ",\"dur\":" << double(event.end - event.start) / 1000.0 << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    return bool(file);
+}
+
+void CpuProfiler::captureFrames(unsigned int frames, const std::string& path)
+{
+    beginCapture();
+    std::lock_guard<std::mutex> lock(mutex);
+    framesToCapture = std::max(frames, 1u);
+    framesPath = path;
+}
+
+void CpuProfiler::frameEnded()
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(framesToCapture == 0 || --framesToCapture != 0)
+            return;
+        path = framesPath;
+    }
+
+    bool written = endCapture(path);
+    std::cout << (written ? "CPU trace written to " : "Failed writing the CPU trace to ") << path << std::endl;
+}
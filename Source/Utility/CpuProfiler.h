@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define CPU_PROFILING 1 /* 0 compiles every PROFILE_SCOPE out. */
+
+#if CPU_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+/// <summary> Profiles the rest of the enclosing block under name, a string literal. </summary>
+#define PROFILE_SCOPE(name) CpuProfiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+/// <summary>
+/// Hierarchical CPU profiler writing Chrome trace event JSON, which Perfetto and chrome://tracing open. Scopes are
+/// recorded only during a capture, each thread into its own ring buffer without locks: the thread owning it is the only
+/// writer and publishes an event by bumping an atomic counter. The buffers are only read once the capture stopped and no
+/// thread is still writing an event. Nesting follows from the begin and end times of the scopes.
+/// </summary>
+class CpuProfiler
+{
+public:
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        long long start; // nanoseconds since the profiler started, -1 while not capturing
+    };
+
+    /// <summary> Time spent in the scopes of one name during a capture, over all threads. </summary>
+    struct ScopeTotal
+    {
+        const char* name = nullptr;
+        size_t calls = 0;
+        double milliseconds = 0.0;
+    };
+
+    static CpuProfiler& getInstance();
+
+    /// <summary> Events each thread keeps, older ones are overwritten once a capture outgrows it. Read when a thread records its first event. </summary>
+    static size_t bufferEvents;
+
+    /// <summary> Shows the calling thread as name in the trace, name must be a literal or otherwise outlive the profiler. </summary>
+    void setThreadName(const char* name);
+
+    /// <summary> Starts recording the scopes of every thread. </summary>
+    void beginCapture();
+
+    /// <summary>
+    /// Stops recording and writes the events since beginCapture to path, unless it is empty. totals, if given, receives
+    /// the time per scope name. False if there was no capture or path can't be written.
+    /// </summary>
+    bool endCapture(const std::string& path, std::vector<ScopeTotal>* totals = nullptr);
+
+    /// <summary> Captures the next frames frames, counted by frameEnded, then writes them to path. </summary>
+    void captureFrames(unsigned int frames, const std::string& path);
+
+    /// <summary> Called by the main loop after each frame. </summary>
+    void frameEnded();
+
+    inline bool isCapturing() const { return capturing.load(std::memory_order_relaxed); }
+
+private:
+    struct Event
+    {
+        const char* name;
+        long long start;
+        long long end;
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+        std::atomic<size_t> written{ 0 }; // events ever recorded, the ring slot of the next is written % events.size()
+        std::atomic<bool> writing{ false }; // set by the owner around an event, endCapture waits for it to drop
+        size_t captureStart = 0; // written when the capture began
+        const char* name = nullptr;
+        unsigned int id = 0;
+    };
+
+    CpuProfiler() {}
+    CpuProfiler(const CpuProfiler&) = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+    ThreadBuffer& threadBuffer();
+    void record(const char* name, long long start, long long end);
+    long long now() const;
+    static size_t captureBegin(const ThreadBuffer& buffer, size_t end); // first event of the capture still in the buffer
+
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::atomic<bool> capturing{ false };
+
+    std::mutex mutex; // the list of buffers and the capture settings, a thread takes it once to add its buffer
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    unsigned int framesToCapture = 0;
+    std::string framesPath;
+};
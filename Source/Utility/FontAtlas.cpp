@@ -0,0 +1,139 @@
+#include "Utility/FontAtlas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+const char* const FontAtlas::DEFAULT_PATH = "/Assets/Fonts/overlay.fontatlas";
+
+namespace
+{
+    const char MAGIC[8] = { 'V', 'C', 'T', 'F', 'O', 'N', 'T', '\0' };
+    const uint32_t VERSION = 1;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t pixelSize;
+        uint32_t spread;
+        uint32_t glyphCount;
+    };
+
+    static_assert(sizeof(FontAtlas::Glyph) == 16, "Glyph is stored as is");
+}
+
+bool FontAtlas::open(const std::string& path)
+{
+    close();
+    if(!file.open(path) || file.size() < sizeof(FileHeader))
+    {
+        close();
+        return false;
+    }
+
+    FileHeader header;
+    memcpy(&header, file.begin(), sizeof(header));
+    uint64_t pixelsOffset = sizeof(FileHeader) + GLYPHS * sizeof(Glyph);
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       header.version != VERSION ||
+       header.glyphCount != GLYPHS ||
+       header.width == 0 || header.height == 0 ||
+       file.size() != pixelsOffset + static_cast<uint64_t>(header.width) * header.height)
+    {
+        close();
+        return false;
+    }
+
+    width = header.width;
+    height = header.height;
+    pixelSize = header.pixelSize;
+    spread = header.spread;
+    memcpy(glyphs, file.begin() + sizeof(FileHeader), sizeof(glyphs));
+    pixels = reinterpret_cast<const unsigned char*>(file.begin() + pixelsOffset);
+    return true;
+}
+
+void FontAtlas::assign(unsigned int _width, unsigned int _height, unsigned int _pixelSize, unsigned int _spread, const Glyph (&_glyphs)[GLYPHS],
+                       std::vector<unsigned char>&& _pixels)
+{
+    close();
+    width = _width;
+    height = _height;
+    pixelSize = _pixelSize;
+    spread = _spread;
+    std::copy(_glyphs, _glyphs + GLYPHS, glyphs);
+    baked = std::move(_pixels);
+    pixels = baked.data();
+}
+
+bool FontAtlas::write(const std::string& path, std::string& err) const
+{
+    if(!isLoaded())
+    {
+        err += "No atlas to write\n";
+        return false;
+    }
+
+    //the directory may not be there yet, e.g. the first bake into the resources
+    size_t separator = path.find_last_of('/');
+    if(separator != std::string::npos && separator != 0)
+        mkdir(path.substr(0, separator).c_str(), 0755);
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    header.pixelSize = pixelSize;
+    header.spread = spread;
+    header.glyphCount = GLYPHS;
+
+    //written into a temporary file and moved into place so a half written atlas is never opened
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!stream.is_open())
+        {
+            err += "Cannot write [" + temporaryPath + "]\n";
+            return false;
+        }
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(glyphs), sizeof(glyphs));
+        stream.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(width) * height);
+        if(!stream.good())
+        {
+            stream.close();
+            std::remove(temporaryPath.c_str());
+            err += "Failed writing [" + temporaryPath + "]\n";
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    if(std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporaryPath.c_str());
+        err += "Cannot move atlas into place [" + path + "]\n";
+        return false;
+    }
+    return true;
+}
+
+void FontAtlas::close()
+{
+    file.close();
+    std::vector<unsigned char>().swap(baked);
+    pixels = nullptr;
+    width = height = pixelSize = spread = 0;
+    for(Glyph& glyph : glyphs)
+        glyph = Glyph();
+}
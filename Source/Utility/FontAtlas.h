@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Utility/MappedFile.h"
+
+/// <summary>
+/// Signed distance field atlas of the ASCII glyphs of a font and their metrics, in one small binary file so text is set
+/// up with a single texture upload and no FreeType in the app. Baked from the font by font-atlas-baker, the app only opens
+/// the atlas committed at DEFAULT_PATH. A texel holds 0.5 on the glyph's outline, rising to 1 spread pixels inside of it
+/// and falling to 0 spread pixels outside, so the glyphs stay sharp at any scale when thresholded at 0.5.
+/// </summary>
+class FontAtlas
+{
+public:
+    /// <summary> Metrics in pixels of the size baked at, a quad covers the glyph and spread pixels around it. </summary>
+    struct Glyph
+    {
+        uint16_t x = 0, y = 0; // top left of the quad in the atlas
+        uint16_t width = 0, height = 0; // 0 for glyphs without an outline, e.g. the space
+        int16_t left = 0; // from the pen to the quad's left edge
+        int16_t top = 0; // from the baseline up to the quad's top edge
+        uint16_t advance = 0; // in 1/64 pixels, like FreeType
+        uint16_t reserved = 0;
+    };
+
+    static const unsigned int GLYPHS = 128;
+
+    /// <summary> Atlas TextQuad loads, under the resource root. </summary>
+    static const char* const DEFAULT_PATH;
+
+    /// <summary> Maps the atlas at path. Returns false if there is none or it was written by another version. </summary>
+    bool open(const std::string& path);
+
+    /// <summary> Takes over an atlas baked by font-atlas-baker, pixels holds width * height bytes, the first row the top. </summary>
+    void assign(unsigned int width, unsigned int height, unsigned int pixelSize, unsigned int spread, const Glyph (&glyphs)[GLYPHS],
+                std::vector<unsigned char>&& pixels);
+
+    /// <summary> Writes the atlas opened or assigned, into a temporary file moved into place once complete. </summary>
+    bool write(const std::string& path, std::string& err) const;
+
+    void close();
+
+    inline bool isLoaded() const { return pixels != nullptr; }
+    inline unsigned int getWidth() const { return width; }
+    inline unsigned int getHeight() const { return height; }
+    inline unsigned int getPixelSize() const { return pixelSize; }
+    inline unsigned int getSpread() const { return spread; }
+    inline const Glyph& getGlyph(unsigned int character) const { return glyphs[character < GLYPHS ? character : '?']; }
+
+    /// <summary> getWidth() * getHeight() bytes, the first row is the atlas' top. </summary>
+    inline const unsigned char* getPixels() const { return pixels; }
+
+private:
+    MappedFile file;
+    std::vector<unsigned char> baked;
+    const unsigned char* pixels = nullptr; // into file or baked, the assigned pixels
+
+    unsigned int width = 0, height = 0;
+    unsigned int pixelSize = 0;
+    unsigned int spread = 0;
+    Glyph glyphs[GLYPHS];
+};
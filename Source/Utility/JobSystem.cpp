@@ -0,0 +1,350 @@
+#include "Utility/JobSystem.h"
+#include "Utility/CpuProfiler.h"
+
+unsigned int JobSystem::threadCount = 0;
+thread_local JobSystem::FrameLoop* JobSystem::threadLoop = nullptr;
+
+//slots every queue starts with, a power of two
+static const size_t INITIAL_QUEUE_JOBS = 256;
+
+namespace
+{
+    //queue of the calling thread, workers set theirs when they start
+    thread_local unsigned int threadQueue = 0;
+
+    //Background scopes alive on the calling thread, and background jobs it is running
+    thread_local unsigned int backgroundDepth = 0;
+}
+
+JobSystem::Background::Background()
+{
+    ++backgroundDepth;
+}
+
+JobSystem::Background::~Background()
+{
+    --backgroundDepth;
+}
+
+double JobSystem::Stats::workerUtilization() const
+{
+    if(threads.size() < 2 || frameSeconds <= 0.0)
+        return 0.0;
+    double busy = 0.0;
+    for(size_t i = 1; i < threads.size(); ++i)
+        busy += threads[i].busySeconds;
+    return std::min(1.0, busy / (frameSeconds * double(threads.size() - 1)));
+}
+
+size_t JobSystem::Stats::jobs() const
+{
+    size_t jobs = 0;
+    for(const ThreadStats& thread : threads)
+        jobs += thread.jobs;
+    return jobs;
+}
+
+size_t JobSystem::Stats::steals() const
+{
+    size_t steals = 0;
+    for(const ThreadStats& thread : threads)
+        steals += thread.steals;
+    return steals;
+}
+
+JobSystem& JobSystem::getInstance()
+{
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+void JobSystem::start()
+{
+    std::call_once(started, [this]()
+    {
+        unsigned int count = threadCount;
+        if(count == 0)
+        {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            count = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        for(unsigned int i = 0; i <= count; ++i)
+        {
+            queues.emplace_back(new Queue());
+            queues.back()->jobs.resize(INITIAL_QUEUE_JOBS);
+        }
+        backgroundQueue.jobs.resize(INITIAL_QUEUE_JOBS);
+        for(unsigned int i = 1; i <= count; ++i)
+            workers.emplace_back(&JobSystem::work, this, i);
+    });
+}
+
+unsigned int JobSystem::size()
+{
+    start();
+    return static_cast<unsigned int>(queues.size());
+}
+
+void JobSystem::run(std::function<void()> job, Counter* counter)
+{
+    start();
+    bool background = backgroundDepth != 0;
+    FrameLoop* loop = background ? nullptr : threadLoop;
+    if(counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    if(loop)
+        loop->frame.pending.fetch_add(1, std::memory_order_relaxed);
+    push({ std::move(job), counter, background, loop });
+}
+
+void JobSystem::run(std::function<void()> job, Counter* counter, Counter& dependency)
+{
+    start();
+    bool background = backgroundDepth != 0;
+    FrameLoop* loop = background ? nullptr : threadLoop;
+    if(counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    if(loop)
+        loop->frame.pending.fetch_add(1, std::memory_order_relaxed);
+
+    //finish() drops the count and takes the dependents under the same lock, so none is left behind
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if(!dependency.done())
+        {
+            dependency.dependents.push_back([this, job, counter, background, loop]() { push({ job, counter, background, loop }); });
+            return;
+        }
+    }
+    push({ std::move(job), counter, background, loop });
+}
+
+void JobSystem::wait(Counter& counter)
+{
+    while(!counter.done())
+    {
+        if(!runOne())
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::beginFrame()
+{
+    start();
+    if(!threadLoop)
+    {
+        std::lock_guard<std::mutex> lock(loopsMutex);
+        loops.emplace_back(new FrameLoop());
+        loops.back()->threads.reset(new LoopThread[queues.size()]);
+        threadLoop = loops.back().get();
+    }
+
+    //the jobs of the last frame of this loop are done, the other loops keep their stats
+    FrameLoop& loop = *threadLoop;
+    for(size_t i = 0; i < queues.size(); ++i)
+    {
+        loop.threads[i].busyNanoseconds = 0;
+        loop.threads[i].jobCount = 0;
+        loop.threads[i].steals = 0;
+    }
+    loop.frameStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::endFrame()
+{
+    start();
+    if(!threadLoop)
+        return;
+    FrameLoop& loop = *threadLoop;
+    wait(loop.frame);
+
+    Stats& stats = loop.stats;
+    stats.frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loop.frameStart).count();
+    stats.threads.resize(queues.size());
+    for(size_t i = 0; i < queues.size(); ++i)
+    {
+        stats.threads[i].busySeconds = double(loop.threads[i].busyNanoseconds.load()) * 1e-9;
+        stats.threads[i].jobs = loop.threads[i].jobCount.load();
+        stats.threads[i].steals = loop.threads[i].steals.load();
+    }
+}
+
+const JobSystem::Stats& JobSystem::getStats() const
+{
+    static const Stats none;
+    return threadLoop ? threadLoop->stats : none;
+}
+
+void JobSystem::push(Job job)
+{
+    Queue& queue = job.background ? backgroundQueue : *queues[threadQueue < queues.size() ? threadQueue : 0];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack(std::move(job));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    //taking the lock orders the push before a worker's last look at queued, no wake up is lost
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    jobQueued.notify_one();
+}
+
+bool JobSystem::pop(unsigned int index, Job& job)
+{
+    Queue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.count == 0)
+        return false;
+    queue.popBack(job);
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::steal(unsigned int index, Job& job)
+{
+    //the oldest job of a victim is likely the largest piece of work left there
+    for(size_t i = 1; i < queues.size(); ++i)
+    {
+        Queue& victim = *queues[(index + i) % queues.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if(!lock.owns_lock() || victim.count == 0)
+            continue;
+        victim.popFront(job);
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::popBackground(Job& job)
+{
+    //oldest first, the loads share the workers in the order they asked
+    std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+    if(backgroundQueue.count == 0)
+        return false;
+    backgroundQueue.popFront(job);
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void JobSystem::Queue::pushBack(Job&& job)
+{
+    if(count == jobs.size())
+    {
+        std::vector<Job> grown(std::max<size_t>(jobs.size() * 2, 1));
+        for(size_t i = 0; i < count; ++i)
+            grown[i] = std::move(jobs[(first + i) & (jobs.size() - 1)]);
+        jobs.swap(grown);
+        first = 0;
+    }
+    jobs[(first + count++) & (jobs.size() - 1)] = std::move(job);
+}
+
+void JobSystem::Queue::popBack(Job& job)
+{
+    //moved out and cleared, the slot doesn't keep the closure's captures alive
+    Job& slot = jobs[(first + --count) & (jobs.size() - 1)];
+    job = std::move(slot);
+    slot = Job();
+}
+
+void JobSystem::Queue::popFront(Job& job)
+{
+    Job& slot = jobs[first];
+    job = std::move(slot);
+    slot = Job();
+    first = (first + 1) & (jobs.size() - 1);
+    --count;
+}
+
+bool JobSystem::runOne()
+{
+    unsigned int index = threadQueue < queues.size() ? threadQueue : 0;
+    Job job;
+    bool worker = index != 0;
+    bool stolen = false;
+    if(!worker && backgroundDepth != 0)
+    {
+        //a thread outside the frame loop only helps with background work, it would hold up the frame otherwise
+        if(!popBackground(job))
+            return false;
+    }
+    else if(!pop(index, job) && !(stolen = steal(index, job)) && !(worker && popBackground(job)))
+        return false;
+    execute(index, job, stolen);
+    return true;
+}
+
+void JobSystem::execute(unsigned int index, Job& job, bool stolen)
+{
+    auto start = std::chrono::steady_clock::now();
+    //jobs queued by this one belong to its loop, whichever thread runs it
+    FrameLoop* callerLoop = threadLoop;
+    threadLoop = job.loop;
+    if(job.background)
+        ++backgroundDepth;
+    job.function();
+    if(job.background)
+        --backgroundDepth;
+    threadLoop = callerLoop;
+    long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    //background jobs and jobs of threads without a loop aren't part of any frame
+    if(job.loop)
+    {
+        LoopThread& thread = job.loop->threads[index];
+        thread.busyNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        thread.jobCount.fetch_add(1, std::memory_order_relaxed);
+        if(stolen)
+            thread.steals.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(job.counter)
+        finish(*job.counter);
+    if(job.loop)
+        finish(job.loop->frame);
+}
+
+void JobSystem::finish(Counter& counter)
+{
+    //the count drops under the lock, so a waiter destroying the counter once it is done waits for the unlock in ~Counter
+    std::vector<std::function<void()>> dependents;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex);
+        if(counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        dependents.swap(counter.dependents);
+    }
+    for(std::function<void()>& dependent : dependents)
+        dependent();
+}
+
+void JobSystem::work(unsigned int index)
+{
+    CpuProfiler::getInstance().setThreadName("Job worker");
+    threadQueue = index;
+    while(true)
+    {
+        if(runOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        jobQueued.wait(lock, [this]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if(stopping)
+            return;
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    jobQueued.notify_all();
+    for(std::thread& worker : workers)
+        worker.join();
+}
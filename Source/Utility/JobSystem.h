@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Work stealing job system for the CPU work of a frame. Every worker and the main thread own a deque, a thread pushes
+/// and pops the back of its own and steals from the front of the others' once it runs dry. Waiting on a Counter runs
+/// jobs instead of blocking, so a job may wait for the jobs it spawned. Jobs must not touch the GL context.
+/// Each thread calling beginFrame runs a frame loop of its own, e.g. the simulation and the render thread: a job belongs
+/// to the loop of the thread that queued it, or of the job that queued it, and each loop waits for and reports only its jobs.
+/// Long running work such as model loads stays on AssetLoader's ThreadPool, jobs here are expected to finish within the frame,
+/// except background jobs: the parallel parts of a load run here too, outside of the frames, see Background.
+/// </summary>
+class JobSystem
+{
+public:
+    /// <summary> Jobs run with it that haven't finished. Jobs depending on it are queued once it reaches zero. </summary>
+    class Counter
+    {
+    public:
+        Counter() {}
+        ~Counter() { std::lock_guard<std::mutex> lock(mutex); } // the job finishing it may still hold the lock
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        inline bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> pending{ 0 };
+        std::mutex mutex;
+        std::vector<std::function<void()>> dependents; // run(job, counter, dependency) calls waiting for this one
+    };
+
+    /// <summary>
+    /// While one is alive, the jobs the calling thread runs are background work: they aren't part of the frame, the threads
+    /// drawing or simulating it never run them and the workers only take them when no frame job is left. Jobs they run are
+    /// background work too. For the work of a thread outside the frame loop, e.g. a model load on AssetLoader's ThreadPool.
+    /// </summary>
+    class Background
+    {
+    public:
+        Background();
+        ~Background();
+        Background(const Background&) = delete;
+        Background& operator=(const Background&) = delete;
+    };
+
+    struct ThreadStats
+    {
+        double busySeconds = 0.0;
+        size_t jobs = 0;
+        size_t steals = 0; // jobs taken from another thread's deque
+    };
+
+    /// <summary> Work of one frame loop between its last beginFrame and endFrame, the threads that aren't workers first, then the workers. </summary>
+    struct Stats
+    {
+        double frameSeconds = 0.0;
+        std::vector<ThreadStats> threads;
+
+        /// <summary> Fraction of the frame the workers spent running jobs, 0 to 1. </summary>
+        double workerUtilization() const;
+        size_t jobs() const;
+        size_t steals() const;
+    };
+
+    static JobSystem& getInstance();
+
+    /// <summary> Worker threads besides the main thread, 0 means one less than the hardware threads. Read when the first job is run. </summary>
+    static unsigned int threadCount;
+
+    /// <summary> Queues job on the calling thread's deque. counter, if given, counts it until it finished. </summary>
+    void run(std::function<void()> job, Counter* counter = nullptr);
+
+    /// <summary> Queues job once dependency is done. counter counts it from now on, so waiting on it covers the dependency too. </summary>
+    void run(std::function<void()> job, Counter* counter, Counter& dependency);
+
+    /// <summary> Runs queued jobs until counter is done. </summary>
+    void wait(Counter& counter);
+
+    /// <summary>
+    /// Calls function(begin, end) over [0, count) in ranges of at least grain items spread over the threads, and returns once all ran.
+    /// Runs inline when count fits in one grain. May be called from a job.
+    /// </summary>
+    template<typename FUNCTION>
+    void parallelFor(size_t count, size_t grain, FUNCTION function);
+
+    /// <summary> Starts a frame of the calling thread's loop, the stats of its next endFrame cover the jobs it queues from here on. </summary>
+    void beginFrame();
+
+    /// <summary> Waits for every job the calling thread's loop queued since beginFrame, then fills getStats(). Dependencies don't outlive the frame. </summary>
+    void endFrame();
+
+    /// <summary> Stats of the calling thread's last frame, empty on a thread that never called beginFrame. </summary>
+    const Stats& getStats() const;
+
+    /// <summary> Threads running jobs, the workers and the main thread. </summary>
+    unsigned int size();
+
+    ~JobSystem();
+
+private:
+    //what a thread's work adds to the frame of one loop, indexed like queues
+    struct LoopThread
+    {
+        std::atomic<long long> busyNanoseconds{ 0 };
+        std::atomic<size_t> jobCount{ 0 };
+        std::atomic<size_t> steals{ 0 };
+    };
+
+    //the frames of the thread that called beginFrame, and of the jobs queued from them
+    struct FrameLoop
+    {
+        Counter frame; // every job of the frame
+        std::unique_ptr<LoopThread[]> threads;
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        Stats stats;
+    };
+
+    struct Job
+    {
+        std::function<void()> function;
+        Counter* counter = nullptr;
+        bool background = false; // not part of any frame, see Background
+        FrameLoop* loop = nullptr; // counts the job in its frame, none for background jobs and threads without a loop
+    };
+
+    //a ring over jobs, doubled when full and never shrunk, so once a frame's jobs fit queuing them doesn't allocate
+    struct Queue
+    {
+        std::mutex mutex;
+        std::vector<Job> jobs; // a power of two slots
+        size_t first = 0; // the oldest job
+        size_t count = 0;
+
+        void pushBack(Job&& job);
+        void popBack(Job& job);
+        void popFront(Job& job);
+    };
+
+    JobSystem() {}
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void start();
+    void push(Job job);
+    bool pop(unsigned int index, Job& job);
+    bool steal(unsigned int index, Job& job);
+    bool popBackground(Job& job);
+    void execute(unsigned int index, Job& job, bool stolen);
+    void finish(Counter& counter);
+    bool runOne();
+    void work(unsigned int index);
+
+    std::once_flag started;
+    std::vector<std::unique_ptr<Queue>> queues; // 0 belongs to the main thread and any thread that isn't a worker
+    Queue backgroundQueue; // background jobs of every thread
+    std::vector<std::thread> workers;
+    std::atomic<int> queued{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable jobQueued;
+    bool stopping = false;
+
+    //loop of the calling thread, set by its first beginFrame and while it runs a job of another loop
+    static thread_local FrameLoop* threadLoop;
+    std::mutex loopsMutex;
+    std::vector<std::unique_ptr<FrameLoop>> loops; // kept until shutdown, a loop's jobs may outlive its thread
+};
+
+template<typename FUNCTION>
+void JobSystem::parallelFor(size_t count, size_t grain, FUNCTION function)
+{
+    grain = std::max<size_t>(grain, 1);
+    if(count <= grain || size() == 1)
+    {
+        if(count != 0)
+            function(size_t(0), count);
+        return;
+    }
+
+    //a few ranges per thread leave room to balance uneven ones by stealing
+    size_t ranges = std::min<size_t>((count + grain - 1) / grain, size_t(size()) * 4);
+    size_t rangeSize = (count + ranges - 1) / ranges;
+
+    //the jobs capture two words, few enough for std::function to keep them without allocating
+    struct Shared
+    {
+        FUNCTION* function;
+        size_t rangeSize;
+        size_t count;
+    };
+    Shared shared = { &function, rangeSize, count };
+    const Shared* state = &shared;
+
+    Counter counter;
+    for(size_t begin = rangeSize; begin < count; begin += rangeSize)
+        run([state, begin]() { (*state->function)(begin, std::min(begin + state->rangeSize, state->count)); }, &counter);
+    function(size_t(0), std::min(rangeSize, count));
+    wait(counter);
+}
@@ -0,0 +1,132 @@
+#include "Utility/MappedFile.h"
+
+#include <fstream>
+#include <utility>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+    open(path);
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if(this != &other)
+    {
+        close();
+        std::swap(data, other.data);
+        std::swap(length, other.length);
+        std::swap(opened, other.opened);
+        std::swap(heapAllocated, other.heapAllocated);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    opened = true;
+    if(length != 0)
+    {
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED)
+        {
+            ::close(fd);
+            length = 0;
+            opened = false;
+            return false;
+        }
+        //the parsers walk the file front to back
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+    }
+    //the mapping keeps its own reference to the file
+    ::close(fd);
+    return true;
+#else
+    std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!stream.is_open())
+        return false;
+
+    length = static_cast<size_t>(stream.tellg());
+    opened = true;
+    if(length != 0)
+    {
+        char* buffer = new char[length];
+        stream.seekg(0);
+        stream.read(buffer, length);
+        data = buffer;
+        heapAllocated = true;
+    }
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+    if(data != nullptr)
+    {
+        if(heapAllocated)
+        {
+            delete [] data;
+        }
+#ifndef _WIN32
+        else
+        {
+            munmap(const_cast<char*>(data), length);
+        }
+#endif
+    }
+    data = nullptr;
+    length = 0;
+    opened = false;
+    heapAllocated = false;
+}
+
+void MappedFile::release(const char* begin, const char* end) const
+{
+#ifndef _WIN32
+    if(data == nullptr || heapAllocated)
+        return;
+
+    //only whole pages, the ones at the edges may still be in use by a neighbouring reader
+    static const uintptr_t PAGE_SIZE = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uintptr_t last = reinterpret_cast<uintptr_t>(end) & ~(PAGE_SIZE - 1);
+    if(first < last)
+    {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/// <summary> Read-only view of a whole file mapped into memory. Falls back to reading the file into a heap buffer where mmap is not available. </summary>
+class MappedFile
+{
+public:
+    MappedFile() {}
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// <summary> Maps the file at path, releasing whatever was mapped before. Returns false if the file can't be opened. </summary>
+    bool open(const std::string& path);
+    void close();
+
+    inline bool isOpen() const { return data != nullptr || (opened && length == 0); }
+    inline const char* begin() const { return data; }
+    inline const char* end() const { return data + length; }
+    inline size_t size() const { return length; }
+
+    /// <summary> Tells the OS the pages fully inside [begin, end) are not needed anymore. They are read again if touched. </summary>
+    void release(const char* begin, const char* end) const;
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    bool heapAllocated = false;
+};
@@ -0,0 +1,386 @@
+#include "Utility/MeshCache.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <climits>
+#include <limits>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+
+#include "Shape/VertexEncoder.h"
+
+const char* const MeshCache::FILE_EXTENSION = ".meshcache";
+
+namespace
+{
+    const char MAGIC[8] = { 'V', 'C', 'T', 'M', 'E', 'S', 'H', '\0' };
+    const uint32_t VERSION = 6;
+    const uint64_t DATA_ALIGNMENT = 16;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t vertexFormat;
+        uint32_t meshCount;
+        uint32_t sourcePathLength;
+        uint32_t reserved;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t sourceHash;
+        uint64_t fileSize;
+    };
+
+    struct MeshRecord
+    {
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t lodOffset;
+        uint64_t meshletOffset;
+        uint32_t vertexCount;
+        uint32_t indexCount; // all levels of detail
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    static_assert(sizeof(MeshLod) == 16, "MeshLod is stored as is");
+    static_assert(sizeof(Meshlet) == 40, "Meshlet is stored as is");
+
+    inline uint64_t align(uint64_t offset)
+    {
+        return (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+    }
+
+    //absolute with links resolved, two sources of the same name in different folders never share a key
+    std::string canonicalPath(const std::string& path)
+    {
+        char resolved[PATH_MAX];
+        if(realpath(path.c_str(), resolved) != nullptr)
+            return resolved;
+
+        //a cache shipped without its source, the folder is resolved and the name kept
+        size_t separator = path.find_last_of("/\\");
+        std::string folder = separator == std::string::npos ? "." : path.substr(0, separator);
+        std::string name = separator == std::string::npos ? path : path.substr(separator + 1);
+        if(realpath(folder.c_str(), resolved) != nullptr)
+            return std::string(resolved) + "/" + name;
+        return path;
+    }
+
+    inline bool inside(uint64_t offset, uint64_t size, uint64_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+}
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath)
+{
+    return sourcePath + FILE_EXTENSION;
+}
+
+uint64_t MeshCache::hashFile(const std::string& sourcePath)
+{
+    MappedFile source;
+    if(!source.open(sourcePath))
+        return 0;
+
+    //FNV-1a, a word at a time
+    const uint64_t PRIME = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const char* data = source.begin();
+    size_t size = source.size();
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * PRIME;
+    }
+    for(; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * PRIME;
+    }
+    return hash;
+}
+
+bool MeshCache::readSourceKey(const std::string& sourcePath, SourceKey& key, bool withHash)
+{
+    struct stat info;
+    if(stat(sourcePath.c_str(), &info) != 0)
+        return false;
+
+    key.size = static_cast<uint64_t>(info.st_size);
+    key.modified = static_cast<int64_t>(info.st_mtime);
+    key.hash = withHash ? hashFile(sourcePath) : 0;
+    return true;
+}
+
+bool MeshCache::write(const std::string& sourcePath, const std::vector<MeshData>& meshData, const VertexFormat& format, std::string& err)
+{
+    SourceKey key;
+    if(!readSourceKey(sourcePath, key, true))
+    {
+        err += "Cannot read [" + sourcePath + "]\n";
+        return false;
+    }
+
+    // -------------------------------------
+    // Lay out header, mesh table, names and then the 16 byte aligned vertex, index, level of detail and meshlet blocks.
+    // -------------------------------------
+    const uint64_t vertexStride = format.stride();
+    std::string sourceKey = canonicalPath(sourcePath);
+    std::vector<MeshRecord> records(meshData.size());
+    uint64_t stringsOffset = sizeof(FileHeader) + records.size() * sizeof(MeshRecord);
+    std::string strings = sourceKey;
+
+    for(size_t i = 0; i < meshData.size(); ++i)
+    {
+        records[i].nameOffset = static_cast<uint32_t>(stringsOffset + strings.size());
+        records[i].nameLength = static_cast<uint32_t>(meshData[i].name.size());
+        strings += meshData[i].name;
+    }
+
+    uint64_t offset = align(stringsOffset + strings.size());
+    for(size_t i = 0; i < meshData.size(); ++i)
+    {
+        const MeshData& mesh = meshData[i];
+        MeshRecord& record = records[i];
+
+        record.vertexCount = static_cast<uint32_t>(mesh.vertexData.size());
+        record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        record.vertexOffset = offset;
+        offset = align(offset + record.vertexCount * vertexStride);
+        record.indexOffset = offset;
+        offset = align(offset + record.indexCount * static_cast<uint64_t>(sizeof(unsigned int)));
+        record.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        record.lodOffset = offset;
+        offset = align(offset + record.lodCount * static_cast<uint64_t>(sizeof(MeshLod)));
+        record.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+        record.meshletOffset = offset;
+        offset = align(offset + record.meshletCount * static_cast<uint64_t>(sizeof(Meshlet)));
+
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+        for(const VertexData& vertex : mesh.vertexData)
+        {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+        if(mesh.vertexData.empty())
+        {
+            boundsMin = boundsMax = glm::vec3(0.0f);
+        }
+        memcpy(record.boundsMin, &boundsMin[0], sizeof(record.boundsMin));
+        memcpy(record.boundsMax, &boundsMax[0], sizeof(record.boundsMax));
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertexStride = static_cast<uint32_t>(vertexStride);
+    header.vertexFormat = format.code();
+    header.meshCount = static_cast<uint32_t>(meshData.size());
+    header.sourcePathLength = static_cast<uint32_t>(sourceKey.size());
+    header.sourceSize = key.size;
+    header.sourceModified = key.modified;
+    header.sourceHash = key.hash;
+    header.fileSize = offset;
+
+    // -------------------------------------
+    // Write into a temporary file and move it into place so a half written cache is never mapped.
+    // -------------------------------------
+    std::string cachePath = cachePathFor(sourcePath);
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!stream.is_open())
+        {
+            err += "Cannot write [" + temporaryPath + "]\n";
+            return false;
+        }
+
+        static const char PADDING[DATA_ALIGNMENT] = {};
+        auto pad = [&stream]()
+        {
+            uint64_t position = static_cast<uint64_t>(stream.tellp());
+            stream.write(PADDING, static_cast<std::streamsize>(align(position) - position));
+        };
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if(!records.empty())
+            stream.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshRecord));
+        stream.write(strings.data(), strings.size());
+        pad();
+
+        std::vector<unsigned char> packed;
+        for(const MeshData& mesh : meshData)
+        {
+            VertexEncoder::encode(mesh.vertexData.data(), mesh.vertexData.size(), format, packed);
+            if(!packed.empty())
+                stream.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+            pad();
+            if(!mesh.indices.empty())
+                stream.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+            pad();
+            if(!mesh.lods.empty())
+                stream.write(reinterpret_cast<const char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+            pad();
+            if(!mesh.meshlets.empty())
+                stream.write(reinterpret_cast<const char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+            pad();
+        }
+
+        if(!stream.good())
+        {
+            stream.close();
+            std::remove(temporaryPath.c_str());
+            err += "Failed writing [" + temporaryPath + "]\n";
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if(std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+    {
+        std::remove(temporaryPath.c_str());
+        err += "Cannot move cache into place [" + cachePath + "]\n";
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::open(const std::string& sourcePath, const VertexFormat& format)
+{
+    close();
+
+    std::string cachePath = cachePathFor(sourcePath);
+    if(!file.open(cachePath) || file.size() < sizeof(FileHeader))
+    {
+        close();
+        return false;
+    }
+
+    FileHeader header;
+    memcpy(&header, file.begin(), sizeof(header));
+    uint64_t fileSize = file.size();
+    uint64_t recordsSize = static_cast<uint64_t>(header.meshCount) * sizeof(MeshRecord);
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       header.version != VERSION ||
+       header.vertexFormat != format.code() ||
+       header.vertexStride != format.stride() ||
+       header.fileSize != fileSize ||
+       !inside(sizeof(FileHeader), recordsSize + header.sourcePathLength, fileSize))
+    {
+        close();
+        return false;
+    }
+
+    std::string sourceKey(file.begin() + sizeof(FileHeader) + recordsSize, header.sourcePathLength);
+    if(sourceKey != canonicalPath(sourcePath))
+    {
+        close();
+        return false;
+    }
+
+    //without the source next to it the cache is trusted as is, models can ship as caches only
+    SourceKey key;
+    if(readSourceKey(sourcePath, key, false))
+    {
+        if(key.size != header.sourceSize)
+        {
+            close();
+            return false;
+        }
+
+        if(key.modified != header.sourceModified)
+        {
+            if(hashFile(sourcePath) != header.sourceHash)
+            {
+                close();
+                return false;
+            }
+
+            //same content, only touched; remember the new time stamp so the next launch skips hashing
+            std::fstream stream(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+            if(stream.is_open())
+            {
+                stream.seekp(offsetof(FileHeader, sourceModified));
+                stream.write(reinterpret_cast<const char*>(&key.modified), sizeof(key.modified));
+            }
+        }
+    }
+
+    meshes.resize(header.meshCount);
+    for(uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        MeshRecord record;
+        memcpy(&record, file.begin() + sizeof(FileHeader) + i * sizeof(MeshRecord), sizeof(record));
+
+        if(!inside(record.nameOffset, record.nameLength, fileSize) ||
+           !inside(record.vertexOffset, record.vertexCount * static_cast<uint64_t>(header.vertexStride), fileSize) ||
+           !inside(record.indexOffset, record.indexCount * static_cast<uint64_t>(sizeof(unsigned int)), fileSize) ||
+           !inside(record.lodOffset, record.lodCount * static_cast<uint64_t>(sizeof(MeshLod)), fileSize) ||
+           !inside(record.meshletOffset, record.meshletCount * static_cast<uint64_t>(sizeof(Meshlet)), fileSize))
+        {
+            close();
+            return false;
+        }
+
+        MeshView& view = meshes[i];
+        view.name.assign(file.begin() + record.nameOffset, record.nameLength);
+        view.format = format;
+        view.vertices = reinterpret_cast<const unsigned char*>(file.begin() + record.vertexOffset);
+        view.vertexCount = record.vertexCount;
+        view.indices = reinterpret_cast<const unsigned int*>(file.begin() + record.indexOffset);
+        view.indexCount = record.indexCount;
+        //a corrupt index would read past the vertices on the GPU and in the culling, meshlets only reach vertices through them
+        for(uint32_t n = 0; n < view.indexCount; ++n)
+        {
+            if(view.indices[n] >= view.vertexCount)
+            {
+                close();
+                return false;
+            }
+        }
+        view.lods = reinterpret_cast<const MeshLod*>(file.begin() + record.lodOffset);
+        view.lodCount = record.lodCount;
+        for(uint32_t l = 0; l < view.lodCount; ++l)
+        {
+            if(view.lods[l].indexOffset > view.indexCount || view.lods[l].indexCount > view.indexCount - view.lods[l].indexOffset)
+            {
+                close();
+                return false;
+            }
+        }
+        view.meshlets = reinterpret_cast<const Meshlet*>(file.begin() + record.meshletOffset);
+        view.meshletCount = record.meshletCount;
+        for(uint32_t m = 0; m < view.meshletCount; ++m)
+        {
+            if(view.meshlets[m].indexOffset > view.indexCount || view.meshlets[m].indexCount > view.indexCount - view.meshlets[m].indexOffset)
+            {
+                close();
+                return false;
+            }
+        }
+        view.boundsMin = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+        view.boundsMax = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+    file.close();
+    meshes.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+#include "Shape/VertexData.h"
+#include "Shape/MeshData.h"
+#include "Shape/VertexFormat.h"
+#include "Utility/MappedFile.h"
+
+/// <summary>
+/// Binary cache of a parsed model, stored next to the source file as "<source>.meshcache".
+/// Vertices are kept packed in the VertexFormat Mesh uploads and indices as they are drawn, so a
+/// cached model is memory mapped and handed to glBufferData without parsing or intermediate copies.
+/// A cache is only used while it matches the source file's canonical path, size and modification time
+/// (or content hash when the time stamp changed, e.g. after a fresh checkout), and its indices stay within its vertices.
+/// </summary>
+class MeshCache
+{
+public:
+    struct MeshView
+    {
+        std::string name;
+        VertexFormat format;
+        const unsigned char* vertices = nullptr; // format.stride() bytes per vertex
+        unsigned int vertexCount = 0;
+        const unsigned int* indices = nullptr;
+        unsigned int indexCount = 0;
+        const MeshLod* lods = nullptr;
+        unsigned int lodCount = 0;
+        const Meshlet* meshlets = nullptr;
+        unsigned int meshletCount = 0;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+    };
+
+    /// <summary> Maps the cache belonging to sourcePath. Returns false if there is none, it is stale or stored in another format. </summary>
+    bool open(const std::string& sourcePath, const VertexFormat& format);
+    void close();
+
+    inline bool isOpen() const { return file.isOpen(); }
+    inline const std::vector<MeshView>& getMeshes() const { return meshes; }
+
+    /// <summary> Writes the cache for sourcePath from already parsed meshes, packing vertices into format. </summary>
+    static bool write(const std::string& sourcePath, const std::vector<MeshData>& meshes, const VertexFormat& format, std::string& err);
+
+    static std::string cachePathFor(const std::string& sourcePath);
+
+    static const char* const FILE_EXTENSION;
+
+private:
+    struct SourceKey
+    {
+        uint64_t size = 0;
+        int64_t modified = 0;
+        uint64_t hash = 0;
+    };
+
+    static bool readSourceKey(const std::string& sourcePath, SourceKey& key, bool withHash);
+    static uint64_t hashFile(const std::string& sourcePath);
+
+    MappedFile file;
+    std::vector<MeshView> meshes;
+};
@@ -0,0 +1,477 @@
+#include "Utility/MeshOptimizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "Utility/JobSystem.h"
+#include "Utility/MeshSimplifier.h"
+#include "Utility/MeshletBuilder.h"
+
+unsigned int MeshOptimizer::cacheSize = 16;
+float MeshOptimizer::overdrawThreshold = 1.05f;
+unsigned int MeshOptimizer::threadCount = 0;
+bool MeshOptimizer::buildLods = true;
+bool MeshOptimizer::buildMeshlets = true;
+
+namespace
+{
+    // -------------------------------------
+    // FIFO post-transform cache. A vertex is cached while fewer than size misses happened since it was
+    // transformed, so flushing is just moving the clock past every stamp.
+    // -------------------------------------
+    class CacheSimulator
+    {
+    public:
+        CacheSimulator(size_t vertexCount, unsigned int size)
+        :stamps(vertexCount, 0), time(size + 1), size(size)
+        {
+        }
+
+        // returns true on a miss
+        inline bool access(unsigned int vertex)
+        {
+            if(time - stamps[vertex] > size)
+            {
+                stamps[vertex] = time++;
+                return true;
+            }
+            return false;
+        }
+
+        inline unsigned int triangleMisses(const unsigned int* triangle)
+        {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        inline void flush()
+        {
+            time += size + 1;
+        }
+
+    private:
+        std::vector<size_t> stamps;
+        size_t time;
+        size_t size;
+    };
+
+    inline uint64_t hashVertex(const VertexData& vertex)
+    {
+        //FNV-1a over the raw bytes, identical vertices are bitwise identical
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for(size_t i = 0; i < sizeof(VertexData); ++i)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+MeshOptimizer::Stats& MeshOptimizer::Stats::operator+=(const Stats& other)
+{
+    vertices += other.vertices;
+    triangles += other.triangles;
+    transformed += other.transformed;
+    return *this;
+}
+
+MeshOptimizer::Report& MeshOptimizer::Report::operator+=(const Report& other)
+{
+    before += other.before;
+    after += other.after;
+    duplicateVertices += other.duplicateVertices;
+    lods += other.lods;
+    meshlets += other.meshlets;
+    seconds += other.seconds;
+    return *this;
+}
+
+MeshOptimizer::Stats MeshOptimizer::analyze(const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    Stats stats;
+    stats.triangles = indices.size() / 3;
+
+    CacheSimulator cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    for(size_t i = 0; i < stats.triangles * 3; ++i)
+    {
+        unsigned int vertex = indices[i];
+        stats.transformed += cache.access(vertex);
+        if(!referenced[vertex])
+        {
+            referenced[vertex] = true;
+            ++stats.vertices;
+        }
+    }
+    return stats;
+}
+
+size_t MeshOptimizer::deduplicateVertices(MeshData& mesh)
+{
+    const size_t vertexCount = mesh.vertexData.size();
+    if(vertexCount == 0)
+        return 0;
+
+    //open addressing table of first occurrences, at most half full
+    size_t tableSize = 1;
+    while(tableSize < vertexCount * 2)
+        tableSize *= 2;
+    const unsigned int EMPTY = ~0u;
+    std::vector<unsigned int> table(tableSize, EMPTY);
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<VertexData> unique;
+    unique.reserve(vertexCount);
+    for(size_t i = 0; i < vertexCount; ++i)
+    {
+        const VertexData& vertex = mesh.vertexData[i];
+        size_t slot = hashVertex(vertex) & (tableSize - 1);
+        while(table[slot] != EMPTY && memcmp(&unique[table[slot]], &vertex, sizeof(VertexData)) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if(table[slot] == EMPTY)
+        {
+            table[slot] = static_cast<unsigned int>(unique.size());
+            unique.push_back(vertex);
+        }
+        remap[i] = table[slot];
+    }
+
+    size_t removed = vertexCount - unique.size();
+    if(removed != 0)
+    {
+        for(unsigned int& index : mesh.indices)
+        {
+            index = remap[index];
+        }
+        unique.shrink_to_fit();
+        mesh.vertexData.swap(unique);
+    }
+    return removed;
+}
+
+void MeshOptimizer::reorderForVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>* clusterStarts)
+{
+    // -------------------------------------
+    // Tipsify, Sander et al. 2007: fan around a vertex, emitting all its remaining triangles, then continue
+    // with the neighbour that is still cached and will stay cached while its own fan is emitted.
+    // -------------------------------------
+    const size_t triangleCount = indices.size() / 3;
+    if(clusterStarts != nullptr)
+        clusterStarts->clear();
+    if(triangleCount == 0)
+        return;
+
+    //triangles around each vertex
+    std::vector<unsigned int> live(vertexCount, 0);
+    for(size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++live[indices[i]];
+    }
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for(size_t v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<unsigned int> adjacency(offsets[vertexCount]);
+    {
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            adjacency[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+    }
+
+    const size_t k = cacheSize;
+    std::vector<size_t> stamps(vertexCount, 0);
+    size_t time = k + 1;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    deadEnds.reserve(triangleCount * 3);
+
+    size_t scan = 0;
+    auto skipDeadEnd = [&]() -> long long
+    {
+        //most recently used vertex with triangles left, otherwise the next one in input order
+        while(!deadEnds.empty())
+        {
+            unsigned int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if(live[vertex] > 0)
+                return vertex;
+        }
+        for(; scan < vertexCount; ++scan)
+        {
+            if(live[scan] > 0)
+                return static_cast<long long>(scan++);
+        }
+        return -1;
+    };
+
+    long long fanning = skipDeadEnd();
+    bool coldStart = true;
+    while(fanning >= 0)
+    {
+        if(coldStart && clusterStarts != nullptr)
+            clusterStarts->push_back(output.size() / 3);
+
+        candidates.clear();
+        for(size_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+        {
+            unsigned int triangle = adjacency[a];
+            if(emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+
+            for(int c = 0; c < 3; ++c)
+            {
+                unsigned int vertex = indices[triangle * 3 + c];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                if(time - stamps[vertex] > k)
+                    stamps[vertex] = time++;
+            }
+        }
+
+        long long next = -1;
+        long long bestPriority = -1;
+        for(unsigned int vertex : candidates)
+        {
+            if(live[vertex] == 0)
+                continue;
+
+            //prefer the oldest cache entry whose fan still fits before it gets evicted
+            long long priority = 0;
+            size_t age = time - stamps[vertex];
+            if(age + 2 * live[vertex] <= k)
+                priority = static_cast<long long>(age);
+            if(priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        coldStart = next < 0;
+        fanning = coldStart ? skipDeadEnd() : next;
+    }
+
+    //leftover indices of an incomplete triangle are kept as they were
+    output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+    indices.swap(output);
+}
+
+void MeshOptimizer::reorderForOverdraw(MeshData& mesh, const std::vector<size_t>& clusterStarts)
+{
+    const std::vector<unsigned int>& indices = mesh.indices;
+    const size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0 || clusterStarts.empty())
+        return;
+
+    // -------------------------------------
+    // Split the cold start clusters wherever the run so far is already about as cache efficient as the whole
+    // cluster, Sander et al. 2007. Cutting there costs little and gives the sort more freedom.
+    // -------------------------------------
+    CacheSimulator cache(mesh.vertexData.size(), cacheSize);
+    std::vector<size_t> starts;
+    for(size_t c = 0; c < clusterStarts.size(); ++c)
+    {
+        size_t begin = clusterStarts[c];
+        size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        if(begin >= end)
+            continue;
+
+        cache.flush();
+        size_t misses = 0;
+        for(size_t t = begin; t < end; ++t)
+        {
+            misses += cache.triangleMisses(&indices[t * 3]);
+        }
+        float threshold = overdrawThreshold * float(misses) / float(end - begin);
+
+        cache.flush();
+        size_t start = begin;
+        misses = 0;
+        starts.push_back(start);
+        for(size_t t = begin; t + 1 < end; ++t)
+        {
+            misses += cache.triangleMisses(&indices[t * 3]);
+            if(float(misses) <= threshold * float(t + 1 - start))
+            {
+                start = t + 1;
+                misses = 0;
+                starts.push_back(start);
+                cache.flush();
+            }
+        }
+    }
+    starts.push_back(triangleCount);
+
+    // -------------------------------------
+    // Draw clusters that face away from the mesh center and lie far out first, they are the likely occluders.
+    // -------------------------------------
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    const size_t clusterCount = starts.size() - 1;
+    std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    for(size_t c = 0; c < clusterCount; ++c)
+    {
+        float clusterArea = 0.0f;
+        for(size_t t = starts[c]; t < starts[c + 1]; ++t)
+        {
+            const glm::vec3& a = mesh.vertexData[indices[t * 3 + 0]].position;
+            const glm::vec3& b = mesh.vertexData[indices[t * 3 + 1]].position;
+            const glm::vec3& d = mesh.vertexData[indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            glm::vec3 center = (a + b + d) * (area / 3.0f);
+
+            clusterCenters[c] += center;
+            clusterNormals[c] += normal;
+            clusterArea += area;
+            meshCenter += center;
+            meshArea += area;
+        }
+        if(clusterArea > 0.0f)
+            clusterCenters[c] /= clusterArea;
+    }
+    if(meshArea > 0.0f)
+        meshCenter /= meshArea;
+
+    std::vector<float> keys(clusterCount);
+    std::vector<unsigned int> order(clusterCount);
+    for(size_t c = 0; c < clusterCount; ++c)
+    {
+        float length = glm::length(clusterNormals[c]);
+        keys[c] = length > 0.0f ? glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c] / length) : 0.0f;
+        order[c] = static_cast<unsigned int>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(mesh.indices.size());
+    for(unsigned int c : order)
+    {
+        sorted.insert(sorted.end(), indices.begin() + starts[c] * 3, indices.begin() + starts[c + 1] * 3);
+    }
+    sorted.insert(sorted.end(), indices.begin() + triangleCount * 3, indices.end());
+    mesh.indices.swap(sorted);
+}
+
+void MeshOptimizer::reorderVertexFetch(MeshData& mesh)
+{
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> remap(mesh.vertexData.size(), UNUSED);
+    std::vector<VertexData> ordered;
+    ordered.reserve(mesh.vertexData.size());
+    for(unsigned int& index : mesh.indices)
+    {
+        if(remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<unsigned int>(ordered.size());
+            ordered.push_back(mesh.vertexData[index]);
+        }
+        index = remap[index];
+    }
+    ordered.shrink_to_fit();
+    mesh.vertexData.swap(ordered);
+}
+
+void MeshOptimizer::optimize(MeshData& mesh, Report* report)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    //levels of detail and meshlets are regenerated from level 0
+    if(!mesh.lods.empty())
+    {
+        mesh.indices.resize(mesh.lods.front().indexCount);
+        mesh.lods.clear();
+    }
+    mesh.meshlets.clear();
+
+    if(report != nullptr)
+        report->before = analyze(mesh.indices, mesh.vertexData.size());
+
+    size_t duplicates = deduplicateVertices(mesh);
+    std::vector<size_t> clusterStarts;
+    reorderForVertexCache(mesh.indices, mesh.vertexData.size(), &clusterStarts);
+    reorderForOverdraw(mesh, clusterStarts);
+    reorderVertexFetch(mesh);
+
+    if(buildLods)
+        MeshSimplifier::generateLods(mesh);
+
+    if(buildMeshlets)
+        MeshletBuilder::build(mesh);
+
+    if(report != nullptr)
+    {
+        //level 0 in the order it is drawn, meshlets regroup its triangles
+        size_t levelIndices = mesh.lods.empty() ? mesh.indices.size() : mesh.lods.front().indexCount;
+        report->after = analyze(std::vector<unsigned int>(mesh.indices.begin(), mesh.indices.begin() + levelIndices), mesh.vertexData.size());
+        report->duplicateVertices = duplicates;
+        report->lods = mesh.lods.size();
+        report->meshlets = mesh.meshlets.size();
+        report->seconds = secondsSince(start);
+    }
+}
+
+void MeshOptimizer::optimize(std::vector<MeshData>& meshes, Report* report)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Report> reports(meshes.size());
+
+    //largest meshes first so one big mesh doesn't end up last on a single worker
+    std::vector<size_t> order(meshes.size());
+    for(size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&meshes](size_t a, size_t b) { return meshes[a].indices.size() > meshes[b].indices.size(); });
+
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        for(size_t i = next++; i < order.size(); i = next++)
+        {
+            optimize(meshes[order[i]], &reports[order[i]]);
+        }
+    };
+
+    //one job per thread taking meshes in that order, on the JobSystem so optimizing on several of AssetLoader's threads doesn't oversubscribe
+    JobSystem& jobs = JobSystem::getInstance();
+    unsigned int threads = threadCount != 0 ? threadCount : jobs.size();
+    threads = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threads, meshes.size())));
+    jobs.parallelFor(threads, 1, [&work](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            work();
+        }
+    });
+
+    if(report != nullptr)
+    {
+        *report = Report();
+        for(const Report& meshReport : reports)
+        {
+            *report += meshReport;
+        }
+        report->seconds = secondsSince(start);
+    }
+}
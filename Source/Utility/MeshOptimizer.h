@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Shape/MeshData.h"
+
+/// <summary>
+/// Reorders MeshData for the GPU before it is uploaded or cached: exact duplicate vertices are merged,
+/// triangles are reordered for the post-transform vertex cache (Tipsify) and, cluster by cluster, so that
+/// outward facing parts are drawn first to cut overdraw, then vertices are renumbered in the order they are fetched.
+/// The mesh renders the same, only the order of vertices and triangles changes. Finally MeshSimplifier appends
+/// the levels of detail and MeshletBuilder splits them into meshlets.
+/// </summary>
+class MeshOptimizer
+{
+public:
+    /// <summary> Post-transform cache behaviour of an index buffer, simulated with a FIFO cache of cacheSize entries. </summary>
+    struct Stats
+    {
+        size_t vertices = 0;
+        size_t triangles = 0;
+        size_t transformed = 0; // cache misses, i.e. vertex shader invocations
+
+        /// <summary> Average cache miss ratio, transformed vertices per triangle (0.5 is ideal, 3 is no reuse). </summary>
+        inline float acmr() const { return triangles == 0 ? 0.0f : float(transformed) / float(triangles); }
+        /// <summary> Average transform to vertex ratio, transformed vertices per unique vertex (1 is ideal). </summary>
+        inline float atvr() const { return vertices == 0 ? 0.0f : float(transformed) / float(vertices); }
+
+        Stats& operator+=(const Stats& other);
+    };
+
+    struct Report
+    {
+        Stats before;
+        Stats after;
+        size_t duplicateVertices = 0;
+        size_t lods = 0;
+        size_t meshlets = 0;
+        double seconds = 0.0;
+
+        Report& operator+=(const Report& other);
+    };
+
+    /// <summary> Runs every stage on one mesh. The statistics are those of level of detail 0. </summary>
+    static void optimize(MeshData& mesh, Report* report = nullptr);
+
+    /// <summary> Optimizes the meshes in parallel, one mesh per worker at a time. report holds the totals. </summary>
+    static void optimize(std::vector<MeshData>& meshes, Report* report = nullptr);
+
+    static Stats analyze(const std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // -------------------------------------
+    // Individual stages, in the order optimize runs them.
+    // -------------------------------------
+
+    /// <summary> Merges bitwise identical vertices and rewrites the indices. Returns the number of vertices removed. </summary>
+    static size_t deduplicateVertices(MeshData& mesh);
+
+    /// <summary> Tipsify triangle order. clusterStarts receives the first triangle of every run that starts with a cold cache. </summary>
+    static void reorderForVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>* clusterStarts = nullptr);
+
+    /// <summary> Splits the clusters further where the cache is warm enough and sorts them front to back, seen from outside the mesh. </summary>
+    static void reorderForOverdraw(MeshData& mesh, const std::vector<size_t>& clusterStarts);
+
+    /// <summary> Renumbers vertices in the order the index buffer first references them and drops unreferenced ones. </summary>
+    static void reorderVertexFetch(MeshData& mesh);
+
+    /// <summary> Entries of the simulated post-transform cache, used by Tipsify and analyze. </summary>
+    static unsigned int cacheSize;
+
+    /// <summary> How much worse than its cluster's ACMR a split off run may be, higher means more, smaller clusters to sort. </summary>
+    static float overdrawThreshold;
+
+    /// <summary> Generate levels of detail after optimizing. </summary>
+    static bool buildLods;
+
+    /// <summary> Split large levels into meshlets for culling. </summary>
+    static bool buildMeshlets;
+
+    /// <summary> Meshes optimized at once on the JobSystem when there are several, 0 means one per thread of the JobSystem. </summary>
+    static unsigned int threadCount;
+};
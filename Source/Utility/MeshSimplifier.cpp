@@ -0,0 +1,426 @@
+#include "Utility/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "Utility/MeshOptimizer.h"
+
+unsigned int MeshSimplifier::maxLods = 8;
+float MeshSimplifier::lodReduction = 0.5f;
+size_t MeshSimplifier::minLodTriangles = 256;
+
+namespace
+{
+    // -------------------------------------
+    // Sum of squared distances to a set of planes, weighted by triangle area.
+    // -------------------------------------
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double weight = 0;
+
+        void addPlane(const glm::dvec3& normal, double distance, double planeWeight)
+        {
+            a00 += planeWeight * normal.x * normal.x;
+            a01 += planeWeight * normal.x * normal.y;
+            a02 += planeWeight * normal.x * normal.z;
+            a11 += planeWeight * normal.y * normal.y;
+            a12 += planeWeight * normal.y * normal.z;
+            a22 += planeWeight * normal.z * normal.z;
+            b0 += planeWeight * normal.x * distance;
+            b1 += planeWeight * normal.y * distance;
+            b2 += planeWeight * normal.z * distance;
+            c += planeWeight * distance * distance;
+            weight += planeWeight;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        double evaluate(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a00 * x * x + a11 * y * y + a22 * z * z
+                 + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                 + 2.0 * (b0 * x + b1 * y + b2 * z)
+                 + c;
+        }
+    };
+
+    // root mean square distance to the planes of both quadrics when moving to position
+    inline float collapseError(const Quadric& from, const Quadric& to, const glm::vec3& position)
+    {
+        double weight = from.weight + to.weight;
+        if(weight <= 0.0)
+            return 0.0f;
+        double squared = std::max(0.0, from.evaluate(position) + to.evaluate(position));
+        return static_cast<float>(std::sqrt(squared / weight));
+    }
+
+    inline uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        float error;
+    };
+
+    // counting sort on the upper half of the error's bits; errors aren't negative so their bits order like
+    // the values, collapses within a bucket stay in input order which is close enough
+    void sortByError(const std::vector<Collapse>& collapses, std::vector<Collapse>& sorted)
+    {
+        const size_t BUCKETS = 1 << 16;
+        std::vector<unsigned int> offsets(BUCKETS + 1, 0);
+        for(const Collapse& collapse : collapses)
+        {
+            ++offsets[(floatBits(collapse.error) >> 16) + 1];
+        }
+        for(size_t b = 0; b < BUCKETS; ++b)
+        {
+            offsets[b + 1] += offsets[b];
+        }
+        sorted.resize(collapses.size());
+        for(const Collapse& collapse : collapses)
+        {
+            sorted[offsets[floatBits(collapse.error) >> 16]++] = collapse;
+        }
+    }
+
+    // -------------------------------------
+    // Triangles around every vertex, rebuilt for each pass.
+    // -------------------------------------
+    struct Adjacency
+    {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        void build(const std::vector<unsigned int>& indices, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for(unsigned int index : indices)
+            {
+                ++offsets[index + 1];
+            }
+            for(size_t v = 0; v < vertexCount; ++v)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+            triangles.resize(indices.size());
+            std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+            for(size_t i = 0; i < indices.size(); ++i)
+            {
+                triangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+
+        inline const unsigned int* begin(unsigned int vertex) const { return triangles.data() + offsets[vertex]; }
+        inline const unsigned int* end(unsigned int vertex) const { return triangles.data() + offsets[vertex + 1]; }
+    };
+
+    // vertex following vertex in triangle, i.e. the end of its outgoing edge
+    inline unsigned int nextInTriangle(const unsigned int* triangle, unsigned int vertex)
+    {
+        return triangle[0] == vertex ? triangle[1] : (triangle[1] == vertex ? triangle[2] : triangle[0]);
+    }
+
+    inline unsigned int previousInTriangle(const unsigned int* triangle, unsigned int vertex)
+    {
+        return triangle[0] == vertex ? triangle[2] : (triangle[1] == vertex ? triangle[0] : triangle[1]);
+    }
+
+    // -------------------------------------
+    // Vertices that have to stay: on an open or non-manifold edge, or sharing their position with another
+    // vertex, where moving one of them would tear the surface apart.
+    // -------------------------------------
+    void findLockedVertices(const std::vector<VertexData>& vertices, const std::vector<unsigned int>& indices,
+                            const Adjacency& adjacency, std::vector<unsigned char>& locked)
+    {
+        locked.assign(vertices.size(), 0);
+
+        //open addressing table of the first vertex at every position, at most half full
+        size_t tableSize = 1;
+        while(tableSize < vertices.size() * 2)
+            tableSize *= 2;
+        const unsigned int EMPTY = ~0u;
+        std::vector<unsigned int> table(tableSize, EMPTY);
+        for(unsigned int v = 0; v < vertices.size(); ++v)
+        {
+            if(adjacency.begin(v) == adjacency.end(v))
+                continue;
+
+            const glm::vec3& position = vertices[v].position;
+            uint32_t hash = (floatBits(position.x) * 73856093u) ^ (floatBits(position.y) * 19349663u) ^ (floatBits(position.z) * 83492791u);
+            size_t slot = (hash ^ (hash >> 16)) & (tableSize - 1);
+            while(table[slot] != EMPTY && vertices[table[slot]].position != position)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if(table[slot] == EMPTY)
+            {
+                table[slot] = v;
+            }
+            else
+            {
+                locked[v] = 1;
+                locked[table[slot]] = 1;
+            }
+        }
+
+        //on a closed manifold the edges leaving a vertex and those arriving at it connect the same neighbours, once each
+        std::vector<unsigned int> outgoing;
+        std::vector<unsigned int> incoming;
+        for(unsigned int v = 0; v < vertices.size(); ++v)
+        {
+            outgoing.clear();
+            incoming.clear();
+            for(const unsigned int* t = adjacency.begin(v); t != adjacency.end(v); ++t)
+            {
+                outgoing.push_back(nextInTriangle(&indices[*t * 3], v));
+                incoming.push_back(previousInTriangle(&indices[*t * 3], v));
+            }
+            std::sort(outgoing.begin(), outgoing.end());
+            std::sort(incoming.begin(), incoming.end());
+            if(outgoing != incoming || std::adjacent_find(outgoing.begin(), outgoing.end()) != outgoing.end())
+                locked[v] = 1;
+        }
+    }
+
+    // collapsing from onto to must keep the surface a manifold: the two vertices may only share the
+    // neighbours opposite their common edge
+    bool keepsManifold(const std::vector<unsigned int>& indices, const Adjacency& adjacency, unsigned int from, unsigned int to)
+    {
+        int shared = 0;
+        for(const unsigned int* t = adjacency.begin(from); t != adjacency.end(from); ++t)
+        {
+            unsigned int neighbour = nextInTriangle(&indices[*t * 3], from);
+            for(const unsigned int* u = adjacency.begin(to); u != adjacency.end(to); ++u)
+            {
+                if(previousInTriangle(&indices[*u * 3], to) == neighbour)
+                {
+                    ++shared;
+                    break;
+                }
+            }
+        }
+        return shared == 2;
+    }
+
+    // no triangle around from may turn over or become much steeper by moving from to the position of to
+    bool keepsOrientation(const std::vector<VertexData>& vertices, const std::vector<unsigned int>& indices,
+                          const Adjacency& adjacency, unsigned int from, unsigned int to)
+    {
+        const glm::vec3& target = vertices[to].position;
+        for(const unsigned int* t = adjacency.begin(from); t != adjacency.end(from); ++t)
+        {
+            const unsigned int* triangle = &indices[*t * 3];
+            if(triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue;
+
+            unsigned int b = nextInTriangle(triangle, from);
+            unsigned int c = previousInTriangle(triangle, from);
+            const glm::vec3& pa = vertices[from].position;
+            const glm::vec3& pb = vertices[b].position;
+            const glm::vec3& pc = vertices[c].position;
+
+            glm::vec3 before = glm::cross(pb - pa, pc - pa);
+            glm::vec3 after = glm::cross(pb - target, pc - target);
+            float limit = 0.25f * glm::length(before) * glm::length(after);
+            if(glm::dot(before, after) <= limit)
+                return false;
+        }
+        return true;
+    }
+}
+
+float MeshSimplifier::averageEdgeLength(const std::vector<VertexData>& vertices, const unsigned int* indices, size_t indexCount)
+{
+    double total = 0.0;
+    size_t triangleCount = indexCount / 3;
+    for(size_t t = 0; t < triangleCount; ++t)
+    {
+        const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+        total += glm::length(b - a) + glm::length(c - b) + glm::length(a - c);
+    }
+    return triangleCount == 0 ? 0.0f : static_cast<float>(total / (triangleCount * 3));
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const std::vector<VertexData>& vertices, const std::vector<unsigned int>& input,
+                                                   size_t targetIndexCount, float maxError, float* error)
+{
+    std::vector<unsigned int> indices(input.begin(), input.begin() + input.size() / 3 * 3);
+    const size_t vertexCount = vertices.size();
+    float largestError = 0.0f;
+
+    // -------------------------------------
+    // Quadrics of the planes around every vertex.
+    // -------------------------------------
+    std::vector<Quadric> quadrics(vertexCount);
+    for(size_t t = 0; t < indices.size(); t += 3)
+    {
+        glm::dvec3 a(vertices[indices[t + 0]].position);
+        glm::dvec3 b(vertices[indices[t + 1]].position);
+        glm::dvec3 c(vertices[indices[t + 2]].position);
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if(length <= 0.0)
+            continue;
+        normal /= length;
+        double area = length * 0.5;
+        for(int k = 0; k < 3; ++k)
+        {
+            quadrics[indices[t + k]].addPlane(normal, -glm::dot(normal, a), area);
+        }
+    }
+
+    Adjacency adjacency;
+    adjacency.build(indices, vertexCount);
+    std::vector<unsigned char> locked;
+    findLockedVertices(vertices, indices, adjacency, locked);
+
+    // -------------------------------------
+    // Passes of independent collapses, cheapest first. Every collapse removes about two triangles and
+    // freezes the neighbourhood it changed until the next pass rebuilds the adjacency.
+    // -------------------------------------
+    std::vector<Collapse> collapses;
+    std::vector<Collapse> sorted;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned char> touched(vertexCount);
+    while(indices.size() > targetIndexCount)
+    {
+        collapses.clear();
+        for(size_t t = 0; t < indices.size(); t += 3)
+        {
+            for(int k = 0; k < 3; ++k)
+            {
+                unsigned int from = indices[t + k];
+                unsigned int to = indices[t + (k + 1) % 3];
+                if(locked[from] || from == to)
+                    continue;
+                float collapseCost = collapseError(quadrics[from], quadrics[to], vertices[to].position);
+                if(collapseCost <= maxError)
+                    collapses.push_back({ from, to, collapseCost });
+            }
+        }
+        if(collapses.empty())
+            break;
+        sortByError(collapses, sorted);
+
+        for(size_t v = 0; v < vertexCount; ++v)
+        {
+            remap[v] = static_cast<unsigned int>(v);
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t goal = std::max<size_t>(1, (indices.size() - targetIndexCount) / 6);
+        size_t collapsed = 0;
+        for(const Collapse& collapse : sorted)
+        {
+            if(touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            bool untouched = true;
+            for(const unsigned int* t = adjacency.begin(collapse.from); t != adjacency.end(collapse.from) && untouched; ++t)
+            {
+                const unsigned int* triangle = &indices[*t * 3];
+                untouched = !touched[triangle[0]] && !touched[triangle[1]] && !touched[triangle[2]];
+            }
+            if(!untouched ||
+               !keepsManifold(indices, adjacency, collapse.from, collapse.to) ||
+               !keepsOrientation(vertices, indices, adjacency, collapse.from, collapse.to))
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            largestError = std::max(largestError, collapse.error);
+            for(const unsigned int* t = adjacency.begin(collapse.from); t != adjacency.end(collapse.from); ++t)
+            {
+                const unsigned int* triangle = &indices[*t * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+
+            if(++collapsed >= goal)
+                break;
+        }
+        if(collapsed == 0)
+            break;
+
+        //apply the pass and drop the triangles that collapsed into edges
+        size_t write = 0;
+        for(size_t t = 0; t < indices.size(); t += 3)
+        {
+            unsigned int a = remap[indices[t + 0]];
+            unsigned int b = remap[indices[t + 1]];
+            unsigned int c = remap[indices[t + 2]];
+            if(a == b || b == c || c == a)
+                continue;
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+        adjacency.build(indices, vertexCount);
+    }
+
+    if(error != nullptr)
+        *error = largestError;
+    return indices;
+}
+
+void MeshSimplifier::generateLods(MeshData& mesh)
+{
+    mesh.lods.clear();
+    const size_t baseCount = mesh.indices.size() / 3 * 3;
+    mesh.indices.resize(baseCount);
+
+    MeshLod base;
+    base.indexCount = static_cast<unsigned int>(baseCount);
+    base.edgeLength = averageEdgeLength(mesh.vertexData, mesh.indices.data(), baseCount);
+    mesh.lods.push_back(base);
+
+    //every level is simplified from the previous one, the errors add up along the chain
+    std::vector<unsigned int> previous(mesh.indices);
+    float chainError = 0.0f;
+    while(mesh.lods.size() < maxLods && previous.size() / 3 > minLodTriangles)
+    {
+        size_t target = static_cast<size_t>(previous.size() / 3 * lodReduction) * 3;
+        float levelError = 0.0f;
+        std::vector<unsigned int> level = simplify(mesh.vertexData, previous, target, std::numeric_limits<float>::max(), &levelError);
+
+        //give up once the simplifier is stuck on locked vertices
+        if(level.empty() || level.size() > previous.size() * (1.0f + lodReduction) * 0.5f)
+            break;
+
+        MeshOptimizer::reorderForVertexCache(level, mesh.vertexData.size());
+        chainError += levelError;
+
+        MeshLod lod;
+        lod.indexOffset = static_cast<unsigned int>(mesh.indices.size());
+        lod.indexCount = static_cast<unsigned int>(level.size());
+        lod.error = chainError;
+        lod.edgeLength = averageEdgeLength(mesh.vertexData, level.data(), level.size());
+        mesh.lods.push_back(lod);
+
+        mesh.indices.insert(mesh.indices.end(), level.begin(), level.end());
+        previous.swap(level);
+    }
+}
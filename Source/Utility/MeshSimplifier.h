@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Shape/MeshData.h"
+
+/// <summary>
+/// Quadric error mesh simplification (Garland and Heckbert 1997) restricted to collapsing vertices onto
+/// their neighbours, so every level of detail indexes the original vertex buffer and only needs its own indices.
+/// Borders, seams (several vertices at one position) and non-manifold edges are kept in place.
+/// </summary>
+class MeshSimplifier
+{
+public:
+    /// <summary>
+    /// Simplifies the triangles in indices to about targetIndexCount indices without exceeding maxError
+    /// (object space distance). Returns the new indices and, in error, the largest error introduced.
+    /// </summary>
+    static std::vector<unsigned int> simplify(const std::vector<VertexData>& vertices, const std::vector<unsigned int>& indices,
+                                              size_t targetIndexCount, float maxError, float* error = nullptr);
+
+    /// <summary>
+    /// Appends a chain of levels to mesh.indices and fills mesh.lods, level 0 being the current indices.
+    /// Run it after MeshOptimizer reordered level 0, each new level is reordered for the vertex cache here.
+    /// </summary>
+    static void generateLods(MeshData& mesh);
+
+    static float averageEdgeLength(const std::vector<VertexData>& vertices, const unsigned int* indices, size_t indexCount);
+
+    /// <summary> Most levels per mesh, including level 0. </summary>
+    static unsigned int maxLods;
+    /// <summary> Triangle count of each level relative to the previous one. </summary>
+    static float lodReduction;
+    /// <summary> No further levels are generated below this many triangles. </summary>
+    static size_t minLodTriangles;
+};
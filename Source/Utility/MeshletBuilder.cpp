@@ -0,0 +1,245 @@
+#include "Utility/MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+unsigned int MeshletBuilder::maxVertices = 64;
+unsigned int MeshletBuilder::maxTriangles = 124;
+size_t MeshletBuilder::minTriangles = 1024;
+
+namespace
+{
+    // -------------------------------------
+    // Greedy growth over shared vertices: a meshlet takes the neighbouring triangle that adds the fewest vertices,
+    // the one closest to its center on ties, and the next meshlet starts next to where the last one stopped.
+    // The level's indices are rewritten in meshlet order.
+    // -------------------------------------
+    void buildLevel(const std::vector<VertexData>& vertices, std::vector<unsigned int>& indices, unsigned int indexOffset, unsigned int indexCount,
+                    std::vector<unsigned int>& stamps, unsigned int& stamp, std::vector<Meshlet>& meshlets)
+    {
+        size_t triangleCount = indexCount / 3;
+        if(triangleCount < MeshletBuilder::minTriangles)
+            return;
+
+        const unsigned int* level = indices.data() + indexOffset;
+
+        //triangles around each vertex, compressed sparse rows over the vertices this level uses
+        std::vector<unsigned int> adjacencyStart(vertices.size() + 1, 0);
+        for(size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            ++adjacencyStart[level[i] + 1];
+        }
+        for(size_t v = 0; v < vertices.size(); ++v)
+        {
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        }
+        std::vector<unsigned int> adjacency(triangleCount * 3);
+        std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for(size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            adjacency[fill[level[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        std::vector<glm::vec3> centroids(triangleCount);
+        for(size_t t = 0; t < triangleCount; ++t)
+        {
+            centroids[t] = (vertices[level[3 * t]].position + vertices[level[3 * t + 1]].position + vertices[level[3 * t + 2]].position) / 3.0f;
+        }
+
+        std::vector<unsigned char> used(triangleCount, 0);
+        std::vector<unsigned int> listed(triangleCount, 0); // stamp of the meshlet whose candidates hold the triangle
+        std::vector<unsigned int> order;
+        order.reserve(triangleCount * 3);
+        std::vector<unsigned int> candidates;
+        size_t nextUnused = 0;
+
+        while(true)
+        {
+            //seed: the best triangle left over from the previous meshlet, else the first unused one in the current order
+            size_t seed = triangleCount;
+            for(unsigned int candidate : candidates)
+            {
+                if(!used[candidate])
+                {
+                    seed = candidate;
+                    break;
+                }
+            }
+            if(seed == triangleCount)
+            {
+                while(nextUnused < triangleCount && used[nextUnused])
+                {
+                    ++nextUnused;
+                }
+                if(nextUnused == triangleCount)
+                    break;
+                seed = nextUnused;
+            }
+
+            Meshlet meshlet;
+            meshlet.indexOffset = indexOffset + static_cast<unsigned int>(order.size());
+            unsigned int vertexCount = 0;
+            unsigned int triangles = 0;
+            glm::vec3 center(0.0f);
+            ++stamp;
+            candidates.clear();
+
+            size_t triangle = seed;
+            while(triangle != triangleCount)
+            {
+                used[triangle] = 1;
+                ++triangles;
+                center += (centroids[triangle] - center) / float(triangles);
+                for(int k = 0; k < 3; ++k)
+                {
+                    unsigned int vertex = level[3 * triangle + k];
+                    order.push_back(vertex);
+                    if(stamps[vertex] == stamp)
+                        continue;
+
+                    stamps[vertex] = stamp;
+                    ++vertexCount;
+                    for(unsigned int a = adjacencyStart[vertex]; a < adjacencyStart[vertex + 1]; ++a)
+                    {
+                        unsigned int neighbour = adjacency[a];
+                        if(!used[neighbour] && listed[neighbour] != stamp)
+                        {
+                            listed[neighbour] = stamp;
+                            candidates.push_back(neighbour);
+                        }
+                    }
+                }
+
+                if(triangles >= MeshletBuilder::maxTriangles)
+                    break;
+
+                //pick the next triangle, dropping candidates that were taken meanwhile
+                triangle = triangleCount;
+                unsigned int bestAdded = 4;
+                float bestDistance = 0.0f;
+                size_t kept = 0;
+                for(size_t c = 0; c < candidates.size(); ++c)
+                {
+                    unsigned int candidate = candidates[c];
+                    if(used[candidate])
+                        continue;
+                    candidates[kept++] = candidate;
+
+                    const unsigned int* corners = level + 3 * candidate;
+                    unsigned int added = (stamps[corners[0]] != stamp) + (stamps[corners[1]] != stamp) + (stamps[corners[2]] != stamp);
+                    if(vertexCount + added > MeshletBuilder::maxVertices || added > bestAdded)
+                        continue;
+
+                    glm::vec3 offset = centroids[candidate] - center;
+                    float distance = glm::dot(offset, offset);
+                    if(added < bestAdded || distance < bestDistance)
+                    {
+                        triangle = candidate;
+                        bestAdded = added;
+                        bestDistance = distance;
+                    }
+                }
+                candidates.resize(kept);
+            }
+
+            meshlet.indexCount = triangles * 3;
+            meshlets.push_back(meshlet);
+        }
+
+        std::copy(order.begin(), order.end(), indices.begin() + indexOffset);
+        for(size_t m = meshlets.size(); m-- > 0 && meshlets[m].indexOffset >= indexOffset;)
+        {
+            MeshletBuilder::computeBounds(vertices, indices.data(), meshlets[m]);
+        }
+    }
+}
+
+void MeshletBuilder::build(MeshData& mesh)
+{
+    mesh.meshlets.clear();
+    std::vector<unsigned int> stamps(mesh.vertexData.size(), 0);
+    unsigned int stamp = 0;
+
+    if(mesh.lods.empty())
+    {
+        buildLevel(mesh.vertexData, mesh.indices, 0, static_cast<unsigned int>(mesh.indices.size()), stamps, stamp, mesh.meshlets);
+        return;
+    }
+
+    //levels follow each other in the index buffer, so the meshlets come out sorted by indexOffset
+    for(const MeshLod& lod : mesh.lods)
+    {
+        buildLevel(mesh.vertexData, mesh.indices, lod.indexOffset, lod.indexCount, stamps, stamp, mesh.meshlets);
+    }
+}
+
+void MeshletBuilder::computeBounds(const std::vector<VertexData>& vertices, const unsigned int* indices, Meshlet& meshlet)
+{
+    const unsigned int* first = indices + meshlet.indexOffset;
+    const unsigned int* last = first + meshlet.indexCount;
+    if(first == last)
+        return;
+
+    // -------------------------------------
+    // Bounding sphere around the center of the bounding box.
+    // -------------------------------------
+    glm::vec3 boundsMin = vertices[*first].position;
+    glm::vec3 boundsMax = boundsMin;
+    for(const unsigned int* index = first; index != last; ++index)
+    {
+        boundsMin = glm::min(boundsMin, vertices[*index].position);
+        boundsMax = glm::max(boundsMax, vertices[*index].position);
+    }
+
+    meshlet.center = 0.5f * (boundsMin + boundsMax);
+    float radiusSquared = 0.0f;
+    for(const unsigned int* index = first; index != last; ++index)
+    {
+        glm::vec3 offset = vertices[*index].position - meshlet.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // -------------------------------------
+    // Normal cone: the average face normal and the widest angle any face makes with it.
+    // -------------------------------------
+    auto faceNormal = [&vertices](const unsigned int* triangle, glm::vec3& normal)
+    {
+        const glm::vec3& a = vertices[triangle[0]].position;
+        normal = glm::cross(vertices[triangle[1]].position - a, vertices[triangle[2]].position - a);
+        float length = glm::length(normal);
+        if(length <= 0.0f)
+            return false;
+        normal /= length;
+        return true;
+    };
+
+    glm::vec3 axis(0.0f);
+    glm::vec3 normal;
+    for(const unsigned int* triangle = first; triangle + 3 <= last; triangle += 3)
+    {
+        if(faceNormal(triangle, normal))
+            axis += normal;
+    }
+
+    float axisLength = glm::length(axis);
+    meshlet.coneAxis = glm::vec3(0.0f);
+    meshlet.coneCutoff = 1.0f;
+    if(axisLength <= 1e-6f)
+        return;
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for(const unsigned int* triangle = first; triangle + 3 <= last; triangle += 3)
+    {
+        if(faceNormal(triangle, normal))
+            minDot = std::min(minDot, glm::dot(axis, normal));
+    }
+
+    //a cone of 90 degrees or more always has a face turned towards the camera
+    if(minDot <= 0.0f)
+        return;
+
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Shape/MeshData.h"
+
+/// <summary>
+/// Splits every large level of detail into meshlets of at most maxVertices vertices and maxTriangles triangles,
+/// each with a bounding sphere and a normal cone so MeshletCuller can skip clusters outside the frustum or facing away.
+/// Meshlets grow over shared vertices, so they stay compact, and each level's triangles are regrouped in meshlet order.
+/// A meshlet starts next to where the previous one stopped, which keeps most of MeshOptimizer's vertex cache order.
+/// </summary>
+class MeshletBuilder
+{
+public:
+    /// <summary> Replaces mesh.meshlets with the clusters of every level that has at least minTriangles triangles. </summary>
+    static void build(MeshData& mesh);
+
+    /// <summary> Fills the bounding sphere and normal cone of the triangles meshlet covers. </summary>
+    static void computeBounds(const std::vector<VertexData>& vertices, const unsigned int* indices, Meshlet& meshlet);
+
+    static unsigned int maxVertices;
+    static unsigned int maxTriangles;
+
+    /// <summary> Levels with fewer triangles are drawn whole, culling them would cost more than it saves. </summary>
+    static size_t minTriangles;
+};
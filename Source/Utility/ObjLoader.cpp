@@ -1,14 +1,19 @@
 
 
 #define __UTILITY_LOG_LOADING_TIME true
+//parse with the multithreaded ObjParser instead of tinyobjloader, both produce the same shapes
+#define __UTILITY_USE_NATIVE_OBJ_PARSER true
+//load from / write to a binary MeshCache next to the .obj
+#define __UTILITY_USE_MESH_CACHE true
+//reorder triangles and vertices for the vertex cache and overdraw and build levels of detail and meshlets before upload, cached meshes are stored optimized
+#define __UTILITY_OPTIMIZE_MESHES true
+//parse files of at least streamingThreshold bytes chunk by chunk instead of holding them in memory
+#define __UTILITY_STREAM_LARGE_FILES true
 
 #if __UTILITY_LOG_LOADING_TIME
 
 #include <iostream>
 #include <iomanip>
-#include "OpenGL_Includes.h"
-
-#include "Time/FrameRate.h"
 #endif
 
 #include "ObjLoader.h"
@@ -16,55 +21,200 @@
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 
 
 
 #include "External/tiny_obj/tiny_obj_loader.h"
+#include "Utility/ObjParser.h"
+#include "Utility/MeshCache.h"
+#include "Utility/MeshOptimizer.h"
 #include "Shape/VertexData.h"
 #include "Shape/Mesh.h"
+#include "Shape/MeshStreamUploader.h"
+#include "Utility/CpuProfiler.h"
+
+size_t ObjLoader::streamingThreshold = size_t(512) * 1024 * 1024;
+
+namespace
+{
+    //std::chrono instead of glfwGetTime, loading runs on worker threads without a GL context
+    inline double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    size_t fileSize(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        return file ? static_cast<size_t>(file.tellg()) : 0;
+    }
+}
 
 Shape * ObjLoader::loadShapeFromObj(const std::string &path)
-{
-    
-    std::string assetPath = AssetStore::resourceRoot + path;
-#if __UTILITY_LOG_LOADING_TIME
-    double logTimestamp = glfwGetTime();
-    double took;
-    std::cout << "Loading obj '" << assetPath << "'..." << std::endl;
-#endif
-    
+{
+    PROFILE_SCOPE("ObjLoader::loadShapeFromObj");
+    return new Shape(AssetStore::getInstance().loadMeshes(path));
+}
+
+size_t ObjLoader::LoadedObj::meshCount() const
+{
+    return cache.isOpen() ? cache.getMeshes().size() : meshData.size();
+}
+
+void ObjLoader::uploadStream(ObjParser::Stream& stream, std::vector<Mesh*>& meshes)
+{
+    PROFILE_SCOPE("ObjLoader::uploadStream");
+    MeshStreamUploader uploader(Mesh::defaultVertexFormat);
+    ObjParser::Stream::Chunk chunk;
+    while(stream.next(chunk))
+    {
+        uploader.append(chunk);
+        if(chunk.lastOfMesh)
+        {
+            if(Mesh* mesh = uploader.finish())
+                meshes.push_back(mesh);
+        }
+    }
+#if __UTILITY_LOG_LOADING_TIME
+    if(!stream.error().empty())
+        std::cerr << "Failed to stream object. Error message:" << std::endl << stream.error() << std::endl;
+#endif
+    stream.close();
+}
+
+Mesh* ObjLoader::LoadedObj::uploadMesh(size_t index, size_t* bytes)
+{
+    PROFILE_SCOPE("ObjLoader::uploadMesh");
+    if(cache.isOpen())
+    {
+        const MeshCache::MeshView& view = cache.getMeshes()[index];
+        if(bytes)
+            *bytes = view.vertexCount * static_cast<size_t>(view.format.stride()) + view.indexCount * sizeof(unsigned int);
+        return new Mesh(view);
+    }
+
+    MeshData& data = meshData[index];
+    if(bytes)
+        *bytes = data.vertexData.size() * static_cast<size_t>(Mesh::defaultVertexFormat.stride()) + data.indices.size() * sizeof(unsigned int);
+    return new Mesh(std::move(data));
+}
+
+bool ObjLoader::loadObj(const std::string &path, LoadedObj& loaded)
+{
+    PROFILE_SCOPE("ObjLoader::loadObj");
+    std::string assetPath = AssetStore::resourceRoot + path;
+#if __UTILITY_LOG_LOADING_TIME
+    auto logTimestamp = std::chrono::steady_clock::now();
+    std::cout << "Loading obj '" << assetPath << "'..." << std::endl;
+#endif
+
+#if __UTILITY_USE_MESH_CACHE
+    if(loaded.cache.open(assetPath, Mesh::defaultVertexFormat))
+    {
+#if __UTILITY_LOG_LOADING_TIME
+        std::cout << std::setprecision(4) << " - Loading '" << assetPath << "' took " << secondsSince(logTimestamp) << " seconds (from " << MeshCache::cachePathFor(assetPath) << ")." << std::endl;
+#endif
+        return true;
+    }
+#endif
+
+#if __UTILITY_STREAM_LARGE_FILES
+    if(fileSize(assetPath) >= streamingThreshold)
+    {
+        std::string streamErr;
+        loaded.stream.reset(new ObjParser::Stream());
+        if(!loaded.stream->open(assetPath, Mesh::defaultVertexFormat, streamErr))
+        {
+#if __UTILITY_LOG_LOADING_TIME
+            std::cerr << "Failed to stream object with path '" << assetPath << "'. Error message:" << std::endl << streamErr << std::endl;
+#endif
+            loaded.stream.reset();
+            return false;
+        }
+#if __UTILITY_LOG_LOADING_TIME
+        const ObjParser::Stream::Stats& stats = loaded.stream->getStats();
+        std::cout << std::setprecision(4) << " - Streaming '" << assetPath << "', spilling " << stats.spilledBytes / (1024.0 * 1024.0)
+                  << " MB of attributes took " << stats.spillSeconds << " seconds." << std::endl;
+#endif
+        return true;
+    }
+#endif
+
+    loadMeshData(path, loaded.meshData);
+
+#if __UTILITY_LOG_LOADING_TIME
+    std::cout << std::setprecision(4) << " - Parsing '" << assetPath << "' took " << secondsSince(logTimestamp) << " seconds (by " << (__UTILITY_USE_NATIVE_OBJ_PARSER ? "ObjParser" : "tinyobjloader") << ")." << std::endl;
+#endif
     
-    RawObjData rawObjData;
-	
+#if __UTILITY_USE_MESH_CACHE
+    // Written before the meshes take the data over.
+    std::string cacheErr;
+    if(!loaded.meshData.empty() && !MeshCache::write(assetPath, loaded.meshData, Mesh::defaultVertexFormat, cacheErr))
+    {
+#if __UTILITY_LOG_LOADING_TIME
+        std::cerr << "Failed to write mesh cache for '" << assetPath << "'. Error message:" << std::endl << cacheErr << std::endl;
+#endif
+    }
+#endif
+
+    return !loaded.meshData.empty();
+}
 
-    loadRawObjData(path, rawObjData);
+void ObjLoader::loadRawObjData(const std::string &path, ObjLoader::RawObjData &rawObjData)
+{
+    std::string assetPath = AssetStore::resourceRoot + path;
 
+    
+    std::string err;
+#if __UTILITY_USE_NATIVE_OBJ_PARSER
+    bool loaded = ObjParser::parse(assetPath, rawObjData.shapes, rawObjData.materials, err);
+#else
+    bool loaded = tinyobj::LoadObj(rawObjData.shapes, rawObjData.materials, err, assetPath.c_str());
+#endif
+    if (!loaded || rawObjData.shapes.size() == 0) {
 #if __UTILITY_LOG_LOADING_TIME
-    took = glfwGetTime() - logTimestamp;
-    std::cout << std::setprecision(4) << " - Parsing '" << assetPath << "' took " << took << " seconds (by tinyobjloader)." << std::endl;
-    logTimestamp = glfwGetTime();
+        std::cerr << "Failed to load object with path '" << assetPath << "'. Error message:" << std::endl << err << std::endl;
 #endif
+        //return nullptr;
+    }
     
-    Shape * result = new Shape(rawObjData.shapes);
-
-#if __UTILITY_LOG_LOADING_TIME
-	took = glfwGetTime() - logTimestamp;
-	std::cout << std::setprecision(4) << " - Loading '" << assetPath << "' took " << took << " seconds." << std::endl;
-#endif
-	return result;
 }
 
-void ObjLoader::loadRawObjData(const std::string &path, ObjLoader::RawObjData &rawObjData)
+void ObjLoader::loadMeshData(const std::string &path, std::vector<MeshData> &meshData)
 {
+    PROFILE_SCOPE("ObjLoader::loadMeshData");
     std::string assetPath = AssetStore::resourceRoot + path;
-
     
     std::string err;
-    if (!tinyobj::LoadObj(rawObjData.shapes, rawObjData.materials, err, assetPath.c_str()) || rawObjData.shapes.size() == 0) {
+    std::vector<tinyobj::material_t> materials;
+#if __UTILITY_USE_NATIVE_OBJ_PARSER
+    // Parsed straight into the buffers Mesh uploads, no tinyobj::shape_t in between.
+    bool loaded = ObjParser::parse(assetPath, meshData, materials, err);
+#else
+    std::vector<tinyobj::shape_t> shapes;
+    bool loaded = tinyobj::LoadObj(shapes, materials, err, assetPath.c_str());
+    meshData.clear();
+    meshData.reserve(shapes.size());
+    for (tinyobj::shape_t& shape : shapes) {
+        meshData.push_back(ObjParser::toMeshData(shape));
+        shape = tinyobj::shape_t();
+    }
+#endif
+    if (!loaded || meshData.size() == 0) {
 #if __UTILITY_LOG_LOADING_TIME
         std::cerr << "Failed to load object with path '" << assetPath << "'. Error message:" << std::endl << err << std::endl;
 #endif
-        //return nullptr;
+        return;
     }
     
+#if __UTILITY_OPTIMIZE_MESHES
+    MeshOptimizer::Report report;
+    MeshOptimizer::optimize(meshData, &report);
+#if __UTILITY_LOG_LOADING_TIME
+    std::cout << std::setprecision(4) << " - Optimizing '" << assetPath << "' took " << report.seconds << " seconds, ACMR "
+              << report.before.acmr() << " -> " << report.after.acmr() << ", ATVR " << report.before.atvr() << " -> " << report.after.atvr()
+              << ", " << report.duplicateVertices << " duplicate vertices, " << report.lods << " levels of detail, " << report.meshlets << " meshlets." << std::endl;
+#endif
+#endif
 }
@@ -1,13 +1,46 @@
 #pragma once
 #include "Shape/Shape.h"
 #include "Utility/AssetStore.h"
+#include "Shape/MeshData.h"
+#include "Utility/MeshCache.h"
+#include "Utility/ObjParser.h"
 
+#include <memory>
 #include <string>
+
+class Mesh;
+
 class ObjLoader : public AssetStore{
 public:
-	/// <summary> Loads an .obj-file into a Shape object. </summary>
+	/// <summary> Loads an .obj-file into a Shape object, sharing the meshes through AssetStore if the file was loaded before. </summary>
 	static Shape * loadShapeFromObj(const std::string &path = "Assets\\Models\\teapot.obj");
 
+    /// <summary>
+    /// A model ready for upload: the mapped cache when it was up to date, otherwise the parsed meshes or,
+    /// for files of at least streamingThreshold bytes, a stream that parses them chunk by chunk.
+    /// </summary>
+    struct LoadedObj
+    {
+        MeshCache cache;
+        std::vector<MeshData> meshData;
+        std::unique_ptr<ObjParser::Stream> stream;
+
+        /// <summary> Meshes uploadMesh can upload, 0 for a stream. </summary>
+        size_t meshCount() const;
+
+        /// <summary> Creates and uploads mesh index, call it on the thread owning the GL context. bytes receives the size of the upload. </summary>
+        Mesh* uploadMesh(size_t index, size_t* bytes = nullptr);
+    };
+
+    /// <summary> Opens the cache or parses, optimizes and caches the .obj. Makes no GL calls, so it runs on any thread. </summary>
+    static bool loadObj(const std::string &path, LoadedObj& loaded);
+
+    /// <summary> Uploads the rest of stream through a MeshStreamUploader, one Mesh per group. Call on the thread owning the GL context. </summary>
+    static void uploadStream(ObjParser::Stream& stream, std::vector<Mesh*>& meshes);
+
+    /// <summary> .obj files without an up to date cache are streamed from this size on, with bounded memory but without optimization or cache. </summary>
+    static size_t streamingThreshold;
+
     
     struct RawObjData
     {
@@ -16,4 +49,7 @@ public:
     };
     
     static void loadRawObjData(const std::string &path, RawObjData& rawObjData);
+    
+    /// <summary> Loads an .obj-file into the interleaved vertex and index buffers Mesh takes over. </summary>
+    static void loadMeshData(const std::string &path, std::vector<MeshData>& meshData);
 };
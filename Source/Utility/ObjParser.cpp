@@ -0,0 +1,1244 @@
+#include "Utility/ObjParser.h"
+#include "Utility/JobSystem.h"
+#include "Utility/MappedFile.h"
+#include "Utility/MeshOptimizer.h"
+#include "Shape/VertexEncoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+unsigned int ObjParser::threadCount = 0;
+const size_t ObjParser::MIN_CHUNK_SIZE = 1 << 20;
+
+namespace
+{
+    const int NO_INDEX = INT_MIN;
+
+    //set on a corner whose index was written relative to the end of the chunk's own arrays, the chunk's
+    //base offset has to be added once the chunks are merged
+    const unsigned char V_RELATIVE = 1;
+    const unsigned char VT_RELATIVE = 2;
+    const unsigned char VN_RELATIVE = 4;
+
+    struct Corner
+    {
+        int v, vt, vn;
+        inline bool operator==(const Corner& other) const { return v == other.v && vt == other.vt && vn == other.vn; }
+    };
+
+    struct CornerHash
+    {
+        inline size_t operator()(const Corner& c) const
+        {
+            uint64_t h = static_cast<uint32_t>(c.v);
+            h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(c.vt);
+            h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(c.vn);
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+    };
+
+    enum class DirectiveType : unsigned char
+    {
+        GROUP,
+        OBJECT,
+        USE_MATERIAL,
+        MATERIAL_LIBRARY
+    };
+
+    struct Directive
+    {
+        DirectiveType type;
+        size_t triangle; //triangles emitted before this directive
+        std::string name;
+    };
+
+    struct Chunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<Corner> corners; //three per triangle, polygons are fanned while parsing
+        std::vector<unsigned char> relative;
+        std::vector<Directive> directives;
+    };
+
+    const double POWERS_OF_TEN[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+    inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+    inline const char* skipSpaces(const char* s, const char* end)
+    {
+        while(s < end && isSpace(*s)) ++s;
+        return s;
+    }
+
+    //fast path for the plain decimal numbers found in .obj files, anything exotic (inf, nan, hex) goes through strtof
+    const char* parseFloat(const char* s, const char* end, float& result)
+    {
+        s = skipSpaces(s, end);
+        const char* start = s;
+
+        bool negative = false;
+        if(s < end && (*s == '-' || *s == '+'))
+        {
+            negative = *s == '-';
+            ++s;
+        }
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int significantDigits = 0;
+        bool anyDigits = false;
+
+        for(; s < end && isDigit(*s); ++s)
+        {
+            anyDigits = true;
+            if(significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+                significantDigits += mantissa != 0 ? 1 : 0;
+            }
+            else
+            {
+                ++exponent;
+            }
+        }
+
+        if(s < end && *s == '.')
+        {
+            ++s;
+            for(; s < end && isDigit(*s); ++s)
+            {
+                anyDigits = true;
+                if(significantDigits < 19)
+                {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+                    significantDigits += mantissa != 0 ? 1 : 0;
+                    --exponent;
+                }
+            }
+        }
+
+        if(!anyDigits)
+        {
+            char buffer[64];
+            size_t length = 0;
+            while(start + length < end && length < sizeof(buffer) - 1 && !isSpace(start[length]) && start[length] != '\r' && start[length] != '\n')
+            {
+                buffer[length] = start[length];
+                ++length;
+            }
+            buffer[length] = '\0';
+            char* parsedEnd = buffer;
+            result = strtof(buffer, &parsedEnd);
+            return start + (parsedEnd - buffer);
+        }
+
+        if(s < end && (*s == 'e' || *s == 'E'))
+        {
+            const char* exponentStart = s;
+            ++s;
+            bool negativeExponent = false;
+            if(s < end && (*s == '-' || *s == '+'))
+            {
+                negativeExponent = *s == '-';
+                ++s;
+            }
+            if(s < end && isDigit(*s))
+            {
+                int value = 0;
+                for(; s < end && isDigit(*s); ++s)
+                {
+                    value = value < 10000 ? value * 10 + (*s - '0') : value;
+                }
+                exponent += negativeExponent ? -value : value;
+            }
+            else
+            {
+                s = exponentStart;
+            }
+        }
+
+        double value = static_cast<double>(mantissa);
+        while(exponent < -22)
+        {
+            value /= 1e22;
+            exponent += 22;
+        }
+        while(exponent > 22)
+        {
+            value *= 1e22;
+            exponent -= 22;
+        }
+        value = exponent < 0 ? value / POWERS_OF_TEN[-exponent] : value * POWERS_OF_TEN[exponent];
+
+        result = static_cast<float>(negative ? -value : value);
+        return s;
+    }
+
+    inline const char* parseInt(const char* s, const char* end, int& result)
+    {
+        bool negative = false;
+        if(s < end && (*s == '-' || *s == '+'))
+        {
+            negative = *s == '-';
+            ++s;
+        }
+        int value = 0;
+        for(; s < end && isDigit(*s); ++s)
+        {
+            value = value * 10 + (*s - '0');
+        }
+        result = negative ? -value : value;
+        return s;
+    }
+
+    //same conventions as tinyobj: 1 based, negative values count back from the current end of the array
+    inline const char* parseIndex(const char* s, const char* end, size_t count, int& index, unsigned char& relative, unsigned char relativeFlag)
+    {
+        int raw = 0;
+        s = parseInt(s, end, raw);
+        if(raw > 0)
+        {
+            index = raw - 1;
+        }
+        else if(raw == 0)
+        {
+            index = 0;
+        }
+        else
+        {
+            index = static_cast<int>(count) + raw;
+            relative |= relativeFlag;
+        }
+
+        while(s < end && *s != '/' && !isSpace(*s) && *s != '\r') ++s;
+        return s;
+    }
+
+    //negative indices are resolved against positionCount, texcoordCount and normalCount, the attributes read so far
+    inline const char* parseCorner(const char* s, const char* end, size_t positionCount, size_t texcoordCount, size_t normalCount,
+                                   Corner& corner, unsigned char& relative)
+    {
+        corner.v = corner.vt = corner.vn = NO_INDEX;
+        relative = 0;
+
+        s = parseIndex(s, end, positionCount, corner.v, relative, V_RELATIVE);
+        if(s >= end || *s != '/')
+            return s;
+        ++s;
+
+        //i//k
+        if(s < end && *s == '/')
+        {
+            ++s;
+            return parseIndex(s, end, normalCount, corner.vn, relative, VN_RELATIVE);
+        }
+
+        //i/j/k or i/j
+        s = parseIndex(s, end, texcoordCount, corner.vt, relative, VT_RELATIVE);
+        if(s >= end || *s != '/')
+            return s;
+        ++s;
+        return parseIndex(s, end, normalCount, corner.vn, relative, VN_RELATIVE);
+    }
+
+    inline const char* parseCorner(const char* s, const char* end, const Chunk& chunk, Corner& corner, unsigned char& relative)
+    {
+        return parseCorner(s, end, chunk.positions.size() / 3, chunk.texcoords.size() / 2, chunk.normals.size() / 3, corner, relative);
+    }
+
+    inline std::string parseName(const char* s, const char* end)
+    {
+        s = skipSpaces(s, end);
+        const char* nameEnd = s;
+        while(nameEnd < end && !isSpace(*nameEnd) && *nameEnd != '\r') ++nameEnd;
+        return std::string(s, nameEnd);
+    }
+
+    inline bool startsWith(const char* s, const char* end, const char* keyword, size_t length)
+    {
+        return static_cast<size_t>(end - s) > length && strncmp(s, keyword, length) == 0 && isSpace(s[length]);
+    }
+
+    void parseLine(Chunk& chunk, const char* s, const char* end)
+    {
+        s = skipSpaces(s, end);
+        if(s >= end || end - s < 2)
+            return;
+
+        if(s[0] == 'v')
+        {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            if(isSpace(s[1]))
+            {
+                s = parseFloat(s + 2, end, x);
+                s = parseFloat(s, end, y);
+                parseFloat(s, end, z);
+                chunk.positions.push_back(x);
+                chunk.positions.push_back(y);
+                chunk.positions.push_back(z);
+            }
+            else if(s[1] == 'n' && end - s > 2 && isSpace(s[2]))
+            {
+                s = parseFloat(s + 3, end, x);
+                s = parseFloat(s, end, y);
+                parseFloat(s, end, z);
+                chunk.normals.push_back(x);
+                chunk.normals.push_back(y);
+                chunk.normals.push_back(z);
+            }
+            else if(s[1] == 't' && end - s > 2 && isSpace(s[2]))
+            {
+                s = parseFloat(s + 3, end, x);
+                parseFloat(s, end, y);
+                chunk.texcoords.push_back(x);
+                chunk.texcoords.push_back(y);
+            }
+            return;
+        }
+
+        if(s[0] == 'f' && isSpace(s[1]))
+        {
+            s += 2;
+            Corner first, previous, current;
+            unsigned char firstRelative = 0, previousRelative = 0, currentRelative = 0;
+            int count = 0;
+            while(true)
+            {
+                while(s < end && (isSpace(*s) || *s == '\r')) ++s;
+                if(s >= end)
+                    break;
+
+                s = parseCorner(s, end, chunk, current, currentRelative);
+                if(count == 0)
+                {
+                    first = current;
+                    firstRelative = currentRelative;
+                }
+                else if(count >= 2)
+                {
+                    chunk.corners.push_back(first);
+                    chunk.corners.push_back(previous);
+                    chunk.corners.push_back(current);
+                    chunk.relative.push_back(firstRelative);
+                    chunk.relative.push_back(previousRelative);
+                    chunk.relative.push_back(currentRelative);
+                }
+                previous = current;
+                previousRelative = currentRelative;
+                ++count;
+            }
+            return;
+        }
+
+        Directive directive;
+        directive.triangle = chunk.corners.size() / 3;
+        if(s[0] == 'g' && isSpace(s[1]))
+        {
+            directive.type = DirectiveType::GROUP;
+            directive.name = parseName(s + 2, end);
+        }
+        else if(s[0] == 'o' && isSpace(s[1]))
+        {
+            directive.type = DirectiveType::OBJECT;
+            directive.name = parseName(s + 2, end);
+        }
+        else if(startsWith(s, end, "usemtl", 6))
+        {
+            directive.type = DirectiveType::USE_MATERIAL;
+            directive.name = parseName(s + 7, end);
+        }
+        else if(startsWith(s, end, "mtllib", 6))
+        {
+            directive.type = DirectiveType::MATERIAL_LIBRARY;
+            directive.name = parseName(s + 7, end);
+        }
+        else
+        {
+            //comments, smoothing groups and anything else tinyobj ignores
+            return;
+        }
+        chunk.directives.push_back(std::move(directive));
+    }
+
+    //pages of the mapping are handed back to the OS once a window this big has been read, so the whole
+    //file is never resident at once
+    const size_t RELEASE_WINDOW = 8 << 20;
+
+    template <typename FUNCTION>
+    void forEachLine(const Chunk& chunk, const MappedFile& file, FUNCTION function)
+    {
+        const char* s = chunk.begin;
+        const char* released = chunk.begin;
+        while(s < chunk.end)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(s, '\n', chunk.end - s));
+            if(lineEnd == nullptr)
+                lineEnd = chunk.end;
+            function(s, lineEnd);
+            s = lineEnd + 1;
+
+            if(static_cast<size_t>(s - released) >= RELEASE_WINDOW)
+            {
+                file.release(released, s);
+                released = s;
+            }
+        }
+        file.release(released, chunk.end);
+    }
+
+    void parseChunk(Chunk& chunk, const MappedFile& file)
+    {
+        //count first so the streams are allocated once at their final size instead of growing by doubling
+        size_t positions = 0, normals = 0, texcoords = 0, faces = 0;
+        forEachLine(chunk, file, [&](const char* s, const char* end)
+        {
+            s = skipSpaces(s, end);
+            if(end - s < 2)
+                return;
+            if(s[0] == 'v')
+            {
+                positions += isSpace(s[1]) ? 1 : 0;
+                normals += s[1] == 'n' ? 1 : 0;
+                texcoords += s[1] == 't' ? 1 : 0;
+            }
+            else if(s[0] == 'f')
+            {
+                ++faces;
+            }
+        });
+
+        chunk.positions.reserve(positions * 3);
+        chunk.normals.reserve(normals * 3);
+        chunk.texcoords.reserve(texcoords * 2);
+        chunk.corners.reserve(faces * 3);
+        chunk.relative.reserve(faces * 3);
+
+        forEachLine(chunk, file, [&chunk](const char* s, const char* end){ parseLine(chunk, s, end); });
+    }
+
+    template <typename FUNCTION>
+    void runOnChunks(std::vector<Chunk>& chunks, FUNCTION function)
+    {
+        //on the JobSystem, parsing on several of AssetLoader's threads at once doesn't start a set of threads per parse
+        JobSystem::getInstance().parallelFor(chunks.size(), 1, [&chunks, &function](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; ++i)
+                function(chunks[i], i);
+        });
+    }
+
+    struct MergedStreams
+    {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<Corner> corners;
+        std::vector<Directive> directives;
+    };
+
+    void merge(std::vector<Chunk>& chunks, MergedStreams& merged)
+    {
+        size_t chunkCount = chunks.size();
+        if(chunkCount == 1)
+        {
+            //nothing to offset, take the streams over as they are
+            merged.positions = std::move(chunks[0].positions);
+            merged.normals = std::move(chunks[0].normals);
+            merged.texcoords = std::move(chunks[0].texcoords);
+            merged.corners = std::move(chunks[0].corners);
+            merged.directives = std::move(chunks[0].directives);
+            std::vector<unsigned char>().swap(chunks[0].relative);
+            return;
+        }
+
+        std::vector<size_t> positionBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0);
+        std::vector<size_t> texcoordBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+
+        //exclusive prefix sums give every chunk its slot in the merged arrays
+        for(size_t i = 0; i < chunkCount; ++i)
+        {
+            positionBase[i + 1] = positionBase[i] + chunks[i].positions.size();
+            normalBase[i + 1] = normalBase[i] + chunks[i].normals.size();
+            texcoordBase[i + 1] = texcoordBase[i] + chunks[i].texcoords.size();
+            cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+        }
+
+        merged.positions.resize(positionBase[chunkCount]);
+        merged.normals.resize(normalBase[chunkCount]);
+        merged.texcoords.resize(texcoordBase[chunkCount]);
+        merged.corners.resize(cornerBase[chunkCount]);
+
+        runOnChunks(chunks, [&](Chunk& chunk, size_t i)
+        {
+            if(!chunk.positions.empty())
+                memcpy(&merged.positions[positionBase[i]], chunk.positions.data(), chunk.positions.size() * sizeof(float));
+            if(!chunk.normals.empty())
+                memcpy(&merged.normals[normalBase[i]], chunk.normals.data(), chunk.normals.size() * sizeof(float));
+            if(!chunk.texcoords.empty())
+                memcpy(&merged.texcoords[texcoordBase[i]], chunk.texcoords.data(), chunk.texcoords.size() * sizeof(float));
+
+            int vOffset = static_cast<int>(positionBase[i] / 3);
+            int vnOffset = static_cast<int>(normalBase[i] / 3);
+            int vtOffset = static_cast<int>(texcoordBase[i] / 2);
+            Corner* destination = merged.corners.data() + cornerBase[i];
+            for(size_t c = 0; c < chunk.corners.size(); ++c)
+            {
+                Corner corner = chunk.corners[c];
+                unsigned char relative = chunk.relative[c];
+                if(relative & V_RELATIVE) corner.v += vOffset;
+                if(relative & VT_RELATIVE) corner.vt += vtOffset;
+                if(relative & VN_RELATIVE) corner.vn += vnOffset;
+                destination[c] = corner;
+            }
+
+            std::vector<float>().swap(chunk.positions);
+            std::vector<float>().swap(chunk.normals);
+            std::vector<float>().swap(chunk.texcoords);
+            std::vector<Corner>().swap(chunk.corners);
+            std::vector<unsigned char>().swap(chunk.relative);
+        });
+
+        for(size_t i = 0; i < chunkCount; ++i)
+        {
+            for(Directive& directive : chunks[i].directives)
+            {
+                directive.triangle += cornerBase[i] / 3;
+                merged.directives.push_back(std::move(directive));
+            }
+        }
+    }
+
+    // -------------------------------------
+    // Output adaptors, the builder writes either tinyobj's layout or the interleaved MeshData Mesh uploads.
+    // -------------------------------------
+    inline void reserveTriangles(tinyobj::shape_t& shape, size_t triangleCount, size_t)
+    {
+        shape.mesh.indices.reserve(shape.mesh.indices.size() + triangleCount * 3);
+        shape.mesh.num_vertices.reserve(shape.mesh.num_vertices.size() + triangleCount);
+        shape.mesh.material_ids.reserve(shape.mesh.material_ids.size() + triangleCount);
+    }
+
+    inline void reserveTriangles(MeshData& mesh, size_t triangleCount, size_t positionCount)
+    {
+        mesh.indices.reserve(mesh.indices.size() + triangleCount * 3);
+        //most positions become exactly one vertex, leave a little room for seams so the vector doesn't double
+        mesh.vertexData.reserve(mesh.vertexData.size() + std::min(triangleCount * 3, positionCount + positionCount / 8));
+    }
+
+    inline std::vector<unsigned int>& indicesOf(tinyobj::shape_t& shape) { return shape.mesh.indices; }
+    inline std::vector<unsigned int>& indicesOf(MeshData& mesh) { return mesh.indices; }
+
+    inline void endTriangle(tinyobj::shape_t& shape, int materialId)
+    {
+        shape.mesh.num_vertices.push_back(3);
+        shape.mesh.material_ids.push_back(materialId);
+    }
+
+    inline void endTriangle(MeshData&, int) {}
+
+    inline unsigned int emitVertex(tinyobj::shape_t& shape, const MergedStreams& streams, const Corner& corner)
+    {
+        tinyobj::mesh_t& mesh = shape.mesh;
+        const float* position = &streams.positions[static_cast<size_t>(corner.v) * 3];
+        mesh.positions.insert(mesh.positions.end(), position, position + 3);
+        if(corner.vn != NO_INDEX)
+        {
+            const float* normal = &streams.normals[static_cast<size_t>(corner.vn) * 3];
+            mesh.normals.insert(mesh.normals.end(), normal, normal + 3);
+        }
+        if(corner.vt != NO_INDEX)
+        {
+            const float* texcoord = &streams.texcoords[static_cast<size_t>(corner.vt) * 2];
+            mesh.texcoords.insert(mesh.texcoords.end(), texcoord, texcoord + 2);
+        }
+        return static_cast<unsigned int>(mesh.positions.size() / 3 - 1);
+    }
+
+    inline unsigned int emitVertex(MeshData& mesh, const MergedStreams& streams, const Corner& corner)
+    {
+        mesh.vertexData.emplace_back();
+        VertexData& vertex = mesh.vertexData.back();
+        const float* position = &streams.positions[static_cast<size_t>(corner.v) * 3];
+        vertex.position = glm::vec3(position[0], position[1], position[2]);
+        if(corner.vn != NO_INDEX)
+        {
+            const float* normal = &streams.normals[static_cast<size_t>(corner.vn) * 3];
+            vertex.normal = glm::vec3(normal[0], normal[1], normal[2]);
+        }
+        if(corner.vt != NO_INDEX)
+        {
+            const float* texcoord = &streams.texcoords[static_cast<size_t>(corner.vt) * 2];
+            vertex.texCoord = glm::vec2(texcoord[0], texcoord[1]);
+        }
+        return static_cast<unsigned int>(mesh.vertexData.size() - 1);
+    }
+
+    /// Turns a run of triangles into an indexed mesh, a new vertex is emitted for every
+    /// v/vt/vn triple the first time it is referenced.
+    class ShapeBuilder
+    {
+    public:
+        explicit ShapeBuilder(const MergedStreams& _streams):
+        streams(_streams)
+        {
+            size_t vertexCount = streams.positions.size() / 3;
+            slot.resize(vertexCount);
+            stamp.resize(vertexCount, 0);
+            attributes.resize(vertexCount);
+        }
+
+        template <typename MESH>
+        bool exportTriangles(MESH& mesh, size_t firstTriangle, size_t lastTriangle, int materialId, std::string& err)
+        {
+            if(firstTriangle >= lastTriangle)
+                return true;
+
+            //every export starts with an empty vertex cache, like tinyobj's exportFaceGroupToShape
+            ++currentStamp;
+            overflow.clear();
+
+            size_t triangleCount = lastTriangle - firstTriangle;
+            reserveTriangles(mesh, triangleCount, slot.size());
+            std::vector<unsigned int>& indices = indicesOf(mesh);
+
+            const Corner* corners = streams.corners.data() + firstTriangle * 3;
+            for(size_t i = 0; i < triangleCount * 3; ++i)
+            {
+                Corner corner = corners[i];
+                if(corner.v < 0 || static_cast<size_t>(corner.v) >= slot.size())
+                {
+                    err += "Face references a vertex that does not exist.\n";
+                    return false;
+                }
+                if(corner.vt != NO_INDEX && (corner.vt < 0 || static_cast<size_t>(corner.vt) * 2 + 1 >= streams.texcoords.size()))
+                    corner.vt = NO_INDEX;
+                if(corner.vn != NO_INDEX && (corner.vn < 0 || static_cast<size_t>(corner.vn) * 3 + 2 >= streams.normals.size()))
+                    corner.vn = NO_INDEX;
+
+                unsigned int index;
+                if(stamp[corner.v] != currentStamp)
+                {
+                    stamp[corner.v] = currentStamp;
+                    attributes[corner.v] = std::make_pair(corner.vt, corner.vn);
+                    index = slot[corner.v] = emitVertex(mesh, streams, corner);
+                }
+                else if(attributes[corner.v].first == corner.vt && attributes[corner.v].second == corner.vn)
+                {
+                    index = slot[corner.v];
+                }
+                else
+                {
+                    //a position shared by vertices with different normals or uvs
+                    std::unordered_map<Corner, unsigned int, CornerHash>::iterator it = overflow.find(corner);
+                    if(it == overflow.end())
+                    {
+                        index = emitVertex(mesh, streams, corner);
+                        overflow.emplace(corner, index);
+                    }
+                    else
+                    {
+                        index = it->second;
+                    }
+                }
+                indices.push_back(index);
+
+                if(i % 3 == 2)
+                {
+                    endTriangle(mesh, materialId);
+                }
+            }
+            return true;
+        }
+
+    private:
+        const MergedStreams& streams;
+        std::vector<unsigned int> slot;
+        std::vector<unsigned int> stamp;
+        std::vector<std::pair<int, int>> attributes;
+        std::unordered_map<Corner, unsigned int, CornerHash> overflow;
+        unsigned int currentStamp = 0;
+    };
+
+    double secondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    template <typename MESH>
+    bool parseInto(const std::string& path,
+                   std::vector<MESH>& meshes,
+                   std::vector<tinyobj::material_t>& materials,
+                   std::string& err,
+                   ObjParser::Stats* stats)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+        Clock::time_point timestamp = Clock::now();
+
+        meshes.clear();
+
+        MappedFile file;
+        if(!file.open(path))
+        {
+            err += "Cannot open file [" + path + "]\n";
+            return false;
+        }
+
+        // -------------------------------------
+        // Split into line aligned chunks and parse them concurrently.
+        // -------------------------------------
+        unsigned int threads = ObjParser::threadCount != 0 ? ObjParser::threadCount : JobSystem::getInstance().size();
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, file.size() / ObjParser::MIN_CHUNK_SIZE));
+
+        std::vector<Chunk> chunks(chunkCount);
+        const char* chunkBegin = file.begin();
+        for(size_t i = 0; i < chunkCount; ++i)
+        {
+            const char* chunkEnd = file.end();
+            if(i + 1 < chunkCount)
+            {
+                chunkEnd = std::max(chunkBegin, file.begin() + file.size() * (i + 1) / chunkCount);
+                const char* newLine = static_cast<const char*>(memchr(chunkEnd, '\n', file.end() - chunkEnd));
+                chunkEnd = newLine != nullptr ? newLine + 1 : file.end();
+            }
+            chunks[i].begin = chunkBegin;
+            chunks[i].end = chunkEnd;
+            chunkBegin = chunkEnd;
+        }
+
+        runOnChunks(chunks, [&file](Chunk& chunk, size_t){ parseChunk(chunk, file); });
+
+        if(stats != nullptr)
+        {
+            stats->bytes = file.size();
+            stats->chunks = static_cast<unsigned int>(chunkCount);
+            stats->parseSeconds = secondsSince(timestamp);
+        }
+        timestamp = Clock::now();
+
+        // -------------------------------------
+        // Stitch the chunks together.
+        // -------------------------------------
+        MergedStreams streams;
+        merge(chunks, streams);
+        chunks.clear();
+        file.close();
+
+        if(stats != nullptr)
+        {
+            stats->mergeSeconds = secondsSince(timestamp);
+        }
+        timestamp = Clock::now();
+
+        // -------------------------------------
+        // Replay groups, objects and materials in file order to build the meshes.
+        // -------------------------------------
+        ShapeBuilder builder(streams);
+        tinyobj::MaterialFileReader materialReader("");
+        std::map<std::string, int> materialMap;
+
+        MESH mesh;
+        std::string name;
+        int material = -1;
+        size_t pendingTriangle = 0;
+
+        auto flush = [&](size_t triangle) -> bool
+        {
+            bool result = builder.exportTriangles(mesh, pendingTriangle, triangle, material, err);
+            if(triangle > pendingTriangle)
+                mesh.name = name;
+            pendingTriangle = triangle;
+            return result;
+        };
+
+        auto finishMesh = [&]()
+        {
+            if(!indicesOf(mesh).empty())
+                meshes.push_back(std::move(mesh));
+            mesh = MESH();
+        };
+
+        for(const Directive& directive : streams.directives)
+        {
+            switch(directive.type)
+            {
+                case DirectiveType::GROUP:
+                case DirectiveType::OBJECT:
+                {
+                    if(!flush(directive.triangle))
+                        return false;
+                    finishMesh();
+                    name = directive.name;
+                    break;
+                }
+                case DirectiveType::USE_MATERIAL:
+                {
+                    std::map<std::string, int>::const_iterator it = materialMap.find(directive.name);
+                    int newMaterial = it != materialMap.end() ? it->second : -1;
+                    if(newMaterial != material)
+                    {
+                        if(!flush(directive.triangle))
+                            return false;
+                        material = newMaterial;
+                    }
+                    break;
+                }
+                case DirectiveType::MATERIAL_LIBRARY:
+                {
+                    std::string materialErr;
+                    bool ok = materialReader(directive.name, materials, materialMap, materialErr);
+                    err += materialErr;
+                    if(!ok)
+                        return false;
+                    break;
+                }
+            }
+        }
+
+        if(!flush(streams.corners.size() / 3))
+            return false;
+        finishMesh();
+
+        if(stats != nullptr)
+        {
+            stats->buildSeconds = secondsSince(timestamp);
+        }
+
+        return true;
+    }
+}
+
+bool ObjParser::parse(const std::string& path,
+                      std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<tinyobj::material_t>& materials,
+                      std::string& err,
+                      Stats* stats)
+{
+    return parseInto(path, shapes, materials, err, stats);
+}
+
+bool ObjParser::parse(const std::string& path,
+                      std::vector<MeshData>& meshes,
+                      std::vector<tinyobj::material_t>& materials,
+                      std::string& err,
+                      Stats* stats)
+{
+    return parseInto(path, meshes, materials, err, stats);
+}
+
+MeshData ObjParser::toMeshData(const tinyobj::shape_t& shape)
+{
+    const tinyobj::mesh_t& mesh = shape.mesh;
+    size_t count = std::max(mesh.positions.size() / 3, std::max(mesh.normals.size() / 3, mesh.texcoords.size() / 2));
+
+    MeshData meshData;
+    meshData.name = shape.name;
+    meshData.indices = mesh.indices;
+    meshData.vertexData.resize(count);
+
+    for(size_t i = 0, j = 0; i + 2 < mesh.positions.size(); i += 3, ++j)
+    {
+        meshData.vertexData[j].position = glm::vec3(mesh.positions[i + 0], mesh.positions[i + 1], mesh.positions[i + 2]);
+    }
+
+    for(size_t i = 0, j = 0; i + 2 < mesh.normals.size(); i += 3, ++j)
+    {
+        meshData.vertexData[j].normal = glm::vec3(mesh.normals[i + 0], mesh.normals[i + 1], mesh.normals[i + 2]);
+    }
+
+    for(size_t i = 0, j = 0; i + 1 < mesh.texcoords.size(); i += 2, ++j)
+    {
+        meshData.vertexData[j].texCoord = glm::vec2(mesh.texcoords[i + 0], mesh.texcoords[i + 1]);
+    }
+    return meshData;
+}
+
+// -------------------------------------
+// Stream
+// -------------------------------------
+size_t ObjParser::Stream::chunkTriangles = 1 << 16;
+
+struct ObjParser::Stream::State
+{
+    MappedFile file;
+    const char* cursor = nullptr;
+    const char* released = nullptr;
+
+    //raw floats of the v, vt and vn lines written by open, faces index them like the file does
+    std::string spillPaths[3];
+    MappedFile spills[3];
+    const float* positions = nullptr;
+    const float* texcoords = nullptr;
+    const float* normals = nullptr;
+    size_t positionCount = 0, texcoordCount = 0, normalCount = 0; //read so far by next()
+
+    VertexFormat format;
+    size_t meshTriangles = 0; //triangles of the current mesh in the chunks already returned
+
+    //the chunk being built, kept to reuse the allocations
+    MeshData mesh;
+    std::unordered_map<Corner, unsigned int, CornerHash> vertexOf;
+};
+
+namespace
+{
+    enum SpillIndex
+    {
+        SPILL_POSITIONS,
+        SPILL_TEXCOORDS,
+        SPILL_NORMALS
+    };
+
+    const char* const SPILL_NAMES[] = { "v", "vt", "vn" };
+
+    //an empty file with a unique name in the temporary directory, so streams of one file or of read-only assets don't collide
+    bool createSpillFile(const char* name, std::string& pathOut)
+    {
+#ifndef _WIN32
+        const char* directory = std::getenv("TMPDIR");
+        std::string pattern = directory && *directory ? directory : "/tmp";
+        if(pattern.back() != '/')
+            pattern += '/';
+        pattern += std::string("obj-stream.") + name + ".XXXXXX";
+
+        std::vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        int descriptor = mkstemp(path.data());
+        if(descriptor < 0)
+            return false;
+        ::close(descriptor);
+        pathOut = path.data();
+        return true;
+#else
+        char path[L_tmpnam];
+        if(!std::tmpnam(path))
+            return false;
+        pathOut = path;
+        return true;
+#endif
+    }
+}
+
+ObjParser::Stream::Stream()
+{
+}
+
+ObjParser::Stream::~Stream()
+{
+    close();
+}
+
+bool ObjParser::Stream::open(const std::string& path, const VertexFormat& format, std::string& errOut)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    Clock::time_point timestamp = Clock::now();
+
+    close();
+    err.clear();
+    stats = Stats();
+
+    std::unique_ptr<State> opened(new State());
+    opened->format = format;
+    auto fail = [&](const std::string& message)
+    {
+        err += message;
+        errOut += message;
+        for(int i = 0; i < 3; ++i)
+        {
+            opened->spills[i].close();
+            if(!opened->spillPaths[i].empty())
+                std::remove(opened->spillPaths[i].c_str());
+        }
+        return false;
+    };
+
+    if(!opened->file.open(path))
+        return fail("Cannot open file [" + path + "]\n");
+
+    // -------------------------------------
+    // First pass, write the attributes out so the faces can look them up without keeping them in memory.
+    // -------------------------------------
+    std::ofstream writers[3];
+    std::vector<float> buffers[3];
+    const size_t FLUSH_FLOATS = 1 << 18;
+    for(int i = 0; i < 3; ++i)
+    {
+        if(!createSpillFile(SPILL_NAMES[i], opened->spillPaths[i]))
+            return fail(std::string("Cannot create the ") + SPILL_NAMES[i] + " spill file in the temporary directory\n");
+        writers[i].open(opened->spillPaths[i], std::ios::binary | std::ios::trunc);
+        if(!writers[i])
+            return fail("Cannot write spill file [" + opened->spillPaths[i] + "]\n");
+        buffers[i].reserve(FLUSH_FLOATS + 3);
+    }
+
+    auto flush = [&](int i)
+    {
+        writers[i].write(reinterpret_cast<const char*>(buffers[i].data()), static_cast<std::streamsize>(buffers[i].size() * sizeof(float)));
+        stats.spilledBytes += buffers[i].size() * sizeof(float);
+        buffers[i].clear();
+    };
+
+    ::Chunk whole; //the parser's chunk, only its range is used
+    whole.begin = opened->file.begin();
+    whole.end = opened->file.end();
+    forEachLine(whole, opened->file, [&](const char* s, const char* end)
+    {
+        s = skipSpaces(s, end);
+        if(end - s < 2 || s[0] != 'v')
+            return;
+
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        int spill;
+        if(isSpace(s[1]))
+        {
+            s = parseFloat(s + 2, end, x);
+            s = parseFloat(s, end, y);
+            parseFloat(s, end, z);
+            spill = SPILL_POSITIONS;
+            buffers[spill].insert(buffers[spill].end(), { x, y, z });
+        }
+        else if(s[1] == 't' && end - s > 2 && isSpace(s[2]))
+        {
+            s = parseFloat(s + 3, end, x);
+            parseFloat(s, end, y);
+            spill = SPILL_TEXCOORDS;
+            buffers[spill].insert(buffers[spill].end(), { x, y });
+        }
+        else if(s[1] == 'n' && end - s > 2 && isSpace(s[2]))
+        {
+            s = parseFloat(s + 3, end, x);
+            s = parseFloat(s, end, y);
+            parseFloat(s, end, z);
+            spill = SPILL_NORMALS;
+            buffers[spill].insert(buffers[spill].end(), { x, y, z });
+        }
+        else
+        {
+            return;
+        }
+
+        if(buffers[spill].size() >= FLUSH_FLOATS)
+            flush(spill);
+    });
+
+    for(int i = 0; i < 3; ++i)
+    {
+        flush(i);
+        writers[i].close();
+        if(!writers[i] || !opened->spills[i].open(opened->spillPaths[i]))
+            return fail("Cannot write spill file [" + opened->spillPaths[i] + "]\n");
+    }
+#ifndef _WIN32
+    //the mappings keep the data, unlinked now nothing is left behind if the process dies before close()
+    for(int i = 0; i < 3; ++i)
+    {
+        std::remove(opened->spillPaths[i].c_str());
+        opened->spillPaths[i].clear();
+    }
+#endif
+    opened->positions = reinterpret_cast<const float*>(opened->spills[SPILL_POSITIONS].begin());
+    opened->texcoords = reinterpret_cast<const float*>(opened->spills[SPILL_TEXCOORDS].begin());
+    opened->normals = reinterpret_cast<const float*>(opened->spills[SPILL_NORMALS].begin());
+
+    opened->cursor = opened->released = opened->file.begin();
+    opened->vertexOf.reserve(chunkTriangles * 3);
+    stats.bytes = opened->file.size();
+    stats.spillSeconds = secondsSince(timestamp);
+    state = std::move(opened);
+    return true;
+}
+
+bool ObjParser::Stream::next(Chunk& chunk)
+{
+    chunk.vertices.clear();
+    chunk.vertexCount = 0;
+    chunk.indices.clear();
+    chunk.boundsMin = chunk.boundsMax = glm::vec3(0.0f);
+    chunk.lastOfMesh = false;
+    if(!state)
+        return false;
+
+    State& st = *state;
+    st.mesh.vertexData.clear();
+    st.mesh.indices.clear();
+    st.vertexOf.clear();
+
+    //the vertex of corner in this chunk, corners repeated within the chunk share one
+    auto vertexOf = [&st](Corner corner, unsigned int& index) -> bool
+    {
+        if(corner.v < 0 || static_cast<size_t>(corner.v) >= st.positionCount)
+            return false;
+        if(corner.vt != NO_INDEX && (corner.vt < 0 || static_cast<size_t>(corner.vt) >= st.texcoordCount))
+            corner.vt = NO_INDEX;
+        if(corner.vn != NO_INDEX && (corner.vn < 0 || static_cast<size_t>(corner.vn) >= st.normalCount))
+            corner.vn = NO_INDEX;
+
+        auto inserted = st.vertexOf.emplace(corner, static_cast<unsigned int>(st.mesh.vertexData.size()));
+        if(inserted.second)
+        {
+            st.mesh.vertexData.emplace_back();
+            VertexData& vertex = st.mesh.vertexData.back();
+            const float* position = st.positions + static_cast<size_t>(corner.v) * 3;
+            vertex.position = glm::vec3(position[0], position[1], position[2]);
+            if(corner.vn != NO_INDEX)
+            {
+                const float* normal = st.normals + static_cast<size_t>(corner.vn) * 3;
+                vertex.normal = glm::vec3(normal[0], normal[1], normal[2]);
+            }
+            if(corner.vt != NO_INDEX)
+            {
+                const float* texcoord = st.texcoords + static_cast<size_t>(corner.vt) * 2;
+                vertex.texCoord = glm::vec2(texcoord[0], texcoord[1]);
+            }
+        }
+        index = inserted.first->second;
+        return true;
+    };
+
+    // -------------------------------------
+    // Second pass, one line at a time until the chunk is full or the mesh ends.
+    // -------------------------------------
+    const char* fileEnd = st.file.end();
+    bool lastOfMesh = false;
+    bool full = false;
+    while(st.cursor < fileEnd && !full && !lastOfMesh)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(st.cursor, '\n', fileEnd - st.cursor));
+        if(lineEnd == nullptr)
+            lineEnd = fileEnd;
+        const char* s = skipSpaces(st.cursor, lineEnd);
+        st.cursor = lineEnd < fileEnd ? lineEnd + 1 : fileEnd;
+
+        if(lineEnd - s < 2)
+            continue;
+
+        if(s[0] == 'v')
+        {
+            st.positionCount += isSpace(s[1]) ? 1 : 0;
+            st.texcoordCount += s[1] == 't' ? 1 : 0;
+            st.normalCount += s[1] == 'n' ? 1 : 0;
+        }
+        else if(s[0] == 'f' && isSpace(s[1]))
+        {
+            //polygons are fanned like parseLine does
+            s += 2;
+            Corner first, previous, current;
+            unsigned char relative = 0;
+            unsigned int firstIndex = 0, previousIndex = 0, currentIndex = 0;
+            int count = 0;
+            while(true)
+            {
+                while(s < lineEnd && (isSpace(*s) || *s == '\r')) ++s;
+                if(s >= lineEnd)
+                    break;
+
+                s = parseCorner(s, lineEnd, st.positionCount, st.texcoordCount, st.normalCount, current, relative);
+                if(!vertexOf(current, currentIndex))
+                {
+                    err += "Face references a vertex that does not exist.\n";
+                    close();
+                    return false;
+                }
+                if(count == 0)
+                {
+                    first = current;
+                    firstIndex = currentIndex;
+                }
+                else if(count >= 2)
+                {
+                    st.mesh.indices.push_back(firstIndex);
+                    st.mesh.indices.push_back(previousIndex);
+                    st.mesh.indices.push_back(currentIndex);
+                }
+                previous = current;
+                previousIndex = currentIndex;
+                ++count;
+            }
+            full = st.mesh.indices.size() / 3 >= chunkTriangles;
+        }
+        else if((s[0] == 'g' || s[0] == 'o') && isSpace(s[1]))
+        {
+            lastOfMesh = st.meshTriangles + st.mesh.indices.size() / 3 != 0;
+        }
+
+        if(static_cast<size_t>(st.cursor - st.released) >= RELEASE_WINDOW)
+        {
+            st.file.release(st.released, st.cursor);
+            st.released = st.cursor;
+        }
+    }
+
+    size_t triangles = st.mesh.indices.size() / 3;
+    if(st.cursor >= fileEnd)
+    {
+        st.file.release(st.released, fileEnd);
+        st.released = fileEnd;
+        if(triangles == 0 && st.meshTriangles == 0)
+            return false;
+        lastOfMesh = true;
+    }
+
+    if(triangles != 0)
+    {
+        MeshOptimizer::reorderForVertexCache(st.mesh.indices, st.mesh.vertexData.size());
+        MeshOptimizer::reorderVertexFetch(st.mesh);
+
+        chunk.boundsMin = chunk.boundsMax = st.mesh.vertexData.front().position;
+        for(const VertexData& vertex : st.mesh.vertexData)
+        {
+            chunk.boundsMin = glm::min(chunk.boundsMin, vertex.position);
+            chunk.boundsMax = glm::max(chunk.boundsMax, vertex.position);
+        }
+
+        chunk.vertexCount = st.mesh.vertexData.size();
+        VertexEncoder::encode(st.mesh.vertexData.data(), chunk.vertexCount, st.format, chunk.vertices);
+        std::swap(chunk.indices, st.mesh.indices);
+    }
+    chunk.lastOfMesh = lastOfMesh;
+    st.meshTriangles = lastOfMesh ? 0 : st.meshTriangles + triangles;
+
+    //the attribute pages this chunk touched are read again from the spill files if a later one needs them
+    for(MappedFile& spill : st.spills)
+        spill.release(spill.begin(), spill.end());
+
+    stats.vertices += chunk.vertexCount;
+    stats.triangles += triangles;
+    ++stats.chunks;
+    return true;
+}
+
+void ObjParser::Stream::close()
+{
+    if(!state)
+        return;
+
+    state->file.close();
+    for(int i = 0; i < 3; ++i)
+    {
+        state->spills[i].close();
+        if(!state->spillPaths[i].empty())
+            std::remove(state->spillPaths[i].c_str());
+    }
+    state.reset();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Utility/External/tiny_obj/tiny_obj_loader.h"
+#include "Shape/MeshData.h"
+#include "Shape/VertexFormat.h"
+
+/// <summary>
+/// Native .obj parser. The file is memory mapped, split into line aligned chunks that are parsed on
+/// worker threads, and the per chunk streams are stitched back together using prefix sums over the chunk counts.
+/// Produces the same tinyobj::shape_t layout tinyobj::LoadObj does (triangulated, one vertex per unique v/vt/vn triple).
+/// </summary>
+class ObjParser
+{
+public:
+    struct Stats
+    {
+        size_t bytes = 0;
+        unsigned int chunks = 0;
+        double parseSeconds = 0.0;
+        double mergeSeconds = 0.0;
+        double buildSeconds = 0.0;
+    };
+
+    /// <summary> Parses the .obj file at path (a full file system path). Returns false and fills err if the file could not be read. </summary>
+    static bool parse(const std::string& path,
+                      std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<tinyobj::material_t>& materials,
+                      std::string& err,
+                      Stats* stats = nullptr);
+
+    /// <summary> Same as above but builds the interleaved vertex and index buffers Mesh uploads directly, skipping tinyobj's layout. </summary>
+    static bool parse(const std::string& path,
+                      std::vector<MeshData>& meshes,
+                      std::vector<tinyobj::material_t>& materials,
+                      std::string& err,
+                      Stats* stats = nullptr);
+
+    /// <summary> Converts a shape in tinyobj's layout into MeshData, e.g. for shapes loaded by tinyobj::LoadObj. </summary>
+    static MeshData toMeshData(const tinyobj::shape_t& shape);
+
+    /// <summary> Chunks parsed in parallel on the JobSystem, 0 means one per thread of the JobSystem. </summary>
+    static unsigned int threadCount;
+
+    /// <summary> Files smaller than this are parsed on the calling thread. </summary>
+    static const size_t MIN_CHUNK_SIZE;
+
+    /// <summary>
+    /// Parses a file too large to hold in memory in fixed size pieces. open() reads the file once and spills the vertex
+    /// attributes to uniquely named files in $TMPDIR (or /tmp), next() then walks the faces and returns them in chunks of at most
+    /// chunkTriangles triangles, each with its own vertices packed in the stream's format and optimized for the vertex cache.
+    /// Memory use depends on chunkTriangles, not on the size of the file (where files can be memory mapped).
+    /// </summary>
+    class Stream
+    {
+    public:
+        struct Chunk
+        {
+            std::vector<unsigned char> vertices; // vertexCount vertices packed in the stream's format
+            size_t vertexCount = 0;
+            std::vector<unsigned int> indices; // into this chunk's vertices
+            glm::vec3 boundsMin = glm::vec3(0.0f);
+            glm::vec3 boundsMax = glm::vec3(0.0f);
+            bool lastOfMesh = false; // a group, an object or the end of the file follows, the next chunk starts a new mesh
+        };
+
+        struct Stats
+        {
+            size_t bytes = 0;
+            size_t spilledBytes = 0;
+            size_t vertices = 0;
+            size_t triangles = 0;
+            size_t chunks = 0;
+            double spillSeconds = 0.0;
+        };
+
+        Stream();
+        ~Stream();
+
+        /// <summary> Opens the .obj file at path (a full file system path) and spills its attributes. Returns false and fills err on failure. </summary>
+        bool open(const std::string& path, const VertexFormat& format, std::string& err);
+
+        /// <summary> Parses the next chunk. Returns false at the end of the file or when a face is invalid, see error(). </summary>
+        bool next(Chunk& chunk);
+
+        /// <summary> Unmaps the file and deletes the spill files. </summary>
+        void close();
+
+        inline bool isOpen() const { return state != nullptr; }
+        inline const std::string& error() const { return err; }
+        inline const Stats& getStats() const { return stats; }
+
+        /// <summary> Triangles per chunk, a polygon is never split so a chunk may exceed it by a few. </summary>
+        static size_t chunkTriangles;
+
+    private:
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        struct State;
+        std::unique_ptr<State> state;
+        std::string err;
+        Stats stats;
+    };
+};
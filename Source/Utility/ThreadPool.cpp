@@ -0,0 +1,73 @@
+#include "Utility/ThreadPool.h"
+#include "Utility/CpuProfiler.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if(threadCount == 0)
+    {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for(unsigned int i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        tasks.clear();
+    }
+    taskQueued.notify_all();
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskQueued.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return tasks.empty() && running == 0; });
+}
+
+void ThreadPool::work()
+{
+    CpuProfiler::getInstance().setThreadName("Thread pool");
+    while(true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskQueued.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if(stopping)
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            ++running;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            if(tasks.empty() && running == 0)
+                idle.notify_all();
+        }
+    }
+}
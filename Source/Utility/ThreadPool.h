@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of worker threads running queued tasks in the order they were queued.
+/// Tasks must not touch the GL context, results are handed back to the main thread by the caller.
+/// </summary>
+class ThreadPool
+{
+public:
+    /// <summary> Starts threadCount workers, 0 means one less than the hardware threads (at least one) to leave the main thread a core. </summary>
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    /// <summary> Drops the tasks that haven't started and waits for the running ones. </summary>
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void enqueue(std::function<void()> task);
+
+    /// <summary> Blocks until the queue is empty and no task is running. </summary>
+    void wait();
+
+    inline unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskQueued;
+    std::condition_variable idle;
+    unsigned int running = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,318 @@
+// Builds a Bvh over .obj files and measures build, refit and query speed, optionally checking every query against
+// brute force over all triangles.
+//
+// usage: bvh-benchmark [--threads N] [--queries N] [--verify] [file.obj ...]
+// Without files it uses the bundled dragon and buddha, run it from the repository root.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "Utility/Bvh.h"
+#include "Utility/ObjParser.h"
+
+namespace
+{
+    struct Model
+    {
+        std::vector<std::vector<glm::vec3>> positions;
+        std::vector<std::vector<unsigned int>> indices;
+        std::vector<Bvh::Geometry> geometry;
+    };
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool load(const std::string& path, Model& model)
+    {
+        std::vector<MeshData> meshes;
+        std::vector<tinyobj::material_t> materials;
+        std::string err;
+        if(!ObjParser::parse(path, meshes, materials, err))
+        {
+            printf("%s: %s", path.c_str(), err.c_str());
+            return false;
+        }
+
+        for(MeshData& mesh : meshes)
+        {
+            std::vector<glm::vec3> positions;
+            positions.reserve(mesh.vertexData.size());
+            for(const VertexData& vertex : mesh.vertexData)
+                positions.push_back(vertex.position);
+            model.positions.push_back(std::move(positions));
+            model.indices.push_back(std::move(mesh.indices));
+        }
+
+        for(size_t i = 0; i < model.positions.size(); ++i)
+        {
+            Bvh::Geometry geometry;
+            geometry.positions = model.positions[i].data();
+            geometry.vertexCount = model.positions[i].size();
+            geometry.indices = model.indices[i].data();
+            geometry.indexCount = model.indices[i].size();
+            model.geometry.push_back(geometry);
+        }
+        return true;
+    }
+
+    struct Queries
+    {
+        std::vector<glm::vec3> origins, directions;
+        std::vector<glm::vec3> boxMins, boxMaxs;
+        std::vector<glm::vec3> points;
+    };
+
+    //rays from a sphere around the model towards points inside it, voxel sized boxes and points in and around it
+    Queries makeQueries(const Bvh& bvh, size_t count)
+    {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        glm::vec3 center = (bvh.getBoundsMin() + bvh.getBoundsMax()) * 0.5f;
+        glm::vec3 size = bvh.getBoundsMax() - bvh.getBoundsMin();
+        float radius = glm::length(size);
+        auto inside = [&](float margin) { return center + (glm::vec3(unit(random), unit(random), unit(random)) - 0.5f) * size * margin; };
+
+        Queries queries;
+        for(size_t i = 0; i < count; ++i)
+        {
+            glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) - 0.5f);
+            glm::vec3 origin = center + direction * radius;
+            queries.origins.push_back(origin);
+            queries.directions.push_back(glm::normalize(inside(1.0f) - origin));
+
+            glm::vec3 boxCenter = inside(1.0f);
+            glm::vec3 halfSize = glm::vec3(glm::length(size) / 256.0f);
+            queries.boxMins.push_back(boxCenter - halfSize);
+            queries.boxMaxs.push_back(boxCenter + halfSize);
+
+            queries.points.push_back(inside(1.5f));
+        }
+        return queries;
+    }
+
+    bool bruteRaycast(const Bvh& bvh, const glm::vec3& origin, const glm::vec3& direction, float& closest)
+    {
+        closest = std::numeric_limits<float>::infinity();
+        for(const Bvh::Triangle& triangle : bvh.getTriangles())
+        {
+            glm::vec3 edge1 = triangle.v1 - triangle.v0, edge2 = triangle.v2 - triangle.v0;
+            glm::vec3 p = glm::cross(direction, edge2);
+            float determinant = glm::dot(edge1, p);
+            if(std::fabs(determinant) < 1e-12f)
+                continue;
+            glm::vec3 s = origin - triangle.v0;
+            float u = glm::dot(s, p) / determinant;
+            glm::vec3 q = glm::cross(s, edge1);
+            float v = glm::dot(direction, q) / determinant;
+            float t = glm::dot(edge2, q) / determinant;
+            if(u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f)
+                closest = std::min(closest, t);
+        }
+        return closest < std::numeric_limits<float>::infinity();
+    }
+
+    //only the triangle's bounds, every triangle Bvh::overlapBox returns must be among these
+    size_t bruteBoundsOverlap(const Bvh& bvh, const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<unsigned int>& triangles)
+    {
+        for(size_t i = 0; i < bvh.getTriangles().size(); ++i)
+        {
+            const Bvh::Triangle& triangle = bvh.getTriangles()[i];
+            glm::vec3 low = glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2));
+            glm::vec3 high = glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2));
+            if(glm::all(glm::lessThanEqual(low, boxMax)) && glm::all(glm::lessThanEqual(boxMin, high)))
+                triangles.push_back(static_cast<unsigned int>(i));
+        }
+        return triangles.size();
+    }
+
+    //a tree that is one big leaf tests every triangle
+    float bruteClosest(const Bvh& bvh, const glm::vec3& point)
+    {
+        std::vector<glm::vec3> corners;
+        std::vector<unsigned int> indices;
+        for(const Bvh::Triangle& triangle : bvh.getTriangles())
+        {
+            corners.push_back(triangle.v0);
+            corners.push_back(triangle.v1);
+            corners.push_back(triangle.v2);
+        }
+        for(size_t i = 0; i < corners.size(); ++i)
+            indices.push_back(static_cast<unsigned int>(i));
+
+        Bvh::Geometry geometry;
+        geometry.positions = corners.data();
+        geometry.vertexCount = corners.size();
+        geometry.indices = indices.data();
+        geometry.indexCount = indices.size();
+
+        unsigned int leafSize = Bvh::leafSize;
+        Bvh::leafSize = 0xFFFFFFFFu;
+        Bvh single;
+        single.build(std::vector<Bvh::Geometry>(1, geometry));
+        Bvh::leafSize = leafSize;
+
+        Bvh::Hit hit;
+        single.closestPoint(point, hit);
+        return hit.distance;
+    }
+
+    void printBuild(const char* label, const Bvh& bvh)
+    {
+        const Bvh::Stats& stats = bvh.getStats();
+        printf("  %-14s %8.1f ms, %zu nodes, %zu leaves, depth %u, SAH cost %.1f\n", label, stats.buildSeconds * 1000.0,
+               stats.nodes, stats.leaves, stats.depth, stats.sahCost);
+    }
+
+    void benchmarkQueries(const Bvh& bvh, const Queries& queries)
+    {
+        size_t count = queries.origins.size();
+        size_t hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < count; ++i)
+        {
+            Bvh::Hit hit;
+            hits += bvh.raycast(queries.origins[i], queries.directions[i], hit) ? 1 : 0;
+        }
+        double seconds = secondsSince(start);
+        printf("  raycast        %8.2f Mrays/s (%.0f%% hit)\n", count / seconds / 1e6, 100.0 * hits / count);
+
+        start = std::chrono::steady_clock::now();
+        hits = 0;
+        for(size_t i = 0; i < count; ++i)
+            hits += bvh.occluded(queries.origins[i], queries.directions[i]) ? 1 : 0;
+        seconds = secondsSince(start);
+        printf("  occluded       %8.2f Mrays/s\n", count / seconds / 1e6);
+
+        std::vector<unsigned int> triangles;
+        start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < count; ++i)
+            bvh.overlapBox(queries.boxMins[i], queries.boxMaxs[i], triangles);
+        seconds = secondsSince(start);
+        printf("  overlapBox     %8.2f Mqueries/s (%.1f triangles each)\n", count / seconds / 1e6, double(triangles.size()) / count);
+
+        start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < count; ++i)
+        {
+            Bvh::Hit hit;
+            bvh.closestPoint(queries.points[i], hit);
+        }
+        seconds = secondsSince(start);
+        printf("  closestPoint   %8.2f Mqueries/s\n", count / seconds / 1e6);
+    }
+
+    bool verify(const Bvh& bvh, const Queries& queries, size_t count)
+    {
+        size_t failures = 0;
+        count = std::min(count, queries.origins.size());
+        for(size_t i = 0; i < count; ++i)
+        {
+            Bvh::Hit hit;
+            float expected;
+            bool found = bvh.raycast(queries.origins[i], queries.directions[i], hit);
+            bool expectedFound = bruteRaycast(bvh, queries.origins[i], queries.directions[i], expected);
+            if(found != expectedFound || (found && std::fabs(hit.distance - expected) > 1e-4f * std::max(1.0f, expected)))
+                ++failures;
+            if(found != bvh.occluded(queries.origins[i], queries.directions[i]))
+                ++failures;
+
+            std::vector<unsigned int> triangles, candidates;
+            bvh.overlapBox(queries.boxMins[i], queries.boxMaxs[i], triangles);
+            bruteBoundsOverlap(bvh, queries.boxMins[i], queries.boxMaxs[i], candidates);
+            for(unsigned int triangle : triangles)
+                failures += std::binary_search(candidates.begin(), candidates.end(), triangle) ? 0 : 1;
+        }
+
+        //brute force closest point is slow, a few are enough
+        for(size_t i = 0; i < std::min<size_t>(count, 8); ++i)
+        {
+            Bvh::Hit hit;
+            bvh.closestPoint(queries.points[i], hit);
+            float expected = bruteClosest(bvh, queries.points[i]);
+            if(std::fabs(hit.distance - expected) > 1e-4f * std::max(1.0f, expected))
+                ++failures;
+        }
+
+        printf("  verify         %s (%zu queries against brute force)\n", failures == 0 ? "same results" : "FAILED", count);
+        return failures == 0;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    unsigned int threads = 0;
+    size_t queryCount = 200000;
+    bool check = false;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = static_cast<unsigned int>(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--queries") == 0 && i + 1 < argc)
+            queryCount = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--verify") == 0)
+            check = true;
+        else
+            files.push_back(argv[i]);
+    }
+
+    if(files.empty())
+    {
+        files.push_back("Assets/Models/dragon.obj");
+        files.push_back("Assets/Models/buddha.obj");
+    }
+
+    bool ok = true;
+    for(const std::string& file : files)
+    {
+        Model model;
+        if(!load(file, model))
+        {
+            ok = false;
+            continue;
+        }
+
+        Bvh bvh;
+        Bvh::threadCount = 1;
+        bvh.build(model.geometry);
+        printf("%s: %zu triangles\n", file.c_str(), bvh.getStats().triangles);
+        printBuild("build serial subtrees", bvh);
+
+        Bvh::threadCount = threads;
+        bvh.build(model.geometry);
+        printBuild("build parallel", bvh);
+
+        Queries queries = makeQueries(bvh, queryCount);
+        benchmarkQueries(bvh, queries);
+        if(check)
+            ok = verify(bvh, queries, 200) && ok;
+
+        //rigid motion of every mesh, then refit against a fresh build of the same transform
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.1f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < model.geometry.size(); ++i)
+            bvh.setTransform(i, transform);
+        bvh.refit();
+        double refitSeconds = secondsSince(start);
+
+        for(Bvh::Geometry& geometry : model.geometry)
+            geometry.transform = transform;
+        Bvh rebuilt;
+        rebuilt.build(model.geometry);
+        printf("  refit          %8.1f ms, SAH cost %.1f after refit, %.1f rebuilt\n", refitSeconds * 1000.0, bvh.sahCost(), rebuilt.getStats().sahCost);
+
+        if(check)
+            ok = verify(bvh, makeQueries(bvh, 200), 200) && ok;
+    }
+    return ok ? 0 : 1;
+}
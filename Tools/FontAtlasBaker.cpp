@@ -0,0 +1,307 @@
+// Bakes the signed distance field atlas TextQuad draws its text from, so the app starts with one texture upload instead
+// of FreeType rasterizing every glyph. Only this tool links FreeType, the app opens the committed atlas and shows no text
+// overlay without it, so bake and commit Assets/Fonts/overlay.fontatlas again after changing the font or the format.
+//
+// usage: font-atlas-baker [--size N] [--spread N] [--out file.fontatlas] [--preview file.pgm] [font.ttf|font.ttc]
+// Without a font it bakes DEFAULT_FONT, on macOS only.
+// Without --out it writes Assets/Fonts/overlay.fontatlas, run it from the repository root, the app loads it from there.
+// --size is the pixel height glyphs are baked at, 48 by default; any scale is drawn from it.
+// --spread is how far in pixels the distances reach past the outlines, 6 by default, more keeps small scales smooth.
+// --preview also writes the atlas as a grayscale PGM image to look at.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "Utility/FontAtlas.h"
+
+namespace
+{
+#if __APPLE__
+    // this font comes with MacOS X
+    const char* const DEFAULT_FONT = "/Library/Fonts/Devanagari Sangam MN.ttc";
+#else
+    const char* const DEFAULT_FONT = "";
+#endif
+
+    //glyphs are rendered this many times larger and the distances measured on the finer outline
+    const int OVERSAMPLE = 4;
+    const unsigned int ATLAS_WIDTH = 512;
+    const int GLYPH_PADDING = 1; // texels between quads, their borders are far outside of the outline already
+
+    //offset from a pixel to the nearest seed pixel found so far
+    struct Offset
+    {
+        int x, y;
+        inline int length2() const { return x * x + y * y; }
+    };
+
+    const int FAR = 1 << 14;
+
+    //two sweeps handing offsets on to the neighbors, 8SSEDT, off by a fraction of a pixel at worst
+    void propagate(std::vector<Offset>& grid, int width, int height)
+    {
+        auto compare = [&](int x, int y, int dx, int dy)
+        {
+            int nx = x + dx, ny = y + dy;
+            if(nx < 0 || ny < 0 || nx >= width || ny >= height)
+                return;
+            Offset candidate = grid[ny * width + nx];
+            candidate.x += dx;
+            candidate.y += dy;
+            Offset& current = grid[y * width + x];
+            if(candidate.length2() < current.length2())
+                current = candidate;
+        };
+
+        for(int y = 0; y < height; ++y)
+        {
+            for(int x = 0; x < width; ++x)
+            {
+                compare(x, y, -1, 0);
+                compare(x, y, 0, -1);
+                compare(x, y, -1, -1);
+                compare(x, y, 1, -1);
+            }
+            for(int x = width - 1; x >= 0; --x)
+                compare(x, y, 1, 0);
+        }
+        for(int y = height - 1; y >= 0; --y)
+        {
+            for(int x = width - 1; x >= 0; --x)
+            {
+                compare(x, y, 1, 0);
+                compare(x, y, 0, 1);
+                compare(x, y, -1, 1);
+                compare(x, y, 1, 1);
+            }
+            for(int x = 0; x < width; ++x)
+                compare(x, y, -1, 0);
+        }
+    }
+
+    //signed distance in pixels from every pixel's center to the outline, positive inside, from 8 bit coverage
+    void distanceField(const std::vector<unsigned char>& coverage, int width, int height, std::vector<float>& distances)
+    {
+        std::vector<Offset> toInside(coverage.size()), toOutside(coverage.size());
+        for(size_t i = 0; i < coverage.size(); ++i)
+        {
+            bool inside = coverage[i] >= 128;
+            toInside[i] = inside ? Offset{ 0, 0 } : Offset{ FAR, FAR };
+            toOutside[i] = inside ? Offset{ FAR, FAR } : Offset{ 0, 0 };
+        }
+        propagate(toInside, width, height);
+        propagate(toOutside, width, height);
+
+        //the outline runs between the centers of an inside and an outside pixel
+        distances.resize(coverage.size());
+        for(size_t i = 0; i < coverage.size(); ++i)
+        {
+            if(coverage[i] >= 128)
+                distances[i] = std::sqrt(static_cast<float>(toOutside[i].length2())) - 0.5f;
+            else
+                distances[i] = 0.5f - std::sqrt(static_cast<float>(toInside[i].length2()));
+        }
+    }
+
+    inline int floorDivide(int value, int divisor)
+    {
+        return static_cast<int>(std::floor(static_cast<float>(value) / divisor));
+    }
+
+    inline int ceilDivide(int value, int divisor)
+    {
+        return static_cast<int>(std::ceil(static_cast<float>(value) / divisor));
+    }
+
+    //renders the glyphs pixelSize pixels high with FreeType and turns them into distance fields reaching spread pixels from the outlines
+    bool bake(const std::string& fontPath, unsigned int pixelSize, unsigned int spread, FontAtlas& atlas, std::string& err)
+    {
+        if(fontPath.empty())
+        {
+            err += "No font to bake on this platform, pass one\n";
+            return false;
+        }
+
+        FT_Library library;
+        if(FT_Init_FreeType(&library) != 0)
+        {
+            err += "FreeType failed to initialize\n";
+            return false;
+        }
+        FT_Face face;
+        if(FT_New_Face(library, fontPath.c_str(), 0, &face) != 0)
+        {
+            FT_Done_FreeType(library);
+            err += "Cannot load font [" + fontPath + "]\n";
+            return false;
+        }
+        FT_Set_Pixel_Sizes(face, 0, pixelSize * OVERSAMPLE);
+
+        const int margin = static_cast<int>(spread);
+
+        //glyphs are packed left to right in rows as tall as their tallest glyph, the atlas grows downwards as rows are added
+        FontAtlas::Glyph glyphs[FontAtlas::GLYPHS];
+        std::vector<std::vector<unsigned char>> fields(FontAtlas::GLYPHS);
+        std::vector<unsigned char> coverage;
+        std::vector<float> distances;
+        int cursorX = GLYPH_PADDING, cursorY = GLYPH_PADDING, rowHeight = 0;
+        int atlasHeight = 0;
+        for(unsigned int c = 0; c < FontAtlas::GLYPHS; ++c)
+        {
+            //control characters would only draw the font's missing glyph box
+            FontAtlas::Glyph& glyph = glyphs[c];
+            if(c < ' ' || c == 127 || FT_Load_Char(face, c, FT_LOAD_RENDER) != 0)
+                continue;
+
+            const FT_GlyphSlot slot = face->glyph;
+            const FT_Bitmap& bitmap = slot->bitmap;
+            glyph.advance = static_cast<uint16_t>((slot->advance.x + OVERSAMPLE / 2) / OVERSAMPLE);
+            int bitmapWidth = static_cast<int>(bitmap.width), bitmapRows = static_cast<int>(bitmap.rows);
+            if(bitmapWidth == 0 || bitmapRows == 0)
+                continue;
+
+            //the quad in pixels of the baked size, around the fine bitmap plus the spread, y up from the baseline
+            int left = floorDivide(slot->bitmap_left, OVERSAMPLE) - margin;
+            int right = ceilDivide(slot->bitmap_left + bitmapWidth, OVERSAMPLE) + margin;
+            int top = ceilDivide(slot->bitmap_top, OVERSAMPLE) + margin;
+            int bottom = floorDivide(slot->bitmap_top - bitmapRows, OVERSAMPLE) - margin;
+            int quadWidth = right - left, quadHeight = top - bottom;
+
+            //the fine bitmap placed into the quad at OVERSAMPLE times its resolution
+            int fineWidth = quadWidth * OVERSAMPLE, fineHeight = quadHeight * OVERSAMPLE;
+            int offsetX = slot->bitmap_left - left * OVERSAMPLE;
+            int offsetY = top * OVERSAMPLE - slot->bitmap_top;
+            coverage.assign(static_cast<size_t>(fineWidth) * fineHeight, 0);
+            for(int row = 0; row < bitmapRows; ++row)
+            {
+                const unsigned char* source = bitmap.buffer + row * bitmap.pitch;
+                std::copy(source, source + bitmapWidth, coverage.begin() + (offsetY + row) * fineWidth + offsetX);
+            }
+            distanceField(coverage, fineWidth, fineHeight, distances);
+
+            //a texel takes the distance at its center, between the four fine pixels in the middle of it
+            std::vector<unsigned char>& field = fields[c];
+            field.resize(static_cast<size_t>(quadWidth) * quadHeight);
+            int middle = OVERSAMPLE / 2;
+            for(int y = 0; y < quadHeight; ++y)
+            {
+                for(int x = 0; x < quadWidth; ++x)
+                {
+                    int fineX = x * OVERSAMPLE + middle, fineY = y * OVERSAMPLE + middle;
+                    float distance = 0.25f * (distances[(fineY - 1) * fineWidth + fineX - 1] + distances[(fineY - 1) * fineWidth + fineX] +
+                                              distances[fineY * fineWidth + fineX - 1] + distances[fineY * fineWidth + fineX]) / OVERSAMPLE;
+                    float value = std::min(std::max(0.5f + distance / (2.0f * std::max(spread, 1u)), 0.0f), 1.0f);
+                    field[y * quadWidth + x] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+                }
+            }
+
+            if(quadWidth + 2 * GLYPH_PADDING > static_cast<int>(ATLAS_WIDTH))
+            {
+                FT_Done_Face(face);
+                FT_Done_FreeType(library);
+                err += "Glyphs too large for the atlas, bake a smaller size\n";
+                return false;
+            }
+            if(cursorX + quadWidth + GLYPH_PADDING > static_cast<int>(ATLAS_WIDTH))
+            {
+                cursorX = GLYPH_PADDING;
+                cursorY += rowHeight + GLYPH_PADDING;
+                rowHeight = 0;
+            }
+            glyph.x = static_cast<uint16_t>(cursorX);
+            glyph.y = static_cast<uint16_t>(cursorY);
+            glyph.width = static_cast<uint16_t>(quadWidth);
+            glyph.height = static_cast<uint16_t>(quadHeight);
+            glyph.left = static_cast<int16_t>(left);
+            glyph.top = static_cast<int16_t>(top);
+            cursorX += quadWidth + GLYPH_PADDING;
+            rowHeight = std::max(rowHeight, quadHeight);
+            atlasHeight = std::max(atlasHeight, cursorY + quadHeight + GLYPH_PADDING);
+        }
+        FT_Done_Face(face);
+        FT_Done_FreeType(library);
+
+        unsigned int width = ATLAS_WIDTH;
+        unsigned int height = static_cast<unsigned int>(std::max(atlasHeight, 1));
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * height, 0);
+        for(unsigned int c = 0; c < FontAtlas::GLYPHS; ++c)
+        {
+            const FontAtlas::Glyph& glyph = glyphs[c];
+            for(int y = 0; y < glyph.height; ++y)
+                std::copy(fields[c].begin() + y * glyph.width, fields[c].begin() + (y + 1) * glyph.width, pixels.begin() + (glyph.y + y) * width + glyph.x);
+        }
+        atlas.assign(width, height, pixelSize, spread, glyphs, std::move(pixels));
+        return true;
+    }
+
+    bool writePreview(const FontAtlas& atlas, const std::string& path)
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        if(file == nullptr)
+            return false;
+        fprintf(file, "P5\n%u %u\n255\n", atlas.getWidth(), atlas.getHeight());
+        fwrite(atlas.getPixels(), 1, static_cast<size_t>(atlas.getWidth()) * atlas.getHeight(), file);
+        return fclose(file) == 0;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::string font = DEFAULT_FONT;
+    std::string out = std::string("Assets/Fonts/overlay.fontatlas");
+    std::string preview;
+    unsigned int size = 48;
+    unsigned int spread = 6;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = static_cast<unsigned int>(std::max(4, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--spread") == 0 && i + 1 < argc)
+            spread = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if(strcmp(argv[i], "--preview") == 0 && i + 1 < argc)
+            preview = argv[++i];
+        else if(argv[i][0] == '-')
+        {
+            printf("unknown argument %s, see the top of FontAtlasBaker.cpp\n", argv[i]);
+            return 1;
+        }
+        else
+            font = argv[i];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    FontAtlas atlas;
+    std::string err;
+    if(!bake(font, size, spread, atlas, err) || !atlas.write(out, err))
+    {
+        fprintf(stderr, "%s", err.c_str());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned int glyphs = 0;
+    for(unsigned int c = 0; c < FontAtlas::GLYPHS; ++c)
+        glyphs += atlas.getGlyph(c).width != 0 ? 1 : 0;
+    printf("%s: %u glyphs at %u pixels, spread %u, into a %ux%u atlas in %.2f s\n", font.c_str(), glyphs, size, spread,
+           atlas.getWidth(), atlas.getHeight(), seconds);
+    printf("wrote %s\n", out.c_str());
+
+    if(!preview.empty() && !writePreview(atlas, preview))
+    {
+        fprintf(stderr, "Cannot write [%s]\n", preview.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,390 @@
+// Renders a scene without a window along a fixed camera path and writes the CPU and GPU time of every pass as JSON,
+// for comparing commits and machines with the same settings.
+//
+// usage: headless-benchmark [--scene glass|cornell|dragon|multiple] [--width N] [--height N] [--voxels 16|32|64]
+//                           [--mode cone|voxels] [--replay file] [--frames N] [--warmup N] [--software] [--cd dir]
+//                           [--out file.json] [--max-allocations N]
+// The camera follows the scene's fly-through, or with --replay a recording made in the app with F5, see InputReplay.
+// Without --frames it measures until the fly-through or recording ends.
+// Resources are read from ../Resources like the app does, --cd changes to a directory where that resolves first.
+// --software asks for Apple's software renderer on macOS and for Mesa's llvmpipe elsewhere, for machines without a GPU.
+// --max-allocations fails the run, exit code 1, if a measured frame made more heap allocations, see AllocationTracker;
+// --max-allocations 0 checks that a steady frame doesn't allocate at all.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "OpenGL_Includes.h"
+#include "Graphic/Graphics.h"
+#include "Graphic/GpuProfiler.h"
+#include "Graphic/OffscreenContext.h"
+#include "Graphic/Camera/Controllers/InputReplay.h"
+#include "Graphic/Material/MaterialStore.h"
+#include "Graphic/Material/Voxelization/VoxelizationMaterial.h"
+#include "Scene/ScenePack.h"
+#include "Scene/SceneGraph.h"
+#include "Scene/SceneSnapshot.h"
+#include "Time/FrameRate.h"
+#include "Utility/AllocationTracker.h"
+#include "Utility/AssetLoader.h"
+#include "Utility/CpuProfiler.h"
+
+namespace
+{
+    struct Settings
+    {
+        std::string scene = "glass";
+        unsigned int width = 1024;
+        unsigned int height = 768;
+        unsigned int voxels = VoxelizationMaterial::voxelTextureDimensions;
+        std::string mode = "cone";
+        std::string replay; // recording to play instead of the fly-through
+        unsigned int frames = 0; // 0 is as long as the camera moves
+        unsigned int warmup = 30;
+        bool software = false;
+        std::string out = "headless-benchmark.json";
+        long long maxAllocations = -1; // per measured frame, -1 doesn't check
+    };
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct Statistics
+    {
+        double mean = 0.0, median = 0.0, min = 0.0, max = 0.0;
+    };
+
+    Statistics statistics(std::vector<double> values)
+    {
+        Statistics result;
+        if(values.empty())
+            return result;
+        std::sort(values.begin(), values.end());
+        for(double value : values)
+            result.mean += value;
+        result.mean /= values.size();
+        result.median = values[values.size() / 2];
+        result.min = values.front();
+        result.max = values.back();
+        return result;
+    }
+
+    void writeStatistics(FILE* file, const Statistics& value)
+    {
+        fprintf(file, "{\"mean\": %.4f, \"median\": %.4f, \"min\": %.4f, \"max\": %.4f}", value.mean, value.median, value.min, value.max);
+    }
+
+    std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for(char c : text)
+        {
+            if(c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    struct Result
+    {
+        std::string renderer;
+        std::vector<double> frameMilliseconds, updateMilliseconds, snapshotMilliseconds, renderMilliseconds;
+        std::vector<double> frameAllocations, frameAllocatedBytes; // of every thread
+        std::vector<CpuProfiler::ScopeTotal> cpuScopes;
+        std::vector<GpuProfiler::FrameTimes> gpuFrames;
+        size_t droppedGpuFrames = 0;
+    };
+
+    bool writeJson(const Settings& settings, const Result& result)
+    {
+        FILE* file = fopen(settings.out.c_str(), "w");
+        if(file == nullptr)
+            return false;
+
+        size_t frames = std::max<size_t>(result.frameMilliseconds.size(), 1);
+        fprintf(file, "{\n  \"config\": {\"scene\": \"%s\", \"width\": %u, \"height\": %u, \"voxels\": %u, \"mode\": \"%s\", \"camera\": \"%s\", \"frames\": %zu, \"warmup\": %u, \"software\": %s},\n",
+                settings.scene.c_str(), settings.width, settings.height, settings.voxels, settings.mode.c_str(),
+                settings.replay.empty() ? "fly-through" : escape(settings.replay).c_str(), result.frameMilliseconds.size(), settings.warmup,
+                settings.software ? "true" : "false");
+        fprintf(file, "  \"renderer\": \"%s\",\n", escape(result.renderer).c_str());
+
+        //wall time per frame including glFinish, so it covers the GPU too
+        fprintf(file, "  \"cpu\": {\n    \"frame\": ");
+        writeStatistics(file, statistics(result.frameMilliseconds));
+        fprintf(file, ",\n    \"update\": ");
+        writeStatistics(file, statistics(result.updateMilliseconds));
+        fprintf(file, ",\n    \"snapshot\": ");
+        writeStatistics(file, statistics(result.snapshotMilliseconds));
+        fprintf(file, ",\n    \"render\": ");
+        writeStatistics(file, statistics(result.renderMilliseconds));
+        fprintf(file, ",\n    \"scopes\": [");
+        for(size_t i = 0; i < result.cpuScopes.size(); ++i)
+        {
+            const CpuProfiler::ScopeTotal& scope = result.cpuScopes[i];
+            fprintf(file, "%s\n      {\"name\": \"%s\", \"callsPerFrame\": %.2f, \"millisecondsPerFrame\": %.4f}", i == 0 ? "" : ",",
+                    escape(scope.name).c_str(), static_cast<double>(scope.calls) / frames, scope.milliseconds / frames);
+        }
+        fprintf(file, "\n    ]\n  },\n");
+
+        fprintf(file, "  \"allocations\": {\n    \"tracking\": %s,\n    \"perFrame\": ", AllocationTracker::isTracking() ? "true" : "false");
+        writeStatistics(file, statistics(result.frameAllocations));
+        fprintf(file, ",\n    \"bytesPerFrame\": ");
+        writeStatistics(file, statistics(result.frameAllocatedBytes));
+        fprintf(file, ",\n    \"framesAllocating\": %zu\n  },\n",
+                static_cast<size_t>(std::count_if(result.frameAllocations.begin(), result.frameAllocations.end(), [](double count) { return count > 0.0; })));
+
+        //passes keyed by name and depth in the order they first ran, frames missing one count as 0 for it
+        std::vector<std::pair<std::string, unsigned int>> order;
+        std::map<std::pair<std::string, unsigned int>, std::vector<double>> passes;
+        for(const GpuProfiler::FrameTimes& frame : result.gpuFrames)
+        {
+            for(const GpuProfiler::Pass& pass : frame.passes)
+            {
+                auto key = std::make_pair(std::string(pass.name), pass.depth);
+                std::vector<double>& values = passes[key];
+                if(values.empty())
+                    order.push_back(key);
+                values.push_back(pass.milliseconds);
+            }
+        }
+
+        fprintf(file, "  \"gpu\": {\n    \"frames\": %zu,\n    \"droppedFrames\": %zu,\n    \"passes\": [", result.gpuFrames.size(), result.droppedGpuFrames);
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            std::vector<double> values = passes[order[i]];
+            values.resize(result.gpuFrames.size(), 0.0);
+            fprintf(file, "%s\n      {\"name\": \"%s\", \"depth\": %u, \"milliseconds\": ", i == 0 ? "" : ",", escape(order[i].first).c_str(), order[i].second);
+            writeStatistics(file, statistics(values));
+            fprintf(file, "}");
+        }
+        fprintf(file, "\n    ]\n  }\n}\n");
+        return fclose(file) == 0;
+    }
+
+    void printStatistics(const char* name, const std::vector<double>& values)
+    {
+        Statistics value = statistics(values);
+        printf("  %-14s %8.3f ms mean, %8.3f median, %8.3f min, %8.3f max\n", name, value.mean, value.median, value.min, value.max);
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    Settings settings;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            settings.scene = argv[++i];
+        else if(strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            settings.width = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            settings.height = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--voxels") == 0 && i + 1 < argc)
+            settings.voxels = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+            settings.mode = argv[++i];
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            settings.replay = argv[++i];
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            settings.frames = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            settings.warmup = static_cast<unsigned int>(std::max(0, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--software") == 0)
+            settings.software = true;
+        else if(strcmp(argv[i], "--cd") == 0 && i + 1 < argc)
+        {
+            if(chdir(argv[++i]) != 0)
+            {
+                printf("can't change to %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            settings.out = argv[++i];
+        else if(strcmp(argv[i], "--max-allocations") == 0 && i + 1 < argc)
+            settings.maxAllocations = std::max(0LL, atoll(argv[++i]));
+        else
+        {
+            printf("unknown argument %s, see the top of HeadlessBenchmark.cpp\n", argv[i]);
+            return 1;
+        }
+    }
+
+    //the cone tracing shader samples NUM_MIP_MAPS levels, more voxels than 64 would need a shader change
+    if(settings.voxels > 64 || (settings.voxels & (settings.voxels - 1)) != 0)
+    {
+        printf("--voxels must be a power of two up to 64\n");
+        return 1;
+    }
+    if(settings.mode != "cone" && settings.mode != "voxels")
+    {
+        printf("--mode is cone or voxels\n");
+        return 1;
+    }
+    if(settings.maxAllocations >= 0 && !AllocationTracker::isTracking())
+    {
+        printf("--max-allocations needs ALLOCATION_TRACKING, see AllocationTracker.h\n");
+        return 1;
+    }
+    Graphics::RenderingMode mode = settings.mode == "cone" ? Graphics::RenderingMode::VOXEL_CONE_TRACING : Graphics::RenderingMode::VOXELIZATION_VISUALIZATION;
+
+    std::unique_ptr<Scene> scene(createStockScene(settings.scene));
+    if(!scene)
+    {
+        printf("unknown scene %s, one of glass, cornell, dragon, multiple\n", settings.scene.c_str());
+        return 1;
+    }
+
+    CpuProfiler::getInstance().setThreadName("Main");
+    OffscreenContext context;
+    if(!context.create(settings.width, settings.height, settings.software))
+    {
+        printf("no offscreen context: %s\n", context.getError().c_str());
+        return 1;
+    }
+
+    Result result;
+    result.renderer = context.getRenderer();
+    printf("%s, %ux%u, %u voxels, %s, %s\n", settings.scene.c_str(), settings.width, settings.height, settings.voxels, settings.mode.c_str(),
+           result.renderer.c_str());
+
+    VoxelizationMaterial::voxelTextureDimensions = settings.voxels;
+    MaterialStore::getInstance();
+    std::unique_ptr<Graphics> graphics(new Graphics());
+    graphics->init(settings.width, settings.height);
+    scene->init(settings.width, settings.height);
+
+    //every model is resident before the first frame, streaming would make the first frames cheaper than the rest
+    AssetLoader::getInstance().finish();
+    FrameRate::initialized = true;
+    size_t droppedWarmupFrames = 0;
+
+    //the warmup frames look from the scene's own camera, the measured ones follow the path
+    InputReplay& replay = InputReplay::getInstance();
+    SceneSnapshot snapshot;
+    for(unsigned int frame = 0; ; ++frame)
+    {
+        bool measured = frame >= settings.warmup;
+        if(frame == settings.warmup)
+        {
+            bool started = settings.replay.empty() ? replay.startFlyThrough(scene->getFlyThrough()) : replay.startPlayback(settings.replay);
+            if(!started)
+            {
+                printf(settings.replay.empty() ? "the scene has no fly-through\n" : "can't read %s\n", settings.replay.c_str());
+                return 1;
+            }
+            unsigned int frames = settings.frames != 0 ? settings.frames : static_cast<unsigned int>(replay.getLength());
+            GpuProfiler::historyFrames = frames;
+            //the results of a frame are stored without allocating, so only the frame itself is counted
+            for(std::vector<double>* values : { &result.frameMilliseconds, &result.updateMilliseconds, &result.snapshotMilliseconds,
+                                                &result.renderMilliseconds, &result.frameAllocations, &result.frameAllocatedBytes })
+                values->reserve(frames);
+
+            GpuProfiler::getInstance().finish();
+            droppedWarmupFrames = GpuProfiler::getInstance().getDroppedFrames();
+            CpuProfiler::getInstance().beginCapture();
+        }
+        if(measured && (settings.frames != 0 ? result.frameMilliseconds.size() == settings.frames : !replay.isDeterministic()))
+            break;
+
+        //a fixed step per frame, the scenes animate the same way on every machine
+        AllocationTracker::Counts allocationsBefore = AllocationTracker::getTotal();
+        auto start = std::chrono::steady_clock::now();
+        FrameRate::deltaTime = replay.getTimestep();
+        FrameRate::time = measured ? replay.getFrame() * replay.getTimestep() : 0.0;
+        FrameRate::framesPerSecond = 1.0 / FrameRate::deltaTime;
+        {
+            PROFILE_SCOPE("HeadlessBenchmark update");
+            scene->update();
+            SceneGraph::getInstance().update();
+            replay.endFrame();
+        }
+        double updateSeconds = secondsSince(start);
+
+        auto snapshotStart = std::chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("HeadlessBenchmark snapshot");
+            snapshot.capture(*scene);
+        }
+        double snapshotSeconds = secondsSince(snapshotStart);
+
+        auto renderStart = std::chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("HeadlessBenchmark render");
+            GpuProfiler::getInstance().beginFrame();
+            graphics->render(snapshot, settings.width, settings.height, mode);
+            GpuProfiler::getInstance().endFrame();
+            AssetLoader::getInstance().update();
+
+            //nothing is presented, without waiting the driver would queue frames and the CPU times would say nothing
+            glFinish();
+        }
+        double renderSeconds = secondsSince(renderStart);
+        CpuProfiler::getInstance().frameEnded();
+        AllocationTracker::Counts allocations = AllocationTracker::getTotal() - allocationsBefore;
+
+        if(measured)
+        {
+            result.frameAllocations.push_back(static_cast<double>(allocations.allocations));
+            result.frameAllocatedBytes.push_back(static_cast<double>(allocations.bytes));
+            result.frameMilliseconds.push_back(secondsSince(start) * 1000.0);
+            result.updateMilliseconds.push_back(updateSeconds * 1000.0);
+            result.snapshotMilliseconds.push_back(snapshotSeconds * 1000.0);
+            result.renderMilliseconds.push_back(renderSeconds * 1000.0);
+        }
+    }
+
+    CpuProfiler::getInstance().endCapture("", &result.cpuScopes);
+    GpuProfiler::getInstance().finish();
+    for(GpuProfiler::FrameTimes& frame : GpuProfiler::getInstance().getHistory())
+    {
+        if(frame.number >= settings.warmup)
+            result.gpuFrames.push_back(std::move(frame));
+    }
+    result.droppedGpuFrames = GpuProfiler::getInstance().getDroppedFrames() - droppedWarmupFrames;
+
+    printStatistics("frame", result.frameMilliseconds);
+    printStatistics("update", result.updateMilliseconds);
+    printStatistics("snapshot", result.snapshotMilliseconds);
+    printStatistics("render", result.renderMilliseconds);
+    printf("  %zu GPU frames read back, %zu dropped\n", result.gpuFrames.size(), result.droppedGpuFrames);
+    Statistics allocations = statistics(result.frameAllocations);
+    printf("  %-14s %8.1f per frame mean, %8.1f median, %8.0f min, %8.0f max\n", "allocations", allocations.mean, allocations.median,
+           allocations.min, allocations.max);
+
+    bool written = writeJson(settings, result);
+    printf("%s %s\n", written ? "wrote" : "can't write", settings.out.c_str());
+
+    //the measured frames over the limit, the first few by their index after the warmup
+    size_t overLimit = 0;
+    for(size_t i = 0; settings.maxAllocations >= 0 && i < result.frameAllocations.size(); ++i)
+    {
+        if(result.frameAllocations[i] <= static_cast<double>(settings.maxAllocations))
+            continue;
+        if(++overLimit <= 10)
+            printf("  frame %zu made %.0f heap allocations of %.0f bytes, over --max-allocations %lld\n", i, result.frameAllocations[i],
+                   result.frameAllocatedBytes[i], settings.maxAllocations);
+    }
+    if(overLimit != 0)
+        printf("%zu of %zu measured frames allocated more than %lld times\n", overLimit, result.frameAllocations.size(), settings.maxAllocations);
+
+    //the GL objects go before the context, the meshes only the store and the loader hold too
+    GpuProfiler::getInstance().clear();
+    scene.reset();
+    graphics.reset();
+    AssetLoader::getInstance().clear();
+    AssetStore::getInstance().clear();
+    context.destroy();
+    return written && overLimit == 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+// Pre-builds the binary MeshCache for .obj models so the first launch doesn't have to parse them.
+//
+// usage: mesh-cache-builder [--force] [--format compact|full] [--no-optimize] [directory | file.obj ...]
+// Without arguments it processes Assets/Models, run it from the repository root.
+// Caches that are still up to date are skipped unless --force is given. The vertex format has to match
+// Mesh::defaultVertexFormat, otherwise the application rebuilds the cache on load; compact is the default.
+// Meshes go through MeshOptimizer like they do at load time (including levels of detail and meshlets), the vertex cache
+// statistics are printed per model.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "Utility/MeshCache.h"
+#include "Utility/MeshOptimizer.h"
+#include "Utility/ObjParser.h"
+
+namespace
+{
+    bool hasObjExtension(const std::string& path)
+    {
+        static const std::string EXTENSION = ".obj";
+        if(path.size() < EXTENSION.size())
+            return false;
+        std::string extension = path.substr(path.size() - EXTENSION.size());
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == EXTENSION;
+    }
+
+    void collectModels(const std::string& path, std::vector<std::string>& models)
+    {
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0)
+        {
+            fprintf(stderr, "Cannot find '%s'\n", path.c_str());
+            return;
+        }
+
+        if(!S_ISDIR(info.st_mode))
+        {
+            models.push_back(path);
+            return;
+        }
+
+        DIR* directory = opendir(path.c_str());
+        if(directory == nullptr)
+            return;
+
+        std::vector<std::string> found;
+        while(dirent* entry = readdir(directory))
+        {
+            std::string name = entry->d_name;
+            if(hasObjExtension(name))
+                found.push_back(path + "/" + name);
+        }
+        closedir(directory);
+
+        std::sort(found.begin(), found.end());
+        models.insert(models.end(), found.begin(), found.end());
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bool force = false;
+    bool optimize = true;
+    VertexFormat format = VertexFormat::Compact();
+    std::vector<std::string> inputs;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--force") == 0)
+            force = true;
+        else if(strcmp(argv[i], "--no-optimize") == 0)
+            optimize = false;
+        else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if(strcmp(name, "compact") == 0)
+                format = VertexFormat::Compact();
+            else if(strcmp(name, "full") == 0)
+                format = VertexFormat::Full();
+            else
+            {
+                fprintf(stderr, "Unknown vertex format '%s', expected compact or full\n", name);
+                return 1;
+            }
+        }
+        else
+            inputs.push_back(argv[i]);
+    }
+
+    if(inputs.empty())
+        inputs.push_back("Assets/Models");
+
+    std::vector<std::string> models;
+    for(const std::string& input : inputs)
+        collectModels(input, models);
+
+    int failures = 0;
+    for(const std::string& model : models)
+    {
+        MeshCache existing;
+        if(!force && existing.open(model, format))
+        {
+            printf("%-40s up to date\n", model.c_str());
+            continue;
+        }
+        existing.close();
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<MeshData> meshData;
+        std::vector<tinyobj::material_t> materials;
+        std::string err;
+        if(!ObjParser::parse(model, meshData, materials, err) || meshData.empty())
+        {
+            fprintf(stderr, "%-40s failed\n%s", model.c_str(), err.c_str());
+            ++failures;
+            continue;
+        }
+
+        MeshOptimizer::Report report;
+        if(optimize)
+            MeshOptimizer::optimize(meshData, &report);
+
+        if(!MeshCache::write(model, meshData, format, err))
+        {
+            fprintf(stderr, "%-40s failed\n%s", model.c_str(), err.c_str());
+            ++failures;
+            continue;
+        }
+
+        size_t vertices = 0, triangles = 0;
+        for(const MeshData& mesh : meshData)
+        {
+            vertices += mesh.vertexData.size();
+            triangles += (mesh.lods.empty() ? mesh.indices.size() : mesh.lods.front().indexCount) / 3;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        printf("%-40s %zu meshes, %zu vertices (%u bytes each), %zu triangles, %.3fs\n", model.c_str(), meshData.size(), vertices, format.stride(), triangles, seconds);
+        if(optimize)
+        {
+            printf("%-40s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %zu duplicate vertices, %zu levels of detail, %zu meshlets, %.3fs\n", "", report.before.acmr(),
+                   report.after.acmr(), report.before.atvr(), report.after.atvr(), report.duplicateVertices, report.lods, report.meshlets, report.seconds);
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+// Compares tinyobj::LoadObj against ObjParser on the same files and checks that both produce identical shapes.
+//
+// usage: obj-parser-benchmark [--runs N] [--threads N] [file.obj ...]
+// Without files it benchmarks the bundled models, run it from the repository root.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Utility/ObjParser.h"
+#include "Utility/External/tiny_obj/tiny_obj_loader.h"
+
+namespace
+{
+    struct Result
+    {
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string err;
+        bool ok = false;
+    };
+
+    bool sameShapes(const Result& a, const Result& b)
+    {
+        if(a.ok != b.ok || a.shapes.size() != b.shapes.size() || a.materials.size() != b.materials.size())
+            return false;
+
+        for(size_t i = 0; i < a.shapes.size(); ++i)
+        {
+            const tinyobj::mesh_t& x = a.shapes[i].mesh;
+            const tinyobj::mesh_t& y = b.shapes[i].mesh;
+            if(a.shapes[i].name != b.shapes[i].name ||
+               x.positions != y.positions ||
+               x.normals != y.normals ||
+               x.texcoords != y.texcoords ||
+               x.indices != y.indices ||
+               x.num_vertices != y.num_vertices ||
+               x.material_ids != y.material_ids)
+                return false;
+        }
+        return true;
+    }
+
+    size_t triangleCount(const Result& result)
+    {
+        size_t count = 0;
+        for(const tinyobj::shape_t& shape : result.shapes)
+            count += shape.mesh.indices.size() / 3;
+        return count;
+    }
+
+    template <typename FUNCTION>
+    double bestOf(int runs, FUNCTION function)
+    {
+        double best = 1e30;
+        for(int i = 0; i < runs; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    int runs = 3;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = std::max(1, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            ObjParser::threadCount = static_cast<unsigned int>(std::max(0, atoi(argv[++i])));
+        else
+            files.push_back(argv[i]);
+    }
+
+    if(files.empty())
+    {
+        files = { "Assets/Models/dragon.obj", "Assets/Models/buddha.obj", "Assets/Models/bunny.obj",
+                  "Assets/Models/susanne.obj", "Assets/Models/teapot.obj", "Assets/Models/cornell.obj" };
+    }
+
+    printf("%-32s %10s %12s %12s %12s %8s %8s\n", "file", "MB", "triangles", "tinyobj (s)", "ObjParser (s)", "speedup", "match");
+
+    bool allMatch = true;
+    for(const std::string& file : files)
+    {
+        Result reference, native;
+        ObjParser::Stats stats;
+
+        double tinyobjSeconds = bestOf(runs, [&]()
+        {
+            reference = Result();
+            reference.ok = tinyobj::LoadObj(reference.shapes, reference.materials, reference.err, file.c_str());
+        });
+
+        double nativeSeconds = bestOf(runs, [&]()
+        {
+            native = Result();
+            native.ok = ObjParser::parse(file, native.shapes, native.materials, native.err, &stats);
+        });
+
+        bool match = sameShapes(reference, native);
+        allMatch = allMatch && match;
+
+        printf("%-32s %10.2f %12zu %12.4f %12.4f %7.2fx %8s\n",
+               file.c_str(), stats.bytes / (1024.0 * 1024.0), triangleCount(native),
+               tinyobjSeconds, nativeSeconds, tinyobjSeconds / std::max(nativeSeconds, 1e-9), match ? "yes" : "NO");
+        printf("    %u chunks, parse %.4fs, merge %.4fs, build %.4fs\n", stats.chunks, stats.parseSeconds, stats.mergeSeconds, stats.buildSeconds);
+
+        if(!native.ok)
+            fprintf(stderr, "%s", native.err.c_str());
+    }
+
+    return allMatch ? 0 : 1;
+}
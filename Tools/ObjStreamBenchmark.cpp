@@ -0,0 +1,270 @@
+// Streams .obj files through ObjParser::Stream and reports throughput and peak memory, optionally checking that the
+// chunks hold the same triangles ObjParser::parse produces. --generate writes a synthetic mesh of about the given size,
+// e.g. several gigabytes to check that memory use doesn't grow with the file.
+//
+// --self-test verifies the files with chunks of a few triangles, so every chunk and mesh boundary is crossed even on
+// small models, and streams each file twice at once to check that the spill files of the two streams don't collide.
+//
+// usage: obj-stream-benchmark [--chunk TRIANGLES] [--verify] [--self-test] [--generate file.obj MEGABYTES] [file.obj ...]
+// Without files it streams the bundled buddha, run it from the repository root.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "Utility/ObjParser.h"
+
+namespace
+{
+    typedef std::array<float, 9> Triangle;
+
+    double peakMegabytes()
+    {
+#ifdef _WIN32
+        return 0.0;
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+        return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+    }
+
+    //rotated so the smallest corner comes first, the stream reorders triangles but keeps their winding
+    Triangle canonical(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        const glm::vec3* corners[3] = { &a, &b, &c };
+        auto less = [](const glm::vec3& x, const glm::vec3& y) { return x.x != y.x ? x.x < y.x : (x.y != y.y ? x.y < y.y : x.z < y.z); };
+        int first = 0;
+        for(int i = 1; i < 3; ++i)
+            first = less(*corners[i], *corners[first]) ? i : first;
+
+        Triangle triangle;
+        for(int i = 0; i < 3; ++i)
+        {
+            const glm::vec3& corner = *corners[(first + i) % 3];
+            triangle[i * 3 + 0] = corner.x;
+            triangle[i * 3 + 1] = corner.y;
+            triangle[i * 3 + 2] = corner.z;
+        }
+        return triangle;
+    }
+
+    //a wavy height field with normals, rows of vertices followed by the faces that close them
+    bool generate(const std::string& path, double megabytes)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if(!file)
+            return false;
+
+        //about 170 bytes of text per vertex: its v and vn lines and two faces
+        size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(megabytes * 1024.0 * 1024.0 / 170.0)));
+        std::vector<char> buffer;
+        buffer.reserve(1 << 20);
+        char line[128];
+        auto write = [&](int length)
+        {
+            buffer.insert(buffer.end(), line, line + length);
+            if(buffer.size() > (1 << 20) - 128)
+            {
+                file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        };
+
+        write(snprintf(line, sizeof(line), "# %zu x %zu synthetic height field\ng synthetic\n", side, side));
+        for(size_t row = 0; row < side; ++row)
+        {
+            for(size_t column = 0; column < side; ++column)
+            {
+                float x = float(column) / float(side - 1) * 2.0f - 1.0f;
+                float z = float(row) / float(side - 1) * 2.0f - 1.0f;
+                float y = 0.1f * std::sin(x * 20.0f) * std::cos(z * 20.0f);
+                glm::vec3 normal = glm::normalize(glm::vec3(-2.0f * std::cos(x * 20.0f) * std::cos(z * 20.0f), 1.0f, 2.0f * std::sin(x * 20.0f) * std::sin(z * 20.0f)));
+                write(snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x, y, z));
+                write(snprintf(line, sizeof(line), "vn %.5f %.5f %.5f\n", normal.x, normal.y, normal.z));
+            }
+
+            if(row == 0)
+                continue;
+            for(size_t column = 0; column + 1 < side; ++column)
+            {
+                size_t a = (row - 1) * side + column + 1, b = a + 1, c = a + side, d = c + 1;
+                write(snprintf(line, sizeof(line), "f %zu//%zu %zu//%zu %zu//%zu\n", a, a, c, c, b, b));
+                write(snprintf(line, sizeof(line), "f %zu//%zu %zu//%zu %zu//%zu\n", b, b, c, c, d, d));
+            }
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        return static_cast<bool>(file);
+    }
+
+    bool stream(const std::string& path, std::vector<Triangle>* triangles)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        ObjParser::Stream stream;
+        std::string err;
+        if(!stream.open(path, VertexFormat::Full(), err))
+        {
+            printf("%s: %s", path.c_str(), err.c_str());
+            return false;
+        }
+
+        ObjParser::Stream::Chunk chunk;
+        size_t meshes = 0;
+        size_t largestChunk = 0;
+        while(stream.next(chunk))
+        {
+            meshes += chunk.lastOfMesh ? 1 : 0;
+            largestChunk = std::max(largestChunk, chunk.vertices.size() + chunk.indices.size() * sizeof(unsigned int));
+            if(triangles == nullptr)
+                continue;
+
+            //Full() starts every vertex with its position as three floats
+            auto position = [&chunk](unsigned int index)
+            {
+                glm::vec3 position;
+                memcpy(&position, &chunk.vertices[index * VertexFormat::Full().stride()], sizeof(glm::vec3));
+                return position;
+            };
+            for(size_t i = 0; i + 2 < chunk.indices.size(); i += 3)
+                triangles->push_back(canonical(position(chunk.indices[i]), position(chunk.indices[i + 1]), position(chunk.indices[i + 2])));
+        }
+
+        if(!stream.error().empty())
+        {
+            printf("%s: %s", path.c_str(), stream.error().c_str());
+            return false;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        const ObjParser::Stream::Stats& stats = stream.getStats();
+        printf("%s: %.1f MB, %zu meshes, %zu chunks, %zu triangles, %zu vertices\n", path.c_str(), stats.bytes / (1024.0 * 1024.0),
+               meshes, stats.chunks, stats.triangles, stats.vertices);
+        printf("  spill %.3f s (%.1f MB), total %.3f s, %.1f MB/s, largest chunk %.2f MB, peak memory %.1f MB\n", stats.spillSeconds,
+               stats.spilledBytes / (1024.0 * 1024.0), seconds, stats.bytes / (1024.0 * 1024.0) / seconds, largestChunk / (1024.0 * 1024.0), peakMegabytes());
+        return true;
+    }
+
+    bool verify(const std::string& path)
+    {
+        std::vector<Triangle> streamed;
+        if(!stream(path, &streamed))
+            return false;
+
+        std::vector<MeshData> meshes;
+        std::vector<tinyobj::material_t> materials;
+        std::string err;
+        if(!ObjParser::parse(path, meshes, materials, err))
+        {
+            printf("%s: %s", path.c_str(), err.c_str());
+            return false;
+        }
+
+        std::vector<Triangle> parsed;
+        for(const MeshData& mesh : meshes)
+        {
+            for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+                parsed.push_back(canonical(mesh.vertexData[mesh.indices[i]].position, mesh.vertexData[mesh.indices[i + 1]].position, mesh.vertexData[mesh.indices[i + 2]].position));
+        }
+
+        std::sort(streamed.begin(), streamed.end());
+        std::sort(parsed.begin(), parsed.end());
+        bool same = streamed == parsed;
+        printf("  %s ObjParser::parse (%zu triangles)\n", same ? "same triangles as" : "DIFFERENT triangles than", parsed.size());
+        return same;
+    }
+
+    bool selfTest(const std::string& path)
+    {
+        const size_t chunkTriangles = ObjParser::Stream::chunkTriangles;
+        bool ok = true;
+
+        //two streams of one file are open at once, as when two loads of a model overlap
+        ObjParser::Stream first, second;
+        std::string err;
+        if(!first.open(path, VertexFormat::Full(), err) || !second.open(path, VertexFormat::Full(), err))
+        {
+            printf("%s: %s", path.c_str(), err.c_str());
+            return false;
+        }
+        ObjParser::Stream::Chunk chunk;
+        while(first.next(chunk) && second.next(chunk))
+            ;
+        while(first.next(chunk) || second.next(chunk))
+            ;
+        bool same = first.error().empty() && second.error().empty() && first.getStats().triangles == second.getStats().triangles;
+        printf("%s: two streams open at once %s (%zu triangles)\n", path.c_str(), same ? "agree" : "DISAGREE", first.getStats().triangles);
+        ok = same && ok;
+        first.close();
+        second.close();
+
+        for(size_t triangles : { 1, 7, 256 })
+        {
+            ObjParser::Stream::chunkTriangles = triangles;
+            printf("chunks of %zu triangles\n", triangles);
+            ok = verify(path) && ok;
+        }
+        ObjParser::Stream::chunkTriangles = chunkTriangles;
+        return ok;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bool check = false;
+    bool test = false;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--chunk") == 0 && i + 1 < argc)
+        {
+            ObjParser::Stream::chunkTriangles = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        }
+        else if(strcmp(argv[i], "--verify") == 0)
+        {
+            check = true;
+        }
+        else if(strcmp(argv[i], "--self-test") == 0)
+        {
+            test = true;
+        }
+        else if(strcmp(argv[i], "--generate") == 0 && i + 2 < argc)
+        {
+            std::string path = argv[++i];
+            double megabytes = atof(argv[++i]);
+            printf("Generating %s (%.0f MB)...\n", path.c_str(), megabytes);
+            if(!generate(path, megabytes))
+            {
+                printf("Cannot write %s\n", path.c_str());
+                return 1;
+            }
+            files.push_back(path);
+        }
+        else
+        {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if(files.empty())
+        files.push_back("Assets/Models/buddha.obj");
+
+    bool ok = true;
+    for(const std::string& file : files)
+        ok = (test ? selfTest(file) : check ? verify(file) : stream(file, nullptr)) && ok;
+    return ok ? 0 : 1;
+}
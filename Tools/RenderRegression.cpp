@@ -0,0 +1,546 @@
+// Renders every stock scene in every Graphics::RenderingMode from fixed cameras without a window and compares the images
+// with stored baselines by PSNR and SSIM, and the pass times with stored budgets, writing a report as JSON.
+//
+// usage: render-regression [--baselines dir] [--update] [--out dir] [--scene name] [--width N] [--height N]
+//                          [--min-psnr dB] [--min-ssim S] [--tolerance T] [--software] [--cd dir]
+// The cameras are the scene's fly-through at its start and half way, see Scene::getFlyThrough. Baselines are binary PPM
+// files named scene-mode-viewN.ppm, the budgets one budgets.csv of case, pass and milliseconds, all in --baselines.
+// --update writes the baselines and budgets from this run instead of comparing. A pass is over budget when it takes longer
+// than its budget times 1 + --tolerance plus TIME_SLACK_MILLISECONDS, budgets are only compared on the renderer they were
+// measured on. The report goes to --out/report.json, next to the images of the cases that failed.
+// A case without a baseline image is unseeded rather than failed, a pass without a budget too. The baselines and budgets
+// aren't generated by the build: seed them once on a Mac with the renderer they are meant for with
+//     render-regression --update
+// and commit the --baselines directory (RegressionBaselines by default). Budgets of another renderer aren't compared.
+// Exits with 1 if a case failed, 2 if none failed but some are unseeded. --software and --cd as for headless-benchmark.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OpenGL_Includes.h"
+#include "Graphic/Graphics.h"
+#include "Graphic/GpuProfiler.h"
+#include "Graphic/OffscreenContext.h"
+#include "Graphic/FBO/FBO_2D.h"
+#include "Graphic/Material/MaterialStore.h"
+#include "Scene/ScenePack.h"
+#include "Scene/SceneGraph.h"
+#include "Scene/SceneSnapshot.h"
+#include "Time/FrameRate.h"
+#include "Utility/AssetLoader.h"
+
+namespace
+{
+    //frames rendered before measuring, so voxelization and mipmaps settle, then the frames whose median is compared
+    const unsigned int SETTLE_FRAMES = 3;
+    const unsigned int TIMED_FRAMES = 10;
+
+    //timer resolution and scheduling noise matter more than the tolerance for passes well under a millisecond
+    const double TIME_SLACK_MILLISECONDS = 0.1;
+
+    const unsigned int VIEWS = 2;
+
+    const char* const MODE_NAMES[] = { "voxel-visualization", "cone-tracing", "depth-layer-0", "depth-layer-1", "depth-layer-2", "depth-layer-3" };
+    static_assert(sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]) == static_cast<size_t>(Graphics::RenderingMode::RENDER_MODE_TOTAL),
+                  "a name per rendering mode");
+
+    struct Settings
+    {
+        std::string baselines = "RegressionBaselines";
+        std::string out = "render-regression";
+        std::string scene; // empty is every stock scene
+        unsigned int width = 256;
+        unsigned int height = 192;
+        double minPsnr = 30.0;
+        double minSsim = 0.97;
+        double tolerance = 0.2;
+        bool update = false;
+        bool software = false;
+    };
+
+    struct Image
+    {
+        unsigned int width = 0, height = 0;
+        std::vector<unsigned char> rgb; // rows top to bottom
+    };
+
+    bool writePpm(const std::string& path, const Image& image)
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        if(file == nullptr)
+            return false;
+        fprintf(file, "P6\n%u %u\n255\n", image.width, image.height);
+        fwrite(image.rgb.data(), 1, image.rgb.size(), file);
+        return fclose(file) == 0;
+    }
+
+    bool readPpm(const std::string& path, Image& image)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if(file == nullptr)
+            return false;
+        unsigned int maxValue = 0;
+        bool read = fscanf(file, "P6 %u %u %u", &image.width, &image.height, &maxValue) == 3 && maxValue == 255 && fgetc(file) != EOF;
+        if(read)
+        {
+            image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+            read = fread(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+        }
+        fclose(file);
+        return read;
+    }
+
+    Image readFramebuffer(unsigned int width, unsigned int height)
+    {
+        Image image;
+        image.width = width;
+        image.height = height;
+        image.rgb.resize(static_cast<size_t>(width) * height * 3);
+        std::vector<unsigned char> rows(image.rgb.size());
+        {
+            FBO_2D::Commands commands(FBO_2D::getDefault().get());
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rows.data());
+        }
+
+        //GL rows start at the bottom
+        size_t stride = static_cast<size_t>(width) * 3;
+        for(unsigned int y = 0; y < height; ++y)
+            memcpy(&image.rgb[y * stride], &rows[(height - 1 - y) * stride], stride);
+        return image;
+    }
+
+    double psnr(const Image& a, const Image& b)
+    {
+        double squaredError = 0.0;
+        for(size_t i = 0; i < a.rgb.size(); ++i)
+        {
+            double difference = static_cast<double>(a.rgb[i]) - b.rgb[i];
+            squaredError += difference * difference;
+        }
+        if(squaredError == 0.0)
+            return 100.0; // identical, capped so the report stays valid JSON
+        return std::min(100.0, 10.0 * std::log10(255.0 * 255.0 * a.rgb.size() / squaredError));
+    }
+
+    //mean SSIM of the luminance over 8x8 windows, 4 pixels apart
+    double ssim(const Image& a, const Image& b)
+    {
+        const unsigned int WINDOW = 8, STEP = 4;
+        const double C1 = (0.01 * 255.0) * (0.01 * 255.0), C2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+        auto luminance = [](const Image& image)
+        {
+            std::vector<double> values(static_cast<size_t>(image.width) * image.height);
+            for(size_t i = 0; i < values.size(); ++i)
+                values[i] = 0.299 * image.rgb[i * 3] + 0.587 * image.rgb[i * 3 + 1] + 0.114 * image.rgb[i * 3 + 2];
+            return values;
+        };
+        std::vector<double> x = luminance(a), y = luminance(b);
+
+        double total = 0.0;
+        size_t windows = 0;
+        for(unsigned int top = 0; top + WINDOW <= a.height; top += STEP)
+        {
+            for(unsigned int left = 0; left + WINDOW <= a.width; left += STEP)
+            {
+                double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumYY = 0.0, sumXY = 0.0;
+                for(unsigned int row = top; row < top + WINDOW; ++row)
+                {
+                    for(unsigned int column = left; column < left + WINDOW; ++column)
+                    {
+                        double valueX = x[row * a.width + column], valueY = y[row * a.width + column];
+                        sumX += valueX;
+                        sumY += valueY;
+                        sumXX += valueX * valueX;
+                        sumYY += valueY * valueY;
+                        sumXY += valueX * valueY;
+                    }
+                }
+                const double n = WINDOW * WINDOW;
+                double meanX = sumX / n, meanY = sumY / n;
+                double varianceX = sumXX / n - meanX * meanX, varianceY = sumYY / n - meanY * meanY;
+                double covariance = sumXY / n - meanX * meanY;
+                total += ((2.0 * meanX * meanY + C1) * (2.0 * covariance + C2)) /
+                         ((meanX * meanX + meanY * meanY + C1) * (varianceX + varianceY + C2));
+                ++windows;
+            }
+        }
+        return windows == 0 ? 1.0 : total / windows;
+    }
+
+    double median(std::vector<double> values)
+    {
+        if(values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for(char c : text)
+        {
+            if(c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    //case name to pass name to milliseconds, measured on renderer
+    struct Budgets
+    {
+        std::string renderer;
+        std::map<std::string, std::map<std::string, double>> cases;
+    };
+
+    bool readBudgets(const std::string& path, Budgets& budgets)
+    {
+        std::ifstream file(path);
+        if(!file)
+            return false;
+        const std::string RENDERER = "# renderer: ";
+        std::string line;
+        while(std::getline(file, line))
+        {
+            if(line.compare(0, RENDERER.size(), RENDERER) == 0)
+                budgets.renderer = line.substr(RENDERER.size());
+            if(line.empty() || line[0] == '#')
+                continue;
+
+            //pass names may hold commas, the case is before the first and the time after the last
+            size_t first = line.find(','), last = line.rfind(',');
+            if(first == std::string::npos || first == last)
+                continue;
+            budgets.cases[line.substr(0, first)][line.substr(first + 1, last - first - 1)] = atof(line.c_str() + last + 1);
+        }
+        return true;
+    }
+
+    bool writeBudgets(const std::string& path, const Budgets& budgets)
+    {
+        FILE* file = fopen(path.c_str(), "w");
+        if(file == nullptr)
+            return false;
+        fprintf(file, "# renderer: %s\n# case,pass,milliseconds\n", budgets.renderer.c_str());
+        for(const auto& test : budgets.cases)
+        {
+            for(const auto& pass : test.second)
+                fprintf(file, "%s,%s,%.4f\n", test.first.c_str(), pass.first.c_str(), pass.second);
+        }
+        return fclose(file) == 0;
+    }
+
+    struct PassResult
+    {
+        std::string name;
+        double milliseconds = 0.0;
+        double budget = 0.0; // 0 if there is none
+        const char* status = "skipped"; // ok, over, skipped, unseeded or new
+    };
+
+    struct CaseResult
+    {
+        std::string name;
+        const char* imageStatus = "unseeded"; // ok, failed, unseeded, mismatch, updated or unwritten
+        double psnr = 0.0, ssim = 0.0;
+        std::vector<PassResult> passes;
+        bool failed = false;
+        bool unseeded = false; // no baseline image to compare with, not a failure
+    };
+
+    bool writeReport(const std::string& path, const Settings& settings, const std::string& renderer, bool timingCompared,
+                     const std::vector<CaseResult>& results)
+    {
+        FILE* file = fopen(path.c_str(), "w");
+        if(file == nullptr)
+            return false;
+
+        size_t failed = std::count_if(results.begin(), results.end(), [](const CaseResult& result) { return result.failed; });
+        size_t unseeded = std::count_if(results.begin(), results.end(), [](const CaseResult& result) { return result.unseeded; });
+        fprintf(file, "{\n  \"renderer\": \"%s\",\n  \"width\": %u,\n  \"height\": %u,\n", escape(renderer).c_str(), settings.width, settings.height);
+        fprintf(file, "  \"thresholds\": {\"minPsnr\": %.2f, \"minSsim\": %.4f, \"tolerance\": %.3f, \"slackMilliseconds\": %.3f},\n",
+                settings.minPsnr, settings.minSsim, settings.tolerance, TIME_SLACK_MILLISECONDS);
+        fprintf(file, "  \"update\": %s,\n  \"timingCompared\": %s,\n  \"passed\": %s,\n  \"failedCases\": %zu,\n  \"unseededCases\": %zu,\n  \"cases\": [",
+                settings.update ? "true" : "false", timingCompared ? "true" : "false", failed == 0 ? "true" : "false", failed, unseeded);
+        for(size_t i = 0; i < results.size(); ++i)
+        {
+            const CaseResult& result = results[i];
+            fprintf(file, "%s\n    {\"name\": \"%s\", \"passed\": %s, \"image\": {\"status\": \"%s\", \"psnr\": %.3f, \"ssim\": %.5f}, \"passes\": [",
+                    i == 0 ? "" : ",", escape(result.name).c_str(), result.failed ? "false" : "true", result.imageStatus, result.psnr, result.ssim);
+            for(size_t j = 0; j < result.passes.size(); ++j)
+            {
+                const PassResult& pass = result.passes[j];
+                fprintf(file, "%s\n      {\"name\": \"%s\", \"milliseconds\": %.4f, \"budget\": %.4f, \"status\": \"%s\"}", j == 0 ? "" : ",",
+                        escape(pass.name).c_str(), pass.milliseconds, pass.budget, pass.status);
+            }
+            fprintf(file, "\n    ]}");
+        }
+        fprintf(file, "\n  ]\n}\n");
+        return fclose(file) == 0;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    Settings settings;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--baselines") == 0 && i + 1 < argc)
+            settings.baselines = argv[++i];
+        else if(strcmp(argv[i], "--update") == 0)
+            settings.update = true;
+        else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            settings.out = argv[++i];
+        else if(strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            settings.scene = argv[++i];
+        else if(strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            settings.width = static_cast<unsigned int>(std::max(8, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            settings.height = static_cast<unsigned int>(std::max(8, atoi(argv[++i])));
+        else if(strcmp(argv[i], "--min-psnr") == 0 && i + 1 < argc)
+            settings.minPsnr = atof(argv[++i]);
+        else if(strcmp(argv[i], "--min-ssim") == 0 && i + 1 < argc)
+            settings.minSsim = atof(argv[++i]);
+        else if(strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            settings.tolerance = std::max(0.0, atof(argv[++i]));
+        else if(strcmp(argv[i], "--software") == 0)
+            settings.software = true;
+        else if(strcmp(argv[i], "--cd") == 0 && i + 1 < argc)
+        {
+            if(chdir(argv[++i]) != 0)
+            {
+                printf("can't change to %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+        {
+            printf("unknown argument %s, see the top of RenderRegression.cpp\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> scenes;
+    for(const char* name : STOCK_SCENES)
+    {
+        if(settings.scene.empty() || settings.scene == name)
+            scenes.push_back(name);
+    }
+    if(scenes.empty())
+    {
+        printf("unknown scene %s, one of glass, cornell, dragon, multiple\n", settings.scene.c_str());
+        return 1;
+    }
+
+    mkdir(settings.out.c_str(), 0755);
+    if(settings.update)
+        mkdir(settings.baselines.c_str(), 0755);
+
+    OffscreenContext context;
+    if(!context.create(settings.width, settings.height, settings.software))
+    {
+        printf("no offscreen context: %s\n", context.getError().c_str());
+        return 1;
+    }
+    std::string renderer = context.getRenderer();
+    printf("%zu scenes, %ux%u, %s\n", scenes.size(), settings.width, settings.height, renderer.c_str());
+
+    //the budgets of scenes not run this time are kept on update
+    const std::string budgetsPath = settings.baselines + "/budgets.csv";
+    Budgets budgets;
+    bool haveBudgets = readBudgets(budgetsPath, budgets);
+    bool timingCompared = !settings.update && haveBudgets && budgets.renderer == renderer;
+    if(settings.update && budgets.renderer != renderer)
+        budgets.cases.clear();
+    budgets.renderer = renderer;
+    if(!settings.update && !timingCompared)
+        printf(haveBudgets ? "budgets were measured on %s, timings not compared\n" : "no budgets in %s, timings not compared, seed them with --update\n",
+               haveBudgets ? budgets.renderer.c_str() : budgetsPath.c_str());
+
+    MaterialStore::getInstance();
+    FrameRate::initialized = true;
+    FrameRate::deltaTime = 1.0 / 60.0;
+    FrameRate::framesPerSecond = 60.0;
+    FrameRate::time = 0.0;
+
+    //every kept frame is filtered by number below, the profiler counts frames across all cases
+    GpuProfiler& profiler = GpuProfiler::getInstance();
+    GpuProfiler::historyFrames = scenes.size() * VIEWS * static_cast<size_t>(Graphics::RenderingMode::RENDER_MODE_TOTAL) * (SETTLE_FRAMES + TIMED_FRAMES);
+    unsigned long long frameNumber = 0;
+
+    std::vector<CaseResult> results;
+    SceneSnapshot snapshot;
+    for(const std::string& sceneName : scenes)
+    {
+        std::unique_ptr<Scene> scene(createStockScene(sceneName));
+        std::unique_ptr<Graphics> graphics(new Graphics());
+        graphics->init(settings.width, settings.height);
+        scene->init(settings.width, settings.height);
+        AssetLoader::getInstance().finish();
+
+        CameraPath path = scene->getFlyThrough();
+        for(unsigned int view = 0; view < VIEWS; ++view)
+        {
+            //without a window or a replay the controller leaves the camera alone
+            if(!path.empty())
+            {
+                path.evaluate(path.getDuration() * view / VIEWS, scene->renderingCamera->position, scene->renderingCamera->forward);
+                scene->renderingCamera->updateViewMatrix();
+            }
+
+            for(unsigned int modeIndex = 0; modeIndex < static_cast<unsigned int>(Graphics::RenderingMode::RENDER_MODE_TOTAL); ++modeIndex)
+            {
+                Graphics::RenderingMode mode = static_cast<Graphics::RenderingMode>(modeIndex);
+                CaseResult result;
+                result.name = sceneName + "-" + MODE_NAMES[modeIndex] + "-view" + std::to_string(view);
+
+                unsigned long long firstTimed = frameNumber + SETTLE_FRAMES;
+                std::vector<double> frameMilliseconds;
+                for(unsigned int frame = 0; frame < SETTLE_FRAMES + TIMED_FRAMES; ++frame, ++frameNumber)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    scene->update();
+                    SceneGraph::getInstance().update();
+                    snapshot.capture(*scene);
+                    profiler.beginFrame();
+                    graphics->render(snapshot, settings.width, settings.height, mode);
+                    profiler.endFrame();
+                    AssetLoader::getInstance().update();
+                    glFinish();
+                    if(frame >= SETTLE_FRAMES)
+                        frameMilliseconds.push_back(secondsSince(start) * 1000.0);
+                }
+
+                //medians of the timed frames, passes summed over depths under the same name
+                std::map<std::string, std::vector<double>> passTimes;
+                std::vector<std::string> passOrder;
+                profiler.finish();
+                for(const GpuProfiler::FrameTimes& frame : profiler.getHistory())
+                {
+                    if(frame.number < firstTimed || frame.number >= frameNumber)
+                        continue;
+                    std::map<std::string, double> sums;
+                    for(const GpuProfiler::Pass& pass : frame.passes)
+                        sums[pass.name] += pass.milliseconds;
+                    for(const GpuProfiler::Pass& pass : frame.passes)
+                    {
+                        std::vector<double>& values = passTimes[pass.name];
+                        if(values.empty())
+                            passOrder.push_back(pass.name);
+                        if(sums.count(pass.name) != 0)
+                        {
+                            values.push_back(sums[pass.name]);
+                            sums.erase(pass.name);
+                        }
+                    }
+                }
+                passTimes["CPU frame"] = frameMilliseconds;
+                passOrder.push_back("CPU frame");
+
+                std::map<std::string, double>& caseBudgets = budgets.cases[result.name];
+                for(const std::string& name : passOrder)
+                {
+                    PassResult pass;
+                    pass.name = name;
+                    pass.milliseconds = median(passTimes[name]);
+                    auto budget = caseBudgets.find(name);
+                    if(settings.update)
+                    {
+                        caseBudgets[name] = pass.milliseconds;
+                        pass.budget = pass.milliseconds;
+                        pass.status = "new";
+                    }
+                    else if(timingCompared && budget != caseBudgets.end())
+                    {
+                        pass.budget = budget->second;
+                        pass.status = pass.milliseconds > pass.budget * (1.0 + settings.tolerance) + TIME_SLACK_MILLISECONDS ? "over" : "ok";
+                        result.failed = result.failed || strcmp(pass.status, "over") == 0;
+                    }
+                    else if(timingCompared)
+                    {
+                        pass.status = "unseeded";
+                    }
+                    result.passes.push_back(pass);
+                }
+
+                Image actual = readFramebuffer(settings.width, settings.height);
+                const std::string baselinePath = settings.baselines + "/" + result.name + ".ppm";
+                Image baseline;
+                if(settings.update)
+                {
+                    result.imageStatus = writePpm(baselinePath, actual) ? "updated" : "unwritten";
+                    result.failed = strcmp(result.imageStatus, "unwritten") == 0;
+                }
+                else if(!readPpm(baselinePath, baseline))
+                {
+                    result.imageStatus = "unseeded";
+                    result.unseeded = true;
+                }
+                else if(baseline.width != actual.width || baseline.height != actual.height)
+                {
+                    result.imageStatus = "mismatch";
+                    result.failed = true;
+                }
+                else
+                {
+                    result.psnr = psnr(actual, baseline);
+                    result.ssim = ssim(actual, baseline);
+                    bool passed = result.psnr >= settings.minPsnr && result.ssim >= settings.minSsim;
+                    result.imageStatus = passed ? "ok" : "failed";
+                    result.failed = result.failed || !passed;
+                }
+                //unseeded cases leave their image too, it is what --update would store
+                if((result.failed || result.unseeded) && !settings.update)
+                    writePpm(settings.out + "/" + result.name + ".ppm", actual);
+
+                printf("  %-40s %-8s %7.2f dB %7.4f SSIM %8.3f ms %s\n", result.name.c_str(), result.imageStatus, result.psnr, result.ssim,
+                       median(frameMilliseconds), result.failed ? "FAILED" : result.unseeded ? "unseeded" : "passed");
+                results.push_back(std::move(result));
+            }
+        }
+
+        //the GL objects of the scene go before the next one
+        scene.reset();
+        graphics.reset();
+    }
+
+    bool written = writeReport(settings.out + "/report.json", settings, renderer, timingCompared, results);
+    if(settings.update)
+        written = writeBudgets(budgetsPath, budgets) && written;
+
+    size_t failed = std::count_if(results.begin(), results.end(), [](const CaseResult& result) { return result.failed; });
+    size_t unseeded = std::count_if(results.begin(), results.end(), [](const CaseResult& result) { return result.unseeded; });
+    printf("%zu of %zu cases failed, %zu unseeded, %s %s/report.json\n", failed, results.size(), unseeded, written ? "wrote" : "can't write",
+           settings.out.c_str());
+    if(unseeded != 0)
+        printf("no baseline for %zu cases in %s, seed them with --update on the renderer they are meant for\n", unseeded, settings.baselines.c_str());
+
+    //meshes only the store and the loader hold are freed while the context is still there
+    profiler.clear();
+    AssetLoader::getInstance().clear();
+    AssetStore::getInstance().clear();
+    context.destroy();
+    if(failed != 0 || !written)
+        return 1;
+    return unseeded != 0 ? 2 : 0;
+}